@@ -0,0 +1,87 @@
+# Training workload for TACTILE_PGO=GENERATE builds; run through the
+# pgo-train target, which passes BIN, RUN, WORK, PROFILE_DIR, LLVM_PROFDATA
+# and WITH_ZMQ. Every step replays the SimData run RUN through one part of
+# the pipeline, so the profile reflects the recorded traffic rather than
+# synthetic input. haptic_tx and standalone_sim have no way to stop on
+# their own and are left out; the USE build optimises them without a
+# profile.
+
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+# Profiles of an older build would be merged with this one
+file(GLOB stale ${PROFILE_DIR}/*.gcda ${PROFILE_DIR}/*.profraw ${PROFILE_DIR}/*.profdata)
+if(stale)
+    file(REMOVE ${stale})
+endif()
+# Clang writes one raw profile per process
+set(ENV{LLVM_PROFILE_FILE} ${PROFILE_DIR}/tactile-%p.profraw)
+
+# train(<description> TIMEOUT <s> COMMAND <program> <args>... [COMMAND ...])
+# Several COMMANDs run at the same time, for the live legs; execute_process
+# pipes each one's output into the next, so the receiver goes last.
+function(train description)
+    cmake_parse_arguments(arg "" "TIMEOUT" "" ${ARGN})
+    message(STATUS "pgo-train: ${description}")
+    string(MAKE_C_IDENTIFIER "${description}" log)
+    string(REPLACE "COMMAND;" "COMMAND;${BIN}/" commands "${arg_UNPARSED_ARGUMENTS}")
+    execute_process(${commands}
+        WORKING_DIRECTORY ${WORK}
+        TIMEOUT ${arg_TIMEOUT}
+        RESULTS_VARIABLE results
+        OUTPUT_FILE ${WORK}/${log}.log
+        ERROR_VARIABLE errors)
+    foreach(result IN LISTS results)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "pgo-train: ${description} failed (${results})\n${errors}")
+        endif()
+    endforeach()
+endfunction()
+
+# Offline: simulation, codecs and batch kernels on the run and on its .tct
+train("cross-layer simulation" TIMEOUT 300
+    COMMAND cross_layer_sim --offline --run ${RUN})
+train("parameter sweep" TIMEOUT 300
+    COMMAND sim_sweep --run ${RUN} --threshold 0.05,0.2 --delay-ms 1,20 --loss 0,0.01)
+train("scheduler" TIMEOUT 300
+    COMMAND sched_bench --run ${RUN})
+train("trace conversion" TIMEOUT 120
+    COMMAND trace_convert ${RUN} ${WORK}/run.tct)
+foreach(trace ${RUN} ${WORK}/run.tct)
+    train("dead-band codecs on ${trace}" TIMEOUT 120
+        COMMAND codec_eval --run ${trace})
+    train("contact codec on ${trace}" TIMEOUT 120
+        COMMAND contact_eval --run ${trace})
+endforeach()
+train("batch kernels" TIMEOUT 300
+    COMMAND batch_bench --run ${WORK}/run.tct --passes 20)
+
+if(WITH_ZMQ)
+    # Relay workers, then the run replayed live over shm into the monitor
+    # and the recorder, and the capture exported back into a run
+    train("relay pipeline" TIMEOUT 300
+        COMMAND relay_bench --messages 400000)
+    set(replay COMMAND sim_replay --run ${WORK}/run.tct --transport shm --sources tactile,video
+        --tactile-bind shm://tactile-5556 --rate 20000 --loops 3)
+    train("live replay into standalone_monitor" TIMEOUT 120
+        ${replay}
+        COMMAND standalone_monitor --transport shm --duration-s 8 --report-s 2)
+    train("live replay into stream_recorder" TIMEOUT 120
+        ${replay}
+        COMMAND stream_recorder --transport shm --streams tactile:5556,video:5566
+        --duration-s 8 --out ${WORK}/capture)
+    train("capture export" TIMEOUT 120
+        COMMAND capture_export --capture ${WORK}/capture --out ${WORK}/exported)
+    train("pipeline benchmark" TIMEOUT 300
+        COMMAND pipeline_bench --transports shm --rates 10000,0 --repeats 2 --min-time-ms 50
+        --point-ms 300 --point-repeats 1 --round-trips 500)
+endif()
+
+if(LLVM_PROFDATA)
+    file(GLOB raw ${PROFILE_DIR}/*.profraw)
+    execute_process(COMMAND ${LLVM_PROFDATA} merge -o ${PROFILE_DIR}/default.profdata ${raw}
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "pgo-train: llvm-profdata merge failed")
+    endif()
+endif()
+message(STATUS "pgo-train: profile in ${PROFILE_DIR}; reconfigure with -DTACTILE_PGO=USE and rebuild")
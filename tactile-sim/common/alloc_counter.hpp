@@ -0,0 +1,81 @@
+// Per-thread heap allocation counter used to check that the receive path
+// stays allocation-free in steady state.
+//
+// Exactly one translation unit per program defines
+// TACTILE_ALLOC_COUNTER_IMPL before including this header; that replaces the
+// global operator new/delete with counting versions.
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace tactile {
+
+inline thread_local uint64_t threadAllocations = 0;
+
+// Counts allocations made by the calling thread after arm().
+class AllocProbe {
+public:
+    void arm() {
+        base = threadAllocations;
+        armed = true;
+    }
+
+    bool isArmed() const {
+        return armed;
+    }
+
+    uint64_t allocations() const {
+        return armed ? threadAllocations - base : 0;
+    }
+
+private:
+    uint64_t base = 0;
+    bool armed = false;
+};
+
+} // namespace tactile
+
+#ifdef TACTILE_ALLOC_COUNTER_IMPL
+
+// Optimised builds inline the replacement new into these and GCC then
+// reports its malloc as a mismatch for free
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    tactile::threadAllocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+// Asynchronous logger for per-packet output.
+//
+// The hot path copies a fixed-size binary record (a formatter function plus
+// its arguments) into a preallocated SPSC ring and returns. A background
+// thread formats the records in batches and writes them with one flush per
+// batch instead of one per line. If the ring is full the record is dropped
+// and counted; the caller never blocks on terminal I/O.
+//
+// Each AsyncLogger accepts records from a single thread. Call flush() before
+// writing to std::cout directly so the two outputs stay in order.
+#pragma once
+
+#include "options.hpp"
+#include "spsc_ring.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace tactile {
+
+enum class LogLevel : uint8_t {
+    Debug,
+    Info,
+    Warn,   // Warn and Error go to stderr
+    Error,
+    Off,
+};
+
+inline bool parseLogLevel(const std::string& name, LogLevel& out) {
+    static const char* names[] = { "debug", "info", "warn", "error", "off" };
+    for (int i = 0; i < 5; i++) {
+        if (name == names[i]) {
+            out = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Arguments captured on the hot path. Text is truncated to fit.
+struct LogArgs {
+    int64_t i[3];
+    double d[4];
+    uint16_t textLength;
+    char text[62];
+
+    void setText(std::string_view s) {
+        textLength = static_cast<uint16_t>(std::min(s.size(), sizeof(text)));
+        std::memcpy(text, s.data(), textLength);
+    }
+
+    std::string_view textView() const {
+        return std::string_view(text, textLength);
+    }
+};
+
+// Formats one record into `out` (snprintf semantics, no trailing newline).
+// Runs on the writer thread.
+using LogFormatter = int (*)(char* out, size_t size, const LogArgs& args);
+
+struct LogRecord {
+    LogFormatter format;
+    LogLevel level;
+    LogArgs args;
+};
+
+class AsyncLogger {
+public:
+    static constexpr size_t ringCapacity = 4096;
+
+    explicit AsyncLogger(LogLevel level = LogLevel::Info,
+                         std::chrono::microseconds idleWait = std::chrono::milliseconds(1))
+        : minLevel(level), idleWait(idleWait), ring(std::make_unique<Ring>()),
+          writer(&AsyncLogger::run, this) {}
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    ~AsyncLogger() {
+        stopping.store(true, std::memory_order_release);
+        writer.join();
+        if (uint64_t lost = dropped()) {
+            std::fprintf(stderr, "Logger dropped %llu records (ring full)\n",
+                         static_cast<unsigned long long>(lost));
+        }
+    }
+
+    bool enabled(LogLevel level) const {
+        return level >= minLevel && level != LogLevel::Off;
+    }
+
+    // Queues a record if `level` is enabled; `fill(LogArgs&)` only runs then.
+    template <typename Fill>
+    void log(LogLevel level, LogFormatter format, Fill fill) {
+        if (!enabled(level)) {
+            return;
+        }
+        LogRecord record;
+        record.format = format;
+        record.level = level;
+        record.args.textLength = 0;
+        fill(record.args);
+        if (ring->tryPush(record)) {
+            produced++;
+        } else {
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Blocks until everything queued so far has been written out.
+    void flush() {
+        while (written.load(std::memory_order_acquire) < produced) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    uint64_t dropped() const {
+        return droppedRecords.load(std::memory_order_relaxed);
+    }
+
+private:
+    using Ring = SpscRing<LogRecord, ringCapacity>;
+
+    void run() {
+        char line[256];
+        uint64_t done = 0;
+        LogRecord record;
+        while (true) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            bool any = false;
+            while (ring->tryPop(record)) {
+                int n = record.format(line, sizeof(line) - 1, record.args);
+                n = std::min(std::max(n, 0), static_cast<int>(sizeof(line) - 2));
+                line[n++] = '\n';
+                std::fwrite(line, 1, n, record.level >= LogLevel::Warn ? stderr : stdout);
+                done++;
+                any = true;
+            }
+            if (any) {
+                std::fflush(stdout);
+                std::fflush(stderr);
+                written.store(done, std::memory_order_release);
+            } else if (stop) {
+                return;
+            } else {
+                std::this_thread::sleep_for(idleWait);
+            }
+        }
+    }
+
+    LogLevel minLevel;
+    std::chrono::microseconds idleWait;
+    std::unique_ptr<Ring> ring;
+    uint64_t produced = 0;  // producer thread only
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> droppedRecords{0};
+    std::atomic<bool> stopping{false};
+    std::thread writer;  // last, so it starts after everything above
+};
+
+// Reads "--log-level debug|info|warn|error|off" (default info).
+inline LogLevel logLevelFromOptions(const Options& opts) {
+    LogLevel level = LogLevel::Info;
+    std::string name = opts.get("--log-level", "info");
+    if (!parseLogLevel(name, level)) {
+        std::cerr << "Unknown --log-level " << name << ", using info" << std::endl;
+    }
+    return level;
+}
+
+} // namespace tactile
@@ -0,0 +1,424 @@
+// Benchmark results in a machine-readable form (standalone/pipeline_bench),
+// read back as a baseline for the next run.
+//
+// A report is one JSON object:
+//
+//   {
+//     "format": "tactile-bench/1",
+//     "info": { "compiler": "...", "options": "...", ... },
+//     "results": [
+//       { "name": "parse.binary", "unit": "ns/op", "value": 3.1,
+//         "better": "lower", "spread": 0.02 },
+//       ...
+//     ]
+//   }
+//
+// "spread" is (max - min) / median over the repeats of that measurement,
+// so a comparison can tell noise from a real change. The reader accepts
+// exactly what the writer produces (plus any extra keys, which it skips);
+// it is not a general JSON parser.
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tactile {
+
+constexpr const char* benchFormat = "tactile-bench/1";
+
+struct BenchResult {
+    std::string name;
+    std::string unit;
+    double value = 0;
+    bool higherIsBetter = false;
+    double spread = 0;
+};
+
+struct BenchReport {
+    std::vector<std::pair<std::string, std::string>> info;
+    std::vector<BenchResult> results;
+
+    void add(const std::string& name, const std::string& unit, double value, bool higherIsBetter,
+             double spread = 0) {
+        results.push_back(BenchResult{ name, unit, value, higherIsBetter, spread });
+    }
+
+    const BenchResult* find(const std::string& name) const {
+        for (const BenchResult& r : results) {
+            if (r.name == name) {
+                return &r;
+            }
+        }
+        return nullptr;
+    }
+
+    std::string infoValue(const std::string& key) const {
+        for (const auto& entry : info) {
+            if (entry.first == key) {
+                return entry.second;
+            }
+        }
+        return "";
+    }
+
+    bool write(const std::string& path, std::string& error) const {
+        std::ofstream out(path);
+        if (!out) {
+            error = "cannot create " + path;
+            return false;
+        }
+        out << "{\n  \"format\": " << quote(benchFormat) << ",\n  \"info\": {";
+        for (size_t i = 0; i < info.size(); i++) {
+            out << (i ? ",\n    " : "\n    ") << quote(info[i].first) << ": " << quote(info[i].second);
+        }
+        out << (info.empty() ? "},\n" : "\n  },\n") << "  \"results\": [";
+        char number[32];
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            out << (i ? ",\n    " : "\n    ") << "{ \"name\": " << quote(r.name) << ", \"unit\": " << quote(r.unit);
+            std::snprintf(number, sizeof(number), "%.6g", std::isfinite(r.value) ? r.value : 0.0);
+            out << ", \"value\": " << number << ", \"better\": " << (r.higherIsBetter ? "\"higher\"" : "\"lower\"");
+            std::snprintf(number, sizeof(number), "%.4f", std::isfinite(r.spread) ? r.spread : 0.0);
+            out << ", \"spread\": " << number << " }";
+        }
+        out << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+        out.close();
+        if (!out) {
+            error = "cannot write " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool read(const std::string& path, std::string& error) {
+        std::ifstream in(path);
+        if (!in) {
+            error = "cannot open " + path;
+            return false;
+        }
+        std::stringstream text;
+        text << in.rdbuf();
+        Scanner s(text.str());
+        info.clear();
+        results.clear();
+        std::string format;
+        bool ok = s.object([&](const std::string& key) {
+            if (key == "format") {
+                return s.string(format);
+            }
+            if (key == "info") {
+                return s.object([&](const std::string& name) {
+                    std::string value;
+                    if (!s.string(value)) {
+                        return false;
+                    }
+                    info.emplace_back(name, value);
+                    return true;
+                });
+            }
+            if (key == "results") {
+                return s.array([&] {
+                    BenchResult r;
+                    std::string better;
+                    bool fine = s.object([&](const std::string& field) {
+                        if (field == "name") return s.string(r.name);
+                        if (field == "unit") return s.string(r.unit);
+                        if (field == "value") return s.number(r.value);
+                        if (field == "spread") return s.number(r.spread);
+                        if (field == "better") return s.string(better);
+                        return s.skip();
+                    });
+                    r.higherIsBetter = better == "higher";
+                    results.push_back(r);
+                    return fine && !r.name.empty();
+                });
+            }
+            return s.skip();
+        });
+        if (!ok) {
+            error = path + ": not a benchmark report (bad JSON near byte " + std::to_string(s.offset()) + ")";
+            return false;
+        }
+        if (format != benchFormat) {
+            error = path + ": format '" + format + "', expected " + benchFormat;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static std::string quote(const std::string& text) {
+        std::string out = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    class Scanner {
+    public:
+        explicit Scanner(std::string text) : text(std::move(text)) {}
+
+        size_t offset() const {
+            return pos;
+        }
+
+        // Calls member(key) with the scanner positioned at each value
+        template <typename Member>
+        bool object(Member&& member) {
+            if (!consume('{')) {
+                return false;
+            }
+            if (consume('}')) {
+                return true;
+            }
+            do {
+                std::string key;
+                if (!string(key) || !consume(':') || !member(key)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume('}');
+        }
+
+        template <typename Element>
+        bool array(Element&& element) {
+            if (!consume('[')) {
+                return false;
+            }
+            if (consume(']')) {
+                return true;
+            }
+            do {
+                if (!element()) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        }
+
+        bool string(std::string& out) {
+            if (!consume('"')) {
+                return false;
+            }
+            out.clear();
+            while (pos < text.size() && text[pos] != '"') {
+                char c = text[pos++];
+                if (c == '\\' && pos < text.size()) {
+                    c = text[pos++];
+                    if (c == 'u' && pos + 4 <= text.size()) {
+                        c = static_cast<char>(std::strtol(text.substr(pos, 4).c_str(), nullptr, 16));
+                        pos += 4;
+                    } else if (c == 'n') {
+                        c = '\n';
+                    } else if (c == 't') {
+                        c = '\t';
+                    }
+                }
+                out += c;
+            }
+            return pos++ < text.size();
+        }
+
+        bool number(double& out) {
+            space();
+            const char* start = text.c_str() + pos;
+            char* end = nullptr;
+            out = std::strtod(start, &end);
+            if (end == start) {
+                return false;
+            }
+            pos += size_t(end - start);
+            return true;
+        }
+
+        // Any value this reader has no use for
+        bool skip() {
+            space();
+            if (pos >= text.size()) {
+                return false;
+            }
+            switch (text[pos]) {
+                case '{': return object([this](const std::string&) { return skip(); });
+                case '[': return array([this] { return skip(); });
+                case '"': {
+                    std::string ignored;
+                    return string(ignored);
+                }
+                default: {
+                    for (const char* word : { "true", "false", "null" }) {
+                        if (text.compare(pos, std::strlen(word), word) == 0) {
+                            pos += std::strlen(word);
+                            return true;
+                        }
+                    }
+                    double ignored;
+                    return number(ignored);
+                }
+            }
+        }
+
+    private:
+        void space() {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+                pos++;
+            }
+        }
+
+        bool consume(char c) {
+            space();
+            if (pos < text.size() && text[pos] == c) {
+                pos++;
+                return true;
+            }
+            return false;
+        }
+
+        std::string text;
+        size_t pos = 0;
+    };
+};
+
+// Median and spread of a measurement repeated a few times
+struct BenchTiming {
+    double median = 0;
+    double spread = 0;  // (max - min) / median
+};
+
+inline BenchTiming summarizeRepeats(std::vector<double> values) {
+    BenchTiming t;
+    if (values.empty()) {
+        return t;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+    t.median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    t.spread = t.median != 0 ? (values.back() - values.front()) / std::fabs(t.median) : 0;
+    return t;
+}
+
+// Keeps the compiler from dropping a result nothing else reads
+template <typename T>
+inline void benchKeep(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// Nanoseconds per operation of `f`, which performs opsPerCall operations a
+// call: one untimed warm-up pass, then `repeats` passes of at least
+// minNs each, summarised by their median.
+template <typename F>
+BenchTiming timePerOp(F&& f, size_t opsPerCall, int repeats, int64_t minNs) {
+    using clock = std::chrono::steady_clock;
+    std::vector<double> perOp;
+    for (int r = -1; r < repeats; r++) {
+        uint64_t calls = 0;
+        const auto start = clock::now();
+        int64_t elapsed = 0;
+        do {
+            f();
+            calls++;
+            elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        } while (elapsed < minNs);
+        if (r >= 0) {
+            perOp.push_back(double(elapsed) / double(calls * opsPerCall));
+        }
+    }
+    return summarizeRepeats(perOp);
+}
+
+// Compares `current` with `baseline` result by result and prints one line
+// for each. A change counts once it is larger than `tolerance` (a fraction)
+// plus the spread of both measurements. Returns the number of regressions.
+inline size_t compareBench(std::ostream& out, const BenchReport& current, const BenchReport& baseline,
+                           double tolerance) {
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::defaultfloat << std::setprecision(5);
+    for (const auto& entry : current.info) {
+        const std::string before = baseline.infoValue(entry.first);
+        if (!before.empty() && before != entry.second) {
+            out << "Note: " << entry.first << " differs from the baseline (" << before << ")" << std::endl;
+        }
+    }
+    out << std::left << std::setw(40) << "Benchmark" << std::right
+        << std::setw(10) << "Unit"
+        << std::setw(13) << "Baseline"
+        << std::setw(13) << "Current"
+        << std::setw(9) << "Change"
+        << "  Verdict" << std::endl;
+    size_t regressions = 0, improvements = 0;
+    for (const BenchResult& r : current.results) {
+        const BenchResult* b = baseline.find(r.name);
+        out << std::left << std::setw(40) << r.name << std::right << std::setw(10) << r.unit;
+        if (!b) {
+            out << std::setw(13) << "-" << std::setw(13) << r.value
+                << std::setw(9) << "-" << "  new" << std::endl;
+            continue;
+        }
+        const double limit = tolerance + r.spread + b->spread;
+        double change;
+        bool worse, better;
+        if (b->value != 0) {
+            change = (r.value - b->value) / std::fabs(b->value);
+            const double gain = r.higherIsBetter ? change : -change;
+            worse = gain < -limit;
+            better = gain > limit;
+        } else {
+            // Nothing to scale by (e.g. no loss before): any move counts
+            change = 0;
+            worse = r.higherIsBetter ? r.value < 0 : r.value > 0;
+            better = !worse && r.value != 0;
+        }
+        out << std::setw(13) << b->value << std::setw(13) << r.value;
+        if (b->value != 0) {
+            std::ostringstream percent;
+            percent << std::showpos << std::fixed << std::setprecision(1) << change * 100 << "%";
+            out << std::setw(9) << percent.str();
+        } else {
+            out << std::setw(9) << "-";
+        }
+        out << (worse ? "  WORSE" : better ? "  better" : "  same") << std::endl;
+        regressions += worse;
+        improvements += better;
+    }
+    for (const BenchResult& b : baseline.results) {
+        if (!current.find(b.name)) {
+            out << std::left << std::setw(40) << b.name << std::right << std::setw(10) << b.unit
+                << std::setw(13) << b.value << std::setw(13) << "-" << std::setw(9) << "-" << "  not run" << std::endl;
+        }
+    }
+    out << regressions << " worse, " << improvements << " better (tolerance " << tolerance * 100
+        << "% plus the spread of both runs)" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+    return regressions;
+}
+
+} // namespace tactile
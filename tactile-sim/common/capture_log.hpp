@@ -0,0 +1,837 @@
+// Lossless on-disk capture of live streams (stream_recorder writes it,
+// capture_export turns it back into a SimData run).
+//
+// A capture is a directory:
+//
+//   capture.txt          manifest: start time, clock, one line per stream
+//   segment-000001.cap   append-only data, rotated at --segment-mb
+//   index.cpx            one CaptureIndexEntry per block, appended only
+//                        once the block is on disk
+//
+// The receive thread copies every message, stamped with its arrival time,
+// into a block buffer in memory (CaptureRecordHeader, payload, hop stamps,
+// 8-byte aligned). A block is sealed when it is full or --flush-ms old and
+// handed to a writer thread, which writes it with O_DIRECT (whole 4 KiB
+// pages, no page cache churn; plain writes where the filesystem refuses
+// O_DIRECT), syncs it and only then appends its index entry. Every block
+// and every index entry carries a CRC-32, so after a crash the reader keeps
+// the index up to its last intact entry and recovers any block that made it
+// to disk after that by scanning; a torn block is simply where the capture
+// ends.
+//
+// Nothing is ever dropped: when the disk falls --buffers blocks behind, the
+// receive thread waits for the writer (counted as a stall) and the messages
+// queue up in the socket meanwhile.
+#pragma once
+
+#include "hop_stamps.hpp"
+#include "mapped_file.hpp"
+#include "options.hpp"
+#include "spsc_ring.hpp"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tactile {
+
+constexpr uint32_t captureBlockMagic = 0x4b4c4243;  // "CBLK"
+constexpr uint32_t captureIndexMagic = 0x58444943;  // "CIDX"
+constexpr uint32_t captureVersion = 1;
+constexpr size_t capturePageSize = 4096;            // O_DIRECT alignment
+constexpr size_t captureMaxBuffers = 256;
+
+constexpr uint8_t captureFlagTruncated = 0x01;      // longer than the receive buffer
+
+struct CaptureBlockHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t seq;        // blocks of the capture, from 0
+    uint32_t bytes;      // on disk, whole pages
+    uint32_t used;       // header and records
+    uint32_t records;
+    uint32_t crc;        // over the header (crc = 0) and the records
+    int64_t firstNs;     // arrival of the first and last record
+    int64_t lastNs;
+    uint8_t reserved[16];
+};
+
+struct CaptureRecordHeader {
+    uint32_t size;       // payload bytes
+    uint16_t stream;     // line in capture.txt
+    uint8_t hopCount;    // HopStamps after the payload
+    uint8_t flags;
+    int64_t arrivalNs;
+};
+
+struct CaptureIndexEntry {
+    uint32_t magic;
+    uint32_t segment;
+    uint64_t offset;
+    uint64_t seq;
+    int64_t firstNs;
+    int64_t lastNs;
+    uint32_t bytes;
+    uint32_t records;
+    uint32_t crc;        // over the entry with crc = 0
+    uint32_t reserved[3];
+};
+
+static_assert(sizeof(CaptureBlockHeader) == 64, "CaptureBlockHeader must stay 64 bytes");
+static_assert(sizeof(CaptureRecordHeader) == 16, "CaptureRecordHeader must stay 16 bytes");
+static_assert(sizeof(CaptureIndexEntry) == 64, "CaptureIndexEntry must stay 64 bytes");
+
+// CRC-32 (IEEE 802.3); pass the previous result as `crc` to continue it
+inline uint32_t crc32(const void* data, size_t size, uint32_t crc = 0) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    const auto* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+inline uint32_t blockCrc(const CaptureBlockHeader& header, const char* block) {
+    CaptureBlockHeader h = header;
+    h.crc = 0;
+    return crc32(block + sizeof(h), h.used - sizeof(h), crc32(&h, sizeof(h)));
+}
+
+inline uint32_t indexEntryCrc(const CaptureIndexEntry& entry) {
+    CaptureIndexEntry e = entry;
+    e.crc = 0;
+    return crc32(&e, sizeof(e));
+}
+
+inline size_t captureRecordLength(size_t size, size_t hops) {
+    return (sizeof(CaptureRecordHeader) + size + hops * sizeof(HopStamp) + 7) & ~size_t(7);
+}
+
+inline std::string captureSegmentPath(const std::string& dir, uint32_t segment) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/segment-%06u.cap", segment);
+    return dir + name;
+}
+
+struct CaptureConfig {
+    std::string dir;
+    size_t blockBytes = 1 << 20;
+    uint64_t segmentBytes = uint64_t(256) << 20;
+    size_t buffers = 32;           // blocks the disk may fall behind by
+    int64_t flushNs = 200000000;   // a block is sealed this long after its first record
+    bool direct = true;
+    bool sync = true;              // fdatasync every block before indexing it
+};
+
+// Reads --out, --block-kb, --segment-mb, --buffers, --flush-ms,
+// --no-direct and --no-sync.
+inline bool captureConfigFromOptions(const Options& opts, CaptureConfig& config) {
+    config.dir = opts.get("--out", "capture");
+    const long blockKb = opts.getInt("--block-kb", 1024);
+    const long segmentMb = opts.getInt("--segment-mb", 256);
+    const long buffers = opts.getInt("--buffers", 32);
+    const double flushMs = opts.getDouble("--flush-ms", 200);
+    if (blockKb < 64 || blockKb > 65536 || blockKb % 4 != 0) {
+        std::cerr << "--block-kb must be a multiple of 4 between 64 and 65536" << std::endl;
+        return false;
+    }
+    if (segmentMb < 1 || uint64_t(segmentMb) * 1024 < uint64_t(blockKb)) {
+        std::cerr << "--segment-mb must hold at least one block" << std::endl;
+        return false;
+    }
+    if (buffers < 2 || buffers > long(captureMaxBuffers) || flushMs <= 0) {
+        std::cerr << "--buffers must be between 2 and " << captureMaxBuffers
+                  << ", --flush-ms positive" << std::endl;
+        return false;
+    }
+    config.blockBytes = size_t(blockKb) * 1024;
+    config.segmentBytes = uint64_t(segmentMb) << 20;
+    config.buffers = size_t(buffers);
+    config.flushNs = int64_t(flushMs * 1e6);
+    config.direct = !opts.has("--no-direct");
+    config.sync = !opts.has("--no-sync");
+    return true;
+}
+
+struct CaptureStream {
+    std::string name;      // e.g. "tactile", the file capture_export writes
+    std::string endpoint;
+};
+
+// Synchronises file data (and the size, so appended data is found again)
+inline int syncData(int fd) {
+#if defined(__linux__)
+    return ::fdatasync(fd);
+#else
+    return ::fsync(fd);
+#endif
+}
+
+class CaptureWriter {
+public:
+    explicit CaptureWriter(const CaptureConfig& config) : config(config) {}
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    ~CaptureWriter() {
+        close();
+        for (Block& b : blocks) {
+            std::free(b.data);
+        }
+    }
+
+    // Creates the capture directory (refusing one that already holds a
+    // capture), writes the manifest and starts the writer thread.
+    bool open(const std::vector<CaptureStream>& streams, const std::string& clockName, std::string& error) {
+        if (::mkdir(config.dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            error = config.dir + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (::stat((config.dir + "/capture.txt").c_str(), &st) == 0) {
+            error = config.dir + " already holds a capture";
+            return false;
+        }
+
+        blocks.resize(config.buffers);
+        for (uint32_t i = 0; i < blocks.size(); i++) {
+            if (::posix_memalign(reinterpret_cast<void**>(&blocks[i].data), capturePageSize, config.blockBytes) != 0) {
+                error = "cannot allocate " + std::to_string(config.buffers) + " capture buffers";
+                return false;
+            }
+            // Touch every page now rather than on the receive path
+            std::memset(blocks[i].data, 0, config.blockBytes);
+            freeBlocks->tryPush(i);
+        }
+
+        const std::string indexPath = config.dir + "/index.cpx";
+        indexFd = ::open(indexPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (indexFd < 0 || !openSegment(1, error)) {
+            if (error.empty()) {
+                error = indexPath + ": " + std::strerror(errno);
+            }
+            return false;
+        }
+
+        std::ostringstream manifest;
+        manifest << "version " << captureVersion << "\n";
+        manifest << "started_unix_ns "
+                 << std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count() << "\n";
+        manifest << "clock " << clockName << "\n";
+        for (size_t i = 0; i < streams.size(); i++) {
+            manifest << "stream " << i << " " << streams[i].name << " " << streams[i].endpoint << "\n";
+        }
+        if (!writeFileSynced(config.dir + "/capture.txt", manifest.str(), error)) {
+            return false;
+        }
+        syncDirectory();
+
+        worker = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Receive thread. Copies one message into the current block; waits for
+    // the writer if every buffer is full. Returns false once the writer has
+    // failed (the message is not recorded).
+    bool append(uint16_t stream, int64_t arrivalNs, const void* data, size_t size,
+                const HopTrail& hops, bool truncated) {
+        if (failed.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        const size_t length = captureRecordLength(size, hops.count);
+        if (length > config.blockBytes - sizeof(CaptureBlockHeader)) {
+            oversized++;
+            return false;
+        }
+        if (current >= 0 && blocks[current].used + length > config.blockBytes) {
+            seal();
+        }
+        if (current < 0 && !acquire(arrivalNs)) {
+            return false;
+        }
+        Block& b = blocks[current];
+        char* at = b.data + b.used;
+        CaptureRecordHeader header = { uint32_t(size), stream, hops.count,
+                                       uint8_t(truncated ? captureFlagTruncated : 0), arrivalNs };
+        std::memcpy(at, &header, sizeof(header));
+        std::memcpy(at + sizeof(header), data, size);
+        std::memcpy(at + sizeof(header) + size, hops.hops, hops.count * sizeof(HopStamp));
+        const size_t written = sizeof(header) + size + hops.count * sizeof(HopStamp);
+        std::memset(at + written, 0, length - written);
+        if (b.records == 0) {
+            b.firstNs = arrivalNs;
+        }
+        b.lastNs = arrivalNs;
+        b.used += length;
+        b.records++;
+        bump(recordCount);
+        bump(byteCount, size);
+        return true;
+    }
+
+    // Receive thread. Seals a block that has waited --flush-ms for more
+    // records, so a quiet stream still reaches the disk.
+    void tick(int64_t nowNs) {
+        if (current >= 0 && nowNs - blocks[current].openedNs >= config.flushNs) {
+            seal();
+        }
+    }
+
+    // Writes what is buffered, stops the writer and closes the files.
+    // Returns false if any write failed.
+    bool close() {
+        if (worker.joinable()) {
+            if (current >= 0) {
+                seal();
+            }
+            stopping.store(true, std::memory_order_release);
+            worker.join();
+        }
+        if (segmentFd >= 0) {
+            ::close(segmentFd);
+            segmentFd = -1;
+        }
+        if (indexFd >= 0) {
+            ::close(indexFd);
+            indexFd = -1;
+        }
+        return !failed.load(std::memory_order_acquire);
+    }
+
+    uint64_t records() const {
+        return recordCount.load(std::memory_order_relaxed);
+    }
+
+    uint64_t payloadBytes() const {
+        return byteCount.load(std::memory_order_relaxed);
+    }
+
+    // Times the receive thread had to wait for a free buffer, and how long
+    uint64_t stalls() const {
+        return stallCount.load(std::memory_order_relaxed);
+    }
+
+    int64_t stallNs() const {
+        return stallTotalNs.load(std::memory_order_relaxed);
+    }
+
+    uint64_t blocksWritten() const {
+        return blockCount.load(std::memory_order_relaxed);
+    }
+
+    uint64_t bytesWritten() const {
+        return diskBytes.load(std::memory_order_relaxed);
+    }
+
+    uint32_t segments() const {
+        return segmentCount.load(std::memory_order_relaxed);
+    }
+
+    // Longest write + sync of one block, the disk's worst moment
+    int64_t maxWriteNs() const {
+        return maxWrite.load(std::memory_order_relaxed);
+    }
+
+    uint64_t oversizedRecords() const {
+        return oversized;
+    }
+
+    bool directIo() const {
+        return direct.load(std::memory_order_relaxed);
+    }
+
+    bool ok() const {
+        return !failed.load(std::memory_order_acquire);
+    }
+
+    const std::string& failure() const {
+        return failureText;  // only read once ok() is false
+    }
+
+private:
+    struct Block {
+        char* data = nullptr;
+        size_t used = 0;
+        uint32_t records = 0;
+        int64_t firstNs = 0;
+        int64_t lastNs = 0;
+        int64_t openedNs = 0;
+    };
+
+    using BlockRing = SpscRing<uint32_t, captureMaxBuffers>;
+
+    // Single writer, so no read-modify-write instruction is needed
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static int64_t steadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool acquire(int64_t nowNs) {
+        uint32_t index;
+        if (!freeBlocks->tryPop(index)) {
+            const int64_t since = steadyNs();
+            while (!freeBlocks->tryPop(index)) {
+                if (failed.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+            bump(stallCount);
+            stallTotalNs.store(stallTotalNs.load(std::memory_order_relaxed) + steadyNs() - since,
+                               std::memory_order_relaxed);
+        }
+        current = int32_t(index);
+        Block& b = blocks[index];
+        b.used = sizeof(CaptureBlockHeader);
+        b.records = 0;
+        b.openedNs = nowNs;
+        return true;
+    }
+
+    void seal() {
+        Block& b = blocks[current];
+        CaptureBlockHeader header{};
+        header.magic = captureBlockMagic;
+        header.version = captureVersion;
+        header.seq = nextSeq++;
+        header.bytes = uint32_t((b.used + capturePageSize - 1) & ~(capturePageSize - 1));
+        header.used = uint32_t(b.used);
+        header.records = b.records;
+        header.firstNs = b.firstNs;
+        header.lastNs = b.lastNs;
+        std::memset(b.data + b.used, 0, header.bytes - b.used);
+        header.crc = blockCrc(header, b.data);
+        std::memcpy(b.data, &header, sizeof(header));
+        // Never full: there are fewer blocks than slots
+        fullBlocks->tryPush(uint32_t(current));
+        current = -1;
+    }
+
+    void run() {
+        uint32_t index;
+        while (true) {
+            // Read first: the last block is sealed before the stop is set
+            const bool stop = stopping.load(std::memory_order_acquire);
+            if (fullBlocks->tryPop(index)) {
+                if (!failed.load(std::memory_order_relaxed)) {
+                    writeBlock(blocks[index]);
+                }
+                freeBlocks->tryPush(index);
+                continue;
+            }
+            if (stop) {
+                return;
+            }
+            // A block takes a while to fill, so there is no point spinning
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void writeBlock(const Block& b) {
+        CaptureBlockHeader header;
+        std::memcpy(&header, b.data, sizeof(header));
+        const int64_t started = steadyNs();
+        std::string error;
+        if (segmentOffset > 0 && segmentOffset + header.bytes > config.segmentBytes &&
+            !openSegment(segmentNumber + 1, error)) {
+            fail(error);
+            return;
+        }
+        if (!writeAt(b.data, header.bytes, error)) {
+            fail(error);
+            return;
+        }
+        if (config.sync && syncData(segmentFd) != 0) {
+            fail(captureSegmentPath(config.dir, segmentNumber) + ": " + std::strerror(errno));
+            return;
+        }
+
+        // The block is durable, so the index may point at it
+        CaptureIndexEntry entry{};
+        entry.magic = captureIndexMagic;
+        entry.segment = segmentNumber;
+        entry.offset = segmentOffset;
+        entry.seq = header.seq;
+        entry.firstNs = header.firstNs;
+        entry.lastNs = header.lastNs;
+        entry.bytes = header.bytes;
+        entry.records = header.records;
+        entry.crc = indexEntryCrc(entry);
+        if (::write(indexFd, &entry, sizeof(entry)) != ssize_t(sizeof(entry)) ||
+            (config.sync && syncData(indexFd) != 0)) {
+            fail(config.dir + "/index.cpx: " + std::strerror(errno));
+            return;
+        }
+
+        segmentOffset += header.bytes;
+        bump(blockCount);
+        bump(diskBytes, header.bytes);
+        const int64_t took = steadyNs() - started;
+        if (took > maxWrite.load(std::memory_order_relaxed)) {
+            maxWrite.store(took, std::memory_order_relaxed);
+        }
+    }
+
+    bool writeAt(const char* data, size_t size, std::string& error) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::pwrite(segmentFd, data + done, size - done, off_t(segmentOffset + done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && errno == EINVAL && direct.load(std::memory_order_relaxed)) {
+                // Some filesystems accept O_DIRECT at open() but not the write
+                direct.store(false, std::memory_order_relaxed);
+                config.direct = false;  // and don't try again on the next segment
+                if (!reopenBuffered(error)) {
+                    return false;
+                }
+                continue;
+            }
+            if (n <= 0) {
+                error = captureSegmentPath(config.dir, segmentNumber) + ": " +
+                        (n < 0 ? std::strerror(errno) : "short write");
+                return false;
+            }
+            done += size_t(n);
+        }
+        return true;
+    }
+
+    bool openSegment(uint32_t number, std::string& error) {
+        if (segmentFd >= 0) {
+            ::close(segmentFd);
+        }
+        const std::string path = captureSegmentPath(config.dir, number);
+        segmentFd = -1;
+#ifdef O_DIRECT
+        if (config.direct) {
+            segmentFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_DIRECT, 0644);
+            direct.store(segmentFd >= 0, std::memory_order_relaxed);
+        }
+#endif
+        if (segmentFd < 0) {
+            // tmpfs and others refuse O_DIRECT
+            segmentFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+#ifdef F_NOCACHE
+            if (segmentFd >= 0 && config.direct) {
+                direct.store(::fcntl(segmentFd, F_NOCACHE, 1) == 0, std::memory_order_relaxed);
+            }
+#endif
+        }
+        if (segmentFd < 0) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        segmentNumber = number;
+        segmentOffset = 0;
+        segmentCount.store(number, std::memory_order_relaxed);
+        if (number > 1) {
+            syncDirectory();
+        }
+        return true;
+    }
+
+    bool reopenBuffered(std::string& error) {
+        const std::string path = captureSegmentPath(config.dir, segmentNumber);
+        ::close(segmentFd);
+        segmentFd = ::open(path.c_str(), O_WRONLY);
+        if (segmentFd < 0) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Makes new directory entries (segments, the manifest) survive a crash
+    void syncDirectory() {
+        int fd = ::open(config.dir.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+    static bool writeFileSynced(const std::string& path, const std::string& text, std::string& error) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool ok = fd >= 0 && ::write(fd, text.data(), text.size()) == ssize_t(text.size()) && ::fsync(fd) == 0;
+        if (!ok) {
+            error = path + ": " + std::strerror(errno);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return ok;
+    }
+
+    void fail(const std::string& error) {
+        failureText = error;
+        failed.store(true, std::memory_order_release);
+    }
+
+    CaptureConfig config;
+    std::vector<Block> blocks;
+    std::unique_ptr<BlockRing> freeBlocks = std::make_unique<BlockRing>();
+    std::unique_ptr<BlockRing> fullBlocks = std::make_unique<BlockRing>();
+
+    // Receive thread
+    int32_t current = -1;
+    uint64_t nextSeq = 0;
+    uint64_t oversized = 0;
+
+    // Writer thread
+    int segmentFd = -1;
+    int indexFd = -1;
+    uint32_t segmentNumber = 0;
+    uint64_t segmentOffset = 0;
+    std::string failureText;
+
+    std::atomic<uint64_t> recordCount{0};
+    std::atomic<uint64_t> byteCount{0};
+    std::atomic<uint64_t> stallCount{0};
+    std::atomic<int64_t> stallTotalNs{0};
+    std::atomic<uint64_t> blockCount{0};
+    std::atomic<uint64_t> diskBytes{0};
+    std::atomic<uint32_t> segmentCount{0};
+    std::atomic<int64_t> maxWrite{0};
+    std::atomic<bool> direct{false};
+    std::atomic<bool> failed{false};
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
+
+struct CaptureRecord {
+    uint16_t stream;
+    bool truncated;
+    int64_t arrivalNs;
+    std::string_view data;
+    HopTrail hops;
+};
+
+// Reads a capture back, in arrival order, including blocks a crash kept
+// out of the index.
+class CaptureReader {
+public:
+    bool open(const std::string& path, std::string& error) {
+        dir = path;
+        std::ifstream manifest(dir + "/capture.txt");
+        if (!manifest) {
+            error = dir + "/capture.txt: " + std::strerror(errno);
+            return false;
+        }
+        std::string line;
+        while (std::getline(manifest, line)) {
+            std::istringstream fields(line);
+            std::string key;
+            fields >> key;
+            if (key == "stream") {
+                size_t index;
+                CaptureStream s;
+                fields >> index >> s.name >> s.endpoint;
+                if (!fields || index != streamList.size()) {
+                    error = dir + "/capture.txt: bad line '" + line + "'";
+                    return false;
+                }
+                streamList.push_back(s);
+            } else if (key == "started_unix_ns") {
+                fields >> startedUnixNs;
+            } else if (key == "clock") {
+                fields >> clockText;
+            }
+        }
+        readIndex();
+        recoverTail();
+        return true;
+    }
+
+    const std::vector<CaptureStream>& streams() const {
+        return streamList;
+    }
+
+    int64_t startedUnix() const {
+        return startedUnixNs;
+    }
+
+    const std::string& clock() const {
+        return clockText;
+    }
+
+    size_t blockCount() const {
+        return blockList.size();
+    }
+
+    size_t indexedBlocks() const {
+        return indexed;
+    }
+
+    // Blocks found on disk past the last intact index entry
+    size_t recoveredBlocks() const {
+        return blockList.size() - indexed;
+    }
+
+    // Blocks whose CRC no longer matched when read; their records are skipped
+    size_t damagedBlocks() const {
+        return damaged;
+    }
+
+    uint64_t recordCount() const {
+        uint64_t total = 0;
+        for (const BlockRef& b : blockList) {
+            total += b.records;
+        }
+        return total;
+    }
+
+    // Calls f(const CaptureRecord&) for every record
+    template <typename F>
+    void forEach(F&& f) {
+        damaged = 0;
+        MappedFile file;
+        uint32_t mapped = 0;
+        std::string error;
+        for (const BlockRef& ref : blockList) {
+            if (ref.segment != mapped) {
+                mapped = file.map(captureSegmentPath(dir, ref.segment), error) ? ref.segment : 0;
+            }
+            const char* block = validBlock(file, ref.offset);
+            if (mapped == 0 || block == nullptr) {
+                damaged++;
+                continue;
+            }
+            CaptureBlockHeader header;
+            std::memcpy(&header, block, sizeof(header));
+            size_t at = sizeof(header);
+            for (uint32_t i = 0; i < header.records; i++) {
+                CaptureRecordHeader rh;
+                std::memcpy(&rh, block + at, sizeof(rh));
+                CaptureRecord record;
+                record.stream = rh.stream;
+                record.truncated = rh.flags & captureFlagTruncated;
+                record.arrivalNs = rh.arrivalNs;
+                record.data = std::string_view(block + at + sizeof(rh), rh.size);
+                const char* hop = block + at + sizeof(rh) + rh.size;
+                for (uint8_t h = 0; h < rh.hopCount; h++) {
+                    HopStamp stamp;
+                    std::memcpy(&stamp, hop + h * sizeof(HopStamp), sizeof(stamp));
+                    record.hops.add(stamp);
+                }
+                f(static_cast<const CaptureRecord&>(record));
+                at += captureRecordLength(rh.size, rh.hopCount);
+            }
+        }
+    }
+
+private:
+    struct BlockRef {
+        uint32_t segment;
+        uint64_t offset;
+        uint32_t records;
+    };
+
+    // The block at `offset` if it is complete and intact
+    static const char* validBlock(const MappedFile& file, uint64_t offset) {
+        if (offset + sizeof(CaptureBlockHeader) > file.size()) {
+            return nullptr;
+        }
+        const char* block = file.data() + offset;
+        CaptureBlockHeader header;
+        std::memcpy(&header, block, sizeof(header));
+        if (header.magic != captureBlockMagic || header.version != captureVersion ||
+            header.used < sizeof(header) || header.used > header.bytes ||
+            offset + header.bytes > file.size() || blockCrc(header, block) != header.crc) {
+            return nullptr;
+        }
+        return block;
+    }
+
+    void readIndex() {
+        std::ifstream in(dir + "/index.cpx", std::ios::binary);
+        CaptureIndexEntry entry;
+        while (in.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+            if (entry.magic != captureIndexMagic || indexEntryCrc(entry) != entry.crc) {
+                break;  // torn by a crash; what follows was never acknowledged
+            }
+            blockList.push_back({ entry.segment, entry.offset, entry.records });
+        }
+        indexed = blockList.size();
+    }
+
+    // Scans on from the last indexed block for blocks that reached the
+    // disk before their index entry did
+    void recoverTail() {
+        uint32_t segment = 1;
+        uint64_t offset = 0;
+        if (!blockList.empty()) {
+            const BlockRef& last = blockList.back();
+            MappedFile file;
+            std::string error;
+            if (!file.map(captureSegmentPath(dir, last.segment), error)) {
+                return;
+            }
+            const char* block = validBlock(file, last.offset);
+            if (block == nullptr) {
+                return;
+            }
+            CaptureBlockHeader header;
+            std::memcpy(&header, block, sizeof(header));
+            segment = last.segment;
+            offset = last.offset + header.bytes;
+        }
+        std::string error;
+        for (MappedFile file; file.map(captureSegmentPath(dir, segment), error); segment++, offset = 0) {
+            while (const char* block = validBlock(file, offset)) {
+                CaptureBlockHeader header;
+                std::memcpy(&header, block, sizeof(header));
+                blockList.push_back({ segment, offset, header.records });
+                offset += header.bytes;
+            }
+            if (offset < file.size()) {
+                return;  // a torn block ends the capture
+            }
+        }
+    }
+
+    std::string dir;
+    std::vector<CaptureStream> streamList;
+    int64_t startedUnixNs = 0;
+    std::string clockText;
+    std::vector<BlockRef> blockList;
+    size_t indexed = 0;
+    size_t damaged = 0;
+};
+
+} // namespace tactile
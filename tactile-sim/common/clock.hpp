@@ -0,0 +1,223 @@
+// Nanosecond clock used for every timestamp and latency in the pipeline.
+//
+// Sources:
+//   monotonic  std::chrono::steady_clock (CLOCK_MONOTONIC on Linux)
+//   tsc        CPU time stamp counter, calibrated against steady_clock at
+//              start-up (cntvct_el0 on arm64); falls back to monotonic
+//   realtime   std::chrono::system_clock, for hosts synchronised by NTP/PTP
+//
+// Epochs:
+//   process    0 is the moment the Clock was created (the old "sim time")
+//   shared     the source's own epoch, identical in every process on the
+//              host, so publisher and subscriber stamps can be subtracted
+#pragma once
+
+#include "options.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace tactile {
+
+enum class ClockSource {
+    Monotonic,
+    Tsc,
+    Realtime,
+};
+
+enum class ClockEpoch {
+    Process,
+    Shared,
+};
+
+class Clock {
+public:
+    explicit Clock(ClockSource source = ClockSource::Monotonic,
+                   ClockEpoch epoch = ClockEpoch::Process)
+        : clockSource(source), clockEpoch(epoch) {
+        if (clockSource == ClockSource::Tsc && !calibrateTsc()) {
+            clockSource = ClockSource::Monotonic;
+        }
+        origin = (epoch == ClockEpoch::Process) ? rawNs() : 0;
+    }
+
+    int64_t nowNs() const {
+        return rawNs() - origin;
+    }
+
+    double nowSeconds() const {
+        return nowNs() / 1e9;
+    }
+
+    ClockSource source() const {
+        return clockSource;
+    }
+
+    ClockEpoch epoch() const {
+        return clockEpoch;
+    }
+
+    const char* describe() const {
+        static const char* names[3][2] = {
+            { "monotonic/process", "monotonic/shared" },
+            { "tsc/process", "tsc/shared" },
+            { "realtime/process", "realtime/shared" },
+        };
+        return names[static_cast<int>(clockSource)][static_cast<int>(clockEpoch)];
+    }
+
+    static bool tscAvailable() {
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+    static int64_t steadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t systemNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static uint64_t readTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return 0;
+#endif
+    }
+
+    int64_t rawNs() const {
+        switch (clockSource) {
+            case ClockSource::Monotonic:
+                return steadyNs();
+            case ClockSource::Realtime:
+                return systemNs();
+            case ClockSource::Tsc: {
+                // 128-bit product keeps days of ticks exact; signed so a
+                // core whose counter lags the calibration point stays sane
+                __int128 delta = static_cast<int64_t>(readTsc() - tscBase);
+                return tscBaseNs + static_cast<int64_t>((delta * tscMult) >> tscShift);
+            }
+        }
+        return 0;
+    }
+
+    // Reads steady_clock and the counter as one pair: the counter is
+    // bracketed by two steady_clock reads, and of a few tries the one with
+    // the tightest bracket wins (a preemption or a slow vDSO call only
+    // widens the bracket). ns is the middle of the bracket.
+    static bool tscPair(int64_t& ns, uint64_t& ticks) {
+        int64_t best = INT64_MAX;
+        for (int attempt = 0; attempt < 16; attempt++) {
+            int64_t before = steadyNs();
+            uint64_t t = readTsc();
+            int64_t after = steadyNs();
+            if (after - before < best) {
+                best = after - before;
+                ns = before + (after - before) / 2;
+                ticks = t;
+            }
+        }
+        return best < 100000;
+    }
+
+    // Anchors the counter to steady_clock so the shared epoch matches the
+    // monotonic source, and measures the tick rate over ~100 ms. With both
+    // endpoints read to within a bracket of tens of ns, the rate is good to
+    // well under a part per million.
+    bool calibrateTsc() {
+        if (!tscAvailable()) {
+            return false;
+        }
+        int64_t startNs = 0, endNs = 0;
+        uint64_t startTicks = 0, endTicks = 0;
+        if (!tscPair(startNs, startTicks)) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!tscPair(endNs, endTicks) || endTicks <= startTicks || endNs <= startNs) {
+            return false;
+        }
+        double nsPerTick = double(endNs - startNs) / double(endTicks - startTicks);
+        tscMult = static_cast<uint64_t>(nsPerTick * double(uint64_t(1) << tscShift) + 0.5);
+        tscBase = endTicks;
+        tscBaseNs = endNs;
+        return tscMult != 0;
+    }
+
+    static constexpr int tscShift = 32;
+
+    ClockSource clockSource;
+    ClockEpoch clockEpoch;
+    int64_t origin = 0;
+    uint64_t tscBase = 0;
+    int64_t tscBaseNs = 0;
+    uint64_t tscMult = 0;
+};
+
+// Builds the clock selected with "--clock monotonic|tsc|realtime" and
+// "--epoch process|shared". Unknown names fall back to the defaults with a
+// warning.
+inline Clock clockFromOptions(const Options& opts, ClockEpoch defaultEpoch = ClockEpoch::Process) {
+    std::string sourceName = opts.get("--clock", "monotonic");
+    ClockSource source = ClockSource::Monotonic;
+    if (sourceName == "tsc") {
+        source = ClockSource::Tsc;
+    } else if (sourceName == "realtime") {
+        source = ClockSource::Realtime;
+    } else if (sourceName != "monotonic") {
+        std::cerr << "Unknown --clock " << sourceName << ", using monotonic" << std::endl;
+    }
+
+    std::string epochName = opts.get("--epoch", defaultEpoch == ClockEpoch::Shared ? "shared" : "process");
+    ClockEpoch epoch = defaultEpoch;
+    if (epochName == "shared") {
+        epoch = ClockEpoch::Shared;
+    } else if (epochName == "process") {
+        epoch = ClockEpoch::Process;
+    } else {
+        std::cerr << "Unknown --epoch " << epochName << std::endl;
+    }
+    return Clock(source, epoch);
+}
+
+// Waits until `clock` reads `deadlineNs`: sleeps while more than `spinNs`
+// remains, then spins the rest for sub-scheduler-tick precision. Returns how
+// late the caller woke up (>= 0). Deadlines are absolute, so a late wakeup
+// never shifts the ones after it.
+inline int64_t waitUntilNs(const Clock& clock, int64_t deadlineNs, int64_t spinNs) {
+    int64_t now = clock.nowNs();
+    while (deadlineNs - now > spinNs) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(deadlineNs - now - spinNs));
+        now = clock.nowNs();
+    }
+    while (now < deadlineNs) {
+        now = clock.nowNs();
+    }
+    return now - deadlineNs;
+}
+
+// Nanosecond duration as (fractional) milliseconds, for display only.
+inline double nsToMs(int64_t ns) {
+    return ns / 1e6;
+}
+
+} // namespace tactile
@@ -0,0 +1,713 @@
+// Columnar, memory-mappable trace format (.tct) and the reader every tool
+// uses to load recorded runs.
+//
+// Layout (little-endian, every section 64-byte aligned, offsets from the
+// start of the file):
+//
+//   TraceFileHeader
+//   TraceEventRef[eventCount]      all rows of all tables in time order
+//   TraceTableDesc[tableCount]     one table per source CSV
+//   per table:
+//     TraceColumnDesc[columnCount]
+//     int64 block index            first timestamp of every 4096 rows
+//     column data                  int64 ns, float, uint32 or uint32 codes
+//     dictionaries                 uint32 offsets[n + 1], then the bytes
+//
+// Column 0 of every table is the timestamp in ns. Repeated strings such as
+// hand_id or material are stored once per table. TraceReader opens either a
+// .tct file (mapped, nothing is parsed or copied) or a SimData run directory
+// (the CSVs are converted in memory to the same image), so callers have one
+// API for both.
+#pragma once
+
+#include "haptic_wire.hpp"
+#include "mapped_file.hpp"
+#include "sim_trace.hpp"
+#include "text_fields.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace tactile {
+
+constexpr char traceMagic[8] = { 'T', 'C', 'T', 'R', 'A', 'C', 'E', '1' };
+constexpr uint32_t traceVersion = 1;
+constexpr size_t traceAlign = 64;
+constexpr size_t traceBlockRows = 4096;
+constexpr size_t traceMaxColumns = 32;
+
+enum class ColumnType : uint8_t {
+    TimeNs = 1,  // int64
+    F32 = 2,
+    U32 = 3,
+    Dict = 4,    // uint32 code into the column's dictionary
+};
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tableCount;
+    uint64_t eventCount;
+    uint64_t eventIndexOffset;
+    uint64_t tableDirOffset;
+    uint64_t reserved[3];
+};
+
+struct TraceEventRef {
+    uint32_t row;
+    uint8_t table;
+    uint8_t reserved[3];
+};
+
+struct TraceTableDesc {
+    char name[16];
+    uint64_t rowCount;
+    uint64_t columnDirOffset;
+    uint64_t blockIndexOffset;
+    uint32_t columnCount;
+    uint32_t reserved0;
+    uint64_t reserved[2];
+};
+
+struct TraceColumnDesc {
+    char name[24];
+    uint8_t type;
+    uint8_t decimals;  // digits after the point in the source CSV
+    uint16_t reserved0;
+    uint32_t dictSize;
+    uint64_t dataOffset;
+    uint64_t dictOffset;
+    uint64_t dictBytes;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(TraceFileHeader) == 64, "TraceFileHeader must stay 64 bytes");
+static_assert(sizeof(TraceEventRef) == 8, "TraceEventRef must stay 8 bytes");
+static_assert(sizeof(TraceTableDesc) == 64, "TraceTableDesc must stay 64 bytes");
+static_assert(sizeof(TraceColumnDesc) == 64, "TraceColumnDesc must stay 64 bytes");
+
+inline size_t columnWidth(ColumnType type) {
+    return type == ColumnType::TimeNs ? 8 : 4;
+}
+
+// Reads a NUL-padded fixed-size name field.
+inline std::string_view fixedName(const char* name, size_t size) {
+    return std::string_view(name, strnlen(name, size));
+}
+
+class TraceColumn {
+public:
+    TraceColumn(const TraceColumnDesc* desc, const char* base, size_t rows)
+        : desc(desc), base(base), rowCount(rows) {}
+
+    std::string_view name() const {
+        return fixedName(desc->name, sizeof(desc->name));
+    }
+
+    ColumnType type() const {
+        return static_cast<ColumnType>(desc->type);
+    }
+
+    int decimals() const {
+        return desc->decimals;
+    }
+
+    // Raw column storage; T must match type() (int64_t, float, uint32_t).
+    template <typename T>
+    const T* data() const {
+        return reinterpret_cast<const T*>(base + desc->dataOffset);
+    }
+
+    // Any numeric column as a double (seconds for the timestamp column).
+    double number(size_t row) const {
+        switch (type()) {
+            case ColumnType::TimeNs: return data<int64_t>()[row] / 1e9;
+            case ColumnType::F32: return data<float>()[row];
+            case ColumnType::U32:
+            case ColumnType::Dict: return data<uint32_t>()[row];
+        }
+        return 0;
+    }
+
+    size_t dictSize() const {
+        return desc->dictSize;
+    }
+
+    std::string_view dictEntry(uint32_t code) const {
+        const uint32_t* offsets = reinterpret_cast<const uint32_t*>(base + desc->dictOffset);
+        const char* bytes = reinterpret_cast<const char*>(offsets + desc->dictSize + 1);
+        return std::string_view(bytes + offsets[code], offsets[code + 1] - offsets[code]);
+    }
+
+    std::string_view string(size_t row) const {
+        return dictEntry(data<uint32_t>()[row]);
+    }
+
+    size_t rows() const {
+        return rowCount;
+    }
+
+private:
+    const TraceColumnDesc* desc;
+    const char* base;
+    size_t rowCount;
+};
+
+class TraceTable {
+public:
+    TraceTable(const TraceTableDesc* desc, const char* base) : desc(desc), base(base) {}
+
+    std::string_view name() const {
+        return fixedName(desc->name, sizeof(desc->name));
+    }
+
+    size_t rows() const {
+        return desc->rowCount;
+    }
+
+    size_t columnCount() const {
+        return desc->columnCount;
+    }
+
+    TraceColumn column(size_t i) const {
+        const TraceColumnDesc* columns = reinterpret_cast<const TraceColumnDesc*>(base + desc->columnDirOffset);
+        return TraceColumn(&columns[i], base, rows());
+    }
+
+    // Column index by name, or -1.
+    int find(std::string_view columnName) const {
+        for (size_t i = 0; i < columnCount(); i++) {
+            if (column(i).name() == columnName) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    int64_t timeNs(size_t row) const {
+        return column(0).data<int64_t>()[row];
+    }
+
+    // First row stamped at or after `t`, via the block index.
+    size_t lowerBound(int64_t t) const {
+        const int64_t* blocks = reinterpret_cast<const int64_t*>(base + desc->blockIndexOffset);
+        size_t blockCount = (rows() + traceBlockRows - 1) / traceBlockRows;
+        // The answer is in the block before the first one starting at >= t,
+        // or is that block's first row
+        size_t block = std::lower_bound(blocks, blocks + blockCount, t) - blocks;
+        if (block == 0) {
+            return 0;
+        }
+        size_t first = (block - 1) * traceBlockRows;
+        size_t last = std::min(rows(), block * traceBlockRows);
+        const int64_t* times = column(0).data<int64_t>();
+        return std::lower_bound(times + first, times + last, t) - times;
+    }
+
+private:
+    const TraceTableDesc* desc;
+    const char* base;
+};
+
+class TraceReader {
+public:
+    TraceReader() = default;
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    // Opens a .tct file, or converts the CSVs of a run directory.
+    bool open(const std::string& path, std::string& error) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            CsvTrace csv;
+            return csv.load(path, (1u << traceSourceCount) - 1, error) &&
+                   buildImage(csv, error) && validate(error);
+        }
+        owned.clear();
+        if (!file.map(path, error)) {
+            return false;
+        }
+        base = file.data();
+        length = file.size();
+        return validate(error);
+    }
+
+    // Converts an already loaded CSV run.
+    bool openCsv(const CsvTrace& csv, std::string& error) {
+        return buildImage(csv, error) && validate(error);
+    }
+
+    // The serialised trace, for writing a .tct file.
+    const char* data() const {
+        return base;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    size_t tableCount() const {
+        return header()->tableCount;
+    }
+
+    TraceTable table(size_t i) const {
+        const TraceTableDesc* tables = reinterpret_cast<const TraceTableDesc*>(base + header()->tableDirOffset);
+        return TraceTable(&tables[i], base);
+    }
+
+    // Table index by name, or -1.
+    int findTable(std::string_view name) const {
+        for (size_t i = 0; i < tableCount(); i++) {
+            if (table(i).name() == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    size_t eventCount() const {
+        return header()->eventCount;
+    }
+
+    const TraceEventRef& event(size_t i) const {
+        return events()[i];
+    }
+
+    int64_t eventTimeNs(size_t i) const {
+        const TraceEventRef& ref = events()[i];
+        return table(ref.table).timeNs(ref.row);
+    }
+
+    // Index of the first event stamped at or after `t`.
+    size_t seek(int64_t t) const {
+        size_t lo = 0, hi = eventCount();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (eventTimeNs(mid) < t) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    int64_t firstNs() const {
+        return eventCount() ? eventTimeNs(0) : 0;
+    }
+
+    int64_t durationNs() const {
+        return eventCount() ? eventTimeNs(eventCount() - 1) - firstNs() : 0;
+    }
+
+private:
+    const TraceFileHeader* header() const {
+        return reinterpret_cast<const TraceFileHeader*>(base);
+    }
+
+    const TraceEventRef* events() const {
+        return reinterpret_cast<const TraceEventRef*>(base + header()->eventIndexOffset);
+    }
+
+    bool within(uint64_t offset, uint64_t bytes) const {
+        return offset <= length && bytes <= length - offset && offset % 8 == 0;
+    }
+
+    // Bounds-checks every offset once so accessors can stay unchecked.
+    bool validate(std::string& error) {
+        error = "not a trace file or truncated";
+        if (length < sizeof(TraceFileHeader) || std::memcmp(header()->magic, traceMagic, 8) != 0) {
+            return false;
+        }
+        if (header()->version != traceVersion) {
+            error = "unsupported trace version " + std::to_string(header()->version);
+            return false;
+        }
+        const TraceFileHeader& h = *header();
+        if (!within(h.eventIndexOffset, h.eventCount * sizeof(TraceEventRef)) ||
+            !within(h.tableDirOffset, uint64_t(h.tableCount) * sizeof(TraceTableDesc)) ||
+            h.tableCount > 255) {
+            return false;
+        }
+        for (size_t t = 0; t < tableCount(); t++) {
+            const TraceTableDesc& td = reinterpret_cast<const TraceTableDesc*>(base + h.tableDirOffset)[t];
+            uint64_t blocks = (td.rowCount + traceBlockRows - 1) / traceBlockRows;
+            if (td.rowCount > std::numeric_limits<uint32_t>::max() || td.columnCount == 0 ||
+                td.columnCount > traceMaxColumns ||
+                !within(td.columnDirOffset, td.columnCount * sizeof(TraceColumnDesc)) ||
+                !within(td.blockIndexOffset, blocks * sizeof(int64_t))) {
+                return false;
+            }
+            const TraceColumnDesc* columns = reinterpret_cast<const TraceColumnDesc*>(base + td.columnDirOffset);
+            if (columns[0].type != static_cast<uint8_t>(ColumnType::TimeNs)) {
+                return false;
+            }
+            for (size_t c = 0; c < td.columnCount; c++) {
+                const TraceColumnDesc& cd = columns[c];
+                if (cd.type < 1 || cd.type > 4 ||
+                    !within(cd.dataOffset, td.rowCount * columnWidth(static_cast<ColumnType>(cd.type)))) {
+                    return false;
+                }
+                if (cd.type == static_cast<uint8_t>(ColumnType::Dict)) {
+                    uint64_t tableBytes = (uint64_t(cd.dictSize) + 1) * sizeof(uint32_t);
+                    if (!within(cd.dictOffset, tableBytes + cd.dictBytes)) {
+                        return false;
+                    }
+                    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(base + cd.dictOffset);
+                    for (uint32_t i = 0; i < cd.dictSize; i++) {
+                        if (offsets[i] > offsets[i + 1]) {
+                            return false;
+                        }
+                    }
+                    if (offsets[cd.dictSize] > cd.dictBytes) {
+                        return false;
+                    }
+                    const uint32_t* codes = reinterpret_cast<const uint32_t*>(base + cd.dataOffset);
+                    for (uint64_t r = 0; r < td.rowCount; r++) {
+                        if (codes[r] >= cd.dictSize) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        for (size_t i = 0; i < eventCount(); i++) {
+            const TraceEventRef& ref = events()[i];
+            if (ref.table >= tableCount() || ref.row >= table(ref.table).rows()) {
+                return false;
+            }
+        }
+        error.clear();
+        return true;
+    }
+
+    // Per-column facts gathered in the first pass over a table.
+    struct ColumnPlan {
+        std::string_view name;
+        ColumnType type = ColumnType::U32;
+        int decimals = 0;
+        std::unordered_map<std::string_view, uint32_t> codes;
+        std::vector<std::string_view> dict;
+        uint64_t dictBytes = 0;
+        uint64_t dataOffset = 0;
+        uint64_t dictOffset = 0;
+    };
+
+    static size_t splitRow(std::string_view row, std::string_view* fields) {
+        size_t count = 0;
+        std::string_view field;
+        while (count < traceMaxColumns && nextField(row, field)) {
+            fields[count++] = field;
+        }
+        return count;
+    }
+
+    // Serialises `csv` into `owned` in the .tct layout and points the reader
+    // at it. The converter writes exactly these bytes to disk.
+    bool buildImage(const CsvTrace& csv, std::string& error) {
+        const auto& events = csv.events();
+        if (events.size() > std::numeric_limits<uint32_t>::max()) {
+            error = "trace has more than 2^32 rows";
+            return false;
+        }
+        int tableOf[traceSourceCount];
+        std::vector<TraceSource> sources;
+        for (int s = 0; s < traceSourceCount; s++) {
+            tableOf[s] = -1;
+            if (csv.loaded(static_cast<TraceSource>(s))) {
+                tableOf[s] = static_cast<int>(sources.size());
+                sources.push_back(static_cast<TraceSource>(s));
+            }
+        }
+
+        // Rows of each table in file order (the merge keeps it) and the
+        // merged index over them
+        std::vector<std::vector<uint32_t>> rowsOf(sources.size());
+        std::vector<TraceEventRef> refs;
+        refs.reserve(events.size());
+        for (uint32_t i = 0; i < events.size(); i++) {
+            int t = tableOf[static_cast<int>(events[i].source)];
+            refs.push_back({ static_cast<uint32_t>(rowsOf[t].size()), static_cast<uint8_t>(t), {} });
+            rowsOf[t].push_back(i);
+        }
+
+        // Pass 1: column names, types, decimals and dictionaries
+        std::vector<std::vector<ColumnPlan>> plans(sources.size());
+        std::string_view fields[traceMaxColumns];
+        for (size_t t = 0; t < sources.size(); t++) {
+            const char* tableName = traceSourceName(sources[t]);
+            size_t columnCount = splitRow(csv.header(sources[t]), fields);
+            if (columnCount == 0) {
+                error = std::string(tableName) + ".csv has no header row";
+                return false;
+            }
+            plans[t].resize(columnCount);
+            for (size_t c = 0; c < columnCount; c++) {
+                plans[t][c].name = fields[c];
+            }
+            plans[t][0].type = ColumnType::TimeNs;
+
+            for (uint32_t e : rowsOf[t]) {
+                if (splitRow(csv.row(events[e]), fields) != columnCount) {
+                    error = std::string(tableName) + ".csv: row with the wrong number of fields";
+                    return false;
+                }
+                for (size_t c = 0; c < columnCount; c++) {
+                    ColumnPlan& plan = plans[t][c];
+                    size_t dot = fields[c].find('.');
+                    if (dot != std::string_view::npos) {
+                        plan.decimals = std::max(plan.decimals, static_cast<int>(fields[c].size() - dot - 1));
+                    }
+                    if (plan.type == ColumnType::TimeNs || plan.type == ColumnType::Dict) {
+                        continue;
+                    }
+                    double value;
+                    if (!parseDouble(fields[c], value)) {
+                        plan.type = ColumnType::Dict;
+                    } else if (plan.type == ColumnType::U32 &&
+                               (dot != std::string_view::npos || value < 0 ||
+                                value > std::numeric_limits<uint32_t>::max())) {
+                        plan.type = ColumnType::F32;
+                    }
+                }
+            }
+            // Dictionaries need every value, so build them once types are settled
+            for (uint32_t e : rowsOf[t]) {
+                splitRow(csv.row(events[e]), fields);
+                for (size_t c = 0; c < columnCount; c++) {
+                    ColumnPlan& plan = plans[t][c];
+                    if (plan.type == ColumnType::Dict && plan.codes.emplace(fields[c], plan.dict.size()).second) {
+                        plan.dict.push_back(fields[c]);
+                        plan.dictBytes += fields[c].size();
+                    }
+                }
+            }
+        }
+
+        // Layout
+        auto align = [](uint64_t offset) { return (offset + traceAlign - 1) / traceAlign * traceAlign; };
+        uint64_t offset = sizeof(TraceFileHeader);
+        const uint64_t eventIndexOffset = align(offset);
+        offset = eventIndexOffset + refs.size() * sizeof(TraceEventRef);
+        const uint64_t tableDirOffset = align(offset);
+        offset = tableDirOffset + sources.size() * sizeof(TraceTableDesc);
+        std::vector<uint64_t> columnDirOffsets(sources.size()), blockIndexOffsets(sources.size());
+        for (size_t t = 0; t < sources.size(); t++) {
+            uint64_t rows = rowsOf[t].size();
+            columnDirOffsets[t] = align(offset);
+            offset = columnDirOffsets[t] + plans[t].size() * sizeof(TraceColumnDesc);
+            blockIndexOffsets[t] = align(offset);
+            offset = blockIndexOffsets[t] + (rows + traceBlockRows - 1) / traceBlockRows * sizeof(int64_t);
+            for (ColumnPlan& plan : plans[t]) {
+                plan.dataOffset = align(offset);
+                offset = plan.dataOffset + rows * columnWidth(plan.type);
+                if (plan.type == ColumnType::Dict) {
+                    plan.dictOffset = align(offset);
+                    offset = plan.dictOffset + (plan.dict.size() + 1) * sizeof(uint32_t) + plan.dictBytes;
+                }
+            }
+        }
+        const uint64_t totalBytes = align(offset);
+
+        owned.assign(totalBytes / sizeof(uint64_t), 0);
+        char* out = reinterpret_cast<char*>(owned.data());
+
+        TraceFileHeader h{};
+        std::memcpy(h.magic, traceMagic, sizeof(h.magic));
+        h.version = traceVersion;
+        h.tableCount = static_cast<uint32_t>(sources.size());
+        h.eventCount = refs.size();
+        h.eventIndexOffset = eventIndexOffset;
+        h.tableDirOffset = tableDirOffset;
+        std::memcpy(out, &h, sizeof(h));
+        if (!refs.empty()) {
+            std::memcpy(out + eventIndexOffset, refs.data(), refs.size() * sizeof(TraceEventRef));
+        }
+
+        // Pass 2: encode the columns
+        for (size_t t = 0; t < sources.size(); t++) {
+            const std::vector<ColumnPlan>& columns = plans[t];
+            TraceTableDesc td{};
+            std::strncpy(td.name, traceSourceName(sources[t]), sizeof(td.name) - 1);
+            td.rowCount = rowsOf[t].size();
+            td.columnDirOffset = columnDirOffsets[t];
+            td.blockIndexOffset = blockIndexOffsets[t];
+            td.columnCount = static_cast<uint32_t>(columns.size());
+            std::memcpy(out + tableDirOffset + t * sizeof(TraceTableDesc), &td, sizeof(td));
+
+            for (size_t c = 0; c < columns.size(); c++) {
+                const ColumnPlan& plan = columns[c];
+                TraceColumnDesc cd{};
+                std::memcpy(cd.name, plan.name.data(), std::min(plan.name.size(), sizeof(cd.name) - 1));
+                cd.type = static_cast<uint8_t>(plan.type);
+                cd.decimals = static_cast<uint8_t>(std::min(plan.decimals, 9));
+                cd.dictSize = static_cast<uint32_t>(plan.dict.size());
+                cd.dataOffset = plan.dataOffset;
+                cd.dictOffset = plan.dictOffset;
+                cd.dictBytes = plan.dictBytes;
+                std::memcpy(out + columnDirOffsets[t] + c * sizeof(TraceColumnDesc), &cd, sizeof(cd));
+
+                if (plan.type == ColumnType::Dict) {
+                    uint32_t* offsets = reinterpret_cast<uint32_t*>(out + plan.dictOffset);
+                    char* bytes = reinterpret_cast<char*>(offsets + plan.dict.size() + 1);
+                    uint32_t at = 0;
+                    for (size_t i = 0; i < plan.dict.size(); i++) {
+                        offsets[i] = at;
+                        std::memcpy(bytes + at, plan.dict[i].data(), plan.dict[i].size());
+                        at += static_cast<uint32_t>(plan.dict[i].size());
+                    }
+                    offsets[plan.dict.size()] = at;
+                }
+            }
+
+            int64_t* blocks = reinterpret_cast<int64_t*>(out + blockIndexOffsets[t]);
+            for (size_t r = 0; r < rowsOf[t].size(); r++) {
+                const TraceEvent& ev = events[rowsOf[t][r]];
+                splitRow(csv.row(ev), fields);
+                for (size_t c = 0; c < columns.size(); c++) {
+                    const ColumnPlan& plan = columns[c];
+                    char* cell = out + plan.dataOffset + r * columnWidth(plan.type);
+                    double value = 0;
+                    switch (plan.type) {
+                        case ColumnType::TimeNs:
+                            std::memcpy(cell, &ev.timeNs, sizeof(int64_t));
+                            break;
+                        case ColumnType::F32: {
+                            parseDouble(fields[c], value);
+                            float f = static_cast<float>(value);
+                            std::memcpy(cell, &f, sizeof(f));
+                            break;
+                        }
+                        case ColumnType::U32: {
+                            parseDouble(fields[c], value);
+                            uint32_t u = static_cast<uint32_t>(value);
+                            std::memcpy(cell, &u, sizeof(u));
+                            break;
+                        }
+                        case ColumnType::Dict: {
+                            uint32_t code = plan.codes.at(fields[c]);
+                            std::memcpy(cell, &code, sizeof(code));
+                            break;
+                        }
+                    }
+                }
+                if (r % traceBlockRows == 0) {
+                    blocks[r / traceBlockRows] = ev.timeNs;
+                }
+            }
+        }
+
+        base = out;
+        length = totalBytes;
+        return true;
+    }
+
+    MappedFile file;
+    std::vector<uint64_t> owned;  // 8-byte aligned in-memory image
+    const char* base = nullptr;
+    size_t length = 0;
+};
+
+// Where the haptic fields live in a table; -1 for columns it lacks.
+// Understands both tactile.csv (contact_*, normal_*, force_N, hand_id) and
+// poses.csv (pos_*, rot_*, controller_id).
+struct HapticColumns {
+    int position[3] = { -1, -1, -1 };
+    int orientation[4] = { -1, -1, -1, -1 };
+    int normal[3] = { -1, -1, -1 };
+    int force = -1;
+    int streamName = -1;
+
+    explicit HapticColumns(const TraceTable& table) {
+        static const char* axes[] = { "x", "y", "z", "w" };
+        for (int i = 0; i < 3; i++) {
+            position[i] = table.find(std::string("contact_") + axes[i]);
+            if (position[i] < 0) {
+                position[i] = table.find(std::string("pos_") + axes[i]);
+            }
+            normal[i] = table.find(std::string("normal_") + axes[i]);
+        }
+        for (int i = 0; i < 4; i++) {
+            orientation[i] = table.find(std::string("rot_") + axes[i]);
+        }
+        force = table.find("force_N");
+        streamName = table.find("hand_id");
+        if (streamName < 0) {
+            streamName = table.find("controller_id");
+        }
+    }
+
+    bool usable() const {
+        return position[0] >= 0 && position[1] >= 0 && position[2] >= 0;
+    }
+};
+
+// Builds the wire sample for one row straight from the columns.
+inline void fillHapticSample(const TraceTable& table, const HapticColumns& map, size_t row, HapticSample& out) {
+    out = makeHapticSample();
+    out.header.timestampNs = table.timeNs(row);
+    auto copy = [&](const int* columns, float* dest, int count) {
+        for (int i = 0; i < count; i++) {
+            if (columns[i] >= 0) {
+                dest[i] = static_cast<float>(table.column(columns[i]).number(row));
+            }
+        }
+    };
+    copy(map.position, out.payload.position, 3);
+    copy(map.orientation, out.payload.orientation, 4);
+    copy(map.normal, out.payload.normal, 3);
+    copy(&map.force, &out.payload.forceN, 1);
+    if (map.streamName >= 0 && table.column(map.streamName).type() == ColumnType::Dict) {
+        out.header.streamId = streamIdFromName(table.column(map.streamName).string(row));
+    }
+}
+
+// Re-creates the CSV row text, optionally with a replacement timestamp
+// (printed with ns precision). Returns the length, or 0 if `size` is too small.
+inline size_t formatTraceRow(const TraceTable& table, size_t row, char* out, size_t size,
+                             const int64_t* stampNs = nullptr) {
+    size_t used = 0;
+    for (size_t c = 0; c < table.columnCount(); c++) {
+        TraceColumn column = table.column(c);
+        int n;
+        char* at = out + used;
+        size_t left = size - used;
+        const char* sep = c == 0 ? "" : ",";
+        switch (column.type()) {
+            case ColumnType::TimeNs:
+                n = stampNs ? std::snprintf(at, left, "%s%.9f", sep, *stampNs / 1e9)
+                            : std::snprintf(at, left, "%s%.*f", sep, column.decimals(), column.number(row));
+                break;
+            case ColumnType::F32:
+                n = std::snprintf(at, left, "%s%.*f", sep, column.decimals(), column.data<float>()[row]);
+                break;
+            case ColumnType::U32:
+                n = std::snprintf(at, left, "%s%u", sep, column.data<uint32_t>()[row]);
+                break;
+            case ColumnType::Dict: {
+                std::string_view s = column.string(row);
+                n = std::snprintf(at, left, "%s%.*s", sep, static_cast<int>(s.size()), s.data());
+                break;
+            }
+            default:
+                n = -1;
+        }
+        if (n < 0 || static_cast<size_t>(n) >= left) {
+            return 0;
+        }
+        used += static_cast<size_t>(n);
+    }
+    return used;
+}
+
+} // namespace tactile
@@ -0,0 +1,384 @@
+// Contact-aware reduction for the tactile force stream. ContactCodec splits
+// a stream into idle stretches and contact episodes and sends each one
+// differently:
+//
+//   idle     a keyframe (the full sample) when the stream starts or a
+//            contact ends, then only a heartbeat (a bare header, so the
+//            receiver knows the link is alive) every heartbeatNs
+//   contact  every sample, as a delta against the last one sent: the
+//            header, a 16-bit mask of the payload fields that changed and
+//            those fields; onset, release and collider changes are sent as
+//            keyframes
+//
+// and a fresh keyframe every keyframeNs in either state, so a receiver that
+// lost a delta catches up. The message kinds are encoded as in
+// haptic_wire.hpp (encodeContact) and turned back into samples by
+// ContactDecoder on the receiving side.
+//
+// Contact starts on a sample that names a collider or whose force exceeds
+// onsetForceN, and ends once neither has been true for releaseHoldNs (force
+// must drop under releaseForceN); the recorded force reads 0.000 for a few
+// samples in the middle of a touch, which the hold rides out. Streams
+// without collider names (binary input) pass contactColliderUnknown and are
+// segmented on force alone.
+//
+// Like DeadbandCodec it mirrors the receiver, so the stats include the
+// reconstruction error as well as bytes and the onset latency: the time
+// from the first sample of a contact to the first message that shows it.
+#pragma once
+
+#include "deadband.hpp"
+#include "haptic_wire.hpp"
+#include "options.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+namespace tactile {
+
+enum class ContactEvent : uint8_t {
+    None,     // idle sample
+    Onset,
+    Sustain,
+    Release,
+};
+
+inline const char* contactEventName(ContactEvent event) {
+    switch (event) {
+        case ContactEvent::None: return "none";
+        case ContactEvent::Onset: return "onset";
+        case ContactEvent::Sustain: return "sustain";
+        case ContactEvent::Release: return "release";
+    }
+    return "?";
+}
+
+enum class ContactMessage : uint8_t {
+    Skip,       // nothing sent
+    Keyframe,
+    Heartbeat,
+    Delta,
+};
+
+inline const char* contactMessageName(ContactMessage message) {
+    switch (message) {
+        case ContactMessage::Skip: return "skip";
+        case ContactMessage::Keyframe: return "keyframe";
+        case ContactMessage::Heartbeat: return "heartbeat";
+        case ContactMessage::Delta: return "delta";
+    }
+    return "?";
+}
+
+// collider argument of ContactCodec::offer for streams that do not name one
+constexpr int contactColliderUnknown = -1;
+// ... and for a row whose collider_name is "none"
+constexpr int contactColliderNone = 0;
+
+struct ContactConfig {
+    double onsetForceN = 1.0;
+    double releaseForceN = 0.5;
+    int64_t releaseHoldNs = 50000000;   // 50 ms without contact ends it
+    int64_t heartbeatNs = 100000000;    // idle liveness
+    int64_t keyframeNs = 1000000000;    // full refresh
+};
+
+// Reads --onset-force, --release-force, --release-hold-ms, --heartbeat-ms
+// and --keyframe-ms.
+inline bool contactConfigFromOptions(const Options& opts, ContactConfig& out) {
+    ContactConfig config;
+    config.onsetForceN = opts.getDouble("--onset-force", config.onsetForceN);
+    config.releaseForceN = opts.getDouble("--release-force", std::min(config.releaseForceN, config.onsetForceN));
+    config.releaseHoldNs = secondsToNs(opts.getDouble("--release-hold-ms", 50) / 1e3);
+    config.heartbeatNs = secondsToNs(opts.getDouble("--heartbeat-ms", 100) / 1e3);
+    config.keyframeNs = secondsToNs(opts.getDouble("--keyframe-ms", 1000) / 1e3);
+    if (config.releaseForceN > config.onsetForceN || config.releaseForceN < 0) {
+        std::cerr << "--release-force must be between 0 and --onset-force" << std::endl;
+        return false;
+    }
+    if (config.releaseHoldNs < 0 || config.heartbeatNs <= 0 || config.keyframeNs < config.heartbeatNs) {
+        std::cerr << "Need --release-hold-ms >= 0, --heartbeat-ms > 0 and --keyframe-ms >= --heartbeat-ms"
+                  << std::endl;
+        return false;
+    }
+    out = config;
+    return true;
+}
+
+struct ContactDecision {
+    ContactEvent event = ContactEvent::None;
+    ContactMessage message = ContactMessage::Skip;
+    uint16_t changed = 0;  // delta mask
+    size_t bytes = 0;
+};
+
+struct ContactStats {
+    uint64_t inputs = 0;
+    uint64_t contactSamples = 0;
+    uint64_t keyframes = 0, heartbeats = 0, deltas = 0;
+    uint64_t inputBytes = 0;  // every sample as a full binary message
+    uint64_t sentBytes = 0;
+    uint64_t onsets = 0, releases = 0, colliderChanges = 0;
+    int64_t onsetLatencySumNs = 0, onsetLatencyMaxNs = 0;
+    DeadbandStats error;      // sent counts every message that updates the payload
+
+    uint64_t messages() const {
+        return keyframes + heartbeats + deltas;
+    }
+
+    // Bytes in over bytes out
+    double compressionRatio() const {
+        return sentBytes ? double(inputBytes) / double(sentBytes) : 0.0;
+    }
+
+    double onsetLatencyMeanNs() const {
+        return onsets ? double(onsetLatencySumNs) / double(onsets) : 0.0;
+    }
+};
+
+class ContactCodec {
+public:
+    explicit ContactCodec(const ContactConfig& config = ContactConfig()) : config(config) {}
+
+    // One sample of the stream; `collider` is an id for the collider the
+    // row names (contactColliderNone for "none") or contactColliderUnknown.
+    ContactDecision offer(const HapticSample& sample, int collider = contactColliderUnknown) {
+        const int64_t t = sample.header.timestampNs;
+        const double force = std::fabs(double(sample.payload.forceN));
+        const bool named = collider > contactColliderNone;
+        // Where a contact would start without hysteresis, for the onset latency
+        if (named || force > 0) {
+            if (!firstTouch) {
+                firstTouch = true;
+                firstTouchNs = t;
+            }
+        } else if (!inContact) {
+            firstTouch = false;
+        }
+
+        ContactDecision d;
+        if (!inContact) {
+            if (named || force > config.onsetForceN) {
+                inContact = true;
+                lastTouchNs = t;
+                contactCollider = collider;
+                d.event = ContactEvent::Onset;
+                d.message = ContactMessage::Keyframe;
+                runStats.onsets++;
+                const int64_t latency = t - (firstTouch ? firstTouchNs : t);
+                runStats.onsetLatencySumNs += latency;
+                runStats.onsetLatencyMaxNs = std::max(runStats.onsetLatencyMaxNs, latency);
+            } else if (!haveSent || t - lastKeyframeNs >= config.keyframeNs) {
+                d.message = ContactMessage::Keyframe;
+            } else if (t - lastMessageNs >= config.heartbeatNs) {
+                d.message = ContactMessage::Heartbeat;
+            }
+        } else if (named || force > config.releaseForceN) {
+            lastTouchNs = t;
+            d.event = ContactEvent::Sustain;
+            d.message = ContactMessage::Delta;
+            if (named && collider != contactCollider) {
+                if (contactCollider > contactColliderNone) {
+                    d.message = ContactMessage::Keyframe;
+                    runStats.colliderChanges++;
+                }
+                contactCollider = collider;
+            }
+        } else if (t - lastTouchNs >= config.releaseHoldNs) {
+            inContact = false;
+            firstTouch = false;
+            d.event = ContactEvent::Release;
+            d.message = ContactMessage::Keyframe;
+            runStats.releases++;
+        } else {
+            d.event = ContactEvent::Sustain;
+            d.message = ContactMessage::Delta;
+        }
+        if (d.message == ContactMessage::Delta && t - lastKeyframeNs >= config.keyframeNs) {
+            d.message = ContactMessage::Keyframe;
+        }
+
+        if (d.message == ContactMessage::Delta) {
+            const float* now = reinterpret_cast<const float*>(&sample.payload);
+            const float* before = reinterpret_cast<const float*>(&shown.payload);
+            for (int i = 0; i < hapticPayloadFields; i++) {
+                if (std::memcmp(&now[i], &before[i], sizeof(float)) != 0) {
+                    d.changed |= uint16_t(1u << i);
+                }
+            }
+            d.bytes = hapticDeltaSize(d.changed);
+        } else if (d.message == ContactMessage::Keyframe) {
+            d.changed = uint16_t((1u << hapticPayloadFields) - 1);
+            d.bytes = hapticWireSize;
+        } else if (d.message == ContactMessage::Heartbeat) {
+            d.bytes = hapticHeartbeatSize;
+        }
+        account(sample, d);
+        return d;
+    }
+
+    bool contact() const {
+        return inContact;
+    }
+
+    const ContactStats& stats() const {
+        return runStats;
+    }
+
+    void resetStats() {
+        runStats = ContactStats();
+    }
+
+private:
+    void account(const HapticSample& sample, const ContactDecision& d) {
+        const int64_t t = sample.header.timestampNs;
+        runStats.inputs++;
+        runStats.inputBytes += hapticWireSize;
+        runStats.sentBytes += d.bytes;
+        runStats.contactSamples += d.event == ContactEvent::Onset || d.event == ContactEvent::Sustain;
+        switch (d.message) {
+            case ContactMessage::Keyframe:
+                runStats.keyframes++;
+                lastKeyframeNs = t;
+                break;
+            case ContactMessage::Heartbeat:
+                runStats.heartbeats++;
+                break;
+            case ContactMessage::Delta:
+                runStats.deltas++;
+                break;
+            case ContactMessage::Skip:
+                break;
+        }
+        if (d.message != ContactMessage::Skip) {
+            lastMessageNs = t;
+        }
+        // A keyframe or delta leaves the receiver holding this sample
+        if (d.message == ContactMessage::Keyframe || d.message == ContactMessage::Delta) {
+            shown = sample;
+            haveSent = true;
+            runStats.error.sent++;
+        }
+        runStats.error.inputs++;
+        runStats.error.add(sample.payload, shown.payload);
+    }
+
+    ContactConfig config;
+    bool inContact = false;
+    int contactCollider = contactColliderUnknown;
+    int64_t lastTouchNs = 0;
+    bool firstTouch = false;
+    int64_t firstTouchNs = 0;
+    bool haveSent = false;
+    int64_t lastKeyframeNs = 0;
+    int64_t lastMessageNs = 0;
+    HapticSample shown{};  // what the receiver holds
+    ContactStats runStats;
+};
+
+// Encodes the message `d` asks for: the full sample for a keyframe, the
+// fields in d.changed for a delta, the header for a heartbeat. Returns the
+// bytes written, d.bytes (0 for Skip or if buf is too small).
+inline size_t encodeContact(const HapticSample& sample, const ContactDecision& d, void* buf, size_t size) {
+    switch (d.message) {
+        case ContactMessage::Keyframe: return encodeHaptic(sample, buf, size);
+        case ContactMessage::Delta: return encodeHapticDelta(sample, d.changed, buf, size);
+        case ContactMessage::Heartbeat: return encodeHapticHeartbeat(sample.header, buf, size);
+        case ContactMessage::Skip: break;
+    }
+    return 0;
+}
+
+// What ContactDecoder::decode made of a message
+enum class ContactReceived : uint8_t {
+    Invalid,    // not a haptic message
+    Sample,     // a full sample: a keyframe, or any other publisher's output
+    Delta,      // applied to the stream's last sample
+    Heartbeat,  // no new payload; the stream's last sample under its header
+    Unsynced,   // a delta after a lost message: header only until a keyframe
+};
+
+struct ContactDecoderStats {
+    uint64_t samples = 0, deltas = 0, heartbeats = 0, unsynced = 0;
+};
+
+// One line for a receiver's summary, printed only if the relay ran the
+// contact codec
+inline void printContactStats(std::ostream& out, const char* prefix, const ContactDecoderStats& s) {
+    if (s.deltas + s.heartbeats + s.unsynced == 0) {
+        return;
+    }
+    out << prefix << "Contact codec: " << s.samples << " keyframes, " << s.deltas << " deltas, " << s.heartbeats
+        << " heartbeats, " << s.unsynced << " deltas dropped waiting for a keyframe\n";
+}
+
+// Receiving side of ContactCodec. Keeps the last sample of every stream and
+// rebuilds the samples deltas stand for. The relay numbers every message
+// kind, so a gap in a stream's sequence means a delta may have been lost;
+// its deltas are then Unsynced until the next keyframe, rather than applied
+// to a payload the sender no longer assumes. Text and plain binary input
+// decode as usual, so a receiver can use this whatever the relay sends.
+class ContactDecoder {
+public:
+    // Writes the sample the stream now shows into `out` (for Unsynced and
+    // Invalid, only the header where there is one).
+    ContactReceived decode(const void* data, size_t size, HapticSample& out) {
+        const uint8_t type = wireMessageType(data, size);
+        if (type == static_cast<uint8_t>(MessageType::HapticDelta) ||
+            type == static_cast<uint8_t>(MessageType::HapticHeartbeat)) {
+            if (!decodeWireHeader(data, size, out.header)) {
+                return ContactReceived::Invalid;
+            }
+            Stream& stream = streams[out.header.streamId];
+            const bool inOrder = stream.synced && out.header.seq == stream.lastSeq + 1;
+            stream.lastSeq = out.header.seq;
+            if (type == static_cast<uint8_t>(MessageType::HapticHeartbeat)) {
+                // Idle: nothing changed, but a gap still leaves the payload in doubt
+                stream.synced = inOrder;
+                out.payload = stream.shown.payload;
+                out.header.type = static_cast<uint8_t>(MessageType::HapticSample);
+                runStats.heartbeats++;
+                return ContactReceived::Heartbeat;
+            }
+            if (!inOrder || !applyHapticDelta(data, size, stream.shown)) {
+                stream.synced = false;
+                runStats.unsynced++;
+                return ContactReceived::Unsynced;
+            }
+            out = stream.shown;
+            runStats.deltas++;
+            return ContactReceived::Delta;
+        }
+        if (!decodeHaptic(data, size, out)) {
+            return ContactReceived::Invalid;
+        }
+        if (out.header.seq != noSequence) {
+            Stream& stream = streams[out.header.streamId];
+            stream.shown = out;
+            stream.lastSeq = out.header.seq;
+            stream.synced = true;
+        }
+        runStats.samples++;
+        return ContactReceived::Sample;
+    }
+
+    const ContactDecoderStats& stats() const {
+        return runStats;
+    }
+
+private:
+    struct Stream {
+        HapticSample shown{};
+        uint64_t lastSeq = 0;
+        bool synced = false;
+    };
+
+    std::unordered_map<uint16_t, Stream> streams;
+    ContactDecoderStats runStats;
+};
+
+} // namespace tactile
@@ -0,0 +1,292 @@
+// Haptic data reduction for the relay. DeadbandCodec decides which samples
+// are transmitted and mirrors what a receiver reconstructs from the ones it
+// gets, so it can report the reconstruction error it causes.
+//
+// Modes:
+//   off         every sample is sent
+//   absolute    the original relay rule: any position axis moved by more
+//               than 0.1 since the last sent sample
+//   weber       perceptual dead-band: position, orientation or force moved
+//               by more than a Weber fraction k of the last sent value's
+//               magnitude (with an absolute floor near zero)
+//   predictive  both ends extrapolate linearly from the last two sent
+//               samples; a sample is sent when it leaves the Weber
+//               dead-band around that prediction
+#pragma once
+
+#include "haptic_wire.hpp"
+#include "options.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+namespace tactile {
+
+enum class DeadbandMode {
+    Off,
+    Absolute,
+    Weber,
+    Predictive,
+};
+
+inline bool parseDeadbandMode(const std::string& name, DeadbandMode& out) {
+    if (name == "off") {
+        out = DeadbandMode::Off;
+    } else if (name == "absolute") {
+        out = DeadbandMode::Absolute;
+    } else if (name == "weber") {
+        out = DeadbandMode::Weber;
+    } else if (name == "predictive") {
+        out = DeadbandMode::Predictive;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* deadbandModeName(DeadbandMode mode) {
+    switch (mode) {
+        case DeadbandMode::Off: return "off";
+        case DeadbandMode::Absolute: return "absolute";
+        case DeadbandMode::Weber: return "weber";
+        case DeadbandMode::Predictive: return "predictive";
+    }
+    return "?";
+}
+
+struct DeadbandConfig {
+    double absoluteThreshold = 0.1;    // absolute mode, per position axis
+    double positionWeber = 0.1;
+    double positionFloor = 0.005;      // same unit as the trace positions
+    double orientationWeber = 0.1;
+    double orientationFloorRad = 0.0175;  // ~1 degree
+    double forceWeber = 0.1;
+    double forceFloor = 0.05;          // N
+    int64_t maxExtrapolationNs = 250000000;  // predictive mode holds after this
+};
+
+// Reads --deadband-k (one Weber fraction for all three), the per-quantity
+// --weber-position/--weber-orientation/--weber-force overrides, and the
+// --floor-position/--floor-orientation-deg/--floor-force absolute floors.
+inline DeadbandConfig deadbandConfigFromOptions(const Options& opts) {
+    DeadbandConfig config;
+    double k = opts.getDouble("--deadband-k", 0.1);
+    config.positionWeber = opts.getDouble("--weber-position", k);
+    config.orientationWeber = opts.getDouble("--weber-orientation", k);
+    config.forceWeber = opts.getDouble("--weber-force", k);
+    config.positionFloor = opts.getDouble("--floor-position", config.positionFloor);
+    config.orientationFloorRad = opts.getDouble("--floor-orientation-deg", 1.0) * (3.14159265358979323846 / 180.0);
+    config.forceFloor = opts.getDouble("--floor-force", config.forceFloor);
+    return config;
+}
+
+inline double positionDistance(const float* a, const float* b) {
+    double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+inline double positionNorm(const float* p) {
+    return std::sqrt(double(p[0]) * p[0] + double(p[1]) * p[1] + double(p[2]) * p[2]);
+}
+
+inline double quaternionNorm(const float* q) {
+    return std::sqrt(double(q[0]) * q[0] + double(q[1]) * q[1] + double(q[2]) * q[2] + double(q[3]) * q[3]);
+}
+
+// Rotation angle (rad) between two orientations, in [0, pi]. Recorded
+// quaternions are rounded to 4 decimals, so they are normalised here.
+inline double quaternionAngle(const float* a, const float* b) {
+    double norms = quaternionNorm(a) * quaternionNorm(b);
+    if (norms == 0) {
+        return 0;
+    }
+    double dot = double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2] + double(a[3]) * b[3];
+    return 2.0 * std::acos(std::min(1.0, std::fabs(dot) / norms));
+}
+
+// Rotation angle (rad) of an orientation away from identity.
+inline double quaternionMagnitude(const float* q) {
+    double n = quaternionNorm(q);
+    return n == 0 ? 0 : 2.0 * std::acos(std::min(1.0, std::fabs(double(q[3])) / n));
+}
+
+inline void normalizeQuaternion(float* q) {
+    double n = quaternionNorm(q);
+    if (n > 0) {
+        for (int i = 0; i < 4; i++) {
+            q[i] = static_cast<float>(q[i] / n);
+        }
+    } else {
+        q[0] = q[1] = q[2] = 0.0f;
+        q[3] = 1.0f;
+    }
+}
+
+// What a receiver displays between transmissions: the last sample held, or
+// extrapolated from the last two.
+class HapticPredictor {
+public:
+    explicit HapticPredictor(bool extrapolate, int64_t maxExtrapolationNs = 250000000)
+        : extrapolate(extrapolate), maxExtrapolationNs(maxExtrapolationNs) {}
+
+    // Call with every sample that was actually transmitted.
+    void update(const HapticSample& sent) {
+        prev = last;
+        last = sent;
+        count = std::min(count + 1, 2);
+    }
+
+    bool ready() const {
+        return count > 0;
+    }
+
+    void predict(int64_t tNs, HapticPayload& out) const {
+        out = last.payload;
+        if (!extrapolate || count < 2) {
+            return;
+        }
+        int64_t span = last.header.timestampNs - prev.header.timestampNs;
+        int64_t ahead = std::min(tNs - last.header.timestampNs, maxExtrapolationNs);
+        if (span <= 0 || ahead <= 0) {
+            return;
+        }
+        double f = double(ahead) / double(span);
+        auto extend = [f](float* dst, const float* now, const float* before, int n) {
+            for (int i = 0; i < n; i++) {
+                dst[i] = static_cast<float>(now[i] + (now[i] - before[i]) * f);
+            }
+        };
+        const HapticPayload& a = last.payload;
+        const HapticPayload& b = prev.payload;
+        extend(out.position, a.position, b.position, 3);
+        // q and -q are the same rotation; extrapolate along the short arc
+        float before[4];
+        double dot = 0;
+        for (int i = 0; i < 4; i++) {
+            dot += double(a.orientation[i]) * b.orientation[i];
+        }
+        for (int i = 0; i < 4; i++) {
+            before[i] = dot < 0 ? -b.orientation[i] : b.orientation[i];
+        }
+        extend(out.orientation, a.orientation, before, 4);
+        normalizeQuaternion(out.orientation);
+        extend(out.normal, a.normal, b.normal, 3);
+        extend(&out.forceN, &a.forceN, &b.forceN, 1);
+    }
+
+private:
+    bool extrapolate;
+    int64_t maxExtrapolationNs;
+    int count = 0;
+    HapticSample last{};
+    HapticSample prev{};
+};
+
+// Packet reduction and the error between every input sample and what the
+// receiver shows at that moment.
+struct DeadbandStats {
+    uint64_t inputs = 0;
+    uint64_t sent = 0;
+    double positionSq = 0, positionMax = 0;
+    double orientationSq = 0, orientationMax = 0;  // rad
+    double forceSq = 0, forceMax = 0;
+
+    void add(const HapticPayload& actual, const HapticPayload& shown) {
+        double p = positionDistance(actual.position, shown.position);
+        double o = quaternionAngle(actual.orientation, shown.orientation);
+        double f = std::fabs(double(actual.forceN) - shown.forceN);
+        positionSq += p * p;
+        orientationSq += o * o;
+        forceSq += f * f;
+        positionMax = std::max(positionMax, p);
+        orientationMax = std::max(orientationMax, o);
+        forceMax = std::max(forceMax, f);
+    }
+
+    // Fraction of input samples that were not sent.
+    double reductionRatio() const {
+        return inputs ? 1.0 - double(sent) / double(inputs) : 0.0;
+    }
+
+    double positionRms() const {
+        return inputs ? std::sqrt(positionSq / inputs) : 0.0;
+    }
+
+    double orientationRms() const {
+        return inputs ? std::sqrt(orientationSq / inputs) : 0.0;
+    }
+
+    double forceRms() const {
+        return inputs ? std::sqrt(forceSq / inputs) : 0.0;
+    }
+};
+
+class DeadbandCodec {
+public:
+    explicit DeadbandCodec(DeadbandMode mode, const DeadbandConfig& config = DeadbandConfig())
+        : codecMode(mode), config(config),
+          receiver(mode == DeadbandMode::Predictive, config.maxExtrapolationNs) {}
+
+    // Returns true if `sample` should be transmitted.
+    bool offer(const HapticSample& sample) {
+        HapticPayload shown;
+        bool send = true;
+        if (receiver.ready() && codecMode != DeadbandMode::Off) {
+            receiver.predict(sample.header.timestampNs, shown);
+            send = exceeds(sample.payload, shown);
+        }
+        if (send) {
+            receiver.update(sample);
+            shown = sample.payload;
+            runStats.sent++;
+        }
+        runStats.inputs++;
+        runStats.add(sample.payload, shown);
+        return send;
+    }
+
+    // Flags for transmitted samples, telling receivers how to reconstruct.
+    uint16_t wireFlags() const {
+        return codecMode == DeadbandMode::Predictive ? wireFlagPredictive : 0;
+    }
+
+    DeadbandMode mode() const {
+        return codecMode;
+    }
+
+    const DeadbandStats& stats() const {
+        return runStats;
+    }
+
+    void resetStats() {
+        runStats = DeadbandStats();
+    }
+
+private:
+    bool exceeds(const HapticPayload& actual, const HapticPayload& reference) const {
+        if (codecMode == DeadbandMode::Absolute) {
+            for (int i = 0; i < 3; i++) {
+                if (std::fabs(double(actual.position[i]) - reference.position[i]) > config.absoluteThreshold) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        double positionLimit = std::max(config.positionWeber * positionNorm(reference.position), config.positionFloor);
+        double orientationLimit = std::max(config.orientationWeber * quaternionMagnitude(reference.orientation),
+                                           config.orientationFloorRad);
+        double forceLimit = std::max(config.forceWeber * std::fabs(double(reference.forceN)), config.forceFloor);
+        return positionDistance(actual.position, reference.position) > positionLimit ||
+               quaternionAngle(actual.orientation, reference.orientation) > orientationLimit ||
+               std::fabs(double(actual.forceN) - reference.forceN) > forceLimit;
+    }
+
+    DeadbandMode codecMode;
+    DeadbandConfig config;
+    HapticPredictor receiver;  // mirror of the receiving end
+    DeadbandStats runStats;
+};
+
+} // namespace tactile
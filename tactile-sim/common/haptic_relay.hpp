@@ -0,0 +1,241 @@
+// Sharded session state for the haptic relay (control/haptic_tx.cpp).
+//
+// A session is one controller stream, keyed by WireHeader::streamId (the
+// hand_id / controller_id hash for text input). The receive thread only
+// reads that key and hands the raw message to the worker that owns the
+// session (key % workers); each worker keeps its sessions' dead-band codec
+// and output sequence numbering to itself, so workers share nothing.
+//
+// Forwarded binary messages begin with the 6 header bytes magic, version,
+// type, streamId, which makes them the session's output topic: a subscriber
+// interested in one hand subscribes to sessionTopic() of its streamId (and,
+// when the relay runs the contact codec, to its delta and heartbeat topics).
+//
+// useContactCodec() replaces the dead-band with ContactCodec
+// (contact_codec.hpp): keyframes, deltas and heartbeats instead of full
+// samples, which receivers turn back into samples with ContactDecoder.
+#pragma once
+
+#include "clock.hpp"
+#include "contact_codec.hpp"
+#include "deadband.hpp"
+#include "haptic_wire.hpp"
+#include "hop_stamps.hpp"
+#include "sequence_tracker.hpp"
+#include "spsc_ring.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+namespace tactile {
+
+// A received message as queued for a worker, with the hop frames that came
+// with it and the relay's own ingress and processing-start times.
+struct RelayMessage {
+    int64_t ingressNs;  // taken off the SUB socket
+    int64_t startNs;    // taken out of the worker's inbox
+    HopTrail hops;      // upstream hops, passed on downstream
+    uint16_t size;
+    char data[358];
+
+    // Returns false for anything longer than a text tactile.csv row, which
+    // is not a haptic sample.
+    bool assign(const void* message, size_t length, const HopTrail& trail, int64_t arrivalNs) {
+        if (length > sizeof(data)) {
+            return false;
+        }
+        ingressNs = arrivalNs;
+        startNs = arrivalNs;
+        hops = trail;
+        size = static_cast<uint16_t>(length);
+        std::memcpy(data, message, length);
+        return true;
+    }
+};
+
+static_assert(sizeof(RelayMessage) == 512, "RelayMessage must stay eight cache lines");
+
+using RelayInbox = SpscRing<RelayMessage, 4096>;
+
+constexpr size_t sessionTopicSize = offsetof(WireHeader, flags);
+
+// Writes the subscription prefix of a session's binary output into `out`
+// (at least sessionTopicSize bytes) and returns its length.
+inline size_t sessionTopic(uint16_t streamId, char* out, MessageType type = MessageType::HapticSample) {
+    HapticSample s = makeHapticSample();
+    s.header.type = static_cast<uint8_t>(type);
+    s.header.streamId = streamId;
+    std::memcpy(out, &s.header, sessionTopicSize);
+    return sessionTopicSize;
+}
+
+// Session key of a received message without decoding the payload. Text
+// messages have to be parsed; the legacy "timestamp,x,y,z" layout carries no
+// controller and maps to session 0.
+inline bool sessionKey(const void* data, size_t size, uint16_t& key) {
+    if (isBinaryMessage(data, size)) {
+        std::memcpy(&key, static_cast<const char*>(data) + offsetof(WireHeader, streamId), sizeof(key));
+        return true;
+    }
+    HapticSample sample;
+    if (!parseHapticText(static_cast<const char*>(data), size, sample)) {
+        return false;
+    }
+    key = sample.header.streamId;
+    return true;
+}
+
+inline size_t shardOf(uint16_t key, size_t shards) {
+    return key % shards;
+}
+
+struct RelaySession {
+    RelaySession(DeadbandMode mode, const DeadbandConfig& config, const ContactConfig& contactConfig)
+        : codec(mode, config), contact(contactConfig) {}
+
+    DeadbandCodec codec;
+    ContactCodec contact;   // used instead of codec with useContactCodec()
+    SequenceTracker input;  // numbering as received from the publisher
+    uint64_t seq = 0;       // output numbering, per session
+};
+
+// One shard: the sessions it owns and the inbox the receive thread fills.
+// Everything but the counters is touched by the worker thread only.
+class RelayWorker {
+public:
+    RelayWorker(DeadbandMode mode, const DeadbandConfig& config, WireFormat wire, const Clock& clock = Clock())
+        : mode(mode), config(config), wire(wire), clock(clock), queue(std::make_unique<RelayInbox>()) {}
+
+    // Receive thread side. Waits for room rather than dropping a sample.
+    void push(const RelayMessage& m) {
+        if (!queue->tryPush(m)) {
+            inboxFullStalls.fetch_add(1, std::memory_order_relaxed);
+            while (!queue->tryPush(m)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Sends keyframes, deltas and heartbeats (contact_codec.hpp) instead of
+    // dead-band filtered samples. Binary output only; call before the
+    // first message.
+    void useContactCodec(const ContactConfig& config) {
+        contactEnabled = true;
+        contactConfig = config;
+    }
+
+    bool contactCodec() const {
+        return contactEnabled;
+    }
+
+    // Worker side: processes everything queued so far, calling
+    // sink(sample, data, size, message) for each message to forward.
+    // Returns the number of messages taken from the inbox.
+    template <typename Sink>
+    size_t drain(Sink&& sink) {
+        size_t handled = 0;
+        while (queue->tryPop(incoming)) {
+            incoming.startNs = clock.nowNs();
+            process(incoming, sink);
+            handled++;
+        }
+        return handled;
+    }
+
+    // Runs one message through its session's codec and calls
+    // sink(sample, data, size, m) with the re-encoded sample if it is
+    // forwarded. Returns false only if the message is not a haptic sample.
+    // Used directly when the relay runs without worker threads.
+    template <typename Sink>
+    bool process(const RelayMessage& m, Sink&& sink) {
+        if (!decodeHaptic(m.data, m.size, sample)) {
+            bump(malformedCount);
+            return false;
+        }
+        bump(processedCount);
+        RelaySession& session = find(sample.header.streamId);
+        if (sample.header.seq != noSequence) {
+            session.input.record(sample.header.seq);
+        }
+        size_t len;
+        if (contactEnabled) {
+            const ContactDecision d = session.contact.offer(sample);
+            if (d.message == ContactMessage::Skip) {
+                return true;
+            }
+            // Every message kind takes a number, so receivers see a lost delta
+            sample.header.seq = session.seq++;
+            sample.header.flags = 0;
+            len = encodeContact(sample, d, out, sizeof(out));
+        } else {
+            if (!session.codec.offer(sample)) {
+                return true;
+            }
+            // Forward the sample under the session's own sequence numbering
+            sample.header.seq = session.seq++;
+            sample.header.flags = session.codec.wireFlags();
+            len = (wire == WireFormat::Text)
+                ? formatHapticText(sample, out, sizeof(out))
+                : encodeHaptic(sample, out, sizeof(out));
+        }
+        bump(forwardedCount);
+        sink(sample, out, len, m);
+        return true;
+    }
+
+    // Worker side; sessions are created on their first sample.
+    const std::unordered_map<uint16_t, RelaySession>& sessions() const {
+        return owned;
+    }
+
+    std::unordered_map<uint16_t, RelaySession>& sessions() {
+        return owned;
+    }
+
+    // Counters, readable from any thread.
+    uint64_t processed() const { return processedCount.load(std::memory_order_relaxed); }
+    uint64_t forwarded() const { return forwardedCount.load(std::memory_order_relaxed); }
+    uint64_t malformed() const { return malformedCount.load(std::memory_order_relaxed); }
+    uint64_t stalls() const { return inboxFullStalls.load(std::memory_order_relaxed); }
+
+private:
+    // Single writer, so no read-modify-write instruction is needed
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    RelaySession& find(uint16_t key) {
+        auto it = owned.find(key);
+        if (it == owned.end()) {
+            it = owned.emplace(key, RelaySession(mode, config, contactConfig)).first;
+        }
+        return it->second;
+    }
+
+    DeadbandMode mode;
+    DeadbandConfig config;
+    WireFormat wire;
+    bool contactEnabled = false;
+    ContactConfig contactConfig;
+    Clock clock;
+    std::unique_ptr<RelayInbox> queue;
+
+    // Worker thread only
+    std::unordered_map<uint16_t, RelaySession> owned;
+    RelayMessage incoming;
+    HapticSample sample;
+    char out[128];
+
+    // Written by the worker, except the stall count (receive thread)
+    alignas(cacheLineSize) std::atomic<uint64_t> processedCount{0};
+    std::atomic<uint64_t> forwardedCount{0};
+    std::atomic<uint64_t> malformedCount{0};
+    alignas(cacheLineSize) std::atomic<uint64_t> inboxFullStalls{0};
+};
+
+} // namespace tactile
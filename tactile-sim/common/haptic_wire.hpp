@@ -0,0 +1,330 @@
+// Versioned binary wire format for haptic samples, shared by the relay
+// (control/haptic_tx.cpp) and every receiver.
+//
+// A message is a fixed 24-byte header followed by a fixed payload, sent in
+// little-endian byte order exactly as laid out in memory. The legacy text
+// format ("timestamp,x,y,z") is still accepted on input and can be produced
+// as a fallback for older subscribers.
+//
+// The contact codec (contact_codec.hpp) adds two shorter kinds: a delta is
+// the header, a 16-bit mask of the payload floats that changed since the
+// stream's previous message and those floats in field order; a heartbeat
+// is the header alone.
+#pragma once
+
+#include "text_fields.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "haptic_wire.hpp assumes a little-endian host"
+#endif
+
+namespace tactile {
+
+constexpr uint16_t wireMagic = 0x4854;  // bytes 'T','H' on the wire
+constexpr uint8_t wireVersion = 1;
+
+enum class MessageType : uint8_t {
+    HapticSample = 1,
+    HapticDelta = 2,
+    HapticHeartbeat = 3,
+};
+
+// WireHeader::seq of text input that carried no "#<seq>" suffix
+constexpr uint64_t noSequence = ~uint64_t(0);
+
+// WireHeader::flags bits
+constexpr uint16_t wireFlagPredictive = 0x0001;  // extrapolate between samples
+
+struct WireHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint16_t streamId;
+    uint16_t flags;
+    uint64_t seq;  // per stream, from 0
+    int64_t timestampNs;
+};
+
+// Mirrors the tactile.csv columns (position, normal, force_N) plus the
+// controller orientation from poses.csv.
+struct HapticPayload {
+    float position[3];
+    float orientation[4];  // x, y, z, w
+    float normal[3];
+    float forceN;
+};
+
+struct HapticSample {
+    WireHeader header;
+    HapticPayload payload;
+};
+
+static_assert(sizeof(WireHeader) == 24, "WireHeader must stay 24 bytes");
+static_assert(sizeof(HapticPayload) == 44, "HapticPayload must stay 44 bytes");
+static_assert(std::is_trivially_copyable<HapticSample>::value,
+              "HapticSample is sent with memcpy");
+
+// Bytes on the wire; the in-memory struct may carry trailing padding.
+constexpr size_t hapticWireSize = sizeof(WireHeader) + sizeof(HapticPayload);
+constexpr size_t hapticHeartbeatSize = sizeof(WireHeader);
+
+// Float fields of HapticPayload, in the order of the delta mask bits
+constexpr int hapticPayloadFields = sizeof(HapticPayload) / sizeof(float);
+static_assert(hapticPayloadFields <= 16, "the delta mask is 16 bits");
+
+inline size_t hapticDeltaSize(uint16_t changed) {
+    size_t fields = 0;
+    for (; changed; changed &= uint16_t(changed - 1)) {
+        fields++;
+    }
+    return sizeof(WireHeader) + sizeof(uint16_t) + fields * sizeof(float);
+}
+
+enum class WireFormat {
+    Binary,
+    Text,
+};
+
+inline HapticSample makeHapticSample() {
+    HapticSample s{};
+    s.header.magic = wireMagic;
+    s.header.version = wireVersion;
+    s.header.type = static_cast<uint8_t>(MessageType::HapticSample);
+    s.payload.orientation[3] = 1.0f;
+    s.payload.normal[1] = 1.0f;
+    return s;
+}
+
+inline bool isBinaryMessage(const void* data, size_t size) {
+    if (size < sizeof(WireHeader)) {
+        return false;
+    }
+    uint16_t magic;
+    std::memcpy(&magic, data, sizeof(magic));
+    return magic == wireMagic;
+}
+
+// Serialises into buf and returns the number of bytes written (0 if buf is
+// too small).
+inline size_t encodeHaptic(const HapticSample& sample, void* buf, size_t size) {
+    if (size < hapticWireSize) {
+        return 0;
+    }
+    std::memcpy(buf, &sample.header, sizeof(WireHeader));
+    std::memcpy(static_cast<char*>(buf) + sizeof(WireHeader), &sample.payload, sizeof(HapticPayload));
+    return hapticWireSize;
+}
+
+inline bool decodeHapticBinary(const void* data, size_t size, HapticSample& out) {
+    if (size < hapticWireSize || !isBinaryMessage(data, size)) {
+        return false;
+    }
+    std::memcpy(&out.header, data, sizeof(WireHeader));
+    std::memcpy(&out.payload, static_cast<const char*>(data) + sizeof(WireHeader), sizeof(HapticPayload));
+    return out.header.version == wireVersion &&
+           out.header.type == static_cast<uint8_t>(MessageType::HapticSample);
+}
+
+// MessageType of a binary message, 0 for anything else
+inline uint8_t wireMessageType(const void* data, size_t size) {
+    if (!isBinaryMessage(data, size)) {
+        return 0;
+    }
+    return static_cast<const uint8_t*>(data)[offsetof(WireHeader, type)];
+}
+
+// Sends the fields of `sample` set in `changed` under its header. Returns
+// the bytes written (0 if buf is too small).
+inline size_t encodeHapticDelta(const HapticSample& sample, uint16_t changed, void* buf, size_t size) {
+    const size_t len = hapticDeltaSize(changed);
+    if (size < len) {
+        return 0;
+    }
+    char* out = static_cast<char*>(buf);
+    WireHeader header = sample.header;
+    header.type = static_cast<uint8_t>(MessageType::HapticDelta);
+    std::memcpy(out, &header, sizeof(WireHeader));
+    std::memcpy(out + sizeof(WireHeader), &changed, sizeof(changed));
+    const float* fields = reinterpret_cast<const float*>(&sample.payload);
+    size_t at = sizeof(WireHeader) + sizeof(changed);
+    for (int i = 0; i < hapticPayloadFields; i++) {
+        if (changed & (1u << i)) {
+            std::memcpy(out + at, &fields[i], sizeof(float));
+            at += sizeof(float);
+        }
+    }
+    return len;
+}
+
+inline size_t encodeHapticHeartbeat(const WireHeader& header, void* buf, size_t size) {
+    if (size < hapticHeartbeatSize) {
+        return 0;
+    }
+    WireHeader h = header;
+    h.type = static_cast<uint8_t>(MessageType::HapticHeartbeat);
+    std::memcpy(buf, &h, sizeof(WireHeader));
+    return hapticHeartbeatSize;
+}
+
+// The header of any binary message of this version
+inline bool decodeWireHeader(const void* data, size_t size, WireHeader& out) {
+    if (!isBinaryMessage(data, size)) {
+        return false;
+    }
+    std::memcpy(&out, data, sizeof(WireHeader));
+    return out.version == wireVersion;
+}
+
+// Applies a delta message to `sample`, the stream's previous message:
+// takes the delta's header (as a HapticSample) and overwrites the fields it
+// carries. Leaves `sample` alone and returns false if it is not a
+// well-formed delta.
+inline bool applyHapticDelta(const void* data, size_t size, HapticSample& sample) {
+    WireHeader header;
+    uint16_t changed;
+    if (size < sizeof(WireHeader) + sizeof(changed) || !decodeWireHeader(data, size, header) ||
+        header.type != static_cast<uint8_t>(MessageType::HapticDelta)) {
+        return false;
+    }
+    const char* in = static_cast<const char*>(data);
+    std::memcpy(&changed, in + sizeof(WireHeader), sizeof(changed));
+    if (changed >> hapticPayloadFields || size != hapticDeltaSize(changed)) {
+        return false;
+    }
+    header.type = static_cast<uint8_t>(MessageType::HapticSample);
+    sample.header = header;
+    float* fields = reinterpret_cast<float*>(&sample.payload);
+    size_t at = sizeof(WireHeader) + sizeof(changed);
+    for (int i = 0; i < hapticPayloadFields; i++) {
+        if (changed & (1u << i)) {
+            std::memcpy(&fields[i], in + at, sizeof(float));
+            at += sizeof(float);
+        }
+    }
+    return true;
+}
+
+// Small, stable id for a controller name such as "Left Controller".
+inline uint16_t streamIdFromName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return static_cast<uint16_t>((hash >> 16) ^ (hash & 0xffff));
+}
+
+inline int64_t secondsToNs(double seconds) {
+    return static_cast<int64_t>(std::llround(seconds * 1e9));
+}
+
+// Accepts the text layouts our publishers emit:
+//   timestamp                                  (legacy relay output)
+//   timestamp,x,y,z                            (extras/haptic_gen.py)
+//   timestamp,controller_id,pos_x..z,rot_x..w  (poses.csv rows)
+//   timestamp,hand_id,collider_name,contact_x..z,normal_x..z,force_N,material
+//                                              (tactile.csv rows)
+// each optionally followed by "#<seq>".
+inline bool parseHapticText(const char* data, size_t size, HapticSample& out) {
+    std::string_view rest(data, size);
+    uint64_t seq;
+    if (!splitTextSequence(rest, seq)) {
+        seq = noSequence;
+    }
+    std::string_view fields[11];
+    size_t count = 0;
+    std::string_view field;
+    while (count < 11 && nextField(rest, field)) {
+        fields[count++] = field;
+    }
+    if (rest.data() != nullptr) {
+        return false;
+    }
+
+    double value[11] = {};
+    double ts;
+    if (count == 0 || !parseDouble(fields[0], ts)) {
+        return false;
+    }
+    out = makeHapticSample();
+    out.header.timestampNs = secondsToNs(ts);
+    out.header.seq = seq;
+
+    auto parseRange = [&](size_t first, size_t last) {
+        for (size_t i = first; i <= last; i++) {
+            if (!parseDouble(fields[i], value[i])) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    switch (count) {
+        case 1:
+            return true;
+        case 4:
+            if (!parseRange(1, 3)) {
+                return false;
+            }
+            for (int i = 0; i < 3; i++) {
+                out.payload.position[i] = static_cast<float>(value[1 + i]);
+            }
+            return true;
+        case 9:
+            if (!parseRange(2, 8)) {
+                return false;
+            }
+            out.header.streamId = streamIdFromName(fields[1]);
+            for (int i = 0; i < 3; i++) {
+                out.payload.position[i] = static_cast<float>(value[2 + i]);
+            }
+            for (int i = 0; i < 4; i++) {
+                out.payload.orientation[i] = static_cast<float>(value[5 + i]);
+            }
+            return true;
+        case 11:
+            if (!parseRange(3, 9)) {
+                return false;
+            }
+            out.header.streamId = streamIdFromName(fields[1]);
+            for (int i = 0; i < 3; i++) {
+                out.payload.position[i] = static_cast<float>(value[3 + i]);
+                out.payload.normal[i] = static_cast<float>(value[6 + i]);
+            }
+            out.payload.forceN = static_cast<float>(value[9]);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Decodes either wire format.
+inline bool decodeHaptic(const void* data, size_t size, HapticSample& out) {
+    if (isBinaryMessage(data, size)) {
+        return decodeHapticBinary(data, size, out);
+    }
+    return parseHapticText(static_cast<const char*>(data), size, out);
+}
+
+// Text fallback: "timestamp,x,y,z#seq" with the timestamp in seconds. Returns
+// the number of characters written, excluding the terminator.
+inline size_t formatHapticText(const HapticSample& sample, char* buf, size_t size) {
+    int n = std::snprintf(buf, size, "%.9f,%.4f,%.4f,%.4f",
+                          sample.header.timestampNs / 1e9,
+                          sample.payload.position[0],
+                          sample.payload.position[1],
+                          sample.payload.position[2]);
+    if (n < 0 || static_cast<size_t>(n) >= size) {
+        return 0;
+    }
+    return appendTextSequence(buf, static_cast<size_t>(n), size, sample.header.seq);
+}
+
+} // namespace tactile
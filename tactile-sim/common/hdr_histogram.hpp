@@ -0,0 +1,257 @@
+// Constant-memory, log-bucketed (HDR-style) histogram for nanosecond values.
+//
+// Values below 256 get their own bucket; above that every power of two is
+// split into 128 linear sub-buckets, so any recorded value is reported within
+// 0.8% of its true value. Values up to 2^40 ns (~18 minutes) are tracked;
+// larger ones land in the last bucket. Recording is O(1) and never allocates.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tactile {
+
+class HdrHistogram {
+public:
+    static constexpr int subBucketBits = 8;
+    static constexpr int maxValueBits = 40;
+    static constexpr int64_t maxTrackable = (int64_t(1) << maxValueBits) - 1;
+
+    static constexpr int64_t subBucketCount = int64_t(1) << subBucketBits;
+    static constexpr int64_t subBucketHalf = subBucketCount / 2;
+    static constexpr size_t bucketCount =
+        size_t((maxValueBits - subBucketBits) * subBucketHalf + subBucketCount);
+
+    HdrHistogram() : counts(bucketCount, 0) {}
+
+    static size_t indexOf(int64_t value) {
+        if (value < subBucketCount) {
+            return value < 0 ? 0 : size_t(value);
+        }
+        if (value > maxTrackable) {
+            value = maxTrackable;
+        }
+        int msb = 63 - __builtin_clzll(uint64_t(value));
+        int shift = msb - subBucketBits + 1;
+        return size_t(shift * subBucketHalf + (value >> shift));
+    }
+
+    static int64_t lowestEquivalent(size_t index) {
+        if (int64_t(index) < subBucketCount) {
+            return int64_t(index);
+        }
+        int shift = int(index >> (subBucketBits - 1)) - 1;
+        int64_t mantissa = int64_t(index) - shift * subBucketHalf;
+        return mantissa << shift;
+    }
+
+    static int64_t highestEquivalent(size_t index) {
+        return index + 1 < bucketCount ? lowestEquivalent(index + 1) - 1 : maxTrackable;
+    }
+
+    void record(int64_t value, uint64_t n = 1) {
+        counts[indexOf(value)] += n;
+        total += n;
+        sum += double(value) * double(n);
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+
+    uint64_t count() const {
+        return total;
+    }
+
+    int64_t min() const {
+        return total ? minValue : 0;
+    }
+
+    int64_t max() const {
+        return total ? maxValue : 0;
+    }
+
+    double mean() const {
+        return total ? sum / double(total) : 0.0;
+    }
+
+    // Smallest recorded value v such that `percentile` percent of all
+    // samples are <= v, reported at bucket resolution.
+    int64_t valueAtPercentile(double percentile) const {
+        if (total == 0) {
+            return 0;
+        }
+        double clamped = std::min(std::max(percentile, 0.0), 100.0);
+        uint64_t target = std::max<uint64_t>(1, uint64_t(std::ceil(clamped / 100.0 * double(total))));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucketCount; i++) {
+            seen += counts[i];
+            if (seen >= target) {
+                return std::min(std::max(highestEquivalent(i), minValue), maxValue);
+            }
+        }
+        return maxValue;
+    }
+
+    void merge(const HdrHistogram& other) {
+        for (size_t i = 0; i < bucketCount; i++) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        sum = 0;
+        minValue = std::numeric_limits<int64_t>::max();
+        maxValue = std::numeric_limits<int64_t>::min();
+    }
+
+    // Sparse binary encoding (only non-empty buckets) so histograms from
+    // several processes can be merged offline.
+    void writeTo(std::ostream& out) const {
+        uint32_t nonEmpty = uint32_t(std::count_if(counts.begin(), counts.end(),
+                                                   [](uint64_t c) { return c != 0; }));
+        writeRaw(out, serialMagic);
+        writeRaw(out, uint32_t(bucketCount));
+        writeRaw(out, total);
+        writeRaw(out, sum);
+        writeRaw(out, minValue);
+        writeRaw(out, maxValue);
+        writeRaw(out, nonEmpty);
+        for (size_t i = 0; i < bucketCount; i++) {
+            if (counts[i]) {
+                writeRaw(out, uint32_t(i));
+                writeRaw(out, counts[i]);
+            }
+        }
+    }
+
+    bool readFrom(std::istream& in) {
+        uint32_t magic = 0, buckets = 0, nonEmpty = 0;
+        reset();
+        if (!readRaw(in, magic) || magic != serialMagic ||
+            !readRaw(in, buckets) || buckets != bucketCount ||
+            !readRaw(in, total) || !readRaw(in, sum) ||
+            !readRaw(in, minValue) || !readRaw(in, maxValue) || !readRaw(in, nonEmpty)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < nonEmpty; i++) {
+            uint32_t index;
+            uint64_t n;
+            if (!readRaw(in, index) || !readRaw(in, n) || index >= bucketCount) {
+                return false;
+            }
+            counts[index] = n;
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t serialMagic = 0x48445231;  // "HDR1"
+
+    template <typename T>
+    static void writeRaw(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static bool readRaw(std::istream& in, T& value) {
+        return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    double sum = 0;
+    int64_t minValue = std::numeric_limits<int64_t>::max();
+    int64_t maxValue = std::numeric_limits<int64_t>::min();
+};
+
+// Whole-run histogram plus one covering the current reporting window.
+struct WindowedHistogram {
+    HdrHistogram run;
+    HdrHistogram window;
+
+    void record(int64_t value) {
+        run.record(value);
+        window.record(value);
+    }
+
+    void rollWindow() {
+        window.reset();
+    }
+};
+
+// Latency and inter-arrival distributions for one stream.
+struct StreamHistograms {
+    WindowedHistogram latency;
+    WindowedHistogram interArrival;
+    int64_t lastArrivalNs = 0;
+    bool seenAny = false;
+
+    // sentNs < 0 means the message carried no usable timestamp.
+    void record(int64_t arrivalNs, int64_t sentNs) {
+        if (seenAny) {
+            interArrival.record(arrivalNs - lastArrivalNs);
+        }
+        if (sentNs >= 0) {
+            latency.record(arrivalNs - sentNs);
+        }
+        lastArrivalNs = arrivalNs;
+        seenAny = true;
+    }
+
+    void rollWindow() {
+        latency.rollWindow();
+        interArrival.rollWindow();
+    }
+};
+
+// One line of p50/p90/p99/p99.9/max in milliseconds.
+inline void printPercentiles(std::ostream& out, const char* label, const HdrHistogram& h) {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3)
+        << label << ": n=" << h.count()
+        << " p50=" << h.valueAtPercentile(50) / 1e6
+        << " p90=" << h.valueAtPercentile(90) / 1e6
+        << " p99=" << h.valueAtPercentile(99) / 1e6
+        << " p99.9=" << h.valueAtPercentile(99.9) / 1e6
+        << " max=" << h.max() / 1e6 << " ms\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+// Named histograms in one file: [u16 name length][name][histogram]...
+inline void writeNamedHistogram(std::ostream& out, const std::string& name, const HdrHistogram& h) {
+    uint16_t length = uint16_t(std::min<size_t>(name.size(), 0xffff));
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(name.data(), length);
+    h.writeTo(out);
+}
+
+inline bool readNamedHistogram(std::istream& in, std::string& name, HdrHistogram& h) {
+    uint16_t length;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+        return false;
+    }
+    name.resize(length);
+    return in.read(&name[0], length) && h.readFrom(in);
+}
+
+inline void writeStreamHistograms(std::ostream& out, const std::string& stream, const StreamHistograms& h) {
+    writeNamedHistogram(out, stream + ".latency", h.latency.run);
+    writeNamedHistogram(out, stream + ".interarrival", h.interArrival.run);
+}
+
+} // namespace tactile
@@ -0,0 +1,152 @@
+// Per-hop timestamps for the latency budget. Every process that forwards a
+// message (sim_replay as the source, haptic_tx as the relay) appends one
+// HopStamp as an extra ZMQ frame after the message and passes on the frames
+// it received, so a receiver sees the whole path:
+//
+//   [message][source hop][relay hop]
+//
+// Each hop records when the message reached it (ingress), when processing
+// started after any internal queue, and when it was handed to the outgoing
+// socket (egress). With the message's own timestamp (the publisher's send
+// time) and the receiver's arrival time, HopBreakdown splits the end-to-end
+// latency into transport, queueing and processing per hop. Stamps are only
+// comparable between processes on one host with "--epoch shared".
+#pragma once
+
+#include "hdr_histogram.hpp"
+
+#include <zmq.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <type_traits>
+
+namespace tactile {
+
+constexpr uint16_t hopMagic = 0x5048;  // bytes 'H','P' on the wire
+
+enum class HopKind : uint16_t {
+    Source = 1,  // sim_replay: ingress is the scheduled send time
+    Relay = 2,   // haptic_tx
+    Link = 3,    // impairment stage: start is the release time it drew
+};
+
+inline const char* hopKindName(uint16_t kind) {
+    switch (static_cast<HopKind>(kind)) {
+        case HopKind::Source: return "source";
+        case HopKind::Relay: return "relay";
+        case HopKind::Link: return "link";
+    }
+    return "hop";
+}
+
+struct HopStamp {
+    uint16_t magic;
+    uint16_t kind;  // HopKind
+    uint32_t reserved;
+    int64_t ingressNs;
+    int64_t startNs;
+    int64_t egressNs;
+};
+
+static_assert(sizeof(HopStamp) == 32, "HopStamp must stay 32 bytes");
+static_assert(std::is_trivially_copyable<HopStamp>::value, "HopStamp is sent with memcpy");
+
+inline HopStamp makeHopStamp(HopKind kind, int64_t ingressNs, int64_t startNs, int64_t egressNs) {
+    return { hopMagic, static_cast<uint16_t>(kind), 0, ingressNs, startNs, egressNs };
+}
+
+// The hop frames that came with one message, in path order.
+struct HopTrail {
+    static constexpr size_t maxHops = 4;
+
+    uint8_t count = 0;
+    HopStamp hops[maxHops];
+
+    // Returns false (dropping the stamp) once the trail is full.
+    bool add(const HopStamp& hop) {
+        if (count == maxHops) {
+            return false;
+        }
+        hops[count++] = hop;
+        return true;
+    }
+
+    void clear() {
+        count = 0;
+    }
+};
+
+// Sends `data` followed by one frame per hop. Returns false if the socket
+// would block (only possible with send_flags::dontwait).
+inline bool sendWithHops(zmq::socket_t& socket, const void* data, size_t size, const HopTrail& trail,
+                         zmq::send_flags flags = zmq::send_flags::none) {
+    zmq::send_flags more = flags | zmq::send_flags::sndmore;
+    if (!socket.send(zmq::const_buffer(data, size), trail.count ? more : flags)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < trail.count; i++) {
+        // Later frames of a started message are always accepted
+        socket.send(zmq::const_buffer(&trail.hops[i], sizeof(HopStamp)), i + 1 < trail.count ? more : flags);
+    }
+    return true;
+}
+
+// Latency distributions per segment of the path, for one stream.
+class HopBreakdown {
+public:
+    // `sentNs` is the message's own timestamp, `arrivalNs` the receiver's.
+    void record(int64_t sentNs, const HopTrail& trail, int64_t arrivalNs) {
+        int64_t previousNs = sentNs;
+        for (uint8_t i = 0; i < trail.count; i++) {
+            const HopStamp& hop = trail.hops[i];
+            if (i >= depth) {
+                kinds[i] = hop.kind;
+                depth = i + 1;
+            }
+            transport[i].record(hop.ingressNs - previousNs);
+            queue[i].record(hop.startNs - hop.ingressNs);
+            processing[i].record(hop.egressNs - hop.startNs);
+            previousNs = hop.egressNs;
+        }
+        lastHop.record(arrivalNs - previousNs);
+        messages++;
+    }
+
+    uint64_t count() const {
+        return messages;
+    }
+
+    // One percentile line per segment, in path order. The source hop's
+    // transport is omitted: its ingress is a schedule, not an arrival.
+    void print(std::ostream& out, const char* prefix) const {
+        char label[64];
+        const char* from = "publisher";
+        for (size_t i = 0; i < depth; i++) {
+            const char* name = hopKindName(kinds[i]);
+            if (kinds[i] != static_cast<uint16_t>(HopKind::Source)) {
+                std::snprintf(label, sizeof(label), "%s%s -> %s", prefix, from, name);
+                printPercentiles(out, label, transport[i]);
+            }
+            std::snprintf(label, sizeof(label), "%s%s queue", prefix, name);
+            printPercentiles(out, label, queue[i]);
+            std::snprintf(label, sizeof(label), "%s%s processing", prefix, name);
+            printPercentiles(out, label, processing[i]);
+            from = name;
+        }
+        std::snprintf(label, sizeof(label), "%s%s -> receiver", prefix, from);
+        printPercentiles(out, label, lastHop);
+    }
+
+private:
+    HdrHistogram transport[HopTrail::maxHops];
+    HdrHistogram queue[HopTrail::maxHops];
+    HdrHistogram processing[HopTrail::maxHops];
+    uint16_t kinds[HopTrail::maxHops] = {};
+    HdrHistogram lastHop;
+    size_t depth = 0;
+    uint64_t messages = 0;
+};
+
+} // namespace tactile
@@ -0,0 +1,447 @@
+// In-process network impairment for one outgoing stream: delay with a
+// chosen distribution, jitter, Gilbert-Elliott burst loss, a bandwidth cap
+// with a bounded queue, and reordering. It stands in for netem when the
+// pipeline runs on a laptop with no kernel setup.
+//
+// A publisher hands each message to ImpairmentStage::send() instead of its
+// socket. The stage's own thread decides each message's fate with
+// ImpairmentModel, parks survivors in a hashed timer wheel and sends them
+// on the publisher when they are due, so thousands of messages in flight
+// cost O(1) each. The publisher then belongs to the stage's thread.
+//
+// The bandwidth cap charges a caller-supplied size per message. Video rows
+// are short text, so sim_replay charges them the recorded bytes_this_frame
+// and the cap shapes the stream like the real frames would.
+#pragma once
+
+#include "clock.hpp"
+#include "hop_stamps.hpp"
+#include "options.hpp"
+#include "sim_random.hpp"
+#include "spsc_ring.hpp"
+#include "transport.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tactile {
+
+enum class DelayDistribution {
+    Uniform,  // delay +- jitter
+    Normal,   // jitter is the standard deviation
+    Pareto,   // heavy tail: delay + jitter * (Pareto(3) - 1), mean delay + jitter / 2
+};
+
+inline bool parseDelayDistribution(const std::string& name, DelayDistribution& out) {
+    if (name == "uniform") {
+        out = DelayDistribution::Uniform;
+    } else if (name == "normal") {
+        out = DelayDistribution::Normal;
+    } else if (name == "pareto") {
+        out = DelayDistribution::Pareto;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* delayDistributionName(DelayDistribution distribution) {
+    switch (distribution) {
+        case DelayDistribution::Uniform: return "uniform";
+        case DelayDistribution::Normal: return "normal";
+        case DelayDistribution::Pareto: return "pareto";
+    }
+    return "?";
+}
+
+// Two-state burst loss. Per message the chain first moves (good -> bad
+// with probability p, bad -> good with r), then the message is lost with
+// the current state's loss probability. p = 0 is plain random loss.
+struct GilbertElliott {
+    double p = 0;
+    double r = 1;
+    double lossGood = 0;
+    double lossBad = 1;
+};
+
+// Messages keep their order unless picked for reordering, like on a FIFO
+// link: with jitter a message can wait for an earlier, slower one, so the
+// delivered delay is at least the drawn one and grows with the jitter.
+struct ImpairmentConfig {
+    int64_t delayNs = 0;
+    int64_t jitterNs = 0;
+    DelayDistribution distribution = DelayDistribution::Uniform;
+    GilbertElliott loss;
+    double rateBps = 0;     // bandwidth cap, 0 = none
+    size_t queueBytes = 0;  // backlog allowed behind the cap, 0 = unbounded
+    double reorder = 0;     // fraction sent straight away, overtaking the rest
+    uint64_t seed = 1;
+
+    bool enabled() const {
+        return delayNs > 0 || jitterNs > 0 || loss.p > 0 || loss.lossGood > 0 || rateBps > 0 || reorder > 0;
+    }
+};
+
+// Reads <prefix>delay-ms, jitter-ms, delay-dist (uniform|normal|pareto),
+// loss (random loss), ge-p, ge-r, ge-loss-bad (burst loss), rate-mbps,
+// queue-kb, reorder and seed, e.g. "--impair-delay-ms 20".
+inline bool impairmentFromOptions(const Options& opts, const std::string& prefix, ImpairmentConfig& config) {
+    auto name = [&](const char* option) { return prefix + option; };
+    config.delayNs = int64_t(std::llround(opts.getDouble(name("delay-ms").c_str(), 0) * 1e6));
+    config.jitterNs = int64_t(std::llround(opts.getDouble(name("jitter-ms").c_str(), 0) * 1e6));
+    if (!parseDelayDistribution(opts.get(name("delay-dist").c_str(), "uniform"), config.distribution)) {
+        std::cerr << "Unknown " << name("delay-dist") << " (use uniform, normal or pareto)" << std::endl;
+        return false;
+    }
+    config.loss.lossGood = opts.getDouble(name("loss").c_str(), 0);
+    config.loss.p = opts.getDouble(name("ge-p").c_str(), 0);
+    config.loss.r = opts.getDouble(name("ge-r").c_str(), 1);
+    config.loss.lossBad = opts.getDouble(name("ge-loss-bad").c_str(), 1);
+    config.rateBps = opts.getDouble(name("rate-mbps").c_str(), 0) * 1e6;
+    config.queueBytes = size_t(std::max(0.0, opts.getDouble(name("queue-kb").c_str(), 0) * 1024));
+    config.reorder = opts.getDouble(name("reorder").c_str(), 0);
+    config.seed = uint64_t(opts.getInt(name("seed").c_str(), 1));
+    const double probabilities[] = { config.loss.lossGood, config.loss.p, config.loss.r, config.loss.lossBad,
+                                     config.reorder };
+    for (double probability : probabilities) {
+        if (probability < 0 || probability > 1) {
+            std::cerr << prefix << "loss, ge-p, ge-r, ge-loss-bad and reorder must be between 0 and 1"
+                      << std::endl;
+            return false;
+        }
+    }
+    if (config.delayNs < 0 || config.jitterNs < 0 || config.rateBps < 0) {
+        std::cerr << prefix << "delay-ms, jitter-ms and rate-mbps must not be negative" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+struct ImpairmentStats {
+    uint64_t offered = 0;
+    uint64_t lost = 0;        // Gilbert-Elliott
+    uint64_t overflowed = 0;  // queue behind the bandwidth cap was full
+    uint64_t reordered = 0;
+};
+
+// The decisions only, no clock and no storage: when a message offered at
+// `nowNs` leaves the link, or that it never does.
+class ImpairmentModel {
+public:
+    explicit ImpairmentModel(const ImpairmentConfig& config) : config(config), random(config.seed) {}
+
+    // Returns false if the message is dropped, otherwise its release time.
+    bool schedule(int64_t nowNs, size_t chargedBytes, int64_t& releaseNs) {
+        counts.offered++;
+        // Every draw is made whatever the probabilities, so changing one of
+        // them does not reshuffle the others
+        const double transition = random.uniform();
+        const double lossDraw = random.uniform();
+        const double reorderDraw = random.uniform();
+        const double delayDraw = drawDelay();
+
+        bad = bad ? transition >= config.loss.r : transition < config.loss.p;
+        if (lossDraw < (bad ? config.loss.lossBad : config.loss.lossGood)) {
+            counts.lost++;
+            return false;
+        }
+
+        int64_t departNs = nowNs;
+        if (config.rateBps > 0) {
+            const int64_t startNs = std::max(nowNs, busyUntilNs);
+            const double backlogBytes = double(startNs - nowNs) * config.rateBps / 8e9;
+            if (config.queueBytes > 0 && backlogBytes + double(chargedBytes) > double(config.queueBytes)) {
+                counts.overflowed++;
+                return false;
+            }
+            departNs = startNs + int64_t(double(chargedBytes) * 8e9 / config.rateBps);
+            busyUntilNs = departNs;
+        }
+
+        if (reorderDraw < config.reorder) {
+            // Skips the delay and overtakes whatever is still in flight
+            counts.reordered++;
+            releaseNs = departNs;
+            return true;
+        }
+        const int64_t delayNs = std::max<int64_t>(0, int64_t(std::llround(delayDraw)));
+        releaseNs = std::max(departNs + delayNs, lastReleaseNs);  // jitter alone keeps order
+        lastReleaseNs = releaseNs;
+        return true;
+    }
+
+    const ImpairmentStats& stats() const {
+        return counts;
+    }
+
+private:
+    double drawDelay() {
+        const double delay = double(config.delayNs);
+        const double jitter = double(config.jitterNs);
+        switch (config.distribution) {
+            case DelayDistribution::Uniform: return delay + (random.uniform() * 2 - 1) * jitter;
+            case DelayDistribution::Normal: return delay + random.normal() * jitter;
+            case DelayDistribution::Pareto: return delay + (random.pareto(3.0) - 1.0) * jitter;
+        }
+        return delay;
+    }
+
+    ImpairmentConfig config;
+    SimRandom random;
+    bool bad = false;
+    int64_t busyUntilNs = INT64_MIN;
+    int64_t lastReleaseNs = INT64_MIN;
+    ImpairmentStats counts;
+};
+
+// Hashed timer wheel: `slotCount` buckets of `tickNs` each. Adding is O(1);
+// advancing visits one bucket per elapsed tick. Deadlines further out than
+// one revolution stay in their bucket and are passed over until their
+// round comes. Entries due in the same tick fire in the order added.
+// Call advance() often: while anything is pending it walks every tick
+// since the previous call.
+template <typename T>
+class TimerWheel {
+public:
+    TimerWheel(int64_t tickNs, size_t slotCount) : tickNs(tickNs), slots(slotCount) {}
+
+    void add(int64_t deadlineNs, const T& item) {
+        int64_t tick = deadlineNs / tickNs;
+        if (tick < currentTick) {
+            tick = currentTick;  // already due: next advance fires it
+        }
+        slots[size_t(tick) % slots.size()].push_back({ tick, item });
+        pending++;
+    }
+
+    // Fires fire(item) for everything due by `nowNs`, in deadline-tick order
+    template <typename Fire>
+    void advance(int64_t nowNs, Fire&& fire) {
+        const int64_t nowTick = nowNs / tickNs;
+        if (currentTick < 0 || pending == 0) {
+            currentTick = nowTick;  // nothing waiting: skip the idle ticks
+        }
+        for (; currentTick <= nowTick && pending > 0; currentTick++) {
+            std::vector<Entry>& slot = slots[size_t(currentTick) % slots.size()];
+            size_t kept = 0;
+            for (size_t i = 0; i < slot.size(); i++) {
+                if (slot[i].tick <= currentTick) {
+                    fire(slot[i].item);
+                    pending--;
+                } else {
+                    slot[kept++] = slot[i];
+                }
+            }
+            slot.resize(kept);  // keeps the capacity, so steady state does not allocate
+        }
+        currentTick = std::min(currentTick, nowTick);
+    }
+
+    size_t size() const {
+        return pending;
+    }
+
+private:
+    struct Entry {
+        int64_t tick;
+        T item;
+    };
+
+    int64_t tickNs;
+    std::vector<std::vector<Entry>> slots;
+    int64_t currentTick = -1;
+    size_t pending = 0;
+};
+
+// One message in the stage's hands. Fits a haptic sample or a text row.
+struct ImpairedMessage {
+    int64_t submitNs;
+    uint32_t chargedBytes;
+    uint16_t size;
+    HopTrail hops;
+    char data[358];
+};
+
+using ImpairmentInbox = SpscRing<ImpairedMessage, 4096>;
+
+class ImpairmentStage {
+public:
+    static constexpr int64_t tickNs = 50000;    // 50 us
+    static constexpr size_t wheelSlots = 8192;  // ~410 ms per revolution
+    static constexpr size_t maxInFlight = 16384;
+
+    // Takes over `out`: only the stage's thread sends on it from now on.
+    ImpairmentStage(const ImpairmentConfig& config, Publisher& out, const Clock& clock)
+        : model(config), out(out), clock(clock), inbox(std::make_unique<ImpairmentInbox>()),
+          wheel(tickNs, wheelSlots), packets(maxInFlight) {
+        freeList.reserve(maxInFlight);
+        for (size_t i = maxInFlight; i > 0; i--) {
+            freeList.push_back(uint32_t(i - 1));
+        }
+        worker = std::thread([this] { run(); });
+    }
+
+    ~ImpairmentStage() {
+        stopping.store(true, std::memory_order_release);
+        worker.join();
+    }
+
+    ImpairmentStage(const ImpairmentStage&) = delete;
+    ImpairmentStage& operator=(const ImpairmentStage&) = delete;
+
+    // Producer side (one thread). `chargedBytes` counts against the
+    // bandwidth cap, 0 meaning the message size. Waits for room rather than
+    // dropping; returns false if the message is too long for the stage.
+    bool send(const void* data, size_t size, const HopTrail& trail, size_t chargedBytes = 0) {
+        if (size > sizeof(staging.data)) {
+            return false;
+        }
+        staging.submitNs = clock.nowNs();
+        staging.chargedBytes = uint32_t(chargedBytes ? chargedBytes : size);
+        staging.size = uint16_t(size);
+        staging.hops = trail;
+        std::memcpy(staging.data, data, size);
+        while (!inbox->tryPush(staging)) {
+            std::this_thread::yield();
+        }
+        submitted++;
+        return true;
+    }
+
+    // Producer side: waits until everything sent so far has left the stage
+    // or been dropped, at most `limit`. Returns false on timeout.
+    bool flush(std::chrono::milliseconds limit) {
+        const auto deadline = std::chrono::steady_clock::now() + limit;
+        while (delivered() + dropped.load(std::memory_order_acquire) < submitted) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    // Counters as of the stage's last pass; readable from any thread
+    ImpairmentStats stats() const {
+        ImpairmentStats s;
+        s.offered = offered.load(std::memory_order_relaxed);
+        s.lost = lost.load(std::memory_order_relaxed);
+        s.overflowed = overflowed.load(std::memory_order_relaxed);
+        s.reordered = reordered.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    uint64_t delivered() const {
+        return sent.load(std::memory_order_relaxed);
+    }
+
+    void printStats(std::ostream& os, const char* label) const {
+        const ImpairmentStats s = stats();
+        os << label << " impairment: " << s.offered << " offered, " << s.lost << " lost, " << s.overflowed
+           << " queue drops, " << s.reordered << " reordered, " << delivered() << " delivered" << std::endl;
+    }
+
+private:
+    // Single writer, so no read-modify-write instruction is needed
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void run() {
+        auto idleSince = std::chrono::steady_clock::now();
+        while (!stopping.load(std::memory_order_acquire)) {
+            bool busy = false;
+            while (inbox->tryPop(incoming)) {
+                busy = true;
+                admit(incoming);
+            }
+            publishStats();
+            wheel.advance(clock.nowNs(), [&](uint32_t index) {
+                busy = true;
+                release(index);
+            });
+            if (busy) {
+                idleSince = std::chrono::steady_clock::now();
+            } else if (std::chrono::steady_clock::now() - idleSince > std::chrono::microseconds(50)) {
+                // Same idle policy as the relay workers; well inside one tick
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+        }
+    }
+
+    void admit(const ImpairedMessage& m) {
+        int64_t releaseNs;
+        if (!model.schedule(m.submitNs, m.chargedBytes, releaseNs)) {
+            return;
+        }
+        if (freeList.empty()) {
+            poolDrops++;  // more in flight than the stage holds
+            return;
+        }
+        const uint32_t index = freeList.back();
+        freeList.pop_back();
+        packets[index].message = m;
+        packets[index].releaseNs = releaseNs;
+        wheel.add(releaseNs, index);
+    }
+
+    void release(uint32_t index) {
+        Packet& p = packets[index];
+        const ImpairedMessage& m = p.message;
+        if (m.hops.count > 0) {
+            // Shows up in the receivers' latency budget as this link's queueing
+            HopTrail trail = m.hops;
+            trail.add(makeHopStamp(HopKind::Link, m.submitNs, p.releaseNs, clock.nowNs()));
+            out.send(m.data, m.size, trail);
+        } else {
+            out.send(m.data, m.size, m.hops);
+        }
+        bump(sent);
+        freeList.push_back(index);
+    }
+
+    void publishStats() {
+        const ImpairmentStats& s = model.stats();
+        offered.store(s.offered, std::memory_order_relaxed);
+        lost.store(s.lost, std::memory_order_relaxed);
+        reordered.store(s.reordered, std::memory_order_relaxed);
+        overflowed.store(s.overflowed + poolDrops, std::memory_order_relaxed);
+        dropped.store(s.lost + s.overflowed + poolDrops, std::memory_order_release);
+    }
+
+    struct Packet {
+        ImpairedMessage message;
+        int64_t releaseNs;
+    };
+
+    ImpairmentModel model;
+    Publisher& out;
+    Clock clock;
+    std::unique_ptr<ImpairmentInbox> inbox;
+    ImpairedMessage staging;   // producer side
+    uint64_t submitted = 0;    // producer side
+    ImpairedMessage incoming;  // stage side
+    TimerWheel<uint32_t> wheel;
+    std::vector<Packet> packets;
+    std::vector<uint32_t> freeList;
+    uint64_t poolDrops = 0;
+    std::atomic<uint64_t> offered{0};
+    std::atomic<uint64_t> lost{0};
+    std::atomic<uint64_t> overflowed{0};
+    std::atomic<uint64_t> reordered{0};
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> stopping{false};
+    std::thread worker;  // last, so it starts after everything above
+};
+
+} // namespace tactile
@@ -0,0 +1,227 @@
+// Cross-layer scheduler for one bottleneck link that haptic and video
+// share. Video frames arrive cut into MTU-sized packets, so a haptic packet
+// never waits behind more than one of them, and the scheduler decides
+// which class goes next:
+//
+//   fifo      arrival order, what two streams on one plain queue get
+//   strict    haptic whenever any is waiting
+//   weighted  byte shares (--haptic-share) while both are backlogged, but a
+//             haptic packet about to miss its deadline goes first anyway
+//
+// Video packets of a frame that is already older than the video deadline
+// are dropped instead of sent: a late frame is useless to the viewer and
+// only delays the haptic packets behind it. The rest of that frame goes
+// with it.
+//
+// The scheduler only orders packets; the caller owns the clock, starts a
+// transmission with next() whenever the link is idle and calls it again
+// serializationNs() later (offline_sim.hpp drives it with events).
+#pragma once
+
+#include "options.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <string>
+
+namespace tactile {
+
+enum class SchedulerPolicy {
+    Fifo,
+    Strict,
+    Weighted,
+};
+
+inline bool parseSchedulerPolicy(const std::string& name, SchedulerPolicy& out) {
+    if (name == "fifo") {
+        out = SchedulerPolicy::Fifo;
+    } else if (name == "strict") {
+        out = SchedulerPolicy::Strict;
+    } else if (name == "weighted") {
+        out = SchedulerPolicy::Weighted;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* schedulerPolicyName(SchedulerPolicy policy) {
+    switch (policy) {
+        case SchedulerPolicy::Fifo: return "fifo";
+        case SchedulerPolicy::Strict: return "strict";
+        case SchedulerPolicy::Weighted: return "weighted";
+    }
+    return "?";
+}
+
+struct SchedulerConfig {
+    SchedulerPolicy policy = SchedulerPolicy::Strict;
+    double rateBps = 0;                    // the bottleneck; 0 = no shared link
+    size_t mtuBytes = 1500;                // video frames are cut into packets of this size
+    double hapticShare = 0.2;              // weighted: haptic's byte share when both are backlogged
+    int64_t hapticDeadlineNs = 2000000;    // bottleneck wait a haptic packet tolerates
+    int64_t videoDeadlineNs = 100000000;   // frame age after which its packets are dropped, 0 = never
+    double videoPacing = 1.25;             // a frame is paced out over interval / pacing, 0 = burst
+
+    bool enabled() const {
+        return rateBps > 0;
+    }
+};
+
+// Reads --bottleneck-mbps, --scheduler, --mtu, --haptic-share,
+// --haptic-deadline-ms, --video-deadline-ms and --video-pacing.
+inline bool schedulerConfigFromOptions(const Options& opts, SchedulerConfig& config) {
+    config.rateBps = opts.getDouble("--bottleneck-mbps", 0) * 1e6;
+    if (!parseSchedulerPolicy(opts.get("--scheduler", "strict"), config.policy)) {
+        std::cerr << "Unknown --scheduler (use fifo, strict or weighted)" << std::endl;
+        return false;
+    }
+    config.mtuBytes = size_t(std::max(64L, opts.getInt("--mtu", 1500)));
+    config.hapticShare = opts.getDouble("--haptic-share", config.hapticShare);
+    config.hapticDeadlineNs = int64_t(std::llround(opts.getDouble("--haptic-deadline-ms", 2) * 1e6));
+    config.videoDeadlineNs = int64_t(std::llround(opts.getDouble("--video-deadline-ms", 100) * 1e6));
+    config.videoPacing = opts.getDouble("--video-pacing", config.videoPacing);
+    if (config.hapticShare <= 0 || config.hapticShare >= 1 || config.videoPacing < 0) {
+        std::cerr << "--haptic-share must be between 0 and 1 (exclusive), --video-pacing not negative" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+struct SchedulerStats {
+    uint64_t hapticSent = 0;
+    uint64_t videoSent = 0;
+    uint64_t hapticLate = 0;      // waited longer than the haptic deadline
+    uint64_t videoDropped = 0;    // packets of frames past the video deadline
+    uint64_t framesDropped = 0;
+    int64_t busyNs = 0;           // time spent serializing
+};
+
+template <typename T>
+class LinkScheduler {
+public:
+    struct Packet {
+        T item;
+        size_t bytes;
+        int64_t originNs;    // creation of the message (video: the frame)
+        int64_t enqueuedNs;
+        uint64_t group;      // video: frame number, dropped together
+        uint64_t order;      // arrival order, for fifo
+    };
+
+    explicit LinkScheduler(const SchedulerConfig& config) : config(config) {}
+
+    int64_t serializationNs(size_t bytes) const {
+        return int64_t(std::llround(double(bytes) * 8e9 / config.rateBps));
+    }
+
+    void enqueueHaptic(const T& item, size_t bytes, int64_t nowNs) {
+        if (haptic.empty()) {
+            catchUp(hapticServed, config.hapticShare, videoServed, 1 - config.hapticShare);
+        }
+        haptic.push_back({ item, bytes, nowNs, nowNs, 0, order++ });
+    }
+
+    // Returns false if the packet's frame has already been dropped
+    bool enqueueVideo(const T& item, size_t bytes, int64_t originNs, uint64_t frame, int64_t nowNs) {
+        if (droppedAny && frame == droppedFrame) {
+            counts.videoDropped++;
+            return false;
+        }
+        if (video.empty()) {
+            catchUp(videoServed, 1 - config.hapticShare, hapticServed, config.hapticShare);
+        }
+        video.push_back({ item, bytes, originNs, nowNs, frame, order++ });
+        return true;
+    }
+
+    // Takes the packet to transmit at `nowNs`; false if nothing is waiting.
+    // isHaptic tells which class it came from.
+    bool next(int64_t nowNs, Packet& out, bool& isHaptic) {
+        dropStaleVideo(nowNs);
+        if (haptic.empty() && video.empty()) {
+            return false;
+        }
+        isHaptic = pickHaptic(nowNs);
+        std::deque<Packet>& queue = isHaptic ? haptic : video;
+        out = queue.front();
+        queue.pop_front();
+        if (isHaptic) {
+            counts.hapticSent++;
+            hapticServed += double(out.bytes);
+            if (nowNs - out.enqueuedNs > config.hapticDeadlineNs) {
+                counts.hapticLate++;
+            }
+        } else {
+            counts.videoSent++;
+            videoServed += double(out.bytes);
+        }
+        counts.busyNs += serializationNs(out.bytes);
+        return true;
+    }
+
+    const SchedulerStats& stats() const {
+        return counts;
+    }
+
+private:
+    bool pickHaptic(int64_t nowNs) const {
+        if (haptic.empty() || video.empty()) {
+            return !haptic.empty();
+        }
+        switch (config.policy) {
+            case SchedulerPolicy::Fifo:
+                return haptic.front().order < video.front().order;
+            case SchedulerPolicy::Strict:
+                return true;
+            case SchedulerPolicy::Weighted: {
+                // One more video packet would push the haptic head past its deadline
+                const int64_t waitAfterVideo = nowNs + serializationNs(video.front().bytes) - haptic.front().enqueuedNs;
+                if (waitAfterVideo > config.hapticDeadlineNs) {
+                    return true;
+                }
+                return hapticServed / config.hapticShare <= videoServed / (1 - config.hapticShare);
+            }
+        }
+        return true;
+    }
+
+    // A class that was idle must not bank credit for the time it sent
+    // nothing, or it would then hog the link
+    static void catchUp(double& served, double share, double otherServed, double otherShare) {
+        served = std::max(served, otherServed / otherShare * share);
+    }
+
+    void dropStaleVideo(int64_t nowNs) {
+        if (config.videoDeadlineNs <= 0) {
+            return;
+        }
+        while (!video.empty() && nowNs - video.front().originNs > config.videoDeadlineNs) {
+            const uint64_t frame = video.front().group;
+            if (!droppedAny || frame != droppedFrame) {
+                counts.framesDropped++;
+            }
+            droppedAny = true;
+            droppedFrame = frame;
+            while (!video.empty() && video.front().group == frame) {
+                video.pop_front();
+                counts.videoDropped++;
+            }
+        }
+    }
+
+    SchedulerConfig config;
+    std::deque<Packet> haptic;
+    std::deque<Packet> video;
+    double hapticServed = 0;  // bytes, for the weighted shares
+    double videoServed = 0;
+    uint64_t order = 0;
+    bool droppedAny = false;
+    uint64_t droppedFrame = 0;  // later packets of it are refused too
+    SchedulerStats counts;
+};
+
+} // namespace tactile
@@ -0,0 +1,89 @@
+// Read-only memory mapping of a whole file (POSIX).
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tactile {
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : base(other.base), length(other.length) {
+        other.base = nullptr;
+        other.length = 0;
+    }
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    // Maps `path`; on failure returns false and leaves a message in `error`.
+    bool map(const std::string& path, std::string& error) {
+        unmap();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            error = path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length > 0) {
+            void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                error = path + ": " + std::strerror(errno);
+                length = 0;
+                ::close(fd);
+                return false;
+            }
+            base = static_cast<const char*>(p);
+            // Replays read front to back
+            ::madvise(p, length, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        return true;
+    }
+
+    const char* data() const {
+        return base;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    std::string_view view() const {
+        return std::string_view(base, length);
+    }
+
+private:
+    void unmap() {
+        if (base) {
+            ::munmap(const_cast<char*>(base), length);
+        }
+        base = nullptr;
+        length = 0;
+    }
+
+    const char* base = nullptr;
+    size_t length = 0;
+};
+
+} // namespace tactile
@@ -0,0 +1,312 @@
+// In-memory metrics for long-running receivers: counters, gauges and
+// latency histograms that the receive path updates with plain relaxed
+// stores, and a registry that renders them in the Prometheus text format
+// or as binary snapshots.
+//
+// Every metric has a single writer (the thread that owns the stream), so an
+// update is a relaxed load and store, never a locked read-modify-write.
+// Readers (the exporter thread) may see a histogram mid-update; the count
+// they report is the sum of the buckets they read, so it always agrees with
+// the +Inf bucket. Register all metrics before the exporter starts.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tactile {
+
+class MetricCounter {
+public:
+    void add(uint64_t n = 1) {
+        total.store(total.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // For counters kept elsewhere (e.g. SequenceStats), refreshed periodically
+    void set(uint64_t value) {
+        total.store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> total{0};
+};
+
+class MetricGauge {
+public:
+    void set(double value) {
+        current.store(value, std::memory_order_relaxed);
+    }
+
+    double value() const {
+        return current.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<double> current{0.0};
+    static_assert(std::atomic<double>::is_always_lock_free, "gauges must not take a lock");
+};
+
+// Power-of-two nanosecond buckets from ~1 us (2^10 ns) to ~17 s (2^34 ns)
+// plus +Inf. Coarser than HdrHistogram, but fixed and cheap to scrape;
+// keep HdrHistogram for the end-of-run percentiles.
+class MetricHistogram {
+public:
+    static constexpr int firstBoundBits = 10;
+    static constexpr int boundCount = 25;
+    static constexpr int bucketCount = boundCount + 1;  // the last is +Inf
+
+    static int bucketOf(int64_t valueNs) {
+        if (valueNs <= (int64_t(1) << firstBoundBits)) {
+            return 0;
+        }
+        // ceil(log2(value)) without a loop
+        int bits = 64 - __builtin_clzll(uint64_t(valueNs - 1));
+        return bits - firstBoundBits < boundCount ? bits - firstBoundBits : boundCount;
+    }
+
+    static double upperBoundSeconds(int bucket) {
+        return double(int64_t(1) << (firstBoundBits + bucket)) / 1e9;
+    }
+
+    void record(int64_t valueNs) {
+        std::atomic<uint64_t>& slot = counts[bucketOf(valueNs)];
+        slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sumNs.store(sumNs.load(std::memory_order_relaxed) + valueNs, std::memory_order_relaxed);
+    }
+
+    uint64_t bucket(int i) const {
+        return counts[i].load(std::memory_order_relaxed);
+    }
+
+    double sumSeconds() const {
+        return double(sumNs.load(std::memory_order_relaxed)) / 1e9;
+    }
+
+private:
+    std::atomic<uint64_t> counts[bucketCount] = {};
+    std::atomic<int64_t> sumNs{0};
+};
+
+enum class MetricType : uint8_t {
+    Counter = 1,
+    Gauge = 2,
+    Histogram = 3,
+};
+
+inline const char* metricTypeName(MetricType type) {
+    switch (type) {
+        case MetricType::Counter: return "counter";
+        case MetricType::Gauge: return "gauge";
+        case MetricType::Histogram: return "histogram";
+    }
+    return "untyped";
+}
+
+// One snapshot read back from a file written by MetricsRegistry::writeSnapshot.
+struct MetricsSnapshot {
+    struct Entry {
+        MetricType type;
+        std::string name;             // "family{labels}"
+        double value = 0;             // counter or gauge
+        std::vector<uint64_t> counts; // histogram buckets, not cumulative
+        double sumSeconds = 0;
+    };
+
+    int64_t timeNs = 0;
+    std::vector<Entry> entries;
+};
+
+class MetricsRegistry {
+public:
+    // `labels` is the inside of the braces, e.g. "stream=\"haptic\"".
+    // Metrics live as long as the registry; references stay valid.
+    MetricCounter& counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+        return *add(MetricType::Counter, name, help, labels).counter;
+    }
+
+    MetricGauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "") {
+        return *add(MetricType::Gauge, name, help, labels).gauge;
+    }
+
+    MetricHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "") {
+        return *add(MetricType::Histogram, name, help, labels).histogram;
+    }
+
+    // Prometheus text exposition format, version 0.0.4.
+    void writePrometheus(std::string& out) const {
+        char line[256];
+        for (size_t i = 0; i < entries.size(); i++) {
+            const Entry& e = entries[i];
+            if (i == 0 || entries[i - 1].name != e.name) {
+                out += "# HELP " + e.name + " " + e.help + "\n";
+                out += "# TYPE " + e.name + " " + metricTypeName(e.type) + "\n";
+            }
+            const std::string braced = e.labels.empty() ? "" : "{" + e.labels + "}";
+            switch (e.type) {
+                case MetricType::Counter:
+                    std::snprintf(line, sizeof(line), "%s%s %llu\n", e.name.c_str(), braced.c_str(),
+                                  static_cast<unsigned long long>(e.counter->value()));
+                    out += line;
+                    break;
+                case MetricType::Gauge:
+                    std::snprintf(line, sizeof(line), "%s%s %.17g\n", e.name.c_str(), braced.c_str(),
+                                  e.gauge->value());
+                    out += line;
+                    break;
+                case MetricType::Histogram: {
+                    const std::string separator = e.labels.empty() ? "" : e.labels + ",";
+                    uint64_t cumulative = 0;
+                    for (int b = 0; b < MetricHistogram::bucketCount; b++) {
+                        cumulative += e.histogram->bucket(b);
+                        if (b < MetricHistogram::boundCount) {
+                            std::snprintf(line, sizeof(line), "%s_bucket{%sle=\"%.9g\"} %llu\n", e.name.c_str(),
+                                          separator.c_str(), MetricHistogram::upperBoundSeconds(b),
+                                          static_cast<unsigned long long>(cumulative));
+                        } else {
+                            std::snprintf(line, sizeof(line), "%s_bucket{%sle=\"+Inf\"} %llu\n", e.name.c_str(),
+                                          separator.c_str(), static_cast<unsigned long long>(cumulative));
+                        }
+                        out += line;
+                    }
+                    std::snprintf(line, sizeof(line), "%s_sum%s %.9f\n%s_count%s %llu\n", e.name.c_str(),
+                                  braced.c_str(), e.histogram->sumSeconds(), e.name.c_str(), braced.c_str(),
+                                  static_cast<unsigned long long>(cumulative));
+                    out += line;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Appends one snapshot: [u32 "TMS1"][i64 time][u32 metrics], then per
+    // metric [u8 type][u16 length]["family{labels}"] followed by a u64
+    // counter, an f64 gauge, or [u32 buckets][u64 count]...[f64 sum seconds].
+    void writeSnapshot(std::ostream& out, int64_t timeNs) const {
+        writeRaw(out, snapshotMagic);
+        writeRaw(out, timeNs);
+        writeRaw(out, uint32_t(entries.size()));
+        for (const Entry& e : entries) {
+            const std::string name = e.labels.empty() ? e.name : e.name + "{" + e.labels + "}";
+            writeRaw(out, uint8_t(e.type));
+            writeRaw(out, uint16_t(name.size()));
+            out.write(name.data(), std::streamsize(name.size()));
+            switch (e.type) {
+                case MetricType::Counter:
+                    writeRaw(out, e.counter->value());
+                    break;
+                case MetricType::Gauge:
+                    writeRaw(out, e.gauge->value());
+                    break;
+                case MetricType::Histogram:
+                    writeRaw(out, uint32_t(MetricHistogram::bucketCount));
+                    for (int b = 0; b < MetricHistogram::bucketCount; b++) {
+                        writeRaw(out, e.histogram->bucket(b));
+                    }
+                    writeRaw(out, e.histogram->sumSeconds());
+                    break;
+            }
+        }
+    }
+
+    static bool readSnapshot(std::istream& in, MetricsSnapshot& snapshot) {
+        uint32_t magic = 0, count = 0;
+        if (!readRaw(in, magic) || magic != snapshotMagic || !readRaw(in, snapshot.timeNs) ||
+            !readRaw(in, count)) {
+            return false;
+        }
+        snapshot.entries.resize(count);
+        for (MetricsSnapshot::Entry& e : snapshot.entries) {
+            uint8_t type;
+            uint16_t length;
+            if (!readRaw(in, type) || !readRaw(in, length)) {
+                return false;
+            }
+            e.type = static_cast<MetricType>(type);
+            e.name.resize(length);
+            if (!in.read(&e.name[0], length)) {
+                return false;
+            }
+            if (e.type == MetricType::Counter) {
+                uint64_t value;
+                if (!readRaw(in, value)) {
+                    return false;
+                }
+                e.value = double(value);
+            } else if (e.type == MetricType::Gauge) {
+                if (!readRaw(in, e.value)) {
+                    return false;
+                }
+            } else if (e.type == MetricType::Histogram) {
+                uint32_t buckets;
+                if (!readRaw(in, buckets) || buckets > 64) {
+                    return false;
+                }
+                e.counts.resize(buckets);
+                for (uint64_t& c : e.counts) {
+                    if (!readRaw(in, c)) {
+                        return false;
+                    }
+                }
+                if (!readRaw(in, e.sumSeconds)) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t snapshotMagic = 0x31534d54;  // "TMS1"
+
+    struct Entry {
+        MetricType type;
+        std::string name;
+        std::string help;
+        std::string labels;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+    };
+
+    // Keeps a family's series together so HELP/TYPE are written once
+    Entry& add(MetricType type, const std::string& name, const std::string& help, const std::string& labels) {
+        auto position = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->name == name) {
+                position = it + 1;
+            }
+        }
+        Entry& e = *entries.insert(position, Entry{ type, name, help, labels, nullptr, nullptr, nullptr });
+        switch (type) {
+            case MetricType::Counter: e.counter = std::make_unique<MetricCounter>(); break;
+            case MetricType::Gauge: e.gauge = std::make_unique<MetricGauge>(); break;
+            case MetricType::Histogram: e.histogram = std::make_unique<MetricHistogram>(); break;
+        }
+        return e;
+    }
+
+    template <typename T>
+    static void writeRaw(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static bool readRaw(std::istream& in, T& value) {
+        return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    std::vector<Entry> entries;  // the metrics themselves are heap-held, so inserts never move them
+};
+
+} // namespace tactile
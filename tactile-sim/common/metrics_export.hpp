@@ -0,0 +1,270 @@
+// Serves a MetricsRegistry to Prometheus and dumps periodic snapshots, all
+// from one background thread so the receive path only ever touches the
+// metrics themselves.
+//
+//   --metrics-port P      HTTP on 127.0.0.1:P (GET /metrics)
+//   --metrics-socket F    HTTP on the Unix socket F instead / as well
+//   --snapshot-out F      append a binary snapshot to F (metrics.hpp)
+//   --snapshot-s S        every S seconds (default 10)
+//
+// Also the stop flag for the long-running modes: "--duration-s 0" runs
+// until SIGINT or SIGTERM.
+#pragma once
+
+#include "metrics.hpp"
+#include "options.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tactile {
+
+inline std::atomic<bool>& stopRequestedFlag() {
+    static std::atomic<bool> flag{false};
+    return flag;
+}
+
+inline bool stopRequested() {
+    return stopRequestedFlag().load(std::memory_order_relaxed);
+}
+
+// SIGINT/SIGTERM end the run cleanly so the final summary is still printed
+inline void installStopSignals() {
+    static_assert(std::atomic<bool>::is_always_lock_free, "the flag is set from a signal handler");
+    auto handler = [](int) { stopRequestedFlag().store(true, std::memory_order_relaxed); };
+    std::signal(SIGINT, handler);
+    std::signal(SIGTERM, handler);
+}
+
+class MetricsExporter {
+public:
+    explicit MetricsExporter(const MetricsRegistry& registry) : registry(registry) {}
+
+    ~MetricsExporter() {
+        stop();
+        for (int fd : listeners) {
+            ::close(fd);
+        }
+        if (!unixPath.empty()) {
+            ::unlink(unixPath.c_str());
+        }
+    }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Loopback only: the endpoint is for a local scraper or an SSH tunnel
+    bool listenTcp(int port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return finishListen(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+
+    bool listenUnix(const std::string& path) {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) {
+            return false;
+        }
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        ::unlink(path.c_str());  // left over from a previous run
+        if (!finishListen(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) {
+            return false;
+        }
+        unixPath = path;
+        return true;
+    }
+
+    bool snapshotTo(const std::string& path, std::chrono::milliseconds every) {
+        snapshots.open(path, std::ios::binary | std::ios::app);
+        snapshotEvery = every;
+        return bool(snapshots);
+    }
+
+    bool enabled() const {
+        return !listeners.empty() || snapshots.is_open();
+    }
+
+    void start() {
+        if (enabled() && !worker.joinable()) {
+            worker = std::thread([this] { run(); });
+        }
+    }
+
+    // Writes a last snapshot so the file ends with the final totals
+    void stop() {
+        if (worker.joinable()) {
+            running = false;
+            worker.join();
+            writeSnapshot();
+        }
+    }
+
+    uint64_t scrapes() const {
+        return scrapeCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    bool finishListen(int fd, sockaddr* addr, socklen_t size) {
+        if (::bind(fd, addr, size) != 0 || ::listen(fd, 8) != 0) {
+            ::close(fd);
+            return false;
+        }
+        listeners.push_back(fd);
+        return true;
+    }
+
+    void run() {
+        std::vector<pollfd> fds;
+        for (int fd : listeners) {
+            fds.push_back({ fd, POLLIN, 0 });
+        }
+        auto nextSnapshot = std::chrono::steady_clock::now() + snapshotEvery;
+        while (running) {
+            // Wake up at least every 200 ms to notice stop()
+            int ready = ::poll(fds.data(), fds.size(), 200);
+            for (size_t i = 0; ready > 0 && i < fds.size(); i++) {
+                if (fds[i].revents & POLLIN) {
+                    serve(fds[i].fd);
+                }
+            }
+            if (snapshots.is_open() && std::chrono::steady_clock::now() >= nextSnapshot) {
+                nextSnapshot += snapshotEvery;
+                writeSnapshot();
+            }
+        }
+    }
+
+    // One request per connection; anything but GET /metrics (or /) is a 404
+    void serve(int listener) {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        timeval timeout{ 1, 0 };
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        char request[2048];
+        size_t used = 0;
+        while (used < sizeof(request) - 1) {
+            ssize_t n = ::recv(fd, request + used, sizeof(request) - 1 - used, 0);
+            if (n <= 0) {
+                break;
+            }
+            used += size_t(n);
+            request[used] = '\0';
+            if (std::strstr(request, "\r\n\r\n") || std::strstr(request, "\n\n")) {
+                break;
+            }
+        }
+        request[used] = '\0';
+
+        body.clear();
+        const char* status = "404 Not Found";
+        if (std::strncmp(request, "GET /metrics", 12) == 0 || std::strncmp(request, "GET / ", 6) == 0) {
+            status = "200 OK";
+            registry.writePrometheus(body);
+            scrapeCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        response = "HTTP/1.1 ";
+        response += status;
+        response += "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: ";
+        response += std::to_string(body.size());
+        response += "\r\nConnection: close\r\n\r\n";
+        response += body;
+        for (size_t sent = 0; sent < response.size();) {
+            ssize_t n = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            sent += size_t(n);
+        }
+        ::close(fd);
+    }
+
+    void writeSnapshot() {
+        if (snapshots.is_open()) {
+            registry.writeSnapshot(snapshots, realtimeNs());
+            snapshots.flush();
+        }
+    }
+
+    static int64_t realtimeNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    const MetricsRegistry& registry;
+    std::vector<int> listeners;
+    std::string unixPath;
+    std::ofstream snapshots;
+    std::chrono::milliseconds snapshotEvery{10000};
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> scrapeCount{0};
+    std::thread worker;
+    std::string body;      // exporter thread only, reused between scrapes
+    std::string response;
+};
+
+// Applies the --metrics-* / --snapshot-* options. Prints the reason and
+// returns false if an endpoint cannot be opened.
+inline bool setupMetricsExport(const Options& opts, MetricsExporter& exporter) {
+    if (opts.has("--metrics-port")) {
+        long port = opts.getInt("--metrics-port", 0);
+        if (!exporter.listenTcp(static_cast<int>(port))) {
+            std::cerr << "Cannot listen on 127.0.0.1:" << port << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        std::cout << "Serving metrics on http://127.0.0.1:" << port << "/metrics" << std::endl;
+    }
+    std::string socketPath = opts.get("--metrics-socket", "");
+    if (!socketPath.empty()) {
+        if (!exporter.listenUnix(socketPath)) {
+            std::cerr << "Cannot listen on Unix socket " << socketPath << std::endl;
+            return false;
+        }
+        std::cout << "Serving metrics on unix:" << socketPath << std::endl;
+    }
+    std::string snapshotPath = opts.get("--snapshot-out", "");
+    if (!snapshotPath.empty()) {
+        const auto every = std::chrono::milliseconds(
+            static_cast<long>(opts.getDouble("--snapshot-s", 10) * 1000));
+        if (every.count() <= 0 || !exporter.snapshotTo(snapshotPath, every)) {
+            std::cerr << "Cannot write snapshots to " << snapshotPath << std::endl;
+            return false;
+        }
+    }
+    exporter.start();
+    return true;
+}
+
+} // namespace tactile
@@ -0,0 +1,584 @@
+// Deterministic offline model of the pipeline: a recorded trace is fed
+// through simulated links and the haptic relay's dead-band codec as
+// discrete events, with no sockets and no wall clock.
+//
+//   tactile rows -> uplink -> relay (dead-band) -> downlink -> receiver
+//   video rows   -> video link                  -> receiver
+//
+// With --bottleneck-mbps the downlink and the video link share one
+// bottleneck in front of them, run by the cross-layer scheduler in
+// link_scheduler.hpp; video frames are then cut into MTU-sized packets
+// and paced over their frame interval.
+//
+// All times are on the trace's own timeline (recorded timestamp_s, in ns),
+// so latency is arrival time minus recorded time. Randomness (jitter and
+// loss) comes from SimRandom, which is seeded per link from one run seed
+// and does not depend on the standard library's distributions, so a run
+// with the same trace, configuration and seed is bit-identical every time.
+//
+// The pipeline does not own the clock: it asks a scheduler to deliver each
+// event at its time. runOffline() uses the EventQueue below; the ns-3
+// variant hands the same events to Simulator::Schedule.
+#pragma once
+
+#include "columnar_trace.hpp"
+#include "deadband.hpp"
+#include "haptic_wire.hpp"
+#include "hdr_histogram.hpp"
+#include "link_scheduler.hpp"
+#include "options.hpp"
+#include "sequence_tracker.hpp"
+#include "sim_random.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace tactile {
+
+struct LinkConfig {
+    int64_t delayNs = 0;       // one-way propagation
+    int64_t jitterNs = 0;      // added delay uniform in [-jitter, +jitter]
+    double loss = 0;           // independent drop probability
+    double bandwidthBps = 0;   // serialization rate, 0 = unlimited
+};
+
+// One direction of a link. Messages leave in the order they were sent:
+// jitter never lets a message overtake the one before it.
+class LinkModel {
+public:
+    LinkModel(const LinkConfig& config, uint64_t seed) : config(config), random(seed) {}
+
+    // Returns false if the message is lost, otherwise its arrival time.
+    bool transmit(int64_t sendNs, size_t bytes, int64_t& arriveNs) {
+        sent++;
+        int64_t departNs = sendNs;
+        if (config.bandwidthBps > 0) {
+            departNs = std::max(sendNs, busyUntilNs) + int64_t(double(bytes) * 8e9 / config.bandwidthBps);
+            busyUntilNs = departNs;
+        }
+        // Draw both numbers every time so one setting does not shift the
+        // random stream of the other
+        const double lossDraw = random.uniform();
+        const double jitterDraw = random.uniform();
+        if (lossDraw < config.loss) {
+            lost++;
+            return false;
+        }
+        const int64_t jitter = int64_t(std::llround((jitterDraw * 2 - 1) * double(config.jitterNs)));
+        arriveNs = std::max(departNs + std::max<int64_t>(config.delayNs + jitter, 0), lastArrivalNs);
+        lastArrivalNs = arriveNs;
+        return true;
+    }
+
+    uint64_t sentCount() const {
+        return sent;
+    }
+
+    uint64_t lostCount() const {
+        return lost;
+    }
+
+private:
+    LinkConfig config;
+    SimRandom random;
+    int64_t busyUntilNs = INT64_MIN;
+    int64_t lastArrivalNs = INT64_MIN;
+    uint64_t sent = 0;
+    uint64_t lost = 0;
+};
+
+struct OfflineConfig {
+    uint64_t seed = 1;
+    int64_t durationNs = 0;  // trace time to cover, 0 = the whole trace
+    LinkConfig uplink;       // tactile source -> relay
+    LinkConfig downlink;     // relay -> receiver
+    LinkConfig videoLink;    // video source -> receiver
+    int64_t relayProcessingNs = 0;
+    double hapticRateHz = 0;     // thin each hand's samples to this rate, 0 = as recorded
+    double videoBitrateBps = 0;  // scale frame sizes to this mean rate, 0 = as recorded
+    DeadbandMode mode = DeadbandMode::Absolute;
+    DeadbandConfig deadband;
+    SchedulerConfig bottleneck;  // shared by downlink and video when enabled
+};
+
+// Reads --seed, --duration-s, the haptic hops' --delay-ms/--jitter-ms/
+// --loss/--bandwidth-mbps (each of uplink and downlink), the video link's
+// --video-delay-ms/--video-jitter-ms/--video-loss/--video-bandwidth-mbps,
+// --relay-us, --haptic-rate-hz, --video-mbps, the relay's --codec plus
+// dead-band options, and the shared bottleneck's options (link_scheduler.hpp).
+inline bool offlineConfigFromOptions(const Options& opts, OfflineConfig& config) {
+    auto msToNs = [](double ms) { return int64_t(std::llround(ms * 1e6)); };
+    config.seed = uint64_t(opts.getInt("--seed", 1));
+    config.durationNs = msToNs(opts.getDouble("--duration-s", 0) * 1e3);
+    config.uplink.delayNs = msToNs(opts.getDouble("--delay-ms", 5));
+    config.uplink.jitterNs = msToNs(opts.getDouble("--jitter-ms", 1));
+    config.uplink.loss = opts.getDouble("--loss", 0);
+    config.uplink.bandwidthBps = opts.getDouble("--bandwidth-mbps", 0) * 1e6;
+    config.downlink = config.uplink;
+    config.videoLink.delayNs = msToNs(opts.getDouble("--video-delay-ms", 10));
+    config.videoLink.jitterNs = msToNs(opts.getDouble("--video-jitter-ms", 2));
+    config.videoLink.loss = opts.getDouble("--video-loss", 0);
+    config.videoLink.bandwidthBps = opts.getDouble("--video-bandwidth-mbps", 100) * 1e6;
+    config.relayProcessingNs = int64_t(opts.getDouble("--relay-us", 0) * 1e3);
+    config.hapticRateHz = opts.getDouble("--haptic-rate-hz", 0);
+    config.videoBitrateBps = opts.getDouble("--video-mbps", 0) * 1e6;
+    if (!parseDeadbandMode(opts.get("--codec", "absolute"), config.mode)) {
+        std::cerr << "Unknown --codec (use off, absolute, weber or predictive)" << std::endl;
+        return false;
+    }
+    config.deadband = deadbandConfigFromOptions(opts);
+    if (!schedulerConfigFromOptions(opts, config.bottleneck)) {
+        return false;
+    }
+    if (config.uplink.loss < 0 || config.uplink.loss > 1 || config.videoLink.loss < 0 || config.videoLink.loss > 1) {
+        std::cerr << "--loss and --video-loss must be between 0 and 1" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+enum class SimEventKind : uint8_t {
+    Source,        // the next trace row is due
+    RelayArrival,  // a haptic sample reaches the relay
+    LinkArrival,   // a packet reaches the shared bottleneck
+    LinkDone,      // the bottleneck finished sending a packet
+    Delivery,      // a message reaches the receiver
+};
+
+struct SimEvent {
+    int64_t timeNs;
+    SimEventKind kind;
+    uint8_t table;   // trace table of the row
+    uint16_t streamId;
+    uint32_t index;  // trace event index (Source) or table row (the others)
+    int64_t sentNs;  // recorded time of the row
+    uint64_t seq;
+    uint16_t part;   // video packet within its frame, behind a bottleneck
+    uint16_t parts;  // 0 = the whole message in one piece
+};
+
+// Min-heap on time; events at the same time run in the order scheduled,
+// so the run never depends on heap internals.
+class EventQueue {
+public:
+    void push(const SimEvent& e) {
+        heap.push({ e, order++ });
+    }
+
+    bool pop(SimEvent& e) {
+        if (heap.empty()) {
+            return false;
+        }
+        e = heap.top().event;
+        heap.pop();
+        return true;
+    }
+
+    size_t size() const {
+        return heap.size();
+    }
+
+private:
+    struct Entry {
+        SimEvent event;
+        uint64_t order;
+
+        bool operator<(const Entry& other) const {
+            // std::priority_queue is a max-heap: "less" means later
+            if (event.timeNs != other.event.timeNs) {
+                return event.timeNs > other.event.timeNs;
+            }
+            return order > other.order;
+        }
+    };
+
+    std::priority_queue<Entry> heap;
+    uint64_t order = 0;
+};
+
+struct OfflineResult {
+    StreamHistograms haptic;
+    StreamHistograms video;
+    SequenceTrackers hapticSeq;
+    SequenceTrackers videoSeq;
+    DeadbandStats codec;  // summed over sessions; error maxima are the overall maxima
+    bool bottleneck = false;
+    SchedulerStats scheduler;
+    uint64_t uplinkLost = 0;
+    uint64_t downlinkLost = 0;
+    uint64_t videoLost = 0;
+    uint64_t events = 0;
+    int64_t startNs = 0;      // trace time of the first row
+    int64_t endNs = 0;        // time of the last event
+    uint64_t digest = 0xcbf29ce484222325ull;  // FNV-1a over every delivery, to compare runs
+};
+
+class OfflinePipeline {
+public:
+    OfflinePipeline(const TraceReader& trace, const OfflineConfig& config)
+        : trace(trace), config(config),
+          uplink(config.uplink, config.seed * 3 + 1),
+          downlink(behindBottleneck(config.downlink, config), config.seed * 3 + 2),
+          videoLink(behindBottleneck(config.videoLink, config), config.seed * 3 + 3),
+          scheduler(config.bottleneck) {
+        for (size_t t = 0; t < trace.tableCount(); t++) {
+            TraceTable table = trace.table(t);
+            TraceSource source;
+            Route route{ false, false, HapticColumns(table), table.find("bytes_this_frame") };
+            if (parseTraceSource(table.name(), source)) {
+                route.haptic = source == TraceSource::Tactile && route.columns.usable();
+                route.video = source == TraceSource::Video;
+            }
+            routes.push_back(route);
+        }
+        if (config.hapticRateHz > 0) {
+            hapticPeriodNs = int64_t(std::llround(1e9 / config.hapticRateHz));
+        }
+        if (config.videoBitrateBps > 0) {
+            const double recorded = recordedVideoBitrate();
+            videoScale = recorded > 0 ? config.videoBitrateBps / recorded : 1;
+        }
+        result.bottleneck = config.bottleneck.enabled();
+        result.startNs = result.endNs = trace.firstNs();
+        endNs = config.durationNs > 0 ? trace.firstNs() + config.durationNs : INT64_MAX;
+    }
+
+    // The first event; schedule it, then hand every due event to handle()
+    bool first(SimEvent& e) const {
+        return sourceEvent(0, e);
+    }
+
+    // Processes one event at its time, scheduling any follow-ups with
+    // schedule(const SimEvent&).
+    template <typename Schedule>
+    void handle(const SimEvent& e, Schedule&& schedule) {
+        result.events++;
+        result.endNs = e.timeNs;
+        switch (e.kind) {
+            case SimEventKind::Source: {
+                SimEvent next;
+                if (sourceEvent(e.index + 1, next)) {
+                    schedule(next);
+                }
+                emit(e, schedule);
+                break;
+            }
+            case SimEventKind::RelayArrival:
+                relay(e, schedule);
+                break;
+            case SimEventKind::LinkArrival:
+                if (routes[e.table].haptic) {
+                    scheduler.enqueueHaptic(e, hapticWireSize, e.timeNs);
+                } else {
+                    scheduler.enqueueVideo(e, partBytes(e), e.sentNs, e.seq, e.timeNs);
+                }
+                startLink(e.timeNs, schedule);
+                break;
+            case SimEventKind::LinkDone:
+                linkBusy = false;
+                propagate(e, schedule);
+                startLink(e.timeNs, schedule);
+                break;
+            case SimEventKind::Delivery:
+                deliver(e);
+                break;
+        }
+    }
+
+    // Settles open sequence gaps and collects the link counters
+    OfflineResult& finish() {
+        result.hapticSeq.finish();
+        result.videoSeq.finish();
+        result.codec = DeadbandStats();
+        for (const auto& entry : sessions) {
+            const DeadbandStats& s = entry.second.codec.stats();
+            result.codec.inputs += s.inputs;
+            result.codec.sent += s.sent;
+            result.codec.positionSq += s.positionSq;
+            result.codec.orientationSq += s.orientationSq;
+            result.codec.forceSq += s.forceSq;
+            result.codec.positionMax = std::max(result.codec.positionMax, s.positionMax);
+            result.codec.orientationMax = std::max(result.codec.orientationMax, s.orientationMax);
+            result.codec.forceMax = std::max(result.codec.forceMax, s.forceMax);
+        }
+        result.uplinkLost = uplink.lostCount();
+        result.downlinkLost = downlink.lostCount();
+        result.videoLost = videoLink.lostCount();
+        result.scheduler = scheduler.stats();
+        return result;
+    }
+
+private:
+    struct Route {
+        bool haptic;
+        bool video;
+        HapticColumns columns;
+        int bytesColumn;  // video frame size, -1 if absent
+    };
+
+    struct Source {
+        int64_t lastNs = 0;
+        uint64_t seq = 0;
+    };
+
+    struct Session {
+        DeadbandCodec codec;
+        uint64_t seq = 0;
+    };
+
+    // The bottleneck does the serializing; the links behind it only delay
+    static LinkConfig behindBottleneck(LinkConfig link, const OfflineConfig& config) {
+        if (config.bottleneck.enabled()) {
+            link.bandwidthBps = 0;
+        }
+        return link;
+    }
+
+    size_t frameBytes(const TraceTable& table, const Route& route, size_t row) const {
+        return route.bytesColumn >= 0
+            ? size_t(std::max(0.0, table.column(route.bytesColumn).number(row)) * videoScale) : 64;
+    }
+
+    size_t partBytes(const SimEvent& e) const {
+        const size_t bytes = frameBytes(trace.table(e.table), routes[e.table], e.index);
+        const size_t mtu = config.bottleneck.mtuBytes;
+        return e.part + 1 < e.parts ? mtu : bytes - size_t(e.parts - 1) * mtu;
+    }
+
+    // Cuts a frame into MTU-sized packets and paces them into the
+    // bottleneck over the time until the next frame
+    template <typename Schedule>
+    void packetizeFrame(const SimEvent& e, const TraceTable& table, size_t row, size_t bytes, uint64_t frameSeq,
+                        Schedule&& schedule) {
+        const size_t mtu = config.bottleneck.mtuBytes;
+        const size_t parts = std::min<size_t>(std::max<size_t>(1, (bytes + mtu - 1) / mtu), UINT16_MAX);
+        int64_t intervalNs = 33333333;  // ~30 fps when the next frame is unknown
+        if (row + 1 < table.rows() && table.timeNs(row + 1) > table.timeNs(row)) {
+            intervalNs = table.timeNs(row + 1) - table.timeNs(row);
+        }
+        const double gapNs = config.bottleneck.videoPacing > 0
+            ? double(intervalNs) / config.bottleneck.videoPacing / double(parts) : 0;
+        for (size_t k = 0; k < parts; k++) {
+            schedule(SimEvent{ e.timeNs + int64_t(gapNs * double(k)), SimEventKind::LinkArrival, e.table, 0,
+                               uint32_t(row), e.sentNs, frameSeq, uint16_t(k), uint16_t(parts) });
+        }
+    }
+
+    template <typename Schedule>
+    void startLink(int64_t nowNs, Schedule&& schedule) {
+        if (linkBusy) {
+            return;
+        }
+        LinkScheduler<SimEvent>::Packet packet;
+        bool haptic;
+        if (!scheduler.next(nowNs, packet, haptic)) {
+            return;
+        }
+        linkBusy = true;
+        SimEvent done = packet.item;
+        done.kind = SimEventKind::LinkDone;
+        done.timeNs = nowNs + scheduler.serializationNs(packet.bytes);
+        schedule(done);
+    }
+
+    // A packet left the bottleneck: on to the receiver over its own link
+    template <typename Schedule>
+    void propagate(const SimEvent& e, Schedule&& schedule) {
+        const bool haptic = routes[e.table].haptic;
+        int64_t arriveNs;
+        if ((haptic ? downlink : videoLink).transmit(e.timeNs, 0, arriveNs)) {
+            SimEvent delivery = e;
+            delivery.kind = SimEventKind::Delivery;
+            delivery.timeNs = arriveNs;
+            schedule(delivery);
+        }
+    }
+
+    // Mean bit rate of the recorded frames over the video table's span
+    double recordedVideoBitrate() const {
+        for (size_t t = 0; t < routes.size(); t++) {
+            const TraceTable table = trace.table(t);
+            if (!routes[t].video || routes[t].bytesColumn < 0 || table.rows() < 2) {
+                continue;
+            }
+            double bytes = 0;
+            for (size_t row = 0; row + 1 < table.rows(); row++) {
+                bytes += table.column(routes[t].bytesColumn).number(row);
+            }
+            const int64_t spanNs = table.timeNs(table.rows() - 1) - table.timeNs(0);
+            return spanNs > 0 ? bytes * 8e9 / double(spanNs) : 0;
+        }
+        return 0;
+    }
+
+    bool sourceEvent(size_t index, SimEvent& e) const {
+        for (; index < trace.eventCount(); index++) {
+            const TraceEventRef& ref = trace.event(index);
+            const Route& route = routes[ref.table];
+            if (!route.haptic && !route.video) {
+                continue;
+            }
+            const int64_t t = trace.eventTimeNs(index);
+            if (t > endNs) {
+                return false;
+            }
+            e = SimEvent{ t, SimEventKind::Source, ref.table, 0, uint32_t(index), t, 0, 0, 0 };
+            return true;
+        }
+        return false;
+    }
+
+    template <typename Schedule>
+    void emit(const SimEvent& e, Schedule&& schedule) {
+        const TraceEventRef& ref = trace.event(e.index);
+        const Route& route = routes[ref.table];
+        const TraceTable table = trace.table(ref.table);
+        int64_t arriveNs;
+        if (route.haptic) {
+            fillHapticSample(table, route.columns, ref.row, sample);
+            Source& source = sources[sample.header.streamId];
+            if (config.hapticRateHz > 0 && source.seq > 0 && e.timeNs - source.lastNs < hapticPeriodNs) {
+                return;  // thinned out
+            }
+            source.lastNs = e.timeNs;
+            const uint64_t sampleSeq = source.seq++;
+            if (uplink.transmit(e.timeNs, hapticWireSize, arriveNs)) {
+                schedule(SimEvent{ arriveNs, SimEventKind::RelayArrival, ref.table, sample.header.streamId, ref.row,
+                                   e.sentNs, sampleSeq, 0, 0 });
+            }
+            return;
+        }
+        const size_t bytes = frameBytes(table, route, ref.row);
+        const uint64_t frameSeq = videoSeq++;
+        if (config.bottleneck.enabled()) {
+            packetizeFrame(e, table, ref.row, bytes, frameSeq, schedule);
+            return;
+        }
+        if (videoLink.transmit(e.timeNs, bytes, arriveNs)) {
+            schedule(SimEvent{ arriveNs, SimEventKind::Delivery, ref.table, 0, ref.row, e.sentNs, frameSeq, 0, 0 });
+        }
+    }
+
+    template <typename Schedule>
+    void relay(const SimEvent& e, Schedule&& schedule) {
+        fillHapticSample(trace.table(e.table), routes[e.table].columns, e.index, sample);
+        auto it = sessions.find(e.streamId);
+        if (it == sessions.end()) {
+            it = sessions.emplace(e.streamId, Session{ DeadbandCodec(config.mode, config.deadband) }).first;
+        }
+        Session& session = it->second;
+        if (!session.codec.offer(sample)) {
+            return;
+        }
+        int64_t arriveNs;
+        const uint64_t forwardSeq = session.seq++;
+        const int64_t departNs = e.timeNs + config.relayProcessingNs;
+        if (config.bottleneck.enabled()) {
+            schedule(SimEvent{ departNs, SimEventKind::LinkArrival, e.table, e.streamId, e.index, e.sentNs,
+                               forwardSeq, 0, 0 });
+        } else if (downlink.transmit(departNs, hapticWireSize, arriveNs)) {
+            schedule(SimEvent{ arriveNs, SimEventKind::Delivery, e.table, e.streamId, e.index, e.sentNs, forwardSeq,
+                               0, 0 });
+        }
+    }
+
+    void deliver(const SimEvent& e) {
+        const bool haptic = routes[e.table].haptic;
+        if (!haptic && e.parts > 0) {
+            // A frame counts once its last packet is in and none went missing
+            if (!frameOpen || e.seq != openFrame) {
+                frameOpen = true;
+                openFrame = e.seq;
+                partsReceived = 0;
+            }
+            partsReceived++;
+            if (e.part + 1 != e.parts || partsReceived != e.parts) {
+                return;
+            }
+        }
+        if (haptic) {
+            result.haptic.record(e.timeNs, e.sentNs);
+            result.hapticSeq.record(e.streamId, e.seq);
+        } else {
+            result.video.record(e.timeNs, e.sentNs);
+            result.videoSeq.record(0, e.seq);
+        }
+        const uint64_t fields[] = { uint64_t(e.timeNs), uint64_t(e.sentNs), e.seq,
+                                    uint64_t(e.streamId) | (uint64_t(haptic) << 16) };
+        for (uint64_t field : fields) {
+            for (int i = 0; i < 8; i++) {
+                result.digest = (result.digest ^ ((field >> (8 * i)) & 0xff)) * 0x100000001b3ull;
+            }
+        }
+    }
+
+    const TraceReader& trace;
+    OfflineConfig config;
+    std::vector<Route> routes;
+    int64_t endNs;
+    LinkModel uplink;
+    LinkModel downlink;
+    LinkModel videoLink;
+    int64_t hapticPeriodNs = 0;
+    double videoScale = 1;
+    std::unordered_map<uint16_t, Source> sources;
+    std::unordered_map<uint16_t, Session> sessions;
+    uint64_t videoSeq = 0;
+    LinkScheduler<SimEvent> scheduler;
+    bool linkBusy = false;
+    bool frameOpen = false;  // video reassembly at the receiver
+    uint64_t openFrame = 0;
+    size_t partsReceived = 0;
+    HapticSample sample;
+    OfflineResult result;
+};
+
+// Runs the whole trace through the pipeline on a plain event queue, as
+// fast as the CPU allows.
+inline OfflineResult runOffline(const TraceReader& trace, const OfflineConfig& config) {
+    OfflinePipeline pipeline(trace, config);
+    EventQueue queue;
+    SimEvent e;
+    if (pipeline.first(e)) {
+        queue.push(e);
+    }
+    auto schedule = [&](const SimEvent& next) { queue.push(next); };
+    while (queue.pop(e)) {
+        pipeline.handle(e, schedule);
+    }
+    return pipeline.finish();
+}
+
+inline void printOfflineResult(std::ostream& out, const OfflineResult& r) {
+    out << "Events: " << r.events << ", simulated " << (r.endNs - r.startNs) / 1e9 << " s of trace time" << std::endl;
+    out << "Haptic delivered: " << r.haptic.latency.run.count() << ", video delivered: "
+        << r.video.latency.run.count() << std::endl;
+    out << "Relay dead-band: " << r.codec.sent << " of " << r.codec.inputs << " samples forwarded ("
+        << 100.0 * r.codec.reductionRatio() << "% suppressed)" << std::endl;
+    out << "Link losses: uplink " << r.uplinkLost << ", downlink " << r.downlinkLost << ", video "
+        << r.videoLost << std::endl;
+    printPercentiles(out, "Haptic latency      ", r.haptic.latency.run);
+    printPercentiles(out, "Haptic inter-arrival", r.haptic.interArrival.run);
+    printPercentiles(out, "Video latency       ", r.video.latency.run);
+    printPercentiles(out, "Video inter-arrival ", r.video.interArrival.run);
+    printSequenceStats(out, "Haptic ", r.hapticSeq.total());
+    printSequenceStats(out, "Video ", r.videoSeq.total());
+    if (r.bottleneck) {
+        const SchedulerStats& s = r.scheduler;
+        const int64_t spanNs = r.endNs - r.startNs;
+        out << "Bottleneck: " << s.hapticSent << " haptic sent, " << s.hapticLate << " over deadline; "
+            << s.videoSent << " video packets sent, " << s.framesDropped << " frames (" << s.videoDropped
+            << " packets) dropped; " << (spanNs > 0 ? 100.0 * double(s.busyNs) / double(spanNs) : 0.0)
+            << "% busy" << std::endl;
+    }
+    out << "Run digest: " << std::hex << std::setw(16) << std::setfill('0') << r.digest << std::dec
+        << std::setfill(' ') << std::endl;
+}
+
+} // namespace tactile
@@ -0,0 +1,47 @@
+// Minimal "--name value" command-line lookup for the standalone programs.
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace tactile {
+
+class Options {
+public:
+    Options(int argc, char* argv[]) : argc(argc), argv(argv) {}
+
+    bool has(const char* name) const {
+        return find(name) != 0;
+    }
+
+    std::string get(const char* name, const std::string& fallback) const {
+        int i = find(name);
+        return (i != 0 && i + 1 < argc) ? std::string(argv[i + 1]) : fallback;
+    }
+
+    long getInt(const char* name, long fallback) const {
+        int i = find(name);
+        return (i != 0 && i + 1 < argc) ? std::strtol(argv[i + 1], nullptr, 10) : fallback;
+    }
+
+    double getDouble(const char* name, double fallback) const {
+        int i = find(name);
+        return (i != 0 && i + 1 < argc) ? std::strtod(argv[i + 1], nullptr) : fallback;
+    }
+
+private:
+    int find(const char* name) const {
+        for (int i = 1; i < argc; i++) {
+            if (std::strcmp(argv[i], name) == 0) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    int argc;
+    char** argv;
+};
+
+} // namespace tactile
@@ -0,0 +1,231 @@
+// Shared receive loop for the subscribers. Replaces the poll-then-sleep
+// pattern with a selectable wait strategy and drains every pending message
+// on every socket per wakeup.
+#pragma once
+
+#include "options.hpp"
+#include "recv_buffer.hpp"
+#include "transport.hpp"
+
+#include <zmq.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace tactile {
+
+enum class WaitStrategy {
+    Block,     // zmq::poll until traffic or timeout (shm sources: spin, then nap)
+    Spin,      // non-blocking receive in a tight loop; pair with --cpu
+    Adaptive,  // spin for a short budget, then fall back to Block
+};
+
+inline bool parseWaitStrategy(const std::string& name, WaitStrategy& out) {
+    if (name == "block") {
+        out = WaitStrategy::Block;
+    } else if (name == "spin") {
+        out = WaitStrategy::Spin;
+    } else if (name == "adaptive") {
+        out = WaitStrategy::Adaptive;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* waitStrategyName(WaitStrategy strategy) {
+    switch (strategy) {
+        case WaitStrategy::Block: return "block";
+        case WaitStrategy::Spin: return "spin";
+        case WaitStrategy::Adaptive: return "adaptive";
+    }
+    return "?";
+}
+
+// Pins the calling thread to one CPU. Only supported on Linux; elsewhere it
+// reports failure and the thread keeps running unpinned.
+inline bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Reads "--wait block|spin|adaptive" and "--cpu N" and pins the calling
+// thread if asked to. Returns false on an unknown strategy.
+inline bool setupReceiveThread(const Options& opts, WaitStrategy& strategy) {
+    if (!parseWaitStrategy(opts.get("--wait", "block"), strategy)) {
+        std::cerr << "Unknown --wait strategy (use block, spin or adaptive)" << std::endl;
+        return false;
+    }
+    long cpu = opts.getInt("--cpu", -1);
+    if (cpu >= 0 && !pinCurrentThread(static_cast<int>(cpu))) {
+        std::cerr << "Could not pin receive thread to CPU " << cpu << std::endl;
+    }
+    return true;
+}
+
+class ReceiveEngine {
+public:
+    using Handler = std::function<void(const RecvBuffer&)>;
+
+    static constexpr size_t maxSockets = 8;
+
+    explicit ReceiveEngine(WaitStrategy strategy,
+                           std::chrono::microseconds spinBudget = std::chrono::microseconds(50))
+        : strategy(strategy), spinBudget(spinBudget) {}
+
+    void add(zmq::socket_t& socket, Handler handler) {
+        addSource(&socket, nullptr, std::move(handler));
+    }
+
+    // Call after subscriber.connect(), which decides how it is read
+    void add(Subscriber& subscriber, Handler handler) {
+        if (subscriber.isShm()) {
+            addSource(nullptr, &subscriber, std::move(handler));
+        } else {
+            addSource(&subscriber.socket(), nullptr, std::move(handler));
+        }
+    }
+
+    // Waits at most `timeout` for traffic, then handles everything that is
+    // pending. Returns the number of messages handled.
+    size_t runOnce(std::chrono::milliseconds timeout) {
+        switch (strategy) {
+            case WaitStrategy::Block:
+                return pollAndDrain(timeout);
+            case WaitStrategy::Spin:
+                return spinUntil(std::chrono::steady_clock::now() + timeout);
+            case WaitStrategy::Adaptive: {
+                auto start = std::chrono::steady_clock::now();
+                auto spinEnd = start + std::min<std::chrono::steady_clock::duration>(spinBudget, timeout);
+                if (size_t handled = spinUntil(spinEnd)) {
+                    return handled;
+                }
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    start + timeout - std::chrono::steady_clock::now());
+                return pollAndDrain(std::max(left, std::chrono::milliseconds(0)));
+            }
+        }
+        return 0;
+    }
+
+    // Handles whatever is already queued without waiting.
+    size_t drain() {
+        size_t handled = 0;
+        size_t before;
+        do {
+            before = handled;
+            for (size_t i = 0; i < count; i++) {
+                handled += drainSocket(i);
+            }
+        } while (handled != before);
+        return handled;
+    }
+
+    WaitStrategy waitStrategy() const {
+        return strategy;
+    }
+
+private:
+    void addSource(zmq::socket_t* socket, Subscriber* shm, Handler handler) {
+        if (count == maxSockets) {
+            throw std::length_error("ReceiveEngine supports at most " + std::to_string(maxSockets) + " sockets");
+        }
+        sockets[count] = socket;
+        shmSources[count] = shm;
+        handlers[count] = std::move(handler);
+        if (socket) {
+            items[polledCount] = { static_cast<void*>(*socket), 0, ZMQ_POLLIN, 0 };
+            polledSource[polledCount++] = count;
+        }
+        count++;
+    }
+
+    size_t drainSocket(size_t i) {
+        size_t handled = 0;
+        if (shmSources[i]) {
+            while (shmSources[i]->receive(buf, zmq::recv_flags::dontwait)) {
+                handlers[i](buf);
+                handled++;
+            }
+            return handled;
+        }
+        while (receiveInto(*sockets[i], buf, zmq::recv_flags::dontwait)) {
+            handlers[i](buf);
+            handled++;
+        }
+        return handled;
+    }
+
+    size_t pollAndDrain(std::chrono::milliseconds timeout) {
+        if (polledCount < count) {
+            // Shared memory has nothing to poll on
+            return napUntil(std::chrono::steady_clock::now() + timeout);
+        }
+        if (zmq::poll(items, polledCount, timeout) <= 0) {
+            return 0;
+        }
+        size_t handled = 0;
+        for (size_t i = 0; i < polledCount; i++) {
+            if (items[i].revents & ZMQ_POLLIN) {
+                handled += drainSocket(polledSource[i]);
+            }
+        }
+        // Pick up anything that arrived on the other sockets meanwhile
+        return handled + drain();
+    }
+
+    // Spins for the spin budget, then checks every 20 us, as the relay
+    // workers do when idle
+    size_t napUntil(std::chrono::steady_clock::time_point deadline) {
+        auto idleSince = std::chrono::steady_clock::now();
+        do {
+            if (size_t handled = drain()) {
+                return handled;
+            }
+            if (std::chrono::steady_clock::now() - idleSince > spinBudget) {
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+        return 0;
+    }
+
+    size_t spinUntil(std::chrono::steady_clock::time_point deadline) {
+        do {
+            if (size_t handled = drain()) {
+                return handled;
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+        return 0;
+    }
+
+    WaitStrategy strategy;
+    std::chrono::microseconds spinBudget;
+    zmq::socket_t* sockets[maxSockets] = {};
+    Subscriber* shmSources[maxSockets] = {};
+    Handler handlers[maxSockets];
+    zmq::pollitem_t items[maxSockets] = {};  // ZMQ sources only
+    size_t polledSource[maxSockets] = {};
+    size_t polledCount = 0;
+    size_t count = 0;
+    RecvBuffer buf;
+};
+
+} // namespace tactile
@@ -0,0 +1,54 @@
+// Preallocated receive buffers. Sockets copy each message straight into a
+// buffer that lives for the whole run, so the receive path never creates a
+// zmq::message_t or std::string per packet.
+#pragma once
+
+#include "hop_stamps.hpp"
+
+#include <zmq.hpp>
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace tactile {
+
+// Large enough for every message we publish; longer ones are flagged as
+// truncated rather than reallocated.
+constexpr size_t recvBufferCapacity = 2048;
+
+struct RecvBuffer {
+    std::array<char, recvBufferCapacity> data;
+    size_t size = 0;
+    bool truncated = false;
+    HopTrail hops;  // hop frames that followed the message, if any
+
+    std::string_view view() const {
+        return std::string_view(data.data(), size);
+    }
+};
+
+// Receives one message into buf, collecting any hop frames behind it (other
+// extra frames are skipped). Returns false when nothing was available (only
+// possible with recv_flags::dontwait).
+inline bool receiveInto(zmq::socket_t& socket, RecvBuffer& buf,
+                        zmq::recv_flags flags = zmq::recv_flags::none) {
+    auto result = socket.recv(zmq::buffer(buf.data.data(), buf.data.size()), flags);
+    if (!result) {
+        return false;
+    }
+    buf.size = result->size;
+    buf.truncated = result->truncated();
+    buf.hops.clear();
+    while (socket.get(zmq::sockopt::rcvmore)) {
+        // The rest of a message is already here, so this never blocks
+        HopStamp hop;
+        auto part = socket.recv(zmq::buffer(&hop, sizeof(hop)), zmq::recv_flags::none);
+        if (part && part->untruncated_size == sizeof(hop) && hop.magic == hopMagic) {
+            buf.hops.add(hop);
+        }
+    }
+    return true;
+}
+
+} // namespace tactile
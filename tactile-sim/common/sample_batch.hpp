@@ -0,0 +1,479 @@
+// Structure-of-arrays batches of haptic samples and the vector kernels that
+// run over them, for offline analysis and for relays that handle many
+// sessions at once.
+//
+// SampleBatch keeps every field of HapticSample in its own 64-byte aligned
+// column (position x/y/z, orientation x/y/z/w, normal x/y/z, force, time,
+// stream), so a kernel reads 4 or 8 samples of one field per instruction.
+// BatchView is a read-only window onto a batch; views offset by one sample
+// give consecutive deltas along a stream.
+//
+// Each kernel is written once against a small set of vector operations and
+// instantiated for:
+//
+//   scalar   always available, one sample at a time
+//   sse      SSE2, 4 samples (every x86-64 build)
+//   avx2     AVX2, 8 samples (every x86-64 build with GCC or Clang; the
+//            kernels are compiled for the avx2 target on their own and
+//            only run when the CPU has it)
+//
+// BatchKernels runs on the widest level the build and the CPU support
+// unless told otherwise; the remainder of a batch that does not fill a whole vector
+// goes through the narrower levels. All levels use the same single
+// precision arithmetic and the same arccos polynomial, so they agree with
+// each other to rounding, and with the double precision helpers in
+// deadband.hpp to ~1e-6.
+#pragma once
+
+#include "deadband.hpp"
+#include "haptic_wire.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TACTILE_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(TACTILE_SIMD_SSE) && (defined(__GNUC__) || defined(__clang__))
+#define TACTILE_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace tactile {
+
+enum class SimdLevel {
+    Scalar,
+    Sse,
+    Avx2,
+};
+
+inline bool parseSimdLevel(const std::string& name, SimdLevel& out) {
+    if (name == "scalar") {
+        out = SimdLevel::Scalar;
+    } else if (name == "sse") {
+        out = SimdLevel::Sse;
+    } else if (name == "avx2") {
+        out = SimdLevel::Avx2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::Sse: return "sse";
+        case SimdLevel::Avx2: return "avx2";
+    }
+    return "?";
+}
+
+// The widest level compiled into this build
+inline SimdLevel compiledSimdLevel() {
+#if defined(TACTILE_SIMD_AVX2)
+    return SimdLevel::Avx2;
+#elif defined(TACTILE_SIMD_SSE)
+    return SimdLevel::Sse;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+// The widest level compiled in that this CPU can run
+inline SimdLevel supportedSimdLevel() {
+#if defined(TACTILE_SIMD_AVX2)
+    static const bool avx2 = [] {
+        __builtin_cpu_init();  // in case this runs before libgcc's constructors
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    if (!avx2) {
+        return SimdLevel::Sse;
+    }
+#endif
+    return compiledSimdLevel();
+}
+
+struct BatchView {
+    const float* position[3];
+    const float* orientation[4];  // x, y, z, w
+    const float* normal[3];
+    const float* force;
+    size_t size;
+};
+
+class SampleBatch {
+public:
+    explicit SampleBatch(size_t capacity) : cap((capacity + laneAlign - 1) / laneAlign * laneAlign) {
+        const size_t floats = cap * floatColumns * sizeof(float);
+        const size_t bytes = floats + cap * (sizeof(int64_t) + sizeof(uint16_t));
+        void* p = nullptr;
+        if (::posix_memalign(&p, 64, bytes > 0 ? bytes : 64) != 0) {
+            throw std::bad_alloc();
+        }
+        storage.reset(static_cast<char*>(p));
+        std::memset(p, 0, bytes);
+        float* column = reinterpret_cast<float*>(storage.get());
+        for (int i = 0; i < 3; i++) {
+            position[i] = column + cap * i;
+            normal[i] = column + cap * (7 + i);
+        }
+        for (int i = 0; i < 4; i++) {
+            orientation[i] = column + cap * (3 + i);
+        }
+        force = column + cap * 10;
+        timeNs = reinterpret_cast<int64_t*>(storage.get() + floats);
+        stream = reinterpret_cast<uint16_t*>(timeNs + cap);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    size_t capacity() const {
+        return cap;
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    // Returns false when the batch is full
+    bool push(const HapticSample& sample) {
+        if (count == cap) {
+            return false;
+        }
+        set(count++, sample);
+        return true;
+    }
+
+    void set(size_t i, const HapticSample& sample) {
+        const HapticPayload& p = sample.payload;
+        for (int k = 0; k < 3; k++) {
+            position[k][i] = p.position[k];
+            normal[k][i] = p.normal[k];
+        }
+        for (int k = 0; k < 4; k++) {
+            orientation[k][i] = p.orientation[k];
+        }
+        force[i] = p.forceN;
+        timeNs[i] = sample.header.timestampNs;
+        stream[i] = sample.header.streamId;
+    }
+
+    void get(size_t i, HapticSample& out) const {
+        out = makeHapticSample();
+        HapticPayload& p = out.payload;
+        for (int k = 0; k < 3; k++) {
+            p.position[k] = position[k][i];
+            p.normal[k] = normal[k][i];
+        }
+        for (int k = 0; k < 4; k++) {
+            p.orientation[k] = orientation[k][i];
+        }
+        p.forceN = force[i];
+        out.header.timestampNs = timeNs[i];
+        out.header.streamId = stream[i];
+    }
+
+    // Copies sample `from` of `other` into slot `to` of this batch
+    void copy(const SampleBatch& other, size_t from, size_t to) {
+        for (int k = 0; k < 3; k++) {
+            position[k][to] = other.position[k][from];
+            normal[k][to] = other.normal[k][from];
+        }
+        for (int k = 0; k < 4; k++) {
+            orientation[k][to] = other.orientation[k][from];
+        }
+        force[to] = other.force[from];
+        timeNs[to] = other.timeNs[from];
+        stream[to] = other.stream[from];
+    }
+
+    // Samples [first, first + n), by default to the end
+    BatchView view(size_t first = 0, size_t n = SIZE_MAX) const {
+        first = std::min(first, count);
+        BatchView v;
+        for (int k = 0; k < 3; k++) {
+            v.position[k] = position[k] + first;
+            v.normal[k] = normal[k] + first;
+        }
+        for (int k = 0; k < 4; k++) {
+            v.orientation[k] = orientation[k] + first;
+        }
+        v.force = force + first;
+        v.size = std::min(n, count - first);
+        return v;
+    }
+
+    float* position[3];
+    float* orientation[4];
+    float* normal[3];
+    float* force;
+    int64_t* timeNs;
+    uint16_t* stream;
+
+private:
+    static constexpr size_t laneAlign = 16;  // keeps every column 64-byte aligned
+    static constexpr size_t floatColumns = 11;
+
+    struct Free {
+        void operator()(char* p) const {
+            std::free(p);
+        }
+    };
+
+    std::unique_ptr<char, Free> storage;
+    size_t cap;
+    size_t count = 0;
+};
+
+namespace simd {
+
+// The operations the kernels are written in. min/max return the second
+// operand when either is NaN, as minps/maxps do, so 0/0 comes out the same
+// on every level.
+struct ScalarOps {
+    using V = float;
+    static constexpr size_t width = 1;
+    static V load(const float* p) { return *p; }
+    static void store(float* p, V v) { *p = v; }
+    static V set(float x) { return x; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static V sqrt(V a) { return std::sqrt(a); }
+    static V min(V a, V b) { return a < b ? a : b; }
+    static V max(V a, V b) { return a > b ? a : b; }
+    static V abs(V a) { return std::fabs(a); }
+    static V flipSign(V a, V sign) { return std::signbit(sign) ? -a : a; }  // a negated where sign < 0
+    static unsigned greater(V a, V b) { return a > b ? 1u : 0u; }  // one bit per lane
+};
+
+#if defined(TACTILE_SIMD_SSE)
+struct SseOps {
+    using V = __m128;
+    static constexpr size_t width = 4;
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V set(float x) { return _mm_set1_ps(x); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_ps(a); }
+    static V min(V a, V b) { return _mm_min_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+    static V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static V flipSign(V a, V sign) { return _mm_xor_ps(a, _mm_and_ps(sign, _mm_set1_ps(-0.0f))); }
+    static unsigned greater(V a, V b) { return unsigned(_mm_movemask_ps(_mm_cmpgt_ps(a, b))); }
+};
+#endif
+
+// mask[k] = bit k of `bits` for k < width; returns how many are set
+inline size_t storeMask(unsigned bits, size_t width, uint8_t* out) {
+    static const auto spread = [] {
+        std::array<std::array<uint8_t, 8>, 256> t{};
+        for (unsigned b = 0; b < 256; b++) {
+            for (unsigned k = 0; k < 8; k++) {
+                t[b][k] = uint8_t((b >> k) & 1u);
+            }
+        }
+        return t;
+    }();
+    std::memcpy(out, spread[bits & 0xff].data(), width);
+    return size_t(__builtin_popcount(bits));
+}
+
+#include "sample_batch_kernels.inc"
+
+} // namespace simd
+
+#if defined(TACTILE_SIMD_AVX2)
+// The same kernels again for the avx2 target. Only code in this block may
+// use AVX2; BatchKernels calls into it after checking the CPU.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+namespace simd {
+namespace avx2 {
+
+struct Avx2Ops {
+    using V = __m256;
+    static constexpr size_t width = 8;
+    static V load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V set(float x) { return _mm256_set1_ps(x); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static V flipSign(V a, V sign) { return _mm256_xor_ps(a, _mm256_and_ps(sign, _mm256_set1_ps(-0.0f))); }
+    static unsigned greater(V a, V b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ))); }
+};
+
+#include "sample_batch_kernels.inc"
+
+} // namespace avx2
+} // namespace simd
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+// Runs the kernels at one SimdLevel. Every kernel takes views of equal size
+// where it compares two sets of samples, and writes one result per sample.
+class BatchKernels {
+public:
+    // Levels above what the build and the CPU support are lowered to it
+    explicit BatchKernels(SimdLevel requested = supportedSimdLevel())
+        : simdLevel(std::min(requested, supportedSimdLevel())) {}
+
+    SimdLevel level() const {
+        return simdLevel;
+    }
+
+    // Scales every orientation to unit length; all-zero ones become identity
+    void normalizeQuaternions(SampleBatch& batch) const {
+        run(batch.size(), [&](auto loops, size_t i, size_t end) {
+            return loops.normalizeQuaternions(batch.orientation, i, end);
+        });
+    }
+
+    // out[i] = |a.position[i] - b.position[i]|
+    void positionDeltaNorms(const BatchView& a, const BatchView& b, float* out) const {
+        run(std::min(a.size, b.size), [&](auto loops, size_t i, size_t end) {
+            return loops.positionDeltaNorms(a, b, out, i, end);
+        });
+    }
+
+    // out[i] = rotation (rad) between a.orientation[i] and b.orientation[i]
+    void deltaAngles(const BatchView& a, const BatchView& b, float* out) const {
+        run(std::min(a.size, b.size), [&](auto loops, size_t i, size_t end) {
+            return loops.deltaAngles(a, b, out, i, end);
+        });
+    }
+
+    // mask[i] = |force[i]| > threshold; returns how many are set
+    size_t forceAbove(const BatchView& a, float threshold, uint8_t* mask) const {
+        size_t set = 0;
+        run(a.size, [&](auto loops, size_t i, size_t end) {
+            return loops.forceAbove(a, threshold, mask, set, i, end);
+        });
+        return set;
+    }
+
+    // mask[i] = actual[i] is outside the dead-band around reference[i],
+    // by the rules of DeadbandCodec (absolute or weber; off sends all).
+    // For predictive mode pass the predictions as the reference. Returns
+    // how many are set.
+    size_t deadbandExceeds(const BatchView& actual, const BatchView& reference, DeadbandMode mode,
+                           const DeadbandConfig& config, uint8_t* mask) const {
+        const size_t n = std::min(actual.size, reference.size);
+        if (mode == DeadbandMode::Off) {
+            std::memset(mask, 1, n);
+            return n;
+        }
+        size_t set = 0;
+        if (mode == DeadbandMode::Absolute) {
+            run(n, [&](auto loops, size_t i, size_t end) {
+                return loops.absoluteExceeds(actual, reference, config, mask, set, i, end);
+            });
+        } else {
+            run(n, [&](auto loops, size_t i, size_t end) {
+                return loops.weberExceeds(actual, reference, config, mask, set, i, end);
+            });
+        }
+        return set;
+    }
+
+private:
+    // Runs body(loops, first, end) at the selected level, then hands what
+    // is left over to the narrower ones. body returns the first sample it
+    // did not process.
+    template <typename Body>
+    void run(size_t n, Body&& body) const {
+        size_t i = 0;
+#if defined(TACTILE_SIMD_AVX2)
+        if (simdLevel == SimdLevel::Avx2) {
+            i = body(simd::avx2::Loops<simd::avx2::Avx2Ops>(), i, n);
+        }
+#endif
+#if defined(TACTILE_SIMD_SSE)
+        if (simdLevel != SimdLevel::Scalar) {
+            i = body(simd::Loops<simd::SseOps>(), i, n);
+        }
+#endif
+        body(simd::Loops<simd::ScalarOps>(), i, n);
+    }
+
+    SimdLevel simdLevel;
+};
+
+// Dead-band for many sessions at once, one lane per session: lane i of
+// every batch passed to decide() is the newest sample of session i. The
+// lane's reference is the last sample it sent, as in DeadbandCodec with
+// absolute or weber mode (predictive is judged like weber, without the
+// extrapolation), and the first sample of a lane is always sent.
+class BatchDeadband {
+public:
+    BatchDeadband(size_t sessions, DeadbandMode mode, const DeadbandConfig& config = DeadbandConfig(),
+                  SimdLevel level = supportedSimdLevel())
+        : codecMode(mode), config(config), kernels(level), reference(sessions), started(sessions) {
+        HapticSample identity = makeHapticSample();
+        for (size_t i = 0; i < sessions; i++) {
+            reference.push(identity);
+        }
+    }
+
+    DeadbandMode mode() const {
+        return codecMode;
+    }
+
+    // Fills send[i] (0/1) for every lane of `current` and makes the lanes
+    // that send the new references. Returns how many send.
+    size_t decide(const SampleBatch& current, uint8_t* send) {
+        const size_t n = std::min(current.size(), reference.size());
+        size_t sent = kernels.deadbandExceeds(current.view(0, n), reference.view(0, n), codecMode, config, send);
+        for (size_t i = 0; i < n; i++) {
+            if (!started[i]) {
+                started[i] = 1;
+                sent += send[i] ? 0 : 1;
+                send[i] = 1;
+            }
+            if (send[i]) {
+                reference.copy(current, i, i);
+            }
+        }
+        return sent;
+    }
+
+private:
+    DeadbandMode codecMode;
+    DeadbandConfig config;
+    BatchKernels kernels;
+    SampleBatch reference;
+    std::vector<uint8_t> started;
+};
+
+} // namespace tactile
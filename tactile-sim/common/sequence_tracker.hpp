@@ -0,0 +1,286 @@
+// Loss, reordering and duplicate detection from per-stream sequence numbers.
+//
+// Every publisher numbers its messages per stream from 0: binary haptic
+// samples in WireHeader::seq, text messages with a "#<seq>" suffix
+// (text_fields.hpp). PUB/SUB drops silently at the high-water mark, so gaps
+// in these numbers are the only way a receiver can see what it missed.
+//
+// A missing number is only declared lost once it has fallen out of a
+// reorder window behind the highest number seen; until then a late arrival
+// counts as reordered instead. Consecutive lost numbers form one burst.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+
+namespace tactile {
+
+// Burst-loss lengths in power-of-two buckets: 1, 2, 3-4, 5-8, ...
+struct BurstHistogram {
+    static constexpr int bucketCount = 17;  // the last one holds > 32768
+
+    std::array<uint64_t, bucketCount> counts{};
+    uint64_t bursts = 0;
+    uint64_t total = 0;
+    uint64_t longest = 0;
+
+    static int bucketOf(uint64_t length) {
+        int bucket = 0;
+        while (bucket + 1 < bucketCount && (uint64_t(1) << bucket) < length) {
+            bucket++;
+        }
+        return bucket;
+    }
+
+    void record(uint64_t length) {
+        counts[bucketOf(length)]++;
+        bursts++;
+        total += length;
+        longest = std::max(longest, length);
+    }
+
+    void merge(const BurstHistogram& other) {
+        for (int i = 0; i < bucketCount; i++) {
+            counts[i] += other.counts[i];
+        }
+        bursts += other.bursts;
+        total += other.total;
+        longest = std::max(longest, other.longest);
+    }
+
+    double mean() const {
+        return bursts ? double(total) / double(bursts) : 0.0;
+    }
+};
+
+struct SequenceStats {
+    uint64_t received = 0;    // distinct numbers that arrived
+    uint64_t lost = 0;        // never arrived within the reorder window
+    uint64_t reordered = 0;   // arrived after a higher number
+    uint64_t duplicates = 0;  // arrived more than once
+    uint64_t restarts = 0;    // publisher started counting again
+    BurstHistogram bursts;
+
+    void merge(const SequenceStats& other) {
+        received += other.received;
+        lost += other.lost;
+        reordered += other.reordered;
+        duplicates += other.duplicates;
+        restarts += other.restarts;
+        bursts.merge(other.bursts);
+    }
+
+    // Fraction of the numbers that are settled (arrived or lost) that were lost.
+    double lossRatio() const {
+        return received + lost ? double(lost) / double(received + lost) : 0.0;
+    }
+};
+
+// One stream's numbering.
+class SequenceTracker {
+public:
+    static constexpr uint64_t window = 1024;
+
+    void record(uint64_t seq) {
+        if (!started) {
+            restart(seq);
+            return;
+        }
+        if (seq > highest) {
+            advance(seq);
+        } else if (highest - seq >= window) {
+            // Far behind anything we could still be waiting for: the
+            // publisher was restarted and counts from the beginning again
+            finish();
+            runStats.restarts++;
+            restart(seq);
+            return;
+        } else if (isSeen(seq)) {
+            runStats.duplicates++;
+            return;
+        } else {
+            runStats.reordered++;
+        }
+        markSeen(seq);
+        runStats.received++;
+    }
+
+    // Settles every number still inside the reorder window: missing ones
+    // count as lost. Call before the final report.
+    void finish() {
+        if (!started) {
+            return;
+        }
+        for (uint64_t seq = settledThrough + 1; seq <= highest; seq++) {
+            settle(seq);
+        }
+        closeBurst();
+    }
+
+    // Numbers not yet arrived that may still come in late.
+    uint64_t pending() const {
+        uint64_t missing = 0;
+        for (uint64_t seq = settledThrough + 1; started && seq <= highest; seq++) {
+            missing += !isSeen(seq);
+        }
+        return missing;
+    }
+
+    const SequenceStats& stats() const {
+        return runStats;
+    }
+
+private:
+    void restart(uint64_t seq) {
+        seen.fill(0);
+        started = true;
+        highest = seq;
+        settledThrough = seq - 1;  // nothing before the first number counts
+        burst = 0;
+        markSeen(seq);
+        runStats.received++;
+    }
+
+    // Slides the window up to `seq`, settling the numbers that leave it.
+    void advance(uint64_t seq) {
+        uint64_t oldest = seq >= window ? seq - window + 1 : 0;
+        if (seq - highest > window) {
+            // Jumped past the whole window: settle it, then the rest of the
+            // gap is lost without ever having been tracked
+            for (uint64_t s = settledThrough + 1; s <= highest; s++) {
+                settle(s);
+            }
+            uint64_t gap = oldest - 1 - highest;
+            runStats.lost += gap;
+            burst += gap;
+            settledThrough = oldest - 1;
+            seen.fill(0);
+        } else {
+            for (uint64_t s = settledThrough + 1; s < oldest; s++) {
+                settle(s);
+            }
+            for (uint64_t s = highest + 1; s <= seq; s++) {
+                clearSeen(s);
+            }
+        }
+        highest = seq;
+    }
+
+    void settle(uint64_t seq) {
+        if (isSeen(seq)) {
+            closeBurst();
+        } else {
+            runStats.lost++;
+            burst++;
+        }
+        settledThrough = seq;
+    }
+
+    void closeBurst() {
+        if (burst > 0) {
+            runStats.bursts.record(burst);
+            burst = 0;
+        }
+    }
+
+    bool isSeen(uint64_t seq) const {
+        return seen[(seq % window) / 64] & (uint64_t(1) << (seq % 64));
+    }
+
+    void markSeen(uint64_t seq) {
+        seen[(seq % window) / 64] |= uint64_t(1) << (seq % 64);
+    }
+
+    void clearSeen(uint64_t seq) {
+        seen[(seq % window) / 64] &= ~(uint64_t(1) << (seq % 64));
+    }
+
+    std::array<uint64_t, window / 64> seen{};  // bit per number in the window
+    bool started = false;
+    uint64_t highest = 0;
+    uint64_t settledThrough = 0;  // every number up to here is settled
+    uint64_t burst = 0;           // current run of lost numbers
+    SequenceStats runStats;
+};
+
+// All streams arriving on one socket, keyed by stream id (the haptic
+// session / hand; 0 for single-stream publishers such as video).
+class SequenceTrackers {
+public:
+    void record(uint16_t streamId, uint64_t seq) {
+        streams[streamId].record(seq);
+    }
+
+    void finish() {
+        for (auto& entry : streams) {
+            entry.second.finish();
+        }
+    }
+
+    SequenceStats total() const {
+        SequenceStats sum;
+        for (const auto& entry : streams) {
+            sum.merge(entry.second.stats());
+        }
+        return sum;
+    }
+
+    uint64_t pending() const {
+        uint64_t sum = 0;
+        for (const auto& entry : streams) {
+            sum += entry.second.pending();
+        }
+        return sum;
+    }
+
+    size_t streamCount() const {
+        return streams.size();
+    }
+
+private:
+    std::unordered_map<uint16_t, SequenceTracker> streams;
+};
+
+// Summary lines in the style of the monitors' final reports, each starting
+// with `prefix` (an indent or a stream name).
+inline void printSequenceStats(std::ostream& out, const char* prefix, const SequenceStats& s) {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << prefix << "Sequence: " << s.received << " received, " << s.lost << " lost ("
+        << s.lossRatio() * 100 << "%), " << s.reordered << " reordered, "
+        << s.duplicates << " duplicates";
+    if (s.restarts) {
+        out << ", " << s.restarts << " restarts";
+    }
+    out << "\n";
+    if (s.bursts.bursts) {
+        out << std::setprecision(1) << prefix << "Loss bursts: " << s.bursts.bursts << ", mean "
+            << s.bursts.mean() << ", longest " << s.bursts.longest << " (";
+        const char* separator = "";
+        for (int i = 0; i < BurstHistogram::bucketCount; i++) {
+            if (!s.bursts.counts[i]) {
+                continue;
+            }
+            uint64_t low = i == 0 ? 1 : (uint64_t(1) << (i - 1)) + 1;
+            uint64_t high = uint64_t(1) << i;
+            out << separator << low;
+            if (i + 1 == BurstHistogram::bucketCount) {
+                out << "+";
+            } else if (high != low) {
+                out << "-" << high;
+            }
+            out << ": " << s.bursts.counts[i];
+            separator = ", ";
+        }
+        out << ")\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace tactile
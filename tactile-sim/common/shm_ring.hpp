@@ -0,0 +1,270 @@
+// Lock-free shared-memory broadcast ring for a publisher and any number of
+// subscribers on the same host ("shm://name" endpoints, see transport.hpp).
+//
+// The publisher writes each message into the next slot of a POSIX shared
+// memory segment and publishes it by bumping a write index; it never waits
+// for subscribers. Each subscriber keeps its own read cursor. A subscriber
+// that falls more than a ring behind loses the oldest messages, like a ZMQ
+// SUB socket at its high-water mark, and the sequence numbers show it.
+//
+// Slots are guarded seqlock-style: the slot's sequence is odd while it is
+// being written and 2n+2 once message n is complete, so a reader that was
+// overtaken mid-copy notices and drops that message instead of using it.
+#pragma once
+
+#include "hop_stamps.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace tactile {
+
+constexpr size_t shmSlotCount = 4096;  // power of two
+constexpr size_t shmSlotSize = 1024;
+
+struct ShmSlot {
+    std::atomic<uint64_t> sequence;  // 2n+1 while writing message n, 2n+2 when done
+    uint32_t size;
+    uint8_t hopCount;
+    uint8_t reserved[3];
+    HopStamp hops[HopTrail::maxHops];
+    char data[shmSlotSize - 16 - HopTrail::maxHops * sizeof(HopStamp)];
+};
+
+struct ShmRingHeader {
+    uint32_t magic;  // written last, once the segment is laid out
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSize;
+    alignas(64) std::atomic<uint64_t> writeIndex;  // messages published so far
+};
+
+static_assert(sizeof(ShmSlot) == shmSlotSize, "ShmSlot must fill its slot exactly");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must not take a lock");
+
+constexpr uint32_t shmRingMagic = 0x474e5253;  // "SRNG"
+constexpr uint32_t shmRingVersion = 1;
+constexpr size_t shmMessageCapacity = sizeof(ShmSlot::data);
+
+inline size_t shmRingBytes() {
+    return sizeof(ShmRingHeader) + shmSlotCount * sizeof(ShmSlot);
+}
+
+// POSIX shared memory names are "/name"
+inline std::string shmObjectName(const std::string& name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+// Maps an open segment; returns nullptr (errno set) on failure.
+inline void* mapShmRing(int fd, bool writable) {
+    void* base = ::mmap(nullptr, shmRingBytes(), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    return base == MAP_FAILED ? nullptr : base;
+}
+
+class ShmPublisher {
+public:
+    // Creates the segment, or reuses a compatible one left by an earlier run
+    // so that attached subscribers simply carry on. Throws std::system_error.
+    explicit ShmPublisher(const std::string& name) : objectName(shmObjectName(name)) {
+        int fd = ::shm_open(objectName.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + objectName);
+        }
+        // macOS only lets a segment be sized once, so leave a right-sized one alone
+        struct stat info;
+        if ((::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) != shmRingBytes()) &&
+            ::ftruncate(fd, static_cast<off_t>(shmRingBytes())) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "ftruncate " + objectName);
+        }
+        void* base = mapShmRing(fd, true);
+        int error = errno;
+        ::close(fd);
+        if (!base) {
+            throw std::system_error(error, std::generic_category(), "mmap " + objectName);
+        }
+        header = static_cast<ShmRingHeader*>(base);
+        slots = reinterpret_cast<ShmSlot*>(static_cast<char*>(base) + sizeof(ShmRingHeader));
+
+        if (header->magic == shmRingMagic && header->version == shmRingVersion &&
+            header->slotCount == shmSlotCount && header->slotSize == shmSlotSize) {
+            next = header->writeIndex.load(std::memory_order_relaxed);
+        } else {
+            std::memset(base, 0, shmRingBytes());
+            header->version = shmRingVersion;
+            header->slotCount = shmSlotCount;
+            header->slotSize = shmSlotSize;
+            std::atomic_thread_fence(std::memory_order_release);
+            header->magic = shmRingMagic;
+        }
+    }
+
+    ~ShmPublisher() {
+        ::munmap(header, shmRingBytes());
+    }
+
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    // Never blocks. Returns false if the message does not fit a slot.
+    bool publish(const void* data, size_t size, const HopTrail& trail) {
+        if (size > shmMessageCapacity) {
+            oversize++;
+            return false;
+        }
+        ShmSlot& slot = slots[next & (shmSlotCount - 1)];
+        slot.sequence.store(2 * next + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.size = static_cast<uint32_t>(size);
+        slot.hopCount = trail.count;
+        std::memcpy(slot.hops, trail.hops, trail.count * sizeof(HopStamp));
+        std::memcpy(slot.data, data, size);
+        slot.sequence.store(2 * next + 2, std::memory_order_release);
+        header->writeIndex.store(++next, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t published() const {
+        return next;
+    }
+
+    uint64_t oversized() const {
+        return oversize;
+    }
+
+    // Removes the name; mapped readers keep their view until they unmap
+    static void unlink(const std::string& name) {
+        ::shm_unlink(shmObjectName(name).c_str());
+    }
+
+private:
+    std::string objectName;
+    ShmRingHeader* header = nullptr;
+    ShmSlot* slots = nullptr;
+    uint64_t next = 0;
+    uint64_t oversize = 0;
+};
+
+class ShmSubscriber {
+public:
+    // Attaches lazily, like a ZMQ connect: the publisher may start later.
+    explicit ShmSubscriber(const std::string& name) : objectName(shmObjectName(name)) {}
+
+    ~ShmSubscriber() {
+        if (header) {
+            ::munmap(header, shmRingBytes());
+        }
+    }
+
+    ShmSubscriber(const ShmSubscriber&) = delete;
+    ShmSubscriber& operator=(const ShmSubscriber&) = delete;
+
+    // Copies the next message into `data` (at most `capacity` bytes) and its
+    // hop frames into `trail`. Returns false when nothing new has arrived.
+    bool tryReceive(char* data, size_t capacity, size_t& size, bool& truncated, HopTrail& trail) {
+        if (!header && !attach()) {
+            return false;
+        }
+        while (true) {
+            const uint64_t written = header->writeIndex.load(std::memory_order_acquire);
+            if (written < cursor) {
+                // The publisher re-created the ring: follow it from here
+                cursor = written;
+            }
+            if (cursor == written) {
+                return false;
+            }
+            if (written - cursor > shmSlotCount) {
+                overrun += written - cursor - shmSlotCount;
+                cursor = written - shmSlotCount;
+            }
+
+            const ShmSlot& slot = slots[cursor & (shmSlotCount - 1)];
+            const uint64_t expected = 2 * cursor + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != expected) {
+                overrun++;  // already being overwritten
+                cursor++;
+                continue;
+            }
+            const size_t length = slot.size < shmMessageCapacity ? slot.size : shmMessageCapacity;
+            const uint8_t hopCount = slot.hopCount < HopTrail::maxHops ? slot.hopCount : HopTrail::maxHops;
+            size = length < capacity ? length : capacity;
+            truncated = length > capacity;
+            std::memcpy(data, slot.data, size);
+            trail.count = hopCount;
+            std::memcpy(trail.hops, slot.hops, hopCount * sizeof(HopStamp));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+                overrun++;  // overtaken while copying
+                cursor++;
+                continue;
+            }
+            cursor++;
+            return true;
+        }
+    }
+
+    bool attached() const {
+        return header != nullptr;
+    }
+
+    // Messages the publisher overwrote before this subscriber read them
+    uint64_t overruns() const {
+        return overrun;
+    }
+
+private:
+    bool attach() {
+        // Retried until the publisher exists, but only on every 64th receive
+        // so a spinning subscriber does not hammer shm_open
+        if (++attachAttempts % 64 != 1) {
+            return false;
+        }
+        int fd = ::shm_open(objectName.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        void* base = nullptr;
+        if (::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= shmRingBytes()) {
+            base = mapShmRing(fd, false);
+        }
+        ::close(fd);
+        if (!base) {
+            return false;
+        }
+        auto* candidate = static_cast<ShmRingHeader*>(base);
+        if (candidate->magic != shmRingMagic || candidate->version != shmRingVersion ||
+            candidate->slotCount != shmSlotCount || candidate->slotSize != shmSlotSize) {
+            ::munmap(base, shmRingBytes());
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        header = candidate;
+        slots = reinterpret_cast<const ShmSlot*>(static_cast<const char*>(base) + sizeof(ShmRingHeader));
+        // Like a late-joining SUB socket: only what is published from now on
+        cursor = header->writeIndex.load(std::memory_order_acquire);
+        return true;
+    }
+
+    std::string objectName;
+    ShmRingHeader* header = nullptr;
+    const ShmSlot* slots = nullptr;
+    uint64_t cursor = 0;
+    uint64_t overrun = 0;
+    uint64_t attachAttempts = 0;
+};
+
+} // namespace tactile
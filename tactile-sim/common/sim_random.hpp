@@ -0,0 +1,64 @@
+// Seeded random numbers for the simulated links (offline_sim.hpp) and the
+// impairment stage (impairment.hpp). The generator and the transforms are
+// spelled out here instead of using std::*_distribution, whose output
+// differs between standard libraries, so a seed means the same run
+// everywhere the math library agrees.
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace tactile {
+
+// xoshiro256** seeded through splitmix64
+class SimRandom {
+public:
+    explicit SimRandom(uint64_t seed) {
+        for (uint64_t& word : state) {
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        const uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, 1) with 53 random bits
+    double uniform() {
+        return double(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Standard normal (Box-Muller; the second value of each pair is dropped
+    // so every call consumes exactly two draws)
+    double normal() {
+        const double u = 1.0 - uniform();  // (0, 1]
+        const double v = uniform();
+        return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * 3.14159265358979323846 * v);
+    }
+
+    // Pareto with minimum 1 and tail index `alpha`
+    double pareto(double alpha) {
+        return std::pow(1.0 - uniform(), -1.0 / alpha);
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t state[4];
+};
+
+} // namespace tactile
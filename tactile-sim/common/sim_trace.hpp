@@ -0,0 +1,157 @@
+// SimData run in its recorded CSV form: tactile.csv, poses.csv and video.csv
+// are memory-mapped and indexed into one time-ordered event list. Events
+// point at their CSV row inside the mapping, so rows are never copied.
+// Tools normally go through TraceReader (columnar_trace.hpp), which builds
+// on this for run directories.
+#pragma once
+
+#include "haptic_wire.hpp"
+#include "mapped_file.hpp"
+#include "text_fields.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tactile {
+
+enum class TraceSource : uint8_t {
+    Tactile,
+    Poses,
+    Video,
+};
+
+constexpr int traceSourceCount = 3;
+
+inline const char* traceSourceName(TraceSource source) {
+    switch (source) {
+        case TraceSource::Tactile: return "tactile";
+        case TraceSource::Poses: return "poses";
+        case TraceSource::Video: return "video";
+    }
+    return "?";
+}
+
+inline bool parseTraceSource(std::string_view name, TraceSource& out) {
+    for (int i = 0; i < traceSourceCount; i++) {
+        if (name == traceSourceName(static_cast<TraceSource>(i))) {
+            out = static_cast<TraceSource>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+struct TraceEvent {
+    int64_t timeNs;   // recorded timestamp_s, in ns
+    uint32_t offset;  // row start within the source file's mapping
+    uint32_t length;  // row length without the line terminator
+    TraceSource source;
+};
+
+class CsvTrace {
+public:
+    // Loads <runDir>/<source>.csv for every source whose bit is set in
+    // `sourceMask` (bit i = TraceSource i). Returns false with a message in
+    // `error` if a file cannot be mapped or has an unparsable timestamp.
+    bool load(const std::string& runDir, unsigned sourceMask, std::string& error) {
+        allEvents.clear();
+        for (int i = 0; i < traceSourceCount; i++) {
+            if (!(sourceMask & (1u << i))) {
+                continue;
+            }
+            TraceSource source = static_cast<TraceSource>(i);
+            std::vector<TraceEvent> events;
+            if (!files[i].map(runDir + "/" + traceSourceName(source) + ".csv", error) ||
+                !index(source, events, error)) {
+                return false;
+            }
+            // Rows are recorded in order; keep them stable if one is not
+            if (!std::is_sorted(events.begin(), events.end(), earlier)) {
+                std::stable_sort(events.begin(), events.end(), earlier);
+            }
+            std::vector<TraceEvent> merged;
+            merged.reserve(allEvents.size() + events.size());
+            std::merge(allEvents.begin(), allEvents.end(), events.begin(), events.end(),
+                       std::back_inserter(merged), earlier);
+            allEvents.swap(merged);
+        }
+        return true;
+    }
+
+    bool loaded(TraceSource source) const {
+        return files[static_cast<int>(source)].data() != nullptr;
+    }
+
+    // The CSV header row ("timestamp_s,hand_id,..."), empty if there was none.
+    std::string_view header(TraceSource source) const {
+        return headers[static_cast<int>(source)];
+    }
+
+    const std::vector<TraceEvent>& events() const {
+        return allEvents;
+    }
+
+    std::string_view row(const TraceEvent& event) const {
+        return std::string_view(files[static_cast<int>(event.source)].data() + event.offset, event.length);
+    }
+
+    int64_t firstNs() const {
+        return allEvents.empty() ? 0 : allEvents.front().timeNs;
+    }
+
+    int64_t durationNs() const {
+        return allEvents.empty() ? 0 : allEvents.back().timeNs - allEvents.front().timeNs;
+    }
+
+private:
+    static bool earlier(const TraceEvent& a, const TraceEvent& b) {
+        return a.timeNs < b.timeNs;
+    }
+
+    bool index(TraceSource source, std::vector<TraceEvent>& events, std::string& error) {
+        const MappedFile& file = files[static_cast<int>(source)];
+        headers[static_cast<int>(source)] = std::string_view();
+        std::string_view text = file.view();
+        size_t lineNumber = 0;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find('\n', pos);
+            if (end == std::string_view::npos) {
+                end = text.size();
+            }
+            size_t length = end - pos;
+            if (length > 0 && text[pos + length - 1] == '\r') {
+                length--;
+            }
+            lineNumber++;
+
+            std::string_view line = text.substr(pos, length);
+            double seconds;
+            if (!line.empty()) {
+                if (parseLeadingDouble(line.data(), line.size(), seconds)) {
+                    events.push_back({ secondsToNs(seconds), static_cast<uint32_t>(pos),
+                                       static_cast<uint32_t>(length), source });
+                } else if (lineNumber == 1) {
+                    headers[static_cast<int>(source)] = line;
+                } else {
+                    // Only the header row may lack a numeric timestamp
+                    error = std::string(traceSourceName(source)) + ".csv line " +
+                            std::to_string(lineNumber) + ": bad timestamp";
+                    return false;
+                }
+            }
+            pos = end + 1;
+        }
+        return true;
+    }
+
+    MappedFile files[traceSourceCount];
+    std::string_view headers[traceSourceCount];
+    std::vector<TraceEvent> allEvents;
+};
+
+} // namespace tactile
@@ -0,0 +1,77 @@
+// Bounded lock-free single-producer/single-consumer ring.
+//
+// One thread may call tryPush and one other thread tryPop. Each side caches
+// the other side's index so the shared cache line is only touched when the
+// ring looks full (producer) or empty (consumer). Storage is inline; allocate
+// large rings on the heap before the hot path starts.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace tactile {
+
+constexpr size_t cacheLineSize = 64;
+
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SpscRing holds plain records only");
+
+public:
+    // Producer side. Returns false if the ring is full.
+    bool tryPush(const T& item) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - cachedHead == Capacity) {
+            cachedHead = headIndex.load(std::memory_order_acquire);
+            if (tail - cachedHead == Capacity) {
+                return false;
+            }
+        }
+        slots[tail & mask] = item;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool tryPop(T& item) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == cachedTail) {
+            cachedTail = tailIndex.load(std::memory_order_acquire);
+            if (head == cachedTail) {
+                return false;
+            }
+        }
+        item = slots[head & mask];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only exact when neither side is running.
+    size_t sizeApprox() const {
+        return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+private:
+    static constexpr size_t mask = Capacity - 1;
+
+    // Consumer-owned line
+    alignas(cacheLineSize) std::atomic<size_t> headIndex{0};
+    size_t cachedTail = 0;
+
+    // Producer-owned line
+    alignas(cacheLineSize) std::atomic<size_t> tailIndex{0};
+    size_t cachedHead = 0;
+
+    alignas(cacheLineSize) std::array<T, Capacity> slots;
+};
+
+} // namespace tactile
@@ -0,0 +1,104 @@
+// Allocation-free helpers for the comma-separated text messages published by
+// the Python streamers and by the relay in its text fallback mode.
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+namespace tactile {
+
+// Splits "a,b,c" one field at a time without copying. Returns false once the
+// input is exhausted.
+inline bool nextField(std::string_view& rest, std::string_view& field) {
+    if (rest.data() == nullptr) {
+        return false;
+    }
+    size_t comma = rest.find(',');
+    if (comma == std::string_view::npos) {
+        field = rest;
+        rest = std::string_view();
+    } else {
+        field = rest.substr(0, comma);
+        rest = rest.substr(comma + 1);
+    }
+    return true;
+}
+
+// Parses a whole field as a double. Uses std::from_chars where the standard
+// library provides the floating-point overload (libstdc++ 11+), otherwise a
+// bounded copy into strtod.
+inline bool parseDouble(std::string_view field, double& value) {
+    while (!field.empty() && field.front() == ' ') {
+        field.remove_prefix(1);
+    }
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\r' || field.back() == '\n')) {
+        field.remove_suffix(1);
+    }
+    if (field.empty()) {
+        return false;
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const char* end = field.data() + field.size();
+    auto result = std::from_chars(field.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+#else
+    char buf[64];
+    if (field.size() >= sizeof(buf)) {
+        return false;
+    }
+    std::memcpy(buf, field.data(), field.size());
+    buf[field.size()] = '\0';
+    char* end = nullptr;
+    value = std::strtod(buf, &end);
+    return end == buf + field.size();
+#endif
+}
+
+// Parses the leading "timestamp," field of a message in place.
+inline bool parseLeadingDouble(const char* data, size_t size, double& value) {
+    std::string_view rest(data, size);
+    std::string_view field;
+    return nextField(rest, field) && parseDouble(field, value);
+}
+
+// Text messages carry their per-stream sequence number as a "#<seq>"
+// suffix, e.g. "12.345000000,2000#17". Strips it from `message` and returns
+// true if there is one; older publishers send none.
+inline bool splitTextSequence(std::string_view& message, uint64_t& seq) {
+    size_t hash = message.rfind('#');
+    if (hash == std::string_view::npos) {
+        return false;
+    }
+    std::string_view digits = message.substr(hash + 1);
+    while (!digits.empty() && (digits.back() == '\r' || digits.back() == '\n')) {
+        digits.remove_suffix(1);
+    }
+    const char* end = digits.data() + digits.size();
+    auto result = std::from_chars(digits.data(), end, seq);
+    if (digits.empty() || result.ec != std::errc() || result.ptr != end) {
+        return false;
+    }
+    message = message.substr(0, hash);
+    return true;
+}
+
+// Appends "#<seq>" to the `length` characters already in buf. Returns the
+// new length, or 0 if it does not fit (with room for a terminator).
+inline size_t appendTextSequence(char* buf, size_t length, size_t size, uint64_t seq) {
+    if (length + 1 >= size) {
+        return 0;
+    }
+    buf[length] = '#';
+    auto result = std::to_chars(buf + length + 1, buf + size - 1, seq);
+    if (result.ec != std::errc()) {
+        return 0;
+    }
+    *result.ptr = '\0';
+    return static_cast<size_t>(result.ptr - buf);
+}
+
+} // namespace tactile
@@ -0,0 +1,188 @@
+// Run-time selectable transport between pipeline stages.
+//
+//   --transport tcp   tcp://host:port, as the stages always used (default)
+//   --transport ipc   ipc:///tmp/tactile-<port>: Unix sockets, no TCP stack
+//   --transport shm   shm://tactile-<port>: the shared-memory ring in
+//                     shm_ring.hpp, no syscalls per message at all
+//
+// Stages keep naming endpoints by their well-known port (5555 tactile,
+// 5556 filtered haptic, 5566 video); the transport decides what that port
+// becomes. ipc and shm only work when both ends run on one host.
+//
+// Publisher and Subscriber wrap a ZMQ socket or a shared-memory ring
+// behind the calls the stages already make (bind/connect, send with hop
+// frames, receive into a RecvBuffer), and ReceiveEngine accepts either.
+#pragma once
+
+#include "hop_stamps.hpp"
+#include "options.hpp"
+#include "recv_buffer.hpp"
+#include "shm_ring.hpp"
+
+#include <zmq.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace tactile {
+
+enum class Transport {
+    Tcp,
+    Ipc,
+    Shm,
+};
+
+inline bool parseTransport(const std::string& name, Transport& out) {
+    if (name == "tcp") {
+        out = Transport::Tcp;
+    } else if (name == "ipc") {
+        out = Transport::Ipc;
+    } else if (name == "shm") {
+        out = Transport::Shm;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* transportName(Transport transport) {
+    switch (transport) {
+        case Transport::Tcp: return "tcp";
+        case Transport::Ipc: return "ipc";
+        case Transport::Shm: return "shm";
+    }
+    return "?";
+}
+
+// Reads "--transport tcp|ipc|shm". Returns false on an unknown name.
+inline bool transportFromOptions(const Options& opts, Transport& transport) {
+    if (!parseTransport(opts.get("--transport", "tcp"), transport)) {
+        std::cerr << "Unknown --transport (use tcp, ipc or shm)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+constexpr const char* shmScheme = "shm://";
+
+inline std::string bindEndpoint(Transport transport, int port) {
+    switch (transport) {
+        case Transport::Tcp: return "tcp://*:" + std::to_string(port);
+        case Transport::Ipc: return "ipc:///tmp/tactile-" + std::to_string(port);
+        case Transport::Shm: return shmScheme + std::string("tactile-") + std::to_string(port);
+    }
+    return "";
+}
+
+// `host` only matters for tcp; the others are always local
+inline std::string connectEndpoint(Transport transport, const std::string& host, int port) {
+    if (transport == Transport::Tcp) {
+        return "tcp://" + host + ":" + std::to_string(port);
+    }
+    return bindEndpoint(transport, port);
+}
+
+inline bool isShmEndpoint(const std::string& endpoint, std::string& name) {
+    if (endpoint.compare(0, std::char_traits<char>::length(shmScheme), shmScheme) != 0) {
+        return false;
+    }
+    name = endpoint.substr(std::char_traits<char>::length(shmScheme));
+    return true;
+}
+
+class Publisher {
+public:
+    explicit Publisher(zmq::context_t& ctx, zmq::socket_type type = zmq::socket_type::pub) : zmqSocket(ctx, type) {}
+
+    // Throws zmq::error_t, or std::system_error for shm:// endpoints
+    void bind(const std::string& endpoint) {
+        std::string name;
+        if (isShmEndpoint(endpoint, name)) {
+            shm = std::make_unique<ShmPublisher>(name);
+        } else {
+            zmqSocket.bind(endpoint);
+        }
+    }
+
+    // Publishes into a socket bound elsewhere, e.g. an inproc fan-in;
+    // ZMQ endpoints only
+    void connect(const std::string& endpoint) {
+        zmqSocket.connect(endpoint);
+    }
+
+    bool send(const void* data, size_t size, const HopTrail& trail = HopTrail()) {
+        if (shm) {
+            return shm->publish(data, size, trail);
+        }
+        return sendWithHops(zmqSocket, data, size, trail);
+    }
+
+    bool isShm() const {
+        return shm != nullptr;
+    }
+
+    // The underlying socket, e.g. for zmq::proxy (not used with shm)
+    zmq::socket_t& socket() {
+        return zmqSocket;
+    }
+
+private:
+    zmq::socket_t zmqSocket;
+    std::unique_ptr<ShmPublisher> shm;
+};
+
+class Subscriber {
+public:
+    explicit Subscriber(zmq::context_t& ctx) : zmqSocket(ctx, zmq::socket_type::sub) {}
+
+    // Subscribes to everything. Throws zmq::error_t on a bad endpoint.
+    void connect(const std::string& endpoint) {
+        std::string name;
+        if (isShmEndpoint(endpoint, name)) {
+            shm = std::make_unique<ShmSubscriber>(name);
+        } else {
+            zmqSocket.connect(endpoint);
+            zmqSocket.set(zmq::sockopt::subscribe, "");
+        }
+    }
+
+    // Like receiveInto(); without dontwait a shm subscriber spins briefly
+    // and then naps 20 us at a time until a message arrives.
+    bool receive(RecvBuffer& buf, zmq::recv_flags flags = zmq::recv_flags::none) {
+        if (!shm) {
+            return receiveInto(zmqSocket, buf, flags);
+        }
+        auto idleSince = std::chrono::steady_clock::now();
+        while (!shm->tryReceive(buf.data.data(), buf.data.size(), buf.size, buf.truncated, buf.hops)) {
+            if (flags == zmq::recv_flags::dontwait) {
+                return false;
+            }
+            if (std::chrono::steady_clock::now() - idleSince > std::chrono::microseconds(50)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+        }
+        return true;
+    }
+
+    bool isShm() const {
+        return shm != nullptr;
+    }
+
+    // Messages a shm subscriber lost by falling a whole ring behind
+    uint64_t overruns() const {
+        return shm ? shm->overruns() : 0;
+    }
+
+    zmq::socket_t& socket() {
+        return zmqSocket;
+    }
+
+private:
+    zmq::socket_t zmqSocket;
+    std::unique_ptr<ShmSubscriber> shm;
+};
+
+} // namespace tactile
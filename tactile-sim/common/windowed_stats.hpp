@@ -0,0 +1,162 @@
+// Sliding-window min/max/mean/stddev with O(1) cost per sample.
+//
+// Mean and variance use Welford's update in both directions (add the new
+// sample, remove the evicted one); min and max come from monotonic deques
+// whose fronts are the current extremes. All storage is sized once by the
+// constructor, so adding samples never allocates regardless of window length.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tactile {
+
+class SlidingWindowStats {
+public:
+    // Keeps at most `maxSamples` samples and, if `maxAgeNs` > 0, only those
+    // stamped within `maxAgeNs` of the newest one.
+    explicit SlidingWindowStats(size_t maxSamples, int64_t maxAgeNs = 0)
+        : capacity(std::max<size_t>(maxSamples, 1)), maxAge(maxAgeNs),
+          values(capacity), stamps(capacity), minQueue(capacity), maxQueue(capacity) {}
+
+    void add(double value, int64_t timeNs = 0) {
+        if (held == capacity) {
+            evictOldest();
+        }
+        if (maxAge > 0) {
+            while (held > 0 && timeNs - stamps[slot(head)] > maxAge) {
+                evictOldest();
+            }
+        }
+
+        uint64_t seq = head + held;
+        values[slot(seq)] = value;
+        stamps[slot(seq)] = timeNs;
+        held++;
+
+        double delta = value - runningMean;
+        runningMean += delta / double(held);
+        m2 += delta * (value - runningMean);
+
+        minQueue.pushBack(seq, [&](uint64_t back) { return values[slot(back)] >= value; });
+        maxQueue.pushBack(seq, [&](uint64_t back) { return values[slot(back)] <= value; });
+    }
+
+    // Drops samples older than `maxAgeNs` before `nowNs`, for time windows
+    // that should shrink while a stream is silent.
+    void expire(int64_t nowNs) {
+        while (maxAge > 0 && held > 0 && nowNs - stamps[slot(head)] > maxAge) {
+            evictOldest();
+        }
+    }
+
+    void clear() {
+        head += held;
+        held = 0;
+        runningMean = 0;
+        m2 = 0;
+        minQueue.clear();
+        maxQueue.clear();
+    }
+
+    size_t count() const {
+        return held;
+    }
+
+    double min() const {
+        return held ? values[slot(minQueue.front())] : 0.0;
+    }
+
+    double max() const {
+        return held ? values[slot(maxQueue.front())] : 0.0;
+    }
+
+    double mean() const {
+        return held ? runningMean : 0.0;
+    }
+
+    // Population variance, as the old two-pass calculation reported.
+    double variance() const {
+        return held ? std::max(m2, 0.0) / double(held) : 0.0;
+    }
+
+    double stddev() const {
+        return std::sqrt(variance());
+    }
+
+private:
+    // Fixed-capacity double-ended queue of sample sequence numbers.
+    class SeqDeque {
+    public:
+        explicit SeqDeque(size_t capacity) : ring(capacity) {}
+
+        // Pops entries from the back while `dominated(back)` holds, then
+        // appends `seq`.
+        template <typename Dominated>
+        void pushBack(uint64_t seq, Dominated dominated) {
+            while (size > 0 && dominated(ring[(first + size - 1) % ring.size()])) {
+                size--;
+            }
+            ring[(first + size) % ring.size()] = seq;
+            size++;
+        }
+
+        uint64_t front() const {
+            return ring[first];
+        }
+
+        void popFrontIf(uint64_t seq) {
+            if (size > 0 && ring[first] == seq) {
+                first = (first + 1) % ring.size();
+                size--;
+            }
+        }
+
+        void clear() {
+            first = 0;
+            size = 0;
+        }
+
+    private:
+        std::vector<uint64_t> ring;
+        size_t first = 0;
+        size_t size = 0;
+    };
+
+    size_t slot(uint64_t seq) const {
+        return size_t(seq % capacity);
+    }
+
+    void evictOldest() {
+        double value = values[slot(head)];
+        minQueue.popFrontIf(head);
+        maxQueue.popFrontIf(head);
+        head++;
+        held--;
+
+        if (held == 0) {
+            runningMean = 0;
+            m2 = 0;
+            return;
+        }
+        double delta = value - runningMean;
+        runningMean -= delta / double(held);
+        m2 -= delta * (value - runningMean);
+    }
+
+    size_t capacity;
+    int64_t maxAge;
+    std::vector<double> values;
+    std::vector<int64_t> stamps;
+    SeqDeque minQueue;
+    SeqDeque maxQueue;
+    uint64_t head = 0;  // sequence number of the oldest held sample
+    size_t held = 0;
+    double runningMean = 0;
+    double m2 = 0;
+};
+
+} // namespace tactile
@@ -0,0 +1,114 @@
+// Runs a batch of independent jobs on a fixed set of threads with work
+// stealing: jobs are dealt out to per-thread deques up front, each thread
+// takes from the back of its own deque, and a thread that runs dry steals
+// from the front of another's. Jobs of very different lengths (a sweep
+// point with 0.1% loss next to one with a 1 kHz haptic rate) therefore
+// still keep every core busy until the end.
+//
+// Jobs are whole simulations, milliseconds to seconds each, so a mutex per
+// deque costs nothing measurable and keeps the stealing easy to follow.
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tactile {
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threads) : queues(threads > 0 ? threads : 1) {
+        for (auto& queue : queues) {
+            queue = std::make_unique<Queue>();
+        }
+    }
+
+    size_t threadCount() const {
+        return queues.size();
+    }
+
+    // Calls job(index, thread) once for every index in [0, count) and
+    // returns when all have finished. Jobs must not throw.
+    template <typename Job>
+    void run(size_t count, Job&& job) {
+        // Contiguous blocks, so neighbouring grid points start on one thread
+        const size_t n = queues.size();
+        for (size_t t = 0; t < n; t++) {
+            for (size_t i = count * t / n; i < count * (t + 1) / n; i++) {
+                queues[t]->jobs.push_back(i);
+            }
+        }
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < n; t++) {
+            threads.emplace_back([this, t, &job] { work(t, job); });
+        }
+        work(0, job);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Jobs a thread took from another thread's deque in the last run()
+    size_t steals() const {
+        size_t total = 0;
+        for (const auto& queue : queues) {
+            total += queue->steals;
+        }
+        return total;
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+        size_t steals = 0;  // only touched by the owning thread
+    };
+
+    template <typename Job>
+    void work(size_t self, Job& job) {
+        Queue& own = *queues[self];
+        own.steals = 0;
+        size_t index;
+        while (true) {
+            if (popOwn(own, index)) {
+                job(index, self);
+                continue;
+            }
+            if (!steal(self, index)) {
+                return;  // jobs are only ever removed, so no deque will refill
+            }
+            own.steals++;
+            job(index, self);
+        }
+    }
+
+    static bool popOwn(Queue& queue, size_t& index) {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty()) {
+            return false;
+        }
+        index = queue.jobs.back();
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool steal(size_t self, size_t& index) {
+        for (size_t k = 1; k < queues.size(); k++) {
+            Queue& victim = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.jobs.empty()) {
+                index = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+};
+
+} // namespace tactile
@@ -1,58 +1,376 @@
 #include <zmq.hpp>
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
 #include <vector>
-#include <sstream>
-#include <cmath>
 
-// Last sent position for dead-band filtering
-double last_x = 0, last_y = 0, last_z = 0;
-double threshold = 0.1; // Threshold for dead-band
+#include "async_log.hpp"
+#include "clock.hpp"
+#include "contact_codec.hpp"
+#include "deadband.hpp"
+#include "haptic_relay.hpp"
+#include "haptic_wire.hpp"
+#include "hop_stamps.hpp"
+#include "impairment.hpp"
+#include "options.hpp"
+#include "receive_engine.hpp"
+#include "transport.hpp"
+
+// Log formatters, run on the logger thread
+static int formatForwarded(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "VM2 forwarded: %lld ns", static_cast<long long>(a.i[0]));
+}
+
+static int formatMalformed(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "VM2 dropped malformed sample (%lld bytes)", static_cast<long long>(a.i[0]));
+}
+
+static int formatReduction(char* out, size_t size, const tactile::LogArgs& a) {
+    std::string_view mode = a.textView();
+    return std::snprintf(out, size, "VM2 session %04llx %.*s dead-band: %lld in, %lld sent (%.1f%% fewer packets)",
+                         static_cast<unsigned long long>(a.i[2]), static_cast<int>(mode.size()), mode.data(),
+                         static_cast<long long>(a.i[0]), static_cast<long long>(a.i[1]), a.d[0] * 100);
+}
+
+static int formatError(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "VM2 session %04llx reconstruction error: position rms %.4f max %.4f, "
+                         "orientation max %.2f deg, force max %.3f N",
+                         static_cast<unsigned long long>(a.i[0]), a.d[0], a.d[1], a.d[2], a.d[3]);
+}
+
+static int formatInput(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "VM2 session %04llx input: %lld lost in %.0f bursts (longest %.0f), "
+                         "%lld reordered, %.0f duplicates",
+                         static_cast<unsigned long long>(a.i[0]), static_cast<long long>(a.i[1]), a.d[0], a.d[1],
+                         static_cast<long long>(a.i[2]), a.d[2]);
+}
+
+static int formatContact(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "VM2 session %04llx contact codec: %lld in, %lld keyframes, %.0f deltas, "
+                         "%.0f heartbeats (%.2fx fewer bytes)",
+                         static_cast<unsigned long long>(a.i[0]), static_cast<long long>(a.i[1]),
+                         static_cast<long long>(a.i[2]), a.d[0], a.d[1], a.d[2]);
+}
+
+static int formatOnsets(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "VM2 session %04llx contact: %lld onsets, %lld releases, "
+                         "onset latency mean %.3f ms max %.3f ms",
+                         static_cast<unsigned long long>(a.i[0]), static_cast<long long>(a.i[1]),
+                         static_cast<long long>(a.i[2]), a.d[0], a.d[1]);
+}
+
+static int formatShard(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "VM2 worker %lld: %lld sessions, %lld inbox-full stalls, %.0f malformed",
+                         static_cast<long long>(a.i[0]), static_cast<long long>(a.i[1]),
+                         static_cast<long long>(a.i[2]), a.d[0]);
+}
+
+// Packet reduction and the error it costs over the last interval, and the
+// input loss so far, for each session the worker owns
+static void reportSessions(tactile::RelayWorker& worker, tactile::AsyncLogger& log) {
+    // The reconstruction error the receivers see, whichever codec ran
+    auto logError = [&](uint16_t session, const tactile::DeadbandStats& stats) {
+        log.log(tactile::LogLevel::Info, formatError, [&](tactile::LogArgs& a) {
+            a.i[0] = session;
+            a.d[0] = stats.positionRms();
+            a.d[1] = stats.positionMax;
+            a.d[2] = stats.orientationMax * (180.0 / 3.14159265358979323846);
+            a.d[3] = stats.forceMax;
+        });
+    };
+    for (auto& entry : worker.sessions()) {
+        const uint16_t session = entry.first;
+        tactile::ContactCodec& contact = entry.second.contact;
+        const tactile::ContactStats& sent = contact.stats();
+        if (sent.inputs > 0) {
+            log.log(tactile::LogLevel::Info, formatContact, [&](tactile::LogArgs& a) {
+                a.i[0] = session;
+                a.i[1] = static_cast<int64_t>(sent.inputs);
+                a.i[2] = static_cast<int64_t>(sent.keyframes);
+                a.d[0] = static_cast<double>(sent.deltas);
+                a.d[1] = static_cast<double>(sent.heartbeats);
+                a.d[2] = sent.compressionRatio();
+            });
+            log.log(tactile::LogLevel::Info, formatOnsets, [&](tactile::LogArgs& a) {
+                a.i[0] = session;
+                a.i[1] = static_cast<int64_t>(sent.onsets);
+                a.i[2] = static_cast<int64_t>(sent.releases);
+                a.d[0] = sent.onsetLatencyMeanNs() / 1e6;
+                a.d[1] = sent.onsetLatencyMaxNs / 1e6;
+            });
+            logError(session, sent.error);
+            contact.resetStats();
+        }
+        tactile::DeadbandCodec& codec = entry.second.codec;
+        const tactile::DeadbandStats& stats = codec.stats();
+        if (stats.inputs > 0) {
+            log.log(tactile::LogLevel::Info, formatReduction, [&](tactile::LogArgs& a) {
+                a.i[0] = static_cast<int64_t>(stats.inputs);
+                a.i[1] = static_cast<int64_t>(stats.sent);
+                a.i[2] = session;
+                a.d[0] = stats.reductionRatio();
+                a.setText(tactile::deadbandModeName(codec.mode()));
+            });
+            logError(session, stats);
+            codec.resetStats();
+        }
+        // Input loss does not depend on the codec
+        const tactile::SequenceStats& input = entry.second.input.stats();
+        log.log(tactile::LogLevel::Info, formatInput, [&](tactile::LogArgs& a) {
+            a.i[0] = session;
+            a.i[1] = static_cast<int64_t>(input.lost);
+            a.i[2] = static_cast<int64_t>(input.reordered);
+            a.d[0] = static_cast<double>(input.bursts.bursts);
+            a.d[1] = static_cast<double>(input.bursts.longest);
+            a.d[2] = static_cast<double>(input.duplicates);
+        });
+    }
+}
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    // Binary is the default; "--wire text" sends "timestamp,x,y,z#seq" for text subscribers
+    const tactile::WireFormat wire = opts.get("--wire", "binary") == "text"
+        ? tactile::WireFormat::Text : tactile::WireFormat::Binary;
+
+    // "--codec off|absolute|weber|predictive"; absolute is the original 0.1 per-axis rule
+    tactile::DeadbandMode mode;
+    if (!tactile::parseDeadbandMode(opts.get("--codec", "absolute"), mode)) {
+        std::cerr << "Unknown --codec (use off, absolute, weber or predictive)" << std::endl;
+        return 1;
+    }
+    const tactile::DeadbandConfig config = tactile::deadbandConfigFromOptions(opts);
+    // "--contact-codec" sends keyframes, deltas and heartbeats (contact_codec.hpp)
+    // in place of the dead-band; receivers need ContactDecoder to read them
+    const bool contactCodec = opts.has("--contact-codec");
+    tactile::ContactConfig contactConfig;
+    if (contactCodec) {
+        if (!tactile::contactConfigFromOptions(opts, contactConfig)) {
+            return 1;
+        }
+        if (wire == tactile::WireFormat::Text || opts.has("--codec")) {
+            std::cerr << "--contact-codec replaces --codec and needs --wire binary" << std::endl;
+            return 1;
+        }
+    }
+    const auto reportEvery = std::chrono::seconds(opts.getInt("--report-s", 10));
+
+    // "--workers N" shards sessions (one per hand_id) over N threads; with 1
+    // the receive thread runs the codec itself, as before. "--worker-cpu C"
+    // pins worker i to CPU C + i, "--worker-spin" keeps idle workers spinning
+    const long workerCount = opts.getInt("--workers", 1);
+    if (workerCount < 1) {
+        std::cerr << "--workers must be at least 1" << std::endl;
+        return 1;
+    }
+    const long workerCpu = opts.getInt("--worker-cpu", -1);
+    const bool workerSpin = opts.has("--worker-spin");
+
+    // Each forwarded sample carries its upstream hop frames; "--hop-stamps"
+    // adds one for this relay, opt-in like sim_replay's because single-frame
+    // subscribers (debug.py) would read it as a message. Stamps use the
+    // shared epoch so receivers on this host can compare them with their
+    // own clock.
+    const tactile::Clock clock = tactile::clockFromOptions(opts, tactile::ClockEpoch::Shared);
+    const bool hopStamps = opts.has("--hop-stamps");
+
+    // "--transport ipc|shm" when VM1 and the subscribers share this host;
+    // "--upstream HOST" is where VM1 runs over tcp
+    tactile::Transport transport;
+    if (!tactile::transportFromOptions(opts, transport)) {
+        return 1;
+    }
+    const std::string inEndpoint = tactile::connectEndpoint(transport, opts.get("--upstream", "vm1"), 5555);
+    const std::string outEndpoint = tactile::bindEndpoint(transport, 5556);
+
+    // "--impair-delay-ms 20 --impair-ge-p 0.01 ..." emulates the link to the
+    // receivers in-process (impairment.hpp)
+    tactile::ImpairmentConfig impair;
+    if (!tactile::impairmentFromOptions(opts, "--impair-", impair)) {
+        return 1;
+    }
+    // Both a shared-memory ring and an impairment stage take one writer
+    const bool singleWriter = transport == tactile::Transport::Shm || impair.enabled();
 
-int main() {
     // Subscriber connects to VM1
     zmq::context_t ctx(1);
-    zmq::socket_t sub(ctx, zmq::socket_type::sub);
-    sub.connect("tcp://vm1:5555");  // Connect to VM1 by container name
-    sub.set(zmq::sockopt::subscribe, "");
+    tactile::Subscriber sub(ctx);
+    // Publisher for filtered data. Workers each publish on their own socket
+    // into an XSUB/XPUB proxy, so subscribers still see one endpoint and
+    // their per-session subscriptions reach every worker. A shared-memory
+    // ring or an impairment stage takes a single writer, so there a
+    // forwarder thread feeds it instead.
+    tactile::Publisher pub(ctx, workerCount > 1 && !singleWriter ? zmq::socket_type::xpub : zmq::socket_type::pub);
+    zmq::socket_t fanIn(ctx, singleWriter ? zmq::socket_type::sub : zmq::socket_type::xsub);
+    const char* fanInEndpoint = "inproc://haptic-relay";
+    try {
+        sub.connect(inEndpoint);
+        pub.bind(outEndpoint);
+        if (workerCount > 1) {
+            fanIn.bind(fanInEndpoint);
+            if (singleWriter) {
+                fanIn.set(zmq::sockopt::subscribe, "");
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "VM2 could not set up its sockets: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "VM2 started - subscribing to " << inEndpoint << ", publishing on " << outEndpoint << " ("
+              << (wire == tactile::WireFormat::Text ? "text" : "binary") << ", "
+              << (contactCodec ? std::string("contact codec")
+                               : std::string(tactile::deadbandModeName(mode)) + " dead-band") << ", " << workerCount
+              << (workerCount == 1 ? " worker)" : " workers)") << std::endl;
+
+    std::unique_ptr<tactile::ImpairmentStage> stage;
+    if (impair.enabled()) {
+        stage = std::make_unique<tactile::ImpairmentStage>(impair, pub, clock);
+        std::cout << "VM2 impairing its output: delay " << impair.delayNs / 1e6 << " ms +- "
+                  << impair.jitterNs / 1e6 << " ms " << tactile::delayDistributionName(impair.distribution)
+                  << ", loss " << impair.loss.lossGood << " (burst p " << impair.loss.p << ", r " << impair.loss.r
+                  << "), reorder " << impair.reorder << std::endl;
+    }
+    // Everything leaving the relay, through the stage if there is one
+    auto output = [&](const char* data, size_t len, const tactile::HopTrail& trail) {
+        if (stage) {
+            stage->send(data, len, trail);
+        } else {
+            pub.send(data, len, trail);
+        }
+    };
+
+    // Per-sample lines are written by a background thread ("--log-level warn" silences them)
+    const tactile::LogLevel logLevel = tactile::logLevelFromOptions(opts);
+    tactile::AsyncLogger log(logLevel);
+
+    std::vector<std::unique_ptr<tactile::RelayWorker>> workers;
+    for (long i = 0; i < workerCount; i++) {
+        workers.push_back(std::make_unique<tactile::RelayWorker>(mode, config, wire, clock));
+        if (contactCodec) {
+            workers.back()->useContactCodec(contactConfig);
+        }
+    }
+
+    // The hop frames a forwarded sample came with, plus ours
+    auto outgoingHops = [&](const tactile::RelayMessage& in) {
+        tactile::HopTrail trail = in.hops;
+        if (hopStamps) {
+            trail.add(tactile::makeHopStamp(tactile::HopKind::Relay, in.ingressNs, in.startNs, clock.nowNs()));
+        }
+        return trail;
+    };
 
-    // Publisher for filtered data
-    zmq::socket_t pub(ctx, zmq::socket_type::pub);
-    pub.bind("tcp://*:5556");
+    std::vector<std::thread> threads;
+    if (workerCount > 1) {
+        threads.emplace_back([&] {
+            try {
+                if (!singleWriter) {
+                    zmq::proxy(fanIn, pub.socket());
+                    return;
+                }
+                tactile::RecvBuffer forwarded;
+                while (tactile::receiveInto(fanIn, forwarded)) {
+                    output(forwarded.data.data(), forwarded.size, forwarded.hops);
+                }
+            } catch (const zmq::error_t&) {
+                // context terminated
+            }
+        });
+        for (long i = 0; i < workerCount; i++) {
+            // Each worker owns its socket and logger (both single-threaded)
+            threads.emplace_back([&, i] {
+                if (workerCpu >= 0 && !tactile::pinCurrentThread(static_cast<int>(workerCpu + i))) {
+                    std::cerr << "Could not pin worker " << i << " to CPU " << workerCpu + i << std::endl;
+                }
+                tactile::RelayWorker& worker = *workers[i];
+                tactile::AsyncLogger workerLog(logLevel);
+                tactile::Publisher out(ctx);
+                out.connect(fanInEndpoint);
+                auto forward = [&](const tactile::HapticSample& sample, const char* data, size_t len,
+                                   const tactile::RelayMessage& in) {
+                    out.send(data, len, outgoingHops(in));
+                    workerLog.log(tactile::LogLevel::Info, formatForwarded, [&](tactile::LogArgs& a) {
+                        a.i[0] = sample.header.timestampNs;
+                    });
+                };
 
-    std::cout << "VM2 started - subscribing to vm1:5555, publishing on *:5556" << std::endl;
+                auto nextReport = std::chrono::steady_clock::now() + reportEvery;
+                auto idleSince = std::chrono::steady_clock::now();
+                while (true) {
+                    auto now = std::chrono::steady_clock::now();
+                    if (worker.drain(forward) > 0) {
+                        idleSince = now;
+                    } else if (!workerSpin && now - idleSince > std::chrono::microseconds(50)) {
+                        // Quiet for a while: stop burning the core
+                        std::this_thread::sleep_for(std::chrono::microseconds(20));
+                    }
+                    if (now >= nextReport) {
+                        nextReport += reportEvery;
+                        reportSessions(worker, workerLog);
+                        workerLog.log(tactile::LogLevel::Info, formatShard, [&](tactile::LogArgs& a) {
+                            a.i[0] = i;
+                            a.i[1] = static_cast<int64_t>(worker.sessions().size());
+                            a.i[2] = static_cast<int64_t>(worker.stalls());
+                            a.d[0] = static_cast<double>(worker.malformed());
+                        });
+                    }
+                }
+            });
+        }
+    }
+
+    auto publish = [&](const tactile::HapticSample& sample, const char* data, size_t len,
+                       const tactile::RelayMessage& in) {
+        output(data, len, outgoingHops(in));
+        log.log(tactile::LogLevel::Info, formatForwarded, [&](tactile::LogArgs& a) {
+            a.i[0] = sample.header.timestampNs;
+        });
+    };
+    auto logMalformed = [&](size_t size) {
+        log.log(tactile::LogLevel::Warn, formatMalformed, [&](tactile::LogArgs& a) {
+            a.i[0] = static_cast<int64_t>(size);
+        });
+    };
+    auto nextReport = std::chrono::steady_clock::now() + reportEvery;
+
+    // Reused for every message so the receive loop does not allocate
+    tactile::RecvBuffer buf;
+    tactile::RelayMessage staging;
 
     while (true) {
-        zmq::message_t msg;
-        auto result = sub.recv(msg, zmq::recv_flags::none);
-        
-        // Parse the message
-        std::string data = msg.to_string();
-        std::istringstream iss(data);
-        std::string ts_str;
-        double x, y, z;
-        char comma;
-        
-        // Format: "timestamp,x,y,z"
-        std::getline(iss, ts_str, ',');
-        iss >> x >> comma >> y >> comma >> z;
-        
-        // Apply dead-band filter
-        bool should_send = (std::abs(x - last_x) > threshold) || 
-                           (std::abs(y - last_y) > threshold) || 
-                           (std::abs(z - last_z) > threshold);
-        
-        if (should_send) {
-            // Update last sent position
-            last_x = x;
-            last_y = y;
-            last_z = z;
-            
-            // Forward the timestamp
-            pub.send(zmq::buffer(ts_str), zmq::send_flags::none);
-            std::cout << "VM2 forwarded: " << ts_str << std::endl;
-        }
-    }
-    
+        if (!sub.receive(buf)) {
+            continue;
+        }
+        const int64_t ingressNs = clock.nowNs();
+        if (buf.truncated || !staging.assign(buf.data.data(), buf.size, buf.hops, ingressNs)) {
+            logMalformed(buf.size);
+            continue;
+        }
+
+        // Single worker: parse, filter and publish right here
+        if (workerCount == 1) {
+            if (!workers[0]->process(staging, publish)) {
+                logMalformed(buf.size);
+            }
+            if (std::chrono::steady_clock::now() >= nextReport) {
+                nextReport += reportEvery;
+                reportSessions(*workers[0], log);
+            }
+            continue;
+        }
+
+        // Otherwise only find the session and hand the message to its worker
+        uint16_t session = 0;
+        if (!tactile::sessionKey(buf.data.data(), buf.size, session)) {
+            logMalformed(buf.size);
+            continue;
+        }
+        workers[tactile::shardOf(session, workers.size())]->push(staging);
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,7 +1,39 @@
 #!/usr/bin/env python3
 import zmq
+import struct
 import argparse
 
+# Binary haptic messages, see common/haptic_wire.hpp
+HEADER_FMT = "<HBBHHQq"
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+HAPTIC_FMT = HEADER_FMT + "11f"
+HAPTIC_SIZE = struct.calcsize(HAPTIC_FMT)
+WIRE_MAGIC = 0x4854
+# MessageType
+HAPTIC_SAMPLE, HAPTIC_DELTA, HAPTIC_HEARTBEAT = 1, 2, 3
+# Payload floats in the order of the delta mask bits
+FIELDS = ["pos_x", "pos_y", "pos_z", "rot_x", "rot_y", "rot_z", "rot_w",
+          "normal_x", "normal_y", "normal_z", "force"]
+
+def describe(msg):
+    if len(msg) < HEADER_SIZE or struct.unpack_from("<H", msg)[0] != WIRE_MAGIC:
+        return msg.decode("utf-8", errors="replace")
+    h = struct.unpack_from(HEADER_FMT, msg)
+    head = f"stream={h[3]} seq={h[5]} ts={h[6] / 1e9:.6f}s"
+    if h[2] == HAPTIC_SAMPLE and len(msg) >= HAPTIC_SIZE:
+        f = struct.unpack_from(HAPTIC_FMT, msg)
+        return (f"haptic {head} pos=({f[7]:.4f},{f[8]:.4f},{f[9]:.4f}) force={f[17]:.3f}N")
+    if h[2] == HAPTIC_DELTA and len(msg) >= HEADER_SIZE + 2:
+        mask = struct.unpack_from("<H", msg, HEADER_SIZE)[0]
+        names = [name for i, name in enumerate(FIELDS) if mask & (1 << i)]
+        if len(msg) == HEADER_SIZE + 2 + 4 * len(names):
+            values = struct.unpack_from(f"<{len(names)}f", msg, HEADER_SIZE + 2)
+            changed = " ".join(f"{n}={v:.4f}" for n, v in zip(names, values))
+            return f"delta {head} {changed or '(no change)'}"
+    if h[2] == HAPTIC_HEARTBEAT:
+        return f"heartbeat {head}"
+    return f"unknown binary message type={h[2]} ({len(msg)} bytes) {head}"
+
 def main():
     parser = argparse.ArgumentParser()
     parser.add_argument("--port", type=int, required=True)
@@ -15,10 +47,12 @@ def main():
 
     try:
         while True:
-            msg = sub.recv_string()
-            print(f"[debug_sub] → {msg}")
+            # Further frames are hop stamps ("--hop-stamps"); describe the message only
+            frames = sub.recv_multipart()
+            hops = f" (+{len(frames) - 1} hop frames)" if len(frames) > 1 else ""
+            print(f"[debug_sub] → {describe(frames[0])}{hops}")
     except KeyboardInterrupt:
         print("\n[debug_sub] Stopped.")
 
 if __name__ == "__main__":
-    main()
\ No newline at end of file
+    main()
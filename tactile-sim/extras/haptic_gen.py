@@ -1,16 +1,23 @@
 #!/usr/bin/env python3
 """
-Broadcasts (timestamp,x,y,z) at 100 Hz on tcp://*:5555
+Broadcasts (timestamp,x,y,z#seq) at 100 Hz on tcp://*:5555
 """
-import time, random, zmq
+import time, random, zmq, argparse
+parser = argparse.ArgumentParser()
+parser.add_argument("--epoch", choices=["process", "shared"], default="process",
+                    help="shared: stamp absolute monotonic time (match receivers run with --epoch shared)")
+args = parser.parse_args()
 ctx = zmq.Context()
 pub = ctx.socket(zmq.PUB)
 pub.bind("tcp://*:5555")
-# Use monotonic time for more reliable relative timing
-t0 = time.monotonic()
+# Use monotonic time for more reliable relative timing, in integer ns
+t0 = 0 if args.epoch == "shared" else time.monotonic_ns()
+seq = 0  # lets receivers count what PUB/SUB dropped
 while True:
-    now = time.monotonic() - t0  # seconds from start
+    now = (time.monotonic_ns() - t0) / 1e9  # seconds from start (or shared epoch)
     xyz = [round(random.uniform(-1,1),3) for _ in range(3)]
-    pub.send_string(f"{now:.5f},{xyz[0]},{xyz[1]},{xyz[2]}")
-    print(f"Published: {now:.5f},{xyz[0]},{xyz[1]},{xyz[2]}")
-    time.sleep(0.01)  # 100 Hz
\ No newline at end of file
+    msg = f"{now:.9f},{xyz[0]},{xyz[1]},{xyz[2]}#{seq}"
+    pub.send_string(msg)
+    print(f"Published: {msg}")
+    seq += 1
+    time.sleep(0.01)  # 100 Hz
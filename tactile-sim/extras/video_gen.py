@@ -2,15 +2,22 @@
 """
 Fake "video bitrate samples" at 30 fps on tcp://*:5566
 """
-import time, random, zmq
+import time, random, zmq, argparse
+parser = argparse.ArgumentParser()
+parser.add_argument("--epoch", choices=["process", "shared"], default="process",
+                    help="shared: stamp absolute monotonic time (match receivers run with --epoch shared)")
+args = parser.parse_args()
 ctx = zmq.Context()
 pub = ctx.socket(zmq.PUB)
 pub.bind("tcp://*:5566")
 # Use the same timing approach as haptic_gen for consistency
-t0 = time.monotonic()
+t0 = 0 if args.epoch == "shared" else time.monotonic_ns()
+seq = 0  # lets receivers count what PUB/SUB dropped
 while True:
-    now = time.monotonic() - t0  # seconds from start
+    now = (time.monotonic_ns() - t0) / 1e9  # seconds from start (or shared epoch)
     kbps = random.randint(2000, 8000)
-    pub.send_string(f"{now:.5f},{kbps}")
-    print(f"Video: {now:.5f},{kbps}")
-    time.sleep(1/30)  # 30 fps
\ No newline at end of file
+    msg = f"{now:.9f},{kbps}#{seq}"
+    pub.send_string(msg)
+    print(f"Video: {msg}")
+    seq += 1
+    time.sleep(1/30)  # 30 fps
@@ -2,167 +2,285 @@
 #include <zmq.hpp>
 #include <iostream>
 #include <string>
-#include <thread>
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <iomanip>
+#include <fstream>
+#include <cstdio>
 
-// Simple simulation time tracker
-class SimulationTime {
-private:
-    std::chrono::steady_clock::time_point startTime;
-    
-public:
-    SimulationTime() : startTime(std::chrono::steady_clock::now()) {}
-    
-    double GetSeconds() const {
-        auto now = std::chrono::steady_clock::now();
-        return std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - startTime).count() / 1000.0;
-    }
-    
-    static SimulationTime& Now() {
-        static SimulationTime instance;
-        return instance;
-    }
-};
+#define TACTILE_ALLOC_COUNTER_IMPL
+#include "alloc_counter.hpp"
+#include "async_log.hpp"
+#include "clock.hpp"
+#include "contact_codec.hpp"
+#include "haptic_wire.hpp"
+#include "hdr_histogram.hpp"
+#include "offline_sim.hpp"
+#include "options.hpp"
+#include "receive_engine.hpp"
+#include "sequence_tracker.hpp"
+#include "transport.hpp"
+
+// Per-packet row formatters, run on the logger thread
+static int FormatRow(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "%12.6f%10s%15.6f%15.6f",
+                         a.d[0], a.i[0] ? "Video" : "Haptic", a.d[1], a.d[2]);
+}
+
+static int FormatParseError(char* out, size_t size, const tactile::LogArgs& a) {
+    std::string_view text = a.textView();
+    return std::snprintf(out, size, "Error parsing %s data: %.*s", a.i[0] ? "video" : "haptic",
+                         static_cast<int>(text.size()), text.data());
+}
 
 // ZMQ receiving thread
-void ReceiveMessages() {
+void ReceiveMessages(tactile::WaitStrategy waitStrategy, tactile::Transport transport, const tactile::Clock& clock,
+                     tactile::AsyncLogger& log, const std::string& histOut) {
     // Set up ZMQ context and sockets
     zmq::context_t context(1);
+    const std::string hapticEndpoint = tactile::connectEndpoint(transport, "localhost", 5556);
+    const std::string videoEndpoint = tactile::connectEndpoint(transport, "localhost", 5566);
     
     // Subscribe to VM2 (haptic)
-    zmq::socket_t hapticSub(context, zmq::socket_type::sub);
+    tactile::Subscriber hapticSub(context);
     try {
-        hapticSub.connect("tcp://localhost:5556");
-        hapticSub.set(zmq::sockopt::subscribe, "");
-        std::cout << "Connected to haptic stream on port 5556" << std::endl;
-    } catch (const zmq::error_t& e) {
+        hapticSub.connect(hapticEndpoint);
+        std::cout << "Connected to haptic stream on " << hapticEndpoint << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Failed to connect to haptic stream: " << e.what() << std::endl;
         return;
     }
     
     // Subscribe to VM3 (video)
-    zmq::socket_t videoSub(context, zmq::socket_type::sub);
+    tactile::Subscriber videoSub(context);
     try {
-        videoSub.connect("tcp://localhost:5566");
-        videoSub.set(zmq::sockopt::subscribe, "");
-        std::cout << "Connected to video stream on port 5566" << std::endl;
-    } catch (const zmq::error_t& e) {
+        videoSub.connect(videoEndpoint);
+        std::cout << "Connected to video stream on " << videoEndpoint << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Failed to connect to video stream: " << e.what() << std::endl;
         return;
     }
     
-    zmq::pollitem_t items[] = {
-        { static_cast<void*>(hapticSub), 0, ZMQ_POLLIN, 0 },
-        { static_cast<void*>(videoSub), 0, ZMQ_POLLIN, 0 }
-    };
-    
     // Stats tracking
     int hapticCount = 0;
     int videoCount = 0;
-    double totalHapticLatency = 0;
-    double totalVideoLatency = 0;
+    int64_t totalHapticLatencyNs = 0;
+    int64_t totalVideoLatencyNs = 0;
+    tactile::StreamHistograms hapticHist;
+    tactile::StreamHistograms videoHist;
+    tactile::SequenceTrackers hapticSeq;  // per hand
+    tactile::SequenceTrackers videoSeq;
+    tactile::HopBreakdown hapticHops;  // when the relay sends hop frames
+    tactile::ContactDecoder hapticDecoder;  // rebuilds "--contact-codec" relay output
+    
+    // Reused for every message so the loop does not allocate
+    tactile::HapticSample sample;
+    tactile::AllocProbe allocProbe;
+    const int warmupMessages = 100;
     
     std::cout << "Starting message reception..." << std::endl;
-    std::cout << std::setw(10) << "Time (s)" 
+    std::cout << std::setw(12) << "Time (s)" 
               << std::setw(10) << "Source" 
               << std::setw(15) << "Timestamp" 
               << std::setw(15) << "Latency (ms)" 
               << std::endl;
+    // Summaries keep the fixed 6-decimal format the packet rows use
+    std::cout << std::fixed << std::setprecision(6);
     
-    // Start polling
-    while (true) {
-        zmq::poll(items, 2, std::chrono::milliseconds(10));
-        
+    tactile::ReceiveEngine engine(waitStrategy);
+    engine.add(hapticSub, [&](const tactile::RecvBuffer& buf) {
         // Current simulation time
-        double now = SimulationTime::Now().GetSeconds();
+        int64_t nowNs = clock.nowNs();
         
-        // Check haptic socket
-        if (items[0].revents & ZMQ_POLLIN) {
-            zmq::message_t msg;
-            hapticSub.recv(msg);
-            std::string data = msg.to_string();
+        if (hapticDecoder.decode(buf.data.data(), buf.size, sample) != tactile::ContactReceived::Invalid) {
+            int64_t latencyNs = nowNs - sample.header.timestampNs;
             
-            try {
-                double timestamp = std::stod(data);
-                double latency = (now - timestamp) * 1000;  // ms
-                
-                hapticCount++;
-                totalHapticLatency += latency;
-                
-                std::cout << std::fixed << std::setprecision(3)
-                          << std::setw(10) << now 
-                          << std::setw(10) << "Haptic" 
-                          << std::setw(15) << timestamp 
-                          << std::setw(15) << latency 
-                          << std::endl;
-            } catch (const std::exception& e) {
-                std::cerr << "Error parsing haptic data: " << data << " - " << e.what() << std::endl;
+            hapticCount++;
+            totalHapticLatencyNs += latencyNs;
+            hapticHist.record(nowNs, sample.header.timestampNs);
+            if (sample.header.seq != tactile::noSequence) {
+                hapticSeq.record(sample.header.streamId, sample.header.seq);
+            }
+            if (buf.hops.count > 0) {
+                hapticHops.record(sample.header.timestampNs, buf.hops, nowNs);
             }
+            
+            log.log(tactile::LogLevel::Info, FormatRow, [&](tactile::LogArgs& a) {
+                a.i[0] = 0;
+                a.d[0] = nowNs / 1e9;
+                a.d[1] = sample.header.timestampNs / 1e9;
+                a.d[2] = tactile::nsToMs(latencyNs);
+            });
+        } else {
+            log.log(tactile::LogLevel::Warn, FormatParseError, [&](tactile::LogArgs& a) {
+                a.i[0] = 0;
+                a.setText(buf.view());
+            });
+        }
+    });
+    engine.add(videoSub, [&](const tactile::RecvBuffer& buf) {
+        int64_t nowNs = clock.nowNs();
+        double timestamp;
+        std::string_view text = buf.view();
+        uint64_t seq;
+        if (tactile::splitTextSequence(text, seq)) {
+            videoSeq.record(0, seq);
         }
         
-        // Check video socket
-        if (items[1].revents & ZMQ_POLLIN) {
-            zmq::message_t msg;
-            videoSub.recv(msg);
-            std::string data = msg.to_string();
+        // Parse timestamp from "timestamp,bitrate#seq" in place
+        if (tactile::parseLeadingDouble(text.data(), text.size(), timestamp)) {
+            int64_t latencyNs = nowNs - tactile::secondsToNs(timestamp);
             
-            try {
-                // Parse timestamp from "timestamp,bitrate"
-                size_t commaPos = data.find(',');
-                if (commaPos != std::string::npos) {
-                    double timestamp = std::stod(data.substr(0, commaPos));
-                    double latency = (now - timestamp) * 1000;  // ms
-                    
-                    videoCount++;
-                    totalVideoLatency += latency;
-                    
-                    std::cout << std::fixed << std::setprecision(3)
-                              << std::setw(10) << now 
-                              << std::setw(10) << "Video" 
-                              << std::setw(15) << timestamp 
-                              << std::setw(15) << latency 
-                              << std::endl;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error parsing video data: " << data << " - " << e.what() << std::endl;
-            }
+            videoCount++;
+            totalVideoLatencyNs += latencyNs;
+            videoHist.record(nowNs, tactile::secondsToNs(timestamp));
+            
+            log.log(tactile::LogLevel::Info, FormatRow, [&](tactile::LogArgs& a) {
+                a.i[0] = 1;
+                a.d[0] = nowNs / 1e9;
+                a.d[1] = timestamp;
+                a.d[2] = tactile::nsToMs(latencyNs);
+            });
+        } else {
+            log.log(tactile::LogLevel::Warn, FormatParseError, [&](tactile::LogArgs& a) {
+                a.i[0] = 1;
+                a.setText(buf.view());
+            });
+        }
+    });
+    
+    const int64_t simulationNs = 30000000000;  // 30 s
+    const int64_t summaryEveryNs = 5000000000;
+    const int64_t startNs = clock.nowNs();
+    int64_t nextSummaryNs = summaryEveryNs;
+    
+    // Start receiving
+    for (int64_t nowNs = 0; nowNs <= simulationNs; nowNs = clock.nowNs() - startNs) {
+        // Wake up at the latest when the next summary is due
+        auto timeout = std::chrono::ceil<std::chrono::milliseconds>(
+            std::chrono::nanoseconds(std::min(nextSummaryNs, simulationNs) - nowNs));
+        engine.runOnce(std::max(timeout, std::chrono::milliseconds(0)));
+        nowNs = clock.nowNs() - startNs;
+        double now = nowNs / 1e9;
+        
+        if (!allocProbe.isArmed() && hapticCount + videoCount >= warmupMessages) {
+            allocProbe.arm();
         }
         
         // Print summary every 5 seconds
-        if (((int)now) % 5 == 0 && ((int)(now * 10) % 10) == 0) {  // Every 5.0 seconds exactly
+        if (nowNs >= nextSummaryNs) {
+            log.flush();
             std::cout << "\n--- Summary at " << now << "s ---" << std::endl;
             std::cout << "Haptic packets: " << hapticCount 
-                      << ", Avg latency: " << (hapticCount > 0 ? totalHapticLatency / hapticCount : 0) << " ms" << std::endl;
+                      << ", Avg latency: " << (hapticCount > 0 ? tactile::nsToMs(totalHapticLatencyNs / hapticCount) : 0) << " ms" << std::endl;
             std::cout << "Video packets: " << videoCount 
-                      << ", Avg latency: " << (videoCount > 0 ? totalVideoLatency / videoCount : 0) << " ms" << std::endl;
+                      << ", Avg latency: " << (videoCount > 0 ? tactile::nsToMs(totalVideoLatencyNs / videoCount) : 0) << " ms" << std::endl;
+            tactile::printPercentiles(std::cout, "Haptic latency (last 5 s)", hapticHist.latency.window);
+            tactile::printPercentiles(std::cout, "Video latency (last 5 s) ", videoHist.latency.window);
             std::cout << "------------------------\n" << std::endl;
+            hapticHist.rollWindow();
+            videoHist.rollWindow();
+            nextSummaryNs += summaryEveryNs;
         }
-        
-        // Check if we should exit (30 second simulation)
-        if (now > 30.0) {
-            break;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
     
     // Final summary
+    log.flush();
     std::cout << "\n=== Final Summary ====" << std::endl;
     std::cout << "Haptic packets: " << hapticCount 
-              << ", Avg latency: " << (hapticCount > 0 ? totalHapticLatency / hapticCount : 0) << " ms" << std::endl;
+              << ", Avg latency: " << (hapticCount > 0 ? tactile::nsToMs(totalHapticLatencyNs / hapticCount) : 0) << " ms" << std::endl;
     std::cout << "Video packets: " << videoCount 
-              << ", Avg latency: " << (videoCount > 0 ? totalVideoLatency / videoCount : 0) << " ms" << std::endl;
+              << ", Avg latency: " << (videoCount > 0 ? tactile::nsToMs(totalVideoLatencyNs / videoCount) : 0) << " ms" << std::endl;
+    tactile::printPercentiles(std::cout, "Haptic latency      ", hapticHist.latency.run);
+    tactile::printPercentiles(std::cout, "Haptic inter-arrival", hapticHist.interArrival.run);
+    tactile::printPercentiles(std::cout, "Video latency       ", videoHist.latency.run);
+    tactile::printPercentiles(std::cout, "Video inter-arrival ", videoHist.interArrival.run);
+    hapticSeq.finish();
+    videoSeq.finish();
+    tactile::printSequenceStats(std::cout, "Haptic ", hapticSeq.total());
+    tactile::printSequenceStats(std::cout, "Video ", videoSeq.total());
+    tactile::printContactStats(std::cout, "Haptic ", hapticDecoder.stats());
+    if (hapticHops.count() > 0) {
+        std::cout << "Haptic latency budget (per hop):" << std::endl;
+        hapticHops.print(std::cout, "  ");
+    }
+    std::cout << "Receive path heap allocations after warm-up: " << allocProbe.allocations() << std::endl;
+    std::cout << "Log records dropped: " << log.dropped() << std::endl;
     std::cout << "====================\n" << std::endl;
+    
+    if (!histOut.empty()) {
+        std::ofstream out(histOut, std::ios::binary);
+        tactile::writeStreamHistograms(out, "haptic", hapticHist);
+        tactile::writeStreamHistograms(out, "video", videoHist);
+    }
+}
+
+// "--offline": no sockets and no wall clock. The recorded run is pushed
+// through simulated links and the relay's dead-band codec as discrete
+// events (offline_sim.hpp), as fast as the CPU allows; the same --seed
+// always gives the same result, down to the run digest.
+int RunOffline(const tactile::Options& opts) {
+    const std::string runDir = opts.get("--run", "../SimData/run01");
+    tactile::OfflineConfig config;
+    if (!tactile::offlineConfigFromOptions(opts, config)) {
+        return 1;
+    }
+    tactile::TraceReader trace;
+    std::string error;
+    if (!trace.open(runDir, error)) {
+        std::cerr << "Cannot load " << runDir << ": " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Offline run of " << runDir << " (" << trace.eventCount() << " rows), seed " << config.seed
+              << ", " << tactile::deadbandModeName(config.mode) << " dead-band" << std::endl;
+    std::cout << std::fixed << std::setprecision(6);
+    
+    const auto started = std::chrono::steady_clock::now();
+    tactile::OfflineResult result = tactile::runOffline(trace, config);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    
+    std::cout << "\n=== Final Summary ====" << std::endl;
+    tactile::printOfflineResult(std::cout, result);
+    std::cout << "Wall time: " << elapsed << " s" << std::endl;
+    std::cout << "====================\n" << std::endl;
+    
+    const std::string histOut = opts.get("--hist-out", "");
+    if (!histOut.empty()) {
+        std::ofstream out(histOut, std::ios::binary);
+        tactile::writeStreamHistograms(out, "haptic", result.haptic);
+        tactile::writeStreamHistograms(out, "video", result.video);
+    }
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
+    tactile::Options opts(argc, argv);
+    if (opts.has("--offline")) {
+        return RunOffline(opts);
+    }
+    
     std::cout << "Starting standalone ZMQ bridge for Tactile Internet..." << std::endl;
     
+    tactile::WaitStrategy waitStrategy;
+    if (!tactile::setupReceiveThread(opts, waitStrategy)) {
+        return 1;
+    }
+    // "--transport tcp|ipc|shm" (transport.hpp); must match the publishers
+    tactile::Transport transport;
+    if (!tactile::transportFromOptions(opts, transport)) {
+        return 1;
+    }
+    
+    // "--epoch shared" when publishers stamp absolute monotonic time
+    tactile::Clock clock = tactile::clockFromOptions(opts);
+    std::cout << "Clock: " << clock.describe() << std::endl;
+    
+    // Per-packet rows are formatted and written off the receive thread
+    tactile::AsyncLogger log(tactile::logLevelFromOptions(opts));
+    
     // Run the message receiving function directly
-    ReceiveMessages();
+    ReceiveMessages(waitStrategy, transport, clock, log, opts.get("--hist-out", ""));
     
     std::cout << "Simulation complete" << std::endl;
     return 0;
@@ -0,0 +1,160 @@
+// Benchmarks the cross-layer scheduler (link_scheduler.hpp): haptic
+// latency when haptic and video share one bottleneck and video runs at
+// or past the link's capacity. Every policy is run on the same offline
+// simulation of the recorded run (offline_sim.hpp) at every video load.
+//
+//   sched_bench [--run ../SimData/run01] [--bottleneck-mbps 20]
+//               [--load 0.8,0.95,1.1] [--policies fifo,weighted,strict]
+//               [--seed 1] [--threads N]
+//
+// --load is the mean video bit rate as a fraction of the bottleneck; the
+// recorded frame sizes are scaled to it. Any other cross_layer_sim
+// --offline option (--haptic-deadline-ms, --video-deadline-ms,
+// --haptic-share, --video-pacing, --mtu, --delay-ms, ...) applies to all
+// runs.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "link_scheduler.hpp"
+#include "offline_sim.hpp"
+#include "options.hpp"
+#include "work_stealing.hpp"
+
+namespace {
+
+struct BenchRun {
+    double load;
+    tactile::SchedulerPolicy policy;
+};
+
+bool parseLoads(const std::string& text, std::vector<double>& out) {
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end = nullptr;
+        double value = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || value <= 0) {
+            std::cerr << "Bad --load value '" << item << "'" << std::endl;
+            return false;
+        }
+        out.push_back(value);
+    }
+    return !out.empty();
+}
+
+bool parsePolicies(const std::string& text, std::vector<tactile::SchedulerPolicy>& out) {
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        tactile::SchedulerPolicy policy;
+        if (!tactile::parseSchedulerPolicy(item, policy)) {
+            std::cerr << "Unknown policy '" << item << "' (use fifo, strict or weighted)" << std::endl;
+            return false;
+        }
+        out.push_back(policy);
+    }
+    return !out.empty();
+}
+
+double ms(int64_t ns) {
+    return ns / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    const std::string runDir = opts.get("--run", "../SimData/run01");
+    tactile::OfflineConfig base;
+    if (!tactile::offlineConfigFromOptions(opts, base)) {
+        return 1;
+    }
+    if (!base.bottleneck.enabled()) {
+        base.bottleneck.rateBps = 20e6;
+    }
+    std::vector<double> loads;
+    std::vector<tactile::SchedulerPolicy> policies;
+    if (!parseLoads(opts.get("--load", "0.8,0.95,1.1"), loads) ||
+        !parsePolicies(opts.get("--policies", "fifo,weighted,strict"), policies)) {
+        return 1;
+    }
+    const long cores = std::max(1u, std::thread::hardware_concurrency());
+    const long threads = opts.getInt("--threads", cores);
+    if (threads < 1) {
+        std::cerr << "--threads must be positive" << std::endl;
+        return 1;
+    }
+
+    tactile::TraceReader trace;
+    std::string error;
+    if (!trace.open(runDir, error)) {
+        std::cerr << "Cannot load " << runDir << ": " << error << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchRun> runs;
+    for (double load : loads) {
+        for (tactile::SchedulerPolicy policy : policies) {
+            runs.push_back({ load, policy });
+        }
+    }
+    std::cout << "Scheduler benchmark on " << runDir << ": " << base.bottleneck.rateBps / 1e6
+              << " Mbit/s bottleneck, haptic deadline " << ms(base.bottleneck.hapticDeadlineNs)
+              << " ms, video deadline " << ms(base.bottleneck.videoDeadlineNs) << " ms, "
+              << tactile::deadbandModeName(base.mode) << " dead-band" << std::endl;
+
+    std::vector<tactile::OfflineResult> results(runs.size());
+    tactile::WorkStealingPool pool(size_t(std::min<long>(threads, long(runs.size()))));
+    const auto started = std::chrono::steady_clock::now();
+    pool.run(runs.size(), [&](size_t i, size_t) {
+        tactile::OfflineConfig config = base;
+        config.bottleneck.policy = runs[i].policy;
+        config.videoBitrateBps = runs[i].load * base.bottleneck.rateBps;
+        results[i] = tactile::runOffline(trace, config);
+    });
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(7) << "load"
+              << std::setw(10) << "policy"
+              << std::setw(10) << "h p50"
+              << std::setw(10) << "h p99"
+              << std::setw(10) << "h p99.9"
+              << std::setw(10) << "h max"
+              << std::setw(8) << "h late"
+              << std::setw(10) << "v p50"
+              << std::setw(10) << "v p99"
+              << std::setw(9) << "frames"
+              << std::setw(9) << "dropped"
+              << std::setw(8) << "busy %"
+              << std::endl;
+    for (size_t i = 0; i < runs.size(); i++) {
+        const tactile::OfflineResult& r = results[i];
+        const tactile::SchedulerStats& s = r.scheduler;
+        const int64_t spanNs = r.endNs - r.startNs;
+        std::cout << std::setw(7) << runs[i].load
+                  << std::setw(10) << tactile::schedulerPolicyName(runs[i].policy)
+                  << std::setw(10) << ms(r.haptic.latency.run.valueAtPercentile(50))
+                  << std::setw(10) << ms(r.haptic.latency.run.valueAtPercentile(99))
+                  << std::setw(10) << ms(r.haptic.latency.run.valueAtPercentile(99.9))
+                  << std::setw(10) << ms(r.haptic.latency.run.max())
+                  << std::setw(8) << s.hapticLate
+                  << std::setw(10) << ms(r.video.latency.run.valueAtPercentile(50))
+                  << std::setw(10) << ms(r.video.latency.run.valueAtPercentile(99))
+                  << std::setw(9) << r.video.latency.run.count()
+                  << std::setw(9) << s.framesDropped
+                  << std::setw(8) << (spanNs > 0 ? 100.0 * double(s.busyNs) / double(spanNs) : 0.0)
+                  << std::endl;
+    }
+    std::cout << "Latencies in ms end to end; h late = haptic packets that waited past the deadline "
+                 "at the bottleneck; frames = video frames delivered whole" << std::endl;
+    std::cout << "Wall time: " << elapsed << " s" << std::endl;
+    return 0;
+}
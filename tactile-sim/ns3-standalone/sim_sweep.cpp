@@ -0,0 +1,234 @@
+// Parameter sweep over the offline cross-layer simulation (offline_sim.hpp).
+// Every combination of the listed values is one independent simulation of
+// the recorded run; they are spread over all cores with work stealing and
+// summarised in one table, one row per grid point.
+//
+//   sim_sweep [--run ../SimData/run01] [--codec absolute]
+//             [--threshold 0.05,0.1,0.2] [--delay-ms 1,5,20] [--jitter-ms 0,2]
+//             [--loss 0,0.01] [--haptic-rate-hz 0,250] [--video-mbps 0,5,20]
+//             [--repeats 3] [--seed 1] [--threads N] [--hist-out sweep.hdr]
+//
+// Each list is comma-separated. --threshold is the dead-band threshold:
+// the per-axis position threshold in absolute mode, the Weber fraction
+// otherwise. A haptic rate or video bit rate of 0 keeps the recording's.
+// Every other option of cross_layer_sim --offline (--video-delay-ms,
+// --relay-us, --floor-position, ...) applies to the whole grid.
+//
+// With --repeats N each point runs with seeds seed..seed+N-1 and its row
+// shows the merged histograms. Rows do not depend on --threads or on which
+// thread ran what: a point and its repeats always run together, in order.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "offline_sim.hpp"
+#include "options.hpp"
+#include "work_stealing.hpp"
+
+namespace {
+
+struct SweepPoint {
+    double threshold;
+    double delayMs;
+    double jitterMs;
+    double loss;
+    double hapticRateHz;
+    double videoMbps;
+};
+
+struct PointResult {
+    tactile::HdrHistogram hapticLatency;
+    tactile::HdrHistogram hapticInterArrival;
+    tactile::HdrHistogram videoLatency;
+    tactile::HdrHistogram videoInterArrival;
+    tactile::SequenceStats hapticSeq;
+    uint64_t samples = 0;    // dead-band inputs at the relay
+    uint64_t forwarded = 0;
+};
+
+// "--name a,b,c"; the fallback if the option is absent
+bool parseList(const tactile::Options& opts, const char* name, double fallback, std::vector<double>& out) {
+    const std::string text = opts.get(name, "");
+    out.clear();
+    if (text.empty()) {
+        out.push_back(fallback);
+        return true;
+    }
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end = nullptr;
+        double value = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0') {
+            std::cerr << "Bad value '" << item << "' in " << name << std::endl;
+            return false;
+        }
+        out.push_back(value);
+    }
+    return true;
+}
+
+tactile::OfflineConfig configFor(const tactile::OfflineConfig& base, const SweepPoint& p) {
+    tactile::OfflineConfig config = base;
+    if (config.mode == tactile::DeadbandMode::Absolute) {
+        config.deadband.absoluteThreshold = p.threshold;
+    } else {
+        config.deadband.positionWeber = p.threshold;
+        config.deadband.orientationWeber = p.threshold;
+        config.deadband.forceWeber = p.threshold;
+    }
+    config.uplink.delayNs = int64_t(std::llround(p.delayMs * 1e6));
+    config.uplink.jitterNs = int64_t(std::llround(p.jitterMs * 1e6));
+    config.uplink.loss = p.loss;
+    config.downlink = config.uplink;
+    config.hapticRateHz = p.hapticRateHz;
+    config.videoBitrateBps = p.videoMbps * 1e6;
+    return config;
+}
+
+double ms(int64_t ns) {
+    return ns / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    const std::string runDir = opts.get("--run", "../SimData/run01");
+    tactile::OfflineConfig base;
+    if (!tactile::offlineConfigFromOptions(opts, base)) {
+        return 1;
+    }
+    const double defaultThreshold = base.mode == tactile::DeadbandMode::Absolute
+        ? base.deadband.absoluteThreshold : base.deadband.positionWeber;
+
+    std::vector<double> thresholds, delays, jitters, losses, rates, bitrates;
+    if (!parseList(opts, "--threshold", defaultThreshold, thresholds) ||
+        !parseList(opts, "--delay-ms", base.uplink.delayNs / 1e6, delays) ||
+        !parseList(opts, "--jitter-ms", base.uplink.jitterNs / 1e6, jitters) ||
+        !parseList(opts, "--loss", base.uplink.loss, losses) ||
+        !parseList(opts, "--haptic-rate-hz", 0, rates) ||
+        !parseList(opts, "--video-mbps", 0, bitrates)) {
+        return 1;
+    }
+    for (double loss : losses) {
+        if (loss < 0 || loss > 1) {
+            std::cerr << "--loss values must be between 0 and 1" << std::endl;
+            return 1;
+        }
+    }
+    const long repeats = opts.getInt("--repeats", 1);
+    const long cores = std::max(1u, std::thread::hardware_concurrency());
+    const long threads = opts.getInt("--threads", cores);
+    if (repeats < 1 || threads < 1) {
+        std::cerr << "--repeats and --threads must be positive" << std::endl;
+        return 1;
+    }
+
+    tactile::TraceReader trace;
+    std::string error;
+    if (!trace.open(runDir, error)) {
+        std::cerr << "Cannot load " << runDir << ": " << error << std::endl;
+        return 1;
+    }
+
+    std::vector<SweepPoint> points;
+    for (double threshold : thresholds)
+        for (double delay : delays)
+            for (double jitter : jitters)
+                for (double loss : losses)
+                    for (double rate : rates)
+                        for (double bitrate : bitrates)
+                            points.push_back({ threshold, delay, jitter, loss, rate, bitrate });
+
+    std::cout << "Sweeping " << points.size() << " point(s) x " << repeats << " seed(s) of " << runDir
+              << " (" << trace.eventCount() << " rows), " << tactile::deadbandModeName(base.mode)
+              << " dead-band, " << threads << " thread(s)" << std::endl;
+
+    // The trace is only read, so every simulation shares one mapping
+    std::vector<PointResult> results(points.size());
+    tactile::WorkStealingPool pool(size_t(std::min<long>(threads, long(points.size()))));
+    const auto started = std::chrono::steady_clock::now();
+    pool.run(points.size(), [&](size_t i, size_t) {
+        tactile::OfflineConfig config = configFor(base, points[i]);
+        PointResult& out = results[i];
+        for (long r = 0; r < repeats; r++) {
+            config.seed = base.seed + uint64_t(r);
+            tactile::OfflineResult run = tactile::runOffline(trace, config);
+            out.hapticLatency.merge(run.haptic.latency.run);
+            out.hapticInterArrival.merge(run.haptic.interArrival.run);
+            out.videoLatency.merge(run.video.latency.run);
+            out.videoInterArrival.merge(run.video.interArrival.run);
+            out.hapticSeq.merge(run.hapticSeq.total());
+            out.samples += run.codec.inputs;
+            out.forwarded += run.codec.sent;
+        }
+    });
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(5) << "#"
+              << std::setw(10) << "threshold"
+              << std::setw(9) << "delay"
+              << std::setw(9) << "jitter"
+              << std::setw(8) << "loss"
+              << std::setw(9) << "rate Hz"
+              << std::setw(9) << "video Mb"
+              << std::setw(9) << "fwd %"
+              << std::setw(9) << "lost %"
+              << std::setw(10) << "h p50"
+              << std::setw(10) << "h p99"
+              << std::setw(10) << "h p99.9"
+              << std::setw(11) << "h gap p99"
+              << std::setw(10) << "v p50"
+              << std::setw(10) << "v p99"
+              << std::endl;
+    for (size_t i = 0; i < points.size(); i++) {
+        const SweepPoint& p = points[i];
+        const PointResult& r = results[i];
+        std::cout << std::setw(5) << i
+                  << std::setw(10) << p.threshold
+                  << std::setw(9) << p.delayMs
+                  << std::setw(9) << p.jitterMs
+                  << std::setw(8) << p.loss
+                  << std::setw(9) << p.hapticRateHz
+                  << std::setw(9) << p.videoMbps
+                  << std::setw(9) << (r.samples ? 100.0 * double(r.forwarded) / double(r.samples) : 0.0)
+                  << std::setw(9) << r.hapticSeq.lossRatio() * 100
+                  << std::setw(10) << ms(r.hapticLatency.valueAtPercentile(50))
+                  << std::setw(10) << ms(r.hapticLatency.valueAtPercentile(99))
+                  << std::setw(10) << ms(r.hapticLatency.valueAtPercentile(99.9))
+                  << std::setw(11) << ms(r.hapticInterArrival.valueAtPercentile(99))
+                  << std::setw(10) << ms(r.videoLatency.valueAtPercentile(50))
+                  << std::setw(10) << ms(r.videoLatency.valueAtPercentile(99))
+                  << std::endl;
+    }
+    std::cout << "Latencies in ms; rate and video 0 = as recorded; lost % is after the relay" << std::endl;
+    std::cout << "Wall time: " << elapsed << " s on " << pool.threadCount() << " thread(s), "
+              << pool.steals() << " point(s) stolen" << std::endl;
+
+    // Named p<index>.<stream>.<kind> so hist_merge can combine or pick points
+    const std::string histOut = opts.get("--hist-out", "");
+    if (!histOut.empty()) {
+        std::ofstream out(histOut, std::ios::binary);
+        for (size_t i = 0; i < points.size(); i++) {
+            const std::string prefix = "p" + std::to_string(i) + ".";
+            tactile::writeNamedHistogram(out, prefix + "haptic.latency", results[i].hapticLatency);
+            tactile::writeNamedHistogram(out, prefix + "haptic.interarrival", results[i].hapticInterArrival);
+            tactile::writeNamedHistogram(out, prefix + "video.latency", results[i].videoLatency);
+            tactile::writeNamedHistogram(out, prefix + "video.interarrival", results[i].videoInterArrival);
+        }
+        if (!out) {
+            std::cerr << "Cannot write " << histOut << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+// Throughput and accuracy of the batch kernels (sample_batch.hpp) on the
+// haptic tables of a trace, at every SIMD level the build supports.
+//
+//   batch_bench [--run ../SimData/run01 | --run run01.tct] [--passes 200]
+//               [--levels scalar,sse,avx2] [--sessions 64]
+//               [--force-threshold 1] [--deadband-k 0.1] ...
+//
+// Each table is loaded into one SampleBatch and every kernel runs over it
+// --passes times; deltas are between consecutive rows. The error columns
+// compare against the double precision helpers of deadband.hpp: the
+// largest difference for norms and angles, the number of differing
+// decisions for masks. The multi-session rows run BatchDeadband with
+// --sessions lanes (lane i starts i/sessions of the way into the table)
+// against one DeadbandCodec per session in weber mode.
+//
+// Build with -mavx2 (or -march=native) for the avx2 level.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "columnar_trace.hpp"
+#include "deadband.hpp"
+#include "options.hpp"
+#include "sample_batch.hpp"
+
+namespace {
+
+bool parseLevels(const std::string& text, std::vector<tactile::SimdLevel>& out) {
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        tactile::SimdLevel level;
+        if (!tactile::parseSimdLevel(item, level)) {
+            std::cerr << "Unknown level '" << item << "' (use scalar, sse or avx2)" << std::endl;
+            return false;
+        }
+        if (level > tactile::supportedSimdLevel()) {
+            std::cerr << "Skipping " << item << ": not supported by this build or CPU" << std::endl;
+            continue;
+        }
+        out.push_back(level);
+    }
+    return !out.empty();
+}
+
+// DeadbandCodec's weber rule in double precision
+bool weberExceeds(const tactile::HapticPayload& actual, const tactile::HapticPayload& reference,
+                  const tactile::DeadbandConfig& config) {
+    double positionLimit = std::max(config.positionWeber * tactile::positionNorm(reference.position), config.positionFloor);
+    double orientationLimit = std::max(config.orientationWeber * tactile::quaternionMagnitude(reference.orientation),
+                                       config.orientationFloorRad);
+    double forceLimit = std::max(config.forceWeber * std::fabs(double(reference.forceN)), config.forceFloor);
+    return tactile::positionDistance(actual.position, reference.position) > positionLimit ||
+           tactile::quaternionAngle(actual.orientation, reference.orientation) > orientationLimit ||
+           std::fabs(double(actual.forceN) - reference.forceN) > forceLimit;
+}
+
+template <typename F>
+double timeSeconds(long passes, F&& f) {
+    const auto start = std::chrono::steady_clock::now();
+    for (long p = 0; p < passes; p++) {
+        f();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printRow(const std::string& table, const char* kernel, const char* level, double samples,
+              double seconds, double error, bool errorIsCount) {
+    std::cout << std::setw(9) << table
+              << std::setw(18) << kernel
+              << std::setw(8) << level
+              << std::setw(12) << std::fixed << std::setprecision(1) << (seconds > 0 ? samples / seconds / 1e6 : 0.0);
+    if (errorIsCount) {
+        std::cout << std::setw(12) << std::setprecision(0) << error;
+    } else {
+        std::cout << std::setw(12) << std::scientific << std::setprecision(2) << error << std::fixed;
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    const std::string runDir = opts.get("--run", "../SimData/run01");
+    const long passes = std::max(1L, opts.getInt("--passes", 200));
+    const size_t sessions = size_t(std::max(1L, opts.getInt("--sessions", 64)));
+    const float forceThreshold = float(opts.getDouble("--force-threshold", 1.0));
+    const tactile::DeadbandConfig config = tactile::deadbandConfigFromOptions(opts);
+    std::vector<tactile::SimdLevel> levels;
+    const std::string allLevels = tactile::supportedSimdLevel() == tactile::SimdLevel::Avx2 ? "scalar,sse,avx2"
+        : tactile::supportedSimdLevel() == tactile::SimdLevel::Sse ? "scalar,sse" : "scalar";
+    if (!parseLevels(opts.get("--levels", allLevels), levels)) {
+        return 1;
+    }
+
+    tactile::TraceReader trace;
+    std::string error;
+    if (!trace.open(runDir, error)) {
+        std::cerr << "Cannot load " << runDir << ": " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Batch kernels on " << runDir << ", " << passes << " passes, widest level "
+              << tactile::simdLevelName(tactile::supportedSimdLevel()) << std::endl;
+    std::cout << std::setw(9) << "Table"
+              << std::setw(18) << "Kernel"
+              << std::setw(8) << "Level"
+              << std::setw(12) << "Msample/s"
+              << std::setw(12) << "Error" << std::endl;
+
+    for (size_t t = 0; t < trace.tableCount(); t++) {
+        const tactile::TraceTable table = trace.table(t);
+        const tactile::HapticColumns columns(table);
+        if (!columns.usable() || table.rows() < 2) {
+            continue;
+        }
+        const std::string name(table.name());
+        const size_t rows = table.rows();
+        std::vector<tactile::HapticSample> samples(rows);
+        tactile::SampleBatch batch(rows);
+        for (size_t row = 0; row < rows; row++) {
+            tactile::fillHapticSample(table, columns, row, samples[row]);
+            batch.push(samples[row]);
+        }
+
+        // Double precision answers to check every level against
+        std::vector<double> distanceRef(rows - 1), angleRef(rows - 1);
+        std::vector<uint8_t> forceRef(rows), weberRef(rows - 1);
+        for (size_t i = 0; i + 1 < rows; i++) {
+            const tactile::HapticPayload& now = samples[i + 1].payload;
+            const tactile::HapticPayload& before = samples[i].payload;
+            distanceRef[i] = tactile::positionDistance(now.position, before.position);
+            angleRef[i] = tactile::quaternionAngle(now.orientation, before.orientation);
+            weberRef[i] = weberExceeds(now, before, config);
+        }
+        for (size_t i = 0; i < rows; i++) {
+            forceRef[i] = std::fabs(samples[i].payload.forceN) > forceThreshold;
+        }
+
+        std::vector<float> out(rows);
+        std::vector<uint8_t> mask(rows);
+        const double deltas = double(rows - 1) * double(passes);
+        const double all = double(rows) * double(passes);
+        for (tactile::SimdLevel level : levels) {
+            const tactile::BatchKernels kernels(level);
+            const char* levelName = tactile::simdLevelName(level);
+            const tactile::BatchView now = batch.view(1);
+            const tactile::BatchView before = batch.view(0, rows - 1);
+
+            double seconds = timeSeconds(passes, [&] { kernels.positionDeltaNorms(now, before, out.data()); });
+            double worst = 0;
+            for (size_t i = 0; i + 1 < rows; i++) {
+                worst = std::max(worst, std::fabs(out[i] - distanceRef[i]));
+            }
+            printRow(name, "position delta", levelName, deltas, seconds, worst, false);
+
+            seconds = timeSeconds(passes, [&] { kernels.deltaAngles(now, before, out.data()); });
+            worst = 0;
+            for (size_t i = 0; i + 1 < rows; i++) {
+                worst = std::max(worst, std::fabs(out[i] - angleRef[i]));
+            }
+            printRow(name, "delta angle", levelName, deltas, seconds, worst, false);
+
+            seconds = timeSeconds(passes, [&] { kernels.forceAbove(batch.view(), forceThreshold, mask.data()); });
+            size_t differ = 0;
+            for (size_t i = 0; i < rows; i++) {
+                differ += mask[i] != forceRef[i];
+            }
+            printRow(name, "force threshold", levelName, all, seconds, double(differ), true);
+
+            seconds = timeSeconds(passes, [&] {
+                kernels.deadbandExceeds(now, before, tactile::DeadbandMode::Weber, config, mask.data());
+            });
+            differ = 0;
+            for (size_t i = 0; i + 1 < rows; i++) {
+                differ += mask[i] != weberRef[i];
+            }
+            printRow(name, "weber decision", levelName, deltas, seconds, double(differ), true);
+
+            // The recorded quaternions are rounded, so this is real work;
+            // after the first pass they stay at unit length
+            tactile::SampleBatch work(rows);
+            for (size_t i = 0; i < rows; i++) {
+                work.push(samples[i]);
+            }
+            kernels.normalizeQuaternions(work);
+            worst = 0;
+            for (size_t i = 0; i < rows; i++) {
+                float q[4];
+                std::copy(samples[i].payload.orientation, samples[i].payload.orientation + 4, q);
+                tactile::normalizeQuaternion(q);
+                for (int k = 0; k < 4; k++) {
+                    worst = std::max(worst, std::fabs(double(work.orientation[k][i]) - q[k]));
+                }
+            }
+            seconds = timeSeconds(passes, [&] { kernels.normalizeQuaternions(work); });
+            printRow(name, "normalize", levelName, all, seconds, worst, false);
+        }
+
+        // Many sessions: lane s replays the table from row s * rows / sessions
+        std::vector<uint8_t> expected(rows * sessions);
+        std::vector<tactile::DeadbandCodec> codecs(sessions, tactile::DeadbandCodec(tactile::DeadbandMode::Weber, config));
+        double seconds = timeSeconds(1, [&] {
+            for (size_t step = 0; step < rows; step++) {
+                for (size_t s = 0; s < sessions; s++) {
+                    expected[step * sessions + s] = codecs[s].offer(samples[(s * rows / sessions + step) % rows]);
+                }
+            }
+        });
+        printRow(name, "sessions weber", "codec", double(rows * sessions), seconds, 0, true);
+        tactile::SampleBatch current(sessions);
+        std::vector<uint8_t> send(current.capacity());
+        for (tactile::SimdLevel level : levels) {
+            tactile::BatchDeadband deadband(sessions, tactile::DeadbandMode::Weber, config, level);
+            size_t differ = 0;
+            seconds = timeSeconds(1, [&] {
+                for (size_t step = 0; step < rows; step++) {
+                    current.clear();
+                    for (size_t s = 0; s < sessions; s++) {
+                        current.push(samples[(s * rows / sessions + step) % rows]);
+                    }
+                    deadband.decide(current, send.data());
+                    for (size_t s = 0; s < sessions; s++) {
+                        differ += send[s] != expected[step * sessions + s];
+                    }
+                }
+            });
+            printRow(name, "sessions weber", tactile::simdLevelName(level), double(rows * sessions), seconds,
+                     double(differ), true);
+        }
+    }
+    std::cout << "Error: largest difference from double precision (rad or trace units), or decisions "
+                 "that differ; codec = one DeadbandCodec per session" << std::endl;
+    return 0;
+}
@@ -0,0 +1,256 @@
+// Turns a stream_recorder capture back into a SimData run directory, so
+// sim_replay (or trace_convert) can replay the incident in the lab.
+//
+//   capture_export --capture capture [--out ../SimData/incident01]
+//                  [--time arrival|sent]
+//                  [--names "Left Controller,Right Controller"]
+//
+// Without --out it only describes the capture. Every stream becomes
+// <out>/<stream name>.csv with the columns its messages carried:
+//
+//   text rows       written as received, without the "#<seq>" suffix; the
+//                   header follows the field count (tactile.csv, poses.csv,
+//                   video.csv or timestamp,x,y,z)
+//   binary haptic   tactile.csv columns, or poses.csv for a stream named
+//                   poses; collider and material are "none"
+//
+// --time arrival (the default) replaces the timestamp with the arrival time
+// relative to the first message of the capture, which is what the
+// recorder's host actually saw; --time sent keeps the publisher's stamp.
+// Empty tactile/poses/video files are added for sources the capture lacks.
+// The binary format only carries a hash of the hand name, so hands are
+// looked up among --names and show up as "Stream <id>" otherwise.
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "capture_log.hpp"
+#include "columnar_trace.hpp"
+#include "haptic_wire.hpp"
+#include "options.hpp"
+#include "text_fields.hpp"
+
+namespace {
+
+const char* tactileHeader =
+    "timestamp_s,hand_id,collider_name,contact_x,contact_y,contact_z,normal_x,normal_y,normal_z,force_N,material";
+const char* posesHeader = "timestamp_s,controller_id,pos_x,pos_y,pos_z,rot_x,rot_y,rot_z,rot_w";
+
+// Header for a text row with `fields` fields, or nullptr if no SimData file has that shape
+const char* textHeader(size_t fields) {
+    switch (fields) {
+        case 11: return tactileHeader;
+        case 9: return posesHeader;
+        case 4: return "timestamp_s,x,y,z";
+        case 2: return "timestamp_s,bytes_this_frame";
+        default: return nullptr;
+    }
+}
+
+const char* sourceHeader(tactile::TraceSource source) {
+    switch (source) {
+        case tactile::TraceSource::Tactile: return tactileHeader;
+        case tactile::TraceSource::Poses: return posesHeader;
+        case tactile::TraceSource::Video: return textHeader(2);
+    }
+    return "";
+}
+
+size_t countFields(std::string_view row) {
+    size_t fields = 0;
+    std::string_view field;
+    while (tactile::nextField(row, field)) {
+        fields++;
+    }
+    return fields;
+}
+
+struct StreamOutput {
+    std::ofstream file;
+    const char* header = nullptr;  // set by the first row, which fixes the layout
+    uint64_t rows = 0;
+    uint64_t skipped = 0;          // did not match the first row's layout
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    const std::string captureDir = opts.get("--capture", "capture");
+    const std::string outDir = opts.get("--out", "");
+    const std::string timeMode = opts.get("--time", "arrival");
+    if (timeMode != "arrival" && timeMode != "sent") {
+        std::cerr << "Unknown --time (use arrival or sent)" << std::endl;
+        return 1;
+    }
+    const bool arrivalTime = timeMode == "arrival";
+
+    std::unordered_map<uint16_t, std::string> handNames;
+    {
+        std::stringstream in(opts.get("--names", "Left Controller,Right Controller"));
+        std::string name;
+        while (std::getline(in, name, ',')) {
+            handNames[tactile::streamIdFromName(name)] = name;
+        }
+    }
+
+    tactile::CaptureReader capture;
+    std::string error;
+    if (!capture.open(captureDir, error)) {
+        std::cerr << "Cannot read capture: " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Capture " << captureDir << ": " << capture.recordCount() << " messages in "
+              << capture.blockCount() << " blocks (" << capture.indexedBlocks() << " indexed, "
+              << capture.recoveredBlocks() << " recovered), clock " << capture.clock() << std::endl;
+    for (size_t i = 0; i < capture.streams().size(); i++) {
+        std::cout << "  " << i << " " << capture.streams()[i].name << " <- " << capture.streams()[i].endpoint << std::endl;
+    }
+    if (outDir.empty()) {
+        return 0;
+    }
+    if (::mkdir(outDir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Cannot create " << outDir << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<StreamOutput>> outputs;
+    for (size_t i = 0; i < capture.streams().size(); i++) {
+        outputs.push_back(std::make_unique<StreamOutput>());
+    }
+    int64_t originNs = 0;
+    bool haveOrigin = false;
+    uint64_t unknownStream = 0;
+    tactile::HapticSample sample;
+    char row[1024];
+
+    capture.forEach([&](const tactile::CaptureRecord& r) {
+        if (r.stream >= outputs.size()) {
+            unknownStream++;
+            return;
+        }
+        if (!haveOrigin) {
+            originNs = r.arrivalNs;
+            haveOrigin = true;
+        }
+        const tactile::CaptureStream& stream = capture.streams()[r.stream];
+        StreamOutput& out = *outputs[r.stream];
+        const double arrivalS = (r.arrivalNs - originNs) / 1e9;
+
+        const char* header;
+        int n;
+        if (tactile::isBinaryMessage(r.data.data(), r.data.size())) {
+            if (!tactile::decodeHapticBinary(r.data.data(), r.data.size(), sample)) {
+                out.skipped++;
+                return;
+            }
+            const auto name = handNames.find(sample.header.streamId);
+            const std::string hand = name != handNames.end()
+                ? name->second : "Stream " + std::to_string(sample.header.streamId);
+            const double t = arrivalTime ? arrivalS : sample.header.timestampNs / 1e9;
+            const tactile::HapticPayload& p = sample.payload;
+            if (stream.name == "poses") {
+                header = posesHeader;
+                n = std::snprintf(row, sizeof(row), "%.9f,%s,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f",
+                                  t, hand.c_str(), p.position[0], p.position[1], p.position[2],
+                                  p.orientation[0], p.orientation[1], p.orientation[2], p.orientation[3]);
+            } else {
+                header = tactileHeader;
+                n = std::snprintf(row, sizeof(row), "%.9f,%s,none,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,none",
+                                  t, hand.c_str(), p.position[0], p.position[1], p.position[2],
+                                  p.normal[0], p.normal[1], p.normal[2], p.forceN);
+            }
+        } else {
+            std::string_view text = r.data;
+            uint64_t seq;
+            tactile::splitTextSequence(text, seq);
+            header = textHeader(countFields(text));
+            if (header == nullptr) {
+                out.skipped++;
+                return;
+            }
+            if (arrivalTime) {
+                const size_t comma = text.find(',');
+                const std::string_view rest = comma == std::string_view::npos ? std::string_view() : text.substr(comma);
+                n = std::snprintf(row, sizeof(row), "%.9f%.*s", arrivalS, int(rest.size()), rest.data());
+            } else {
+                n = std::snprintf(row, sizeof(row), "%.*s", int(text.size()), text.data());
+            }
+        }
+        if (n < 0 || size_t(n) >= sizeof(row)) {
+            out.skipped++;
+            return;
+        }
+        if (out.header == nullptr) {
+            out.header = header;
+            out.file.open(outDir + "/" + stream.name + ".csv");
+            out.file << header << "\n";
+        } else if (header != out.header) {
+            out.skipped++;
+            return;
+        }
+        out.file.write(row, n);
+        out.file.put('\n');
+        out.rows++;
+    });
+
+    bool ok = true;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        StreamOutput& out = *outputs[i];
+        const std::string path = outDir + "/" + capture.streams()[i].name + ".csv";
+        if (out.header == nullptr) {
+            std::cout << "  " << capture.streams()[i].name << ": no messages, nothing written" << std::endl;
+            continue;
+        }
+        out.file.close();
+        if (!out.file) {
+            std::cerr << "Cannot write " << path << std::endl;
+            ok = false;
+            continue;
+        }
+        std::cout << "  " << path << ": " << out.rows << " rows";
+        if (out.skipped) {
+            std::cout << ", " << out.skipped << " messages skipped (unrecognised or a different layout)";
+        }
+        std::cout << std::endl;
+    }
+    if (capture.damagedBlocks() || unknownStream) {
+        std::cout << capture.damagedBlocks() << " damaged blocks and " << unknownStream
+                  << " records of unknown streams skipped" << std::endl;
+    }
+    if (!ok) {
+        return 1;
+    }
+    // A run has all three files; the ones nothing was recorded for stay empty
+    for (int i = 0; i < tactile::traceSourceCount; i++) {
+        const char* name = tactile::traceSourceName(static_cast<tactile::TraceSource>(i));
+        const std::string path = outDir + "/" + name + ".csv";
+        bool recorded = false;
+        for (size_t s = 0; s < outputs.size(); s++) {
+            recorded = recorded || (outputs[s]->header && capture.streams()[s].name == name);
+        }
+        if (!recorded) {
+            std::ofstream(path) << sourceHeader(static_cast<tactile::TraceSource>(i)) << "\n";
+        }
+    }
+
+    // Make sure the result loads the way sim_replay will load it
+    tactile::TraceReader trace;
+    if (!trace.open(outDir, error)) {
+        std::cerr << "Exported run does not load: " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << outDir << ": " << trace.eventCount() << " events over "
+              << trace.durationNs() / 1e9 << " s" << std::endl;
+    return 0;
+}
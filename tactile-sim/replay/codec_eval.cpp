@@ -0,0 +1,162 @@
+// Runs every dead-band mode over the haptic tables of a trace and reports
+// packet reduction and reconstruction error, without any networking.
+//
+//   codec_eval [--run ../SimData/run01 | --run run01.tct] [--deadband-k 0.1] ...
+//              [--batch [--simd scalar|sse|avx2]]
+//
+// Accepts the same dead-band options as haptic_tx. With --batch the
+// absolute and weber modes run every table at once through BatchDeadband
+// (sample_batch.hpp), one lane per table, the way a relay serving many
+// sessions would; decisions are made in single precision, so a sample
+// right at the edge of the dead-band can go the other way.
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "columnar_trace.hpp"
+#include "deadband.hpp"
+#include "options.hpp"
+#include "sample_batch.hpp"
+
+namespace {
+
+// Runs all tables together, one lane each; a table that has ended keeps
+// offering its last row, which is not counted.
+std::vector<tactile::DeadbandStats> runBatch(const std::vector<std::vector<tactile::HapticSample>>& tables,
+                                             tactile::DeadbandMode mode, const tactile::DeadbandConfig& config,
+                                             tactile::SimdLevel level) {
+    const size_t lanes = tables.size();
+    size_t rows = 0;
+    for (const auto& samples : tables) {
+        rows = std::max(rows, samples.size());
+    }
+    tactile::BatchDeadband deadband(lanes, mode, config, level);
+    tactile::SampleBatch current(lanes);
+    std::vector<uint8_t> send(current.capacity());
+    std::vector<tactile::HapticPayload> shown(lanes);
+    std::vector<tactile::DeadbandStats> stats(lanes);
+    for (size_t row = 0; row < rows; row++) {
+        current.clear();
+        for (const auto& samples : tables) {
+            current.push(samples[std::min(row, samples.size() - 1)]);
+        }
+        deadband.decide(current, send.data());
+        for (size_t lane = 0; lane < lanes; lane++) {
+            if (row >= tables[lane].size()) {
+                continue;
+            }
+            const tactile::HapticPayload& actual = tables[lane][row].payload;
+            if (send[lane]) {
+                shown[lane] = actual;
+                stats[lane].sent++;
+            }
+            stats[lane].inputs++;
+            stats[lane].add(actual, shown[lane]);
+        }
+    }
+    return stats;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    const std::string runDir = opts.get("--run", "../SimData/run01");
+    const tactile::DeadbandConfig config = tactile::deadbandConfigFromOptions(opts);
+    const bool batch = opts.has("--batch");
+    tactile::SimdLevel level = tactile::supportedSimdLevel();
+    if (opts.has("--simd") && !tactile::parseSimdLevel(opts.get("--simd", ""), level)) {
+        std::cerr << "Unknown --simd level (use scalar, sse or avx2)" << std::endl;
+        return 1;
+    }
+
+    tactile::TraceReader trace;
+    std::string error;
+    if (!trace.open(runDir, error)) {
+        std::cerr << "Cannot load " << runDir << ": " << error << std::endl;
+        return 1;
+    }
+
+    const tactile::DeadbandMode modes[] = {
+        tactile::DeadbandMode::Off,
+        tactile::DeadbandMode::Absolute,
+        tactile::DeadbandMode::Weber,
+        tactile::DeadbandMode::Predictive,
+    };
+
+    // Every usable table, decoded once
+    std::vector<std::string> names;
+    std::vector<std::vector<tactile::HapticSample>> tables;
+    for (size_t t = 0; t < trace.tableCount(); t++) {
+        tactile::TraceTable table = trace.table(t);
+        tactile::HapticColumns columns(table);
+        if (!columns.usable() || table.rows() == 0) {
+            continue;
+        }
+        std::vector<tactile::HapticSample> samples(table.rows());
+        for (size_t row = 0; row < table.rows(); row++) {
+            tactile::fillHapticSample(table, columns, row, samples[row]);
+        }
+        names.emplace_back(table.name());
+        tables.push_back(std::move(samples));
+    }
+
+    // results[mode][table]
+    std::vector<std::vector<tactile::DeadbandStats>> results;
+    for (tactile::DeadbandMode mode : modes) {
+        if (batch && (mode == tactile::DeadbandMode::Absolute || mode == tactile::DeadbandMode::Weber)) {
+            results.push_back(runBatch(tables, mode, config, level));
+            continue;
+        }
+        results.emplace_back();
+        for (const auto& samples : tables) {
+            tactile::DeadbandCodec codec(mode, config);
+            for (const tactile::HapticSample& sample : samples) {
+                codec.offer(sample);
+            }
+            results.back().push_back(codec.stats());
+        }
+    }
+
+    if (batch) {
+        std::cout << "Absolute and weber through BatchDeadband, " << tables.size() << " lanes, "
+                  << tactile::simdLevelName(tactile::BatchKernels(level).level()) << std::endl;
+    }
+    std::cout << std::setw(10) << "Table"
+              << std::setw(12) << "Mode"
+              << std::setw(8) << "Sent"
+              << std::setw(8) << "Saved"
+              << std::setw(10) << "Pos.rms"
+              << std::setw(10) << "Pos.max"
+              << std::setw(10) << "Ang.rms"
+              << std::setw(10) << "Ang.max"
+              << std::setw(10) << "F.rms"
+              << std::setw(10) << "F.max"
+              << std::endl;
+    std::cout << std::fixed;
+
+    for (size_t t = 0; t < tables.size(); t++) {
+        for (size_t m = 0; m < results.size(); m++) {
+            const tactile::DeadbandStats& s = results[m][t];
+            const double toDeg = 180.0 / 3.14159265358979323846;
+            std::cout << std::setw(10) << names[t]
+                      << std::setw(12) << tactile::deadbandModeName(modes[m])
+                      << std::setw(8) << s.sent
+                      << std::setw(7) << std::setprecision(1) << s.reductionRatio() * 100 << "%"
+                      << std::setprecision(4)
+                      << std::setw(10) << s.positionRms()
+                      << std::setw(10) << s.positionMax
+                      << std::setprecision(2)
+                      << std::setw(10) << s.orientationRms() * toDeg
+                      << std::setw(10) << s.orientationMax * toDeg
+                      << std::setprecision(3)
+                      << std::setw(10) << s.forceRms()
+                      << std::setw(10) << s.forceMax
+                      << std::endl;
+        }
+    }
+    std::cout << "(angles in degrees)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Runs ContactCodec (contact_codec.hpp) over the tactile table of a trace
+// and reports what it would send: messages by kind, bytes against sending
+// every sample, contact episodes, the onset latency and the force the
+// receiver shows, next to the weber dead-band for reference.
+//
+//   contact_eval [--run ../SimData/run01 | --run run01.tct]
+//                [--onset-force 1] [--release-force 0.5]
+//                [--release-hold-ms 50] [--heartbeat-ms 100]
+//                [--keyframe-ms 1000] [--events] [--deadband-k 0.1] ...
+//
+// Every hand_id is its own stream with its own codec, as in the relay.
+// The "collider" rows segment on collider_name and force, the way a text
+// stream can; the "force" rows see force_N only, like binary input.
+// --events prints every onset, release and collider change.
+//
+// Each message is encoded as the relay sends it (encodeContact) and decoded
+// by a ContactDecoder: the byte counts are the encoded sizes and the force
+// error is measured on the samples the decoder rebuilds.
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "columnar_trace.hpp"
+#include "contact_codec.hpp"
+#include "deadband.hpp"
+#include "options.hpp"
+
+namespace {
+
+// One hand_id through the codec, the wire and the receiver
+struct ContactStream {
+    explicit ContactStream(const tactile::ContactConfig& config) : codec(config) {}
+
+    tactile::ContactCodec codec;
+    uint64_t seq = 0;              // numbered like the relay's output
+    tactile::HapticSample held{};  // what the receiver shows
+};
+
+void printRow(const std::string& table, const char* input, const tactile::ContactStats& s) {
+    std::cout << std::setw(9) << table
+              << std::setw(10) << input
+              << std::setw(8) << s.inputs
+              << std::setw(7) << std::setprecision(1) << (s.inputs ? 100.0 * s.contactSamples / s.inputs : 0.0) << "%"
+              << std::setw(8) << s.keyframes
+              << std::setw(8) << s.heartbeats
+              << std::setw(8) << s.deltas
+              << std::setw(10) << std::setprecision(1) << s.sentBytes / 1024.0
+              << std::setw(7) << std::setprecision(2) << s.compressionRatio() << "x"
+              << std::setw(8) << s.onsets
+              << std::setw(9) << std::setprecision(2) << s.onsetLatencyMeanNs() / 1e6
+              << std::setw(9) << s.onsetLatencyMaxNs / 1e6
+              << std::setprecision(3)
+              << std::setw(10) << s.error.forceRms()
+              << std::setw(10) << s.error.forceMax
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    const std::string runDir = opts.get("--run", "../SimData/run01");
+    const bool printEvents = opts.has("--events");
+    tactile::ContactConfig config;
+    if (!tactile::contactConfigFromOptions(opts, config)) {
+        return 1;
+    }
+    const tactile::DeadbandConfig deadband = tactile::deadbandConfigFromOptions(opts);
+
+    tactile::TraceReader trace;
+    std::string error;
+    if (!trace.open(runDir, error)) {
+        std::cerr << "Cannot load " << runDir << ": " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Contact codec on " << runDir << ": onset above " << config.onsetForceN << " N, release under "
+              << config.releaseForceN << " N for " << config.releaseHoldNs / 1e6 << " ms, heartbeat "
+              << config.heartbeatNs / 1e6 << " ms, keyframe " << config.keyframeNs / 1e6 << " ms" << std::endl;
+    std::cout << std::setw(9) << "Table"
+              << std::setw(10) << "Input"
+              << std::setw(8) << "Samples"
+              << std::setw(8) << "Contact"
+              << std::setw(8) << "Keyfr."
+              << std::setw(8) << "Heartb."
+              << std::setw(8) << "Deltas"
+              << std::setw(10) << "KiB"
+              << std::setw(8) << "Ratio"
+              << std::setw(8) << "Onsets"
+              << std::setw(9) << "Lat.ms"
+              << std::setw(9) << "Lat.max"
+              << std::setw(10) << "F.rms"
+              << std::setw(10) << "F.max"
+              << std::endl;
+    std::cout << std::fixed;
+
+    tactile::HapticSample sample;
+    for (size_t t = 0; t < trace.tableCount(); t++) {
+        const tactile::TraceTable table = trace.table(t);
+        const tactile::HapticColumns columns(table);
+        if (!columns.usable() || columns.force < 0) {
+            continue;
+        }
+        const std::string name(table.name());
+        const int colliderColumn = table.find("collider_name");
+        const bool haveColliders = colliderColumn >= 0 &&
+            table.column(colliderColumn).type() == tactile::ColumnType::Dict;
+
+        for (bool useColliders : { true, false }) {
+            if (useColliders && !haveColliders) {
+                continue;
+            }
+            std::map<uint16_t, ContactStream> streams;
+            tactile::ContactDecoder decoder;
+            tactile::DeadbandStats received;
+            uint64_t wireBytes = 0, mismatches = 0;
+            char frame[128];
+            for (size_t row = 0; row < table.rows(); row++) {
+                tactile::fillHapticSample(table, columns, row, sample);
+                int collider = tactile::contactColliderUnknown;
+                if (useColliders) {
+                    const tactile::TraceColumn column = table.column(colliderColumn);
+                    collider = column.string(row) == "none" ? tactile::contactColliderNone
+                                                            : int(column.data<uint32_t>()[row]) + 1;
+                }
+                ContactStream& stream = streams.try_emplace(sample.header.streamId, config).first->second;
+                const tactile::ContactDecision d = stream.codec.offer(sample, collider);
+                if (d.message != tactile::ContactMessage::Skip) {
+                    tactile::HapticSample message = sample;
+                    message.header.seq = stream.seq++;
+                    const size_t len = tactile::encodeContact(message, d, frame, sizeof(frame));
+                    const tactile::ContactReceived got = decoder.decode(frame, len, stream.held);
+                    const tactile::ContactReceived expected =
+                        d.message == tactile::ContactMessage::Keyframe ? tactile::ContactReceived::Sample
+                        : d.message == tactile::ContactMessage::Delta ? tactile::ContactReceived::Delta
+                                                                      : tactile::ContactReceived::Heartbeat;
+                    mismatches += got != expected || len != d.bytes;
+                    wireBytes += len;
+                    received.sent += got == tactile::ContactReceived::Sample || got == tactile::ContactReceived::Delta;
+                }
+                received.inputs++;
+                received.add(sample.payload, stream.held.payload);
+                if (printEvents && useColliders &&
+                    (d.event == tactile::ContactEvent::Onset || d.event == tactile::ContactEvent::Release ||
+                     (d.event == tactile::ContactEvent::Sustain && d.message == tactile::ContactMessage::Keyframe))) {
+                    std::cout << "  " << std::setprecision(4) << sample.header.timestampNs / 1e9 << " s  stream "
+                              << sample.header.streamId << "  "
+                              << (d.event == tactile::ContactEvent::Sustain ? "collider" : tactile::contactEventName(d.event))
+                              << "  " << table.column(colliderColumn).string(row)
+                              << "  " << std::setprecision(3) << sample.payload.forceN << " N" << std::endl;
+                }
+            }
+            tactile::ContactStats total;
+            for (const auto& entry : streams) {
+                const tactile::ContactStats& s = entry.second.codec.stats();
+                total.inputs += s.inputs;
+                total.contactSamples += s.contactSamples;
+                total.keyframes += s.keyframes;
+                total.heartbeats += s.heartbeats;
+                total.deltas += s.deltas;
+                total.inputBytes += s.inputBytes;
+                total.onsets += s.onsets;
+                total.releases += s.releases;
+                total.colliderChanges += s.colliderChanges;
+                total.onsetLatencySumNs += s.onsetLatencySumNs;
+                total.onsetLatencyMaxNs = std::max(total.onsetLatencyMaxNs, s.onsetLatencyMaxNs);
+            }
+            // What actually crossed the wire and what the receiver rebuilt
+            total.sentBytes = wireBytes;
+            total.error = received;
+            printRow(name, useColliders ? "collider" : "force", total);
+            if (mismatches) {
+                std::cout << std::setw(19) << "" << "WARNING: " << mismatches
+                          << " messages did not decode as encoded" << std::endl;
+            }
+            if (total.releases || total.colliderChanges) {
+                std::cout << std::setw(19) << "" << total.releases << " releases, " << total.colliderChanges
+                          << " collider changes" << std::endl;
+            }
+        }
+
+        // The weber dead-band sends full samples, which is what the ratio compares to
+        std::map<uint16_t, tactile::DeadbandCodec> weber;
+        for (size_t row = 0; row < table.rows(); row++) {
+            tactile::fillHapticSample(table, columns, row, sample);
+            weber.try_emplace(sample.header.streamId, tactile::DeadbandMode::Weber, deadband).first->second.offer(sample);
+        }
+        uint64_t inputs = 0, sent = 0;
+        double forceSq = 0, forceMax = 0;
+        for (const auto& entry : weber) {
+            const tactile::DeadbandStats& s = entry.second.stats();
+            inputs += s.inputs;
+            sent += s.sent;
+            forceSq += s.forceSq;
+            forceMax = std::max(forceMax, s.forceMax);
+        }
+        std::cout << std::setw(9) << name
+                  << std::setw(10) << "weber"
+                  << std::setw(8) << inputs
+                  << std::setw(8) << "-"
+                  << std::setw(8) << sent
+                  << std::setw(8) << 0
+                  << std::setw(8) << 0
+                  << std::setw(10) << std::setprecision(1) << sent * tactile::hapticWireSize / 1024.0
+                  << std::setw(7) << std::setprecision(2) << (sent ? double(inputs) / double(sent) : 0.0) << "x"
+                  << std::setw(8) << "-"
+                  << std::setw(9) << "-"
+                  << std::setw(9) << "-"
+                  << std::setprecision(3)
+                  << std::setw(10) << (inputs ? std::sqrt(forceSq / inputs) : 0.0)
+                  << std::setw(10) << forceMax
+                  << std::endl;
+    }
+    std::cout << "Ratio: bytes of every sample as a full message over bytes sent; Lat: first sample of a "
+                 "contact (collider named or force > 0) to its onset keyframe" << std::endl;
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Throughput of the sharded haptic relay pipeline, without any networking:
+// one dispatch thread routes pre-encoded samples of many sessions to 1..N
+// workers exactly as haptic_tx does, and each worker runs the dead-band codec
+// and re-encodes what it forwards.
+//
+//   relay_bench [--sessions 64] [--messages 4000000] [--max-workers N]
+//               [--codec weber] [--worker-cpu C] [--deadband-k 0.1] ...
+//
+// Reports messages per second for every worker count (powers of two up to
+// --max-workers, default the number of cores) and the speedup over one
+// worker. The dispatcher only reads the session key and copies the message,
+// so it is the ceiling on how far the workers can scale.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deadband.hpp"
+#include "haptic_relay.hpp"
+#include "haptic_wire.hpp"
+#include "options.hpp"
+#include "receive_engine.hpp"
+
+// Samples per session in the pre-encoded pool; sessions wrap around after it
+constexpr size_t samplesPerSession = 1024;
+
+// A hand moving on a slow Lissajous path, pressing intermittently
+static void synthesize(uint16_t session, size_t i, tactile::HapticSample& s) {
+    s = tactile::makeHapticSample();
+    s.header.streamId = session;
+    s.header.seq = i;
+    s.header.timestampNs = static_cast<int64_t>(i) * 1000000;  // 1 kHz
+    double t = i * 0.001 + session * 0.37;
+    s.payload.position[0] = static_cast<float>(0.3 * std::sin(1.3 * t));
+    s.payload.position[1] = static_cast<float>(1.1 + 0.1 * std::sin(0.7 * t));
+    s.payload.position[2] = static_cast<float>(0.4 + 0.2 * std::cos(0.9 * t));
+    double half = 0.25 * std::sin(0.5 * t);
+    s.payload.orientation[1] = static_cast<float>(std::sin(half));
+    s.payload.orientation[3] = static_cast<float>(std::cos(half));
+    s.payload.forceN = static_cast<float>(std::max(0.0, 4.0 * std::sin(2.1 * t)));
+}
+
+struct RunResult {
+    double seconds;
+    uint64_t forwarded;
+    uint64_t stalls;
+};
+
+static RunResult runPipeline(const std::vector<char>& pool, size_t messages, size_t workerCount,
+                             tactile::DeadbandMode mode, const tactile::DeadbandConfig& config, long workerCpu) {
+    std::vector<std::unique_ptr<tactile::RelayWorker>> workers;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.push_back(std::make_unique<tactile::RelayWorker>(mode, config, tactile::WireFormat::Binary));
+    }
+
+    std::atomic<bool> dispatching{true};
+    std::atomic<size_t> ready{0};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workerCount; i++) {
+        threads.emplace_back([&, i] {
+            if (workerCpu >= 0) {
+                tactile::pinCurrentThread(static_cast<int>(workerCpu + i));
+            }
+            // Forwarded messages are already encoded; a real worker would send them here
+            auto discard = [](const tactile::HapticSample&, const char*, size_t, const tactile::RelayMessage&) {};
+            ready.fetch_add(1);
+            while (true) {
+                bool last = !dispatching.load(std::memory_order_acquire);
+                if (workers[i]->drain(discard) == 0) {
+                    if (last) {
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    while (ready.load() != workerCount) {
+        std::this_thread::yield();
+    }
+
+    const size_t poolMessages = pool.size() / tactile::hapticWireSize;
+    const tactile::HopTrail noHops{};
+    tactile::RelayMessage staging;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t m = 0; m < messages; m++) {
+        const char* data = pool.data() + (m % poolMessages) * tactile::hapticWireSize;
+        uint16_t session = 0;
+        tactile::sessionKey(data, tactile::hapticWireSize, session);  // always binary here
+        staging.assign(data, tactile::hapticWireSize, noHops, 0);
+        workers[tactile::shardOf(session, workerCount)]->push(staging);
+    }
+    dispatching.store(false, std::memory_order_release);
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    RunResult result{ std::chrono::duration<double>(end - start).count(), 0, 0 };
+    for (const auto& w : workers) {
+        result.forwarded += w->forwarded();
+        result.stalls += w->stalls();
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    const long sessions = opts.getInt("--sessions", 64);
+    const long messages = opts.getInt("--messages", 4000000);
+    const long cores = std::max(1u, std::thread::hardware_concurrency());
+    const long maxWorkers = opts.getInt("--max-workers", cores);
+    const long workerCpu = opts.getInt("--worker-cpu", -1);
+    if (sessions < 1 || sessions > 65536 || messages < 1 || maxWorkers < 1) {
+        std::cerr << "--sessions (1-65536), --messages and --max-workers must be positive" << std::endl;
+        return 1;
+    }
+    tactile::DeadbandMode mode;
+    if (!tactile::parseDeadbandMode(opts.get("--codec", "weber"), mode)) {
+        std::cerr << "Unknown --codec (use off, absolute, weber or predictive)" << std::endl;
+        return 1;
+    }
+    const tactile::DeadbandConfig config = tactile::deadbandConfigFromOptions(opts);
+
+    // Sessions interleaved sample by sample, as many hands would arrive
+    std::vector<char> pool(sessions * samplesPerSession * tactile::hapticWireSize);
+    tactile::HapticSample sample;
+    for (size_t i = 0; i < samplesPerSession; i++) {
+        for (long s = 0; s < sessions; s++) {
+            synthesize(static_cast<uint16_t>(s), i, sample);
+            tactile::encodeHaptic(sample, pool.data() + (i * sessions + s) * tactile::hapticWireSize,
+                                  tactile::hapticWireSize);
+        }
+    }
+
+    std::vector<long> counts;
+    for (long w = 1; w < maxWorkers; w *= 2) {
+        counts.push_back(w);
+    }
+    counts.push_back(maxWorkers);
+
+    std::cout << sessions << " sessions, " << messages << " messages per run, "
+              << tactile::deadbandModeName(mode) << " dead-band, " << cores << " cores" << std::endl;
+    if (maxWorkers >= cores) {
+        std::cout << "(the dispatch thread shares the cores with the workers)" << std::endl;
+    }
+    std::cout << std::setw(8) << "Workers"
+              << std::setw(14) << "Msg/s"
+              << std::setw(10) << "Speedup"
+              << std::setw(12) << "Efficiency"
+              << std::setw(10) << "Sent"
+              << std::setw(10) << "Stalls"
+              << std::endl;
+    std::cout << std::fixed;
+
+    double baseline = 0;
+    for (long w : counts) {
+        RunResult r = runPipeline(pool, messages, w, mode, config, workerCpu);
+        double rate = messages / r.seconds;
+        if (baseline == 0) {
+            baseline = rate;
+        }
+        std::cout << std::setw(8) << w
+                  << std::setw(14) << std::setprecision(0) << rate
+                  << std::setw(9) << std::setprecision(2) << rate / baseline << "x"
+                  << std::setw(11) << std::setprecision(1) << 100.0 * rate / baseline / w << "%"
+                  << std::setw(9) << std::setprecision(1) << 100.0 * r.forwarded / messages << "%"
+                  << std::setw(10) << r.stalls
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,269 @@
+// Replays a SimData run over ZMQ at high rate with absolute-deadline pacing.
+//
+//   sim_replay [--run ../SimData/run01 | --run run01.tct]
+//              [--sources tactile,poses,video]
+//              [--speed 1 | --speed max | --rate HZ] [--loops N]
+//              [--wire binary|text] [--stamp send|recorded]
+//              [--spin-us 200] [--clock ...] [--epoch process|shared]
+//              [--hop-stamps] [--transport tcp|ipc|shm]
+//              [--impair-<source>-delay-ms 20 --impair-<source>-loss 0.01 ...]
+//
+// The run is loaded through TraceReader: a .tct file from trace_convert is
+// mapped as is, a run directory has its CSVs converted in memory. Its time
+// index merges the three sources into one ordered stream.
+// Tactile rows go to --tactile-bind (tcp://*:5555, where haptic_tx listens),
+// pose rows to --poses-bind (tcp://*:5557) and video rows to --video-bind
+// (tcp://*:5566); "--transport ipc|shm" moves all three to the same ports on
+// that transport (transport.hpp). Event i is due at start + (t_i - t_0) / speed, or at
+// start + i / rate, so a late send never delays the ones after it.
+// Messages are numbered per source and hand; text rows end in "#<seq>".
+// "--hop-stamps" sends a source hop frame (hop_stamps.hpp) behind every
+// message: due time, send start and hand-off to the socket. Only use it
+// when every subscriber reads multipart messages (the C++ tools do).
+// "--impair-<source>-*" puts an impairment stage (impairment.hpp) in front
+// of that source's socket, e.g. --impair-video-rate-mbps 20 caps video at
+// 20 Mbit/s, charging every row its recorded bytes_this_frame.
+#include <zmq.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "clock.hpp"
+#include "columnar_trace.hpp"
+#include "haptic_wire.hpp"
+#include "hdr_histogram.hpp"
+#include "hop_stamps.hpp"
+#include "impairment.hpp"
+#include "options.hpp"
+#include "transport.hpp"
+
+enum class Pacing {
+    Recorded,  // recorded timestamps divided by --speed
+    Max,       // as fast as the sockets take them
+    Rate,      // fixed --rate events per second, ignoring timestamps
+};
+
+// How the rows of one trace table are published
+struct TableRoute {
+    int pub;  // index into the publishers, -1 if the table is not replayed
+    bool haptic;
+    tactile::HapticColumns columns;
+    int bytesColumn;  // bytes_this_frame: what the row stands for on a link, -1 if absent
+};
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    const tactile::Clock clock = tactile::clockFromOptions(opts);
+
+    // Which files to replay
+    unsigned sourceMask = 0;
+    {
+        std::string list = opts.get("--sources", "tactile,poses,video");
+        std::string_view rest = list;
+        std::string_view name;
+        while (tactile::nextField(rest, name)) {
+            tactile::TraceSource source;
+            if (!tactile::parseTraceSource(name, source)) {
+                std::cerr << "Unknown source " << name << " (use tactile, poses, video)" << std::endl;
+                return 1;
+            }
+            sourceMask |= 1u << static_cast<int>(source);
+        }
+    }
+
+    const std::string runDir = opts.get("--run", "../SimData/run01");
+    tactile::TraceReader trace;
+    std::string error;
+    if (!trace.open(runDir, error)) {
+        std::cerr << "Cannot load " << runDir << ": " << error << std::endl;
+        return 1;
+    }
+    if (trace.eventCount() == 0) {
+        std::cerr << "No events in " << runDir << std::endl;
+        return 1;
+    }
+
+    std::vector<TableRoute> routes;
+    for (size_t t = 0; t < trace.tableCount(); t++) {
+        tactile::TraceTable table = trace.table(t);
+        tactile::TraceSource source;
+        bool known = tactile::parseTraceSource(table.name(), source);
+        routes.push_back({ known && (sourceMask & (1u << static_cast<int>(source))) ? static_cast<int>(source) : -1,
+                           known && source != tactile::TraceSource::Video, tactile::HapticColumns(table),
+                           table.find("bytes_this_frame") });
+    }
+
+    Pacing pacing = Pacing::Recorded;
+    double speed = 1.0;
+    double rate = 0.0;
+    if (opts.has("--rate")) {
+        pacing = Pacing::Rate;
+        rate = opts.getDouble("--rate", 0.0);
+    } else if (opts.get("--speed", "1") == "max") {
+        pacing = Pacing::Max;
+    } else {
+        speed = opts.getDouble("--speed", 1.0);
+    }
+    if ((pacing == Pacing::Rate && rate <= 0) || (pacing == Pacing::Recorded && speed <= 0)) {
+        std::cerr << "--speed and --rate must be positive" << std::endl;
+        return 1;
+    }
+
+    const long loops = opts.getInt("--loops", 1);  // 0 = forever
+    const int64_t spinNs = opts.getInt("--spin-us", 200) * 1000;
+    const bool binary = opts.get("--wire", "binary") != "text";
+    const bool stampOnSend = opts.get("--stamp", "send") != "recorded";
+    const bool hopStamps = opts.has("--hop-stamps");
+
+    tactile::Transport transport;
+    if (!tactile::transportFromOptions(opts, transport)) {
+        return 1;
+    }
+
+    zmq::context_t ctx(1);
+    tactile::Publisher pubs[tactile::traceSourceCount] = {
+        tactile::Publisher(ctx),
+        tactile::Publisher(ctx),
+        tactile::Publisher(ctx),
+    };
+    const std::string binds[tactile::traceSourceCount] = {
+        opts.get("--tactile-bind", tactile::bindEndpoint(transport, 5555)),
+        opts.get("--poses-bind", tactile::bindEndpoint(transport, 5557)),
+        opts.get("--video-bind", tactile::bindEndpoint(transport, 5566)),
+    };
+    for (int i = 0; i < tactile::traceSourceCount; i++) {
+        if (!(sourceMask & (1u << i))) {
+            continue;
+        }
+        try {
+            pubs[i].bind(binds[i]);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to bind " << binds[i] << ": " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Replaying " << tactile::traceSourceName(static_cast<tactile::TraceSource>(i))
+                  << " on " << binds[i] << std::endl;
+    }
+
+    // Optional impairment per source; a stage owns its publisher from here on
+    std::unique_ptr<tactile::ImpairmentStage> stages[tactile::traceSourceCount];
+    for (int i = 0; i < tactile::traceSourceCount; i++) {
+        const char* name = tactile::traceSourceName(static_cast<tactile::TraceSource>(i));
+        tactile::ImpairmentConfig impair;
+        if (!tactile::impairmentFromOptions(opts, std::string("--impair-") + name + "-", impair)) {
+            return 1;
+        }
+        if (impair.enabled() && (sourceMask & (1u << i))) {
+            stages[i] = std::make_unique<tactile::ImpairmentStage>(impair, pubs[i], clock);
+            std::cout << "Impairing " << name << ": delay " << impair.delayNs / 1e6 << " ms +- "
+                      << impair.jitterNs / 1e6 << " ms " << tactile::delayDistributionName(impair.distribution)
+                      << ", rate " << impair.rateBps / 1e6 << " Mbit/s (0 = uncapped)" << std::endl;
+        }
+    }
+    std::cout << trace.eventCount() << " events over " << trace.durationNs() / 1e9 << " s, clock "
+              << clock.describe() << ", " << (binary ? "binary" : "text") << " haptic" << std::endl;
+
+    // Give subscribers time to connect before the first event
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // One loop lasts the recorded span plus one average gap, so the last
+    // event of a loop and the first of the next are not sent together
+    const int64_t loopSpanNs = trace.durationNs() + trace.durationNs() / int64_t(trace.eventCount());
+
+    tactile::HdrHistogram lateness;
+    tactile::HapticSample sample;
+    // Next sequence number per source and stream (hand), so receivers can
+    // detect loss on each stream on its own
+    std::vector<uint64_t> seq(tactile::traceSourceCount << 16);
+    uint64_t sent = 0;
+    uint64_t paced = 0;
+    uint64_t malformed = 0;
+    char out[512];
+    tactile::HopTrail trail;
+
+    const int64_t startNs = clock.nowNs();
+    for (long loop = 0; loops == 0 || loop < loops; loop++) {
+        for (size_t i = 0; i < trace.eventCount(); i++) {
+            const tactile::TraceEventRef& ev = trace.event(i);
+            const TableRoute& route = routes[ev.table];
+            if (route.pub < 0) {
+                continue;
+            }
+            const tactile::TraceTable table = trace.table(ev.table);
+            const int64_t recordedNs = table.timeNs(ev.row);
+
+            int64_t dueNs = 0;
+            if (pacing != Pacing::Max) {
+                int64_t offsetNs = (pacing == Pacing::Rate)
+                    ? static_cast<int64_t>(paced * 1e9 / rate)
+                    : static_cast<int64_t>((loop * loopSpanNs + recordedNs - trace.firstNs()) / speed);
+                dueNs = startNs + offsetNs;
+                lateness.record(tactile::waitUntilNs(clock, dueNs, spinNs));
+                paced++;
+            }
+
+            const int64_t beginNs = clock.nowNs();
+            const int64_t stampNs = stampOnSend ? beginNs : recordedNs;
+            const bool haptic = route.haptic && route.columns.usable();
+            uint16_t streamId = 0;
+            if (haptic) {
+                tactile::fillHapticSample(table, route.columns, ev.row, sample);
+                streamId = sample.header.streamId;
+            }
+            uint64_t& nextSeq = seq[(size_t(route.pub) << 16) | streamId];
+            size_t len = 0;
+            if (binary && haptic) {
+                sample.header.timestampNs = stampNs;
+                sample.header.seq = nextSeq;
+                len = tactile::encodeHaptic(sample, out, sizeof(out));
+            } else {
+                len = tactile::formatTraceRow(table, ev.row, out, sizeof(out), stampOnSend ? &stampNs : nullptr);
+                if (len != 0) {
+                    len = tactile::appendTextSequence(out, len, sizeof(out), nextSeq);
+                }
+            }
+            if (len == 0) {
+                malformed++;
+                continue;
+            }
+            if (hopStamps) {
+                trail.clear();
+                trail.add(tactile::makeHopStamp(tactile::HopKind::Source, pacing == Pacing::Max ? beginNs : dueNs,
+                                                beginNs, clock.nowNs()));
+            }
+            if (stages[route.pub]) {
+                const size_t charged = route.bytesColumn >= 0
+                    ? size_t(std::max(0.0, table.column(route.bytesColumn).number(ev.row))) : 0;
+                stages[route.pub]->send(out, len, trail, charged);
+            } else {
+                pubs[route.pub].send(out, len, trail);
+            }
+            nextSeq++;
+            sent++;
+        }
+    }
+    const int64_t elapsedNs = clock.nowNs() - startNs;
+
+    std::cout << "\n=== Replay Summary ===" << std::endl;
+    std::cout << "Sent " << sent << " messages in " << elapsedNs / 1e9 << " s ("
+              << (elapsedNs > 0 ? sent * 1e9 / elapsedNs : 0.0) << " msg/s)" << std::endl;
+    if (malformed) {
+        std::cout << "Skipped " << malformed << " rows that could not be encoded" << std::endl;
+    }
+    if (pacing != Pacing::Max) {
+        tactile::printPercentiles(std::cout, "Send lateness vs deadline", lateness);
+    }
+    for (int i = 0; i < tactile::traceSourceCount; i++) {
+        if (stages[i]) {
+            // Let what is still in flight arrive before the stage stops
+            stages[i]->flush(std::chrono::seconds(5));
+            stages[i]->printStats(std::cout, tactile::traceSourceName(static_cast<tactile::TraceSource>(i)));
+        }
+    }
+    return 0;
+}
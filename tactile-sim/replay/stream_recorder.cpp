@@ -0,0 +1,229 @@
+// Records live streams to disk without losing a message, for replaying an
+// incident later (capture_export turns a capture into a SimData run).
+//
+//   stream_recorder [--streams tactile:5556,video:5566] [--host localhost]
+//                   [--transport tcp|ipc|shm] [--out capture]
+//                   [--duration-s 0] [--segment-mb 256] [--block-kb 1024]
+//                   [--buffers 32] [--flush-ms 200] [--rcvhwm 1000000]
+//                   [--no-direct] [--no-sync] [--clock ...] [--epoch ...]
+//                   [--wait block|spin|adaptive] [--cpu N]
+//
+// --streams names each stream and where it comes from: "name:port" connects
+// to that port on --host over --transport, "name=endpoint" to any endpoint.
+// The name becomes the CSV capture_export writes, so use tactile, poses and
+// video for a replayable run. Up to 8 streams share one receive thread,
+// which stamps every message on arrival and appends it to the capture
+// (capture_log.hpp); a writer thread puts the blocks on disk.
+//
+// A PUB socket drops when a subscriber's queue is full, so the SUB side is
+// given a deep queue (--rcvhwm) to ride out a slow disk; the sequence
+// numbers every publisher adds show anything lost before the recorder.
+// Runs until --duration-s (0 = until SIGINT/SIGTERM) and prints one status
+// line per second.
+#include <zmq.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "capture_log.hpp"
+#include "clock.hpp"
+#include "haptic_wire.hpp"
+#include "metrics_export.hpp"
+#include "options.hpp"
+#include "receive_engine.hpp"
+#include "sequence_tracker.hpp"
+#include "transport.hpp"
+
+namespace {
+
+bool parseStreams(const std::string& text, tactile::Transport transport, const std::string& host,
+                  std::vector<tactile::CaptureStream>& out) {
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        const size_t eq = item.find('=');
+        const size_t colon = item.find(':');
+        tactile::CaptureStream s;
+        if (eq != std::string::npos && eq > 0 && eq + 1 < item.size()) {
+            s.name = item.substr(0, eq);
+            s.endpoint = item.substr(eq + 1);
+        } else if (colon != std::string::npos && colon > 0) {
+            char* end = nullptr;
+            const long port = std::strtol(item.c_str() + colon + 1, &end, 10);
+            if (*end != '\0' || port <= 0 || port > 65535) {
+                std::cerr << "Bad port in --streams entry '" << item << "'" << std::endl;
+                return false;
+            }
+            s.name = item.substr(0, colon);
+            s.endpoint = tactile::connectEndpoint(transport, host, int(port));
+        } else {
+            std::cerr << "Bad --streams entry '" << item << "' (use name:port or name=endpoint)" << std::endl;
+            return false;
+        }
+        if (s.name.find_first_of(" \t/") != std::string::npos) {
+            std::cerr << "Stream name '" << s.name << "' may not contain spaces or slashes" << std::endl;
+            return false;
+        }
+        out.push_back(s);
+    }
+    if (out.empty() || out.size() > tactile::ReceiveEngine::maxSockets) {
+        std::cerr << "--streams takes 1 to " << tactile::ReceiveEngine::maxSockets << " streams" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Sequence number and stream (hand) of a message in either wire format
+bool messageSequence(const tactile::RecvBuffer& buf, tactile::HapticSample& sample,
+                     uint16_t& streamId, uint64_t& seq) {
+    if (tactile::decodeHaptic(buf.data.data(), buf.size, sample)) {
+        streamId = sample.header.streamId;
+        seq = sample.header.seq;
+    } else {
+        std::string_view text = buf.view();
+        streamId = 0;
+        if (!tactile::splitTextSequence(text, seq)) {
+            return false;
+        }
+    }
+    return seq != tactile::noSequence;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    tactile::WaitStrategy waitStrategy;
+    if (!tactile::setupReceiveThread(opts, waitStrategy)) {
+        return 1;
+    }
+    tactile::Transport transport;
+    if (!tactile::transportFromOptions(opts, transport)) {
+        return 1;
+    }
+    // Shared epoch by default, so arrivals line up with the publishers' stamps
+    const tactile::Clock clock = tactile::clockFromOptions(opts, tactile::ClockEpoch::Shared);
+    std::vector<tactile::CaptureStream> streams;
+    if (!parseStreams(opts.get("--streams", "tactile:5556,video:5566"), transport,
+                      opts.get("--host", "localhost"), streams)) {
+        return 1;
+    }
+    tactile::CaptureConfig config;
+    if (!tactile::captureConfigFromOptions(opts, config)) {
+        return 1;
+    }
+    const long durationSec = opts.getInt("--duration-s", 0);
+    const int rcvhwm = int(opts.getInt("--rcvhwm", 1000000));
+
+    zmq::context_t context(1);
+    std::vector<std::unique_ptr<tactile::Subscriber>> subs;
+    for (const tactile::CaptureStream& s : streams) {
+        subs.push_back(std::make_unique<tactile::Subscriber>(context));
+        try {
+            subs.back()->socket().set(zmq::sockopt::rcvhwm, rcvhwm);
+            subs.back()->connect(s.endpoint);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to connect to " << s.name << " on " << s.endpoint << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    tactile::CaptureWriter writer(config);
+    std::string error;
+    if (!writer.open(streams, clock.describe(), error)) {
+        std::cerr << "Cannot start capture: " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Recording " << streams.size() << " stream(s) to " << config.dir << " ("
+              << (writer.directIo() ? "direct I/O" : "buffered I/O") << ", "
+              << config.blockBytes / 1024 << " KiB blocks, " << (config.segmentBytes >> 20)
+              << " MiB segments, clock " << clock.describe() << ")" << std::endl;
+    for (const tactile::CaptureStream& s : streams) {
+        std::cout << "  " << s.name << " <- " << s.endpoint << std::endl;
+    }
+
+    std::vector<uint64_t> received(streams.size());
+    std::vector<tactile::SequenceTrackers> sequences(streams.size());
+    uint64_t unrecorded = 0;
+    tactile::HapticSample sample;
+    tactile::ReceiveEngine engine(waitStrategy);
+    for (size_t i = 0; i < streams.size(); i++) {
+        engine.add(*subs[i], [&, i](const tactile::RecvBuffer& buf) {
+            const int64_t arrivalNs = clock.nowNs();
+            if (!writer.append(uint16_t(i), arrivalNs, buf.data.data(), buf.size, buf.hops, buf.truncated)) {
+                unrecorded++;
+            }
+            received[i]++;
+            uint16_t streamId;
+            uint64_t seq;
+            if (messageSequence(buf, sample, streamId, seq)) {
+                sequences[i].record(streamId, seq);
+            }
+        });
+    }
+
+    tactile::installStopSignals();
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto endTime = durationSec > 0 ? startTime + std::chrono::seconds(durationSec)
+                                         : std::chrono::steady_clock::time_point::max();
+    auto nextReport = startTime + std::chrono::seconds(1);
+    uint64_t lastRecords = 0;
+    while (!tactile::stopRequested() && writer.ok()) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= endTime) {
+            break;
+        }
+        engine.runOnce(std::chrono::milliseconds(20));
+        writer.tick(clock.nowNs());
+        if (std::chrono::steady_clock::now() >= nextReport) {
+            const uint64_t records = writer.records();
+            const double elapsed = std::chrono::duration<double>(nextReport - startTime).count();
+            std::cout << std::fixed << std::setprecision(0) << std::setw(6) << elapsed << " s"
+                      << std::setw(10) << records - lastRecords << " msg/s"
+                      << std::setw(12) << records << " total"
+                      << std::setw(9) << std::setprecision(1) << writer.bytesWritten() / 1048576.0 << " MiB on disk"
+                      << std::setw(7) << writer.stalls() << " stalls" << std::endl;
+            lastRecords = records;
+            nextReport += std::chrono::seconds(1);
+        }
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    const bool written = writer.close();
+
+    std::cout << "\n=== Capture Summary ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Recorded " << writer.records() << " messages (" << writer.payloadBytes() / 1048576.0
+              << " MiB) in " << elapsed << " s, " << (elapsed > 0 ? writer.records() / elapsed : 0.0)
+              << " msg/s" << std::endl;
+    std::cout << "Disk: " << writer.blocksWritten() << " blocks, " << writer.bytesWritten() / 1048576.0
+              << " MiB in " << writer.segments() << " segment(s), "
+              << (writer.directIo() ? "direct" : "buffered") << " I/O, slowest block "
+              << writer.maxWriteNs() / 1e6 << " ms" << std::endl;
+    std::cout << "Stalls waiting for the disk: " << writer.stalls() << " (" << writer.stallNs() / 1e6
+              << " ms in total)" << std::endl;
+    for (size_t i = 0; i < streams.size(); i++) {
+        sequences[i].finish();
+        std::cout << streams[i].name << ": " << received[i] << " received";
+        if (subs[i]->overruns()) {
+            std::cout << ", " << subs[i]->overruns() << " overrun in the shm ring";
+        }
+        std::cout << std::endl;
+        if (sequences[i].streamCount() > 0) {
+            tactile::printSequenceStats(std::cout, "  ", sequences[i].total());
+        }
+    }
+    if (unrecorded || writer.oversizedRecords()) {
+        std::cout << unrecorded << " messages not recorded (" << writer.oversizedRecords()
+                  << " larger than a block)" << std::endl;
+    }
+    if (!written) {
+        std::cerr << "Capture failed: " << writer.failure() << std::endl;
+        return 1;
+    }
+    return 0;
+}
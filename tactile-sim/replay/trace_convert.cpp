@@ -0,0 +1,46 @@
+// Converts a SimData run directory (tactile.csv, poses.csv, video.csv) into
+// one columnar .tct trace that sim_replay and the analysis tools can map
+// without parsing.
+//
+//   trace_convert ../SimData/run01 run01.tct
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "columnar_trace.hpp"
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: trace_convert <run directory> <output.tct>" << std::endl;
+        return 1;
+    }
+
+    std::string error;
+    tactile::TraceReader trace;
+    if (!trace.open(argv[1], error)) {
+        std::cerr << "Cannot convert " << argv[1] << ": " << error << std::endl;
+        return 1;
+    }
+
+    std::ofstream out(argv[2], std::ios::binary);
+    if (!out.write(trace.data(), trace.size()) || !out.flush()) {
+        std::cerr << "Cannot write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << argv[2] << ": " << trace.size() << " bytes, "
+              << trace.eventCount() << " events over " << trace.durationNs() / 1e9 << " s" << std::endl;
+    for (size_t t = 0; t < trace.tableCount(); t++) {
+        tactile::TraceTable table = trace.table(t);
+        std::cout << "  " << table.name() << ": " << table.rows() << " rows,";
+        for (size_t c = 0; c < table.columnCount(); c++) {
+            tactile::TraceColumn column = table.column(c);
+            std::cout << " " << column.name();
+            if (column.type() == tactile::ColumnType::Dict) {
+                std::cout << "[" << column.dictSize() << "]";
+            }
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -1,87 +1,260 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 // cross_layer_sim.cc
+//
+// Copy the headers from ../common next to this file in ns-3-dev/scratch
+// (or add that directory to the include path) before building.
 
 #include "ns3/core-module.h"
 #include <zmq.hpp>
 #include <iostream>
 #include <string>
 #include <iomanip>
+#include <cstdio>
+
+#include "async_log.hpp"
+#include "clock.hpp"
+#include "contact_codec.hpp"
+#include "haptic_wire.hpp"
+#include "hdr_histogram.hpp"
+#include "offline_sim.hpp"
+#include "receive_engine.hpp"
+#include "sequence_tracker.hpp"
+#include "transport.hpp"
 
 using namespace ns3;
 
-//––– Global ZMQ sockets so PollZmq can see them –––
-static zmq::socket_t* g_hapticSub = nullptr;
-static zmq::socket_t* g_videoSub  = nullptr;
+//––– Global receive engine and logger so PollZmq can see them –––
+static tactile::ReceiveEngine* g_engine = nullptr;
+static tactile::AsyncLogger*   g_log    = nullptr;
 
 // Statistics
-static int    g_hapticCount       = 0;
-static int    g_videoCount        = 0;
-static double g_totalHapticLat    = 0.0;
-static double g_totalVideoLat     = 0.0;
-static bool   g_seenFirstTs       = false;
-static double g_baseTs            = 0.0;
+static int     g_hapticCount       = 0;
+static int     g_videoCount        = 0;
+static int64_t g_totalHapticLatNs  = 0;
+static int64_t g_totalVideoLatNs   = 0;
+static bool    g_seenFirstTs       = false;
+static int64_t g_baseTsNs          = 0;
+static tactile::StreamHistograms g_hapticHist;
+static tactile::StreamHistograms g_videoHist;
+static tactile::SequenceTrackers g_hapticSeq;  // per hand
+static tactile::SequenceTrackers g_videoSeq;
+
+// Reused for every haptic message so receiving does not allocate
+static tactile::HapticSample  g_sample;
+// Rebuilds the output of a relay running "--contact-codec"
+static tactile::ContactDecoder g_hapticDecoder;
+
+// Per-packet row formatters, run on the logger thread
+static int
+FormatRow (char* out, size_t size, const tactile::LogArgs& a)
+{
+  return std::snprintf (out, size, "%10.6f%10s%12.6f%12.6f",
+                        a.d[0], a.i[0] ? "Video" : "Haptic", a.d[1], a.d[2]);
+}
+
+static int
+FormatBadMessage (char* out, size_t size, const tactile::LogArgs& a)
+{
+  std::string_view text = a.textView ();
+  return std::snprintf (out, size, "Bad %s message: %.*s", a.i[0] ? "video" : "haptic",
+                        static_cast<int> (text.size ()), text.data ());
+}
+
+static void
+HandleHaptic (const tactile::RecvBuffer& buf)
+{
+  int64_t simNowNs = Simulator::Now ().GetNanoSeconds ();
+  if (g_hapticDecoder.decode (buf.data.data (), buf.size, g_sample) != tactile::ContactReceived::Invalid)
+    {
+      int64_t tsNs = g_sample.header.timestampNs;
+      if (!g_seenFirstTs) { g_baseTsNs = tsNs; g_seenFirstTs = true; }
+      tsNs -= g_baseTsNs;
+      int64_t latNs = simNowNs - tsNs;
+      g_hapticCount++;  g_totalHapticLatNs += latNs;
+      g_hapticHist.record (simNowNs, tsNs);
+      if (g_sample.header.seq != tactile::noSequence)
+        {
+          g_hapticSeq.record (g_sample.header.streamId, g_sample.header.seq);
+        }
+      g_log->log (tactile::LogLevel::Info, FormatRow, [&] (tactile::LogArgs& a) {
+        a.i[0] = 0;
+        a.d[0] = simNowNs / 1e9;
+        a.d[1] = tsNs / 1e9;
+        a.d[2] = tactile::nsToMs (latNs);
+      });
+    }
+  else
+    {
+      g_log->log (tactile::LogLevel::Warn, FormatBadMessage, [&] (tactile::LogArgs& a) {
+        a.i[0] = 0;
+        a.setText (buf.view ());
+      });
+    }
+}
+
+static void
+HandleVideo (const tactile::RecvBuffer& buf)
+{
+  int64_t simNowNs = Simulator::Now ().GetNanoSeconds ();
+  double ts;
+  std::string_view text = buf.view ();
+  uint64_t seq;
+  if (tactile::splitTextSequence (text, seq))
+    {
+      g_videoSeq.record (0, seq);
+    }
+  if (tactile::parseLeadingDouble (text.data (), text.size (), ts))
+    {
+      int64_t tsNs = tactile::secondsToNs (ts);
+      if (!g_seenFirstTs) { g_baseTsNs = tsNs; g_seenFirstTs = true; }
+      tsNs -= g_baseTsNs;
+      int64_t latNs = simNowNs - tsNs;
+      g_videoCount++;  g_totalVideoLatNs += latNs;
+      g_videoHist.record (simNowNs, tsNs);
+      g_log->log (tactile::LogLevel::Info, FormatRow, [&] (tactile::LogArgs& a) {
+        a.i[0] = 1;
+        a.d[0] = simNowNs / 1e9;
+        a.d[1] = tsNs / 1e9;
+        a.d[2] = tactile::nsToMs (latNs);
+      });
+    }
+  else
+    {
+      g_log->log (tactile::LogLevel::Warn, FormatBadMessage, [&] (tactile::LogArgs& a) {
+        a.i[0] = 1;
+        a.setText (buf.view ());
+      });
+    }
+}
 
 // This is called once per millisecond of *real* wall-clock
-// (because we use the realtime scheduler).  It polls ZMQ,
-// prints any incoming packets, and re-schedules itself 1 ms later.
+// (because we use the realtime scheduler).  It drains every
+// pending ZMQ message without blocking, so the realtime scheduler
+// alone paces the loop, and re-schedules itself 1 ms later.
 void
 PollZmq ()
 {
-  zmq::pollitem_t items[2] = {
-    { static_cast<void*>(*g_hapticSub), 0, ZMQ_POLLIN, 0 },
-    { static_cast<void*>(*g_videoSub),  0, ZMQ_POLLIN,  0 }
-  };
-  zmq::poll (items, 2, std::chrono::milliseconds (1));
+  g_engine->drain ();
+
+  // Schedule yourself again in 1 ms sim-time (which maps to ~1 ms wall-clock)
+  Simulator::Schedule (MilliSeconds (1), &PollZmq);
+}
+
+//––– Offline mode: the recorded run as discrete events, no ZMQ –––
+// The pipeline (offline_sim.hpp) hands every follow-up event to the
+// default, non-realtime ns-3 scheduler, so the run takes as long as the
+// CPU needs and the same seed always gives the same result.
+static tactile::OfflinePipeline* g_pipeline = nullptr;
+static int64_t g_traceStartNs = 0;
+
+static void OfflineEvent (tactile::SimEvent e);
+
+static void
+ScheduleOffline (const tactile::SimEvent& e)
+{
+  Time at = NanoSeconds (e.timeNs - g_traceStartNs);
+  Simulator::Schedule (at - Simulator::Now (), &OfflineEvent, e);
+}
 
-  double simNow = Simulator::Now ().GetSeconds ();
+static void
+OfflineEvent (tactile::SimEvent e)
+{
+  g_pipeline->handle (e, &ScheduleOffline);
+}
 
-  //––– Haptic? –––
-  if (items[0].revents & ZMQ_POLLIN)
+static int
+RunOffline (const std::string& runDir, const tactile::OfflineConfig& config)
+{
+  tactile::TraceReader trace;
+  std::string error;
+  if (!trace.open (runDir, error))
     {
-      zmq::message_t m;
-      (void) g_hapticSub->recv (m, zmq::recv_flags::none);
-      double ts = std::stod (m.to_string ());
-      if (!g_seenFirstTs) { g_baseTs = ts; g_seenFirstTs = true; }
-      ts -= g_baseTs;
-      double lat = (simNow - ts) * 1000.0;
-      g_hapticCount++;  g_totalHapticLat += lat;
-      std::cout << std::fixed<<std::setprecision(3)
-                << std::setw(8)<< simNow
-                << std::setw(10)<<"Haptic"
-                << std::setw(12)<< ts
-                << std::setw(12)<< lat
-                << "\n";
+      std::cerr << "Cannot load " << runDir << ": " << error << "\n";
+      return 1;
     }
+  std::cout << "[offline] " << runDir << " (" << trace.eventCount () << " rows), seed "
+            << config.seed << "\n";
 
-  //––– Video? –––
-  if (items[1].revents & ZMQ_POLLIN)
+  Time::SetResolution (Time::NS);
+  RngSeedManager::SetSeed (static_cast<uint32_t> (config.seed));
+  static tactile::OfflinePipeline pipeline (trace, config);
+  g_pipeline = &pipeline;
+  g_traceStartNs = trace.firstNs ();
+  tactile::SimEvent first;
+  if (pipeline.first (first))
     {
-      zmq::message_t m;
-      (void) g_videoSub->recv (m, zmq::recv_flags::none);
-      std::string s = m.to_string ();
-      double ts = std::stod (s.substr (0, s.find (',')));
-      if (!g_seenFirstTs) { g_baseTs = ts; g_seenFirstTs = true; }
-      ts -= g_baseTs;
-      double lat = (simNow - ts) * 1000.0;
-      g_videoCount++;  g_totalVideoLat += lat;
-      std::cout << std::fixed<<std::setprecision(3)
-                << std::setw(8)<< simNow
-                << std::setw(10)<<"Video"
-                << std::setw(12)<< ts
-                << std::setw(12)<< lat
-                << "\n";
+      ScheduleOffline (first);
     }
+  Simulator::Run ();
+  Simulator::Destroy ();
 
-  // Schedule yourself again in 1 ms sim-time (which maps to ~1 ms wall-clock)
-  Simulator::Schedule (MilliSeconds (1), &PollZmq);
+  std::cout << std::fixed << std::setprecision (6) << "\n=== Final Summary ===\n";
+  tactile::printOfflineResult (std::cout, pipeline.finish ());
+  return 0;
 }
 
 int
 main (int argc, char *argv[])
 {
+  std::string logLevel = "info";
+  std::string transportName = "tcp";
+  bool offline = false;
+  std::string runDir = "../SimData/run01";
+  uint64_t seed = 1;
+  double durationS = 0;
+  double delayMs = 5, jitterMs = 1, loss = 0;
+  double videoDelayMs = 10, videoJitterMs = 2, videoBandwidthMbps = 100;
+  std::string codec = "absolute";
   CommandLine cmd;
+  cmd.AddValue ("logLevel", "Per-packet log level: debug, info, warn, error or off", logLevel);
+  cmd.AddValue ("transport", "Transport to the publishers: tcp, ipc or shm", transportName);
+  cmd.AddValue ("offline", "Simulate the recorded run as discrete events instead of receiving over ZMQ", offline);
+  cmd.AddValue ("run", "Offline: SimData run directory or converted .tct trace", runDir);
+  cmd.AddValue ("seed", "Offline: seed for link jitter and loss", seed);
+  cmd.AddValue ("durationS", "Offline: seconds of trace to simulate (0 = all)", durationS);
+  cmd.AddValue ("delayMs", "Offline: one-way delay of each haptic hop", delayMs);
+  cmd.AddValue ("jitterMs", "Offline: uniform jitter of each haptic hop", jitterMs);
+  cmd.AddValue ("loss", "Offline: drop probability of each haptic hop", loss);
+  cmd.AddValue ("videoDelayMs", "Offline: one-way delay of the video link", videoDelayMs);
+  cmd.AddValue ("videoJitterMs", "Offline: uniform jitter of the video link", videoJitterMs);
+  cmd.AddValue ("videoBandwidthMbps", "Offline: video link rate (0 = unlimited)", videoBandwidthMbps);
+  cmd.AddValue ("codec", "Offline: relay dead-band off, absolute, weber or predictive", codec);
   cmd.Parse (argc, argv);
 
+  if (offline)
+    {
+      tactile::OfflineConfig config;
+      config.seed = seed;
+      config.durationNs = tactile::secondsToNs (durationS);
+      config.uplink.delayNs = tactile::secondsToNs (delayMs / 1e3);
+      config.uplink.jitterNs = tactile::secondsToNs (jitterMs / 1e3);
+      config.uplink.loss = loss;
+      config.downlink = config.uplink;
+      config.videoLink.delayNs = tactile::secondsToNs (videoDelayMs / 1e3);
+      config.videoLink.jitterNs = tactile::secondsToNs (videoJitterMs / 1e3);
+      config.videoLink.bandwidthBps = videoBandwidthMbps * 1e6;
+      if (!tactile::parseDeadbandMode (codec, config.mode))
+        {
+          std::cerr << "Unknown codec " << codec << ", using absolute\n";
+        }
+      return RunOffline (runDir, config);
+    }
+
+  tactile::Transport transport = tactile::Transport::Tcp;
+  if (!tactile::parseTransport (transportName, transport))
+    {
+      std::cerr << "Unknown transport " << transportName << ", using tcp\n";
+    }
+
+  tactile::LogLevel level = tactile::LogLevel::Info;
+  if (!tactile::parseLogLevel (logLevel, level))
+    {
+      std::cerr << "Unknown logLevel " << logLevel << ", using info\n";
+    }
+  // Rows are formatted and written by a background thread
+  static tactile::AsyncLogger log (level);
+  g_log = &log;
+
   // 1) real-time scheduler
   Time::SetResolution (Time::NS);
   ObjectFactory f;
@@ -90,18 +263,21 @@ main (int argc, char *argv[])
 
   // 2) bind our ZMQ SUB sockets once
   zmq::context_t ctx (1);
-  static zmq::socket_t hSub (ctx, zmq::socket_type::sub);
-  static zmq::socket_t vSub (ctx, zmq::socket_type::sub);
-  g_hapticSub = &hSub;
-  g_videoSub  = &vSub;
+  static tactile::Subscriber hSub (ctx);
+  static tactile::Subscriber vSub (ctx);
+  const std::string hEndpoint = tactile::connectEndpoint (transport, "127.0.0.1", 5556);
+  const std::string vEndpoint = tactile::connectEndpoint (transport, "127.0.0.1", 5566);
+
+  hSub.connect (hEndpoint);
+  std::cout << "[ZMQ] Connected to haptic → " << hEndpoint << "\n";
 
-  hSub.connect ("tcp://127.0.0.1:5556");
-  hSub.set (zmq::sockopt::subscribe, "");
-  std::cout << "[ZMQ] Connected to haptic → tcp://127.0.0.1:5556\n";
+  vSub.connect (vEndpoint);
+  std::cout << "[ZMQ] Connected to video  → " << vEndpoint << "\n";
 
-  vSub.connect ("tcp://127.0.0.1:5566");
-  vSub.set (zmq::sockopt::subscribe, "");
-  std::cout << "[ZMQ] Connected to video  → tcp://127.0.0.1:5566\n";
+  static tactile::ReceiveEngine engine (tactile::WaitStrategy::Block);
+  engine.add (hSub, &HandleHaptic);
+  engine.add (vSub, &HandleVideo);
+  g_engine = &engine;
 
   // 3) start polling at t=0
   Simulator::Schedule (MilliSeconds (0), &PollZmq);
@@ -114,12 +290,22 @@ main (int argc, char *argv[])
   Simulator::Destroy ();
 
   // 6) final summary
+  g_log->flush ();
   std::cout << "\n=== Final Summary ===\n"
             << "Haptic: " << g_hapticCount
-            << ", avg = " << (g_hapticCount ? g_totalHapticLat/g_hapticCount : 0.0)
+            << ", avg = " << (g_hapticCount ? tactile::nsToMs (g_totalHapticLatNs/g_hapticCount) : 0.0)
             << " ms\n"
             << "Video : " << g_videoCount
-            << ", avg = " << (g_videoCount ? g_totalVideoLat/g_videoCount : 0.0)
+            << ", avg = " << (g_videoCount ? tactile::nsToMs (g_totalVideoLatNs/g_videoCount) : 0.0)
             << " ms\n";
+  tactile::printPercentiles (std::cout, "Haptic latency      ", g_hapticHist.latency.run);
+  tactile::printPercentiles (std::cout, "Haptic inter-arrival", g_hapticHist.interArrival.run);
+  tactile::printPercentiles (std::cout, "Video latency       ", g_videoHist.latency.run);
+  tactile::printPercentiles (std::cout, "Video inter-arrival ", g_videoHist.interArrival.run);
+  g_hapticSeq.finish ();
+  g_videoSeq.finish ();
+  tactile::printSequenceStats (std::cout, "Haptic ", g_hapticSeq.total ());
+  tactile::printSequenceStats (std::cout, "Video ", g_videoSeq.total ());
+  tactile::printContactStats (std::cout, "Haptic ", g_hapticDecoder.stats ());
   return 0;
 }
\ No newline at end of file
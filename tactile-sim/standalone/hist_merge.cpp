@@ -0,0 +1,58 @@
+// Merges histogram files written with --hist-out (by standalone_sim,
+// standalone_monitor or cross_layer_sim) and prints combined percentiles.
+//
+//   hist_merge run1.hdr run2.hdr ... [--out merged.hdr]
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "hdr_histogram.hpp"
+
+int main(int argc, char* argv[]) {
+    std::map<std::string, tactile::HdrHistogram> merged;
+    std::string outPath;
+    int files = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+            continue;
+        }
+        
+        std::ifstream in(arg, std::ios::binary);
+        if (!in) {
+            std::cerr << "Cannot open " << arg << std::endl;
+            return 1;
+        }
+        std::string name;
+        tactile::HdrHistogram h;
+        while (tactile::readNamedHistogram(in, name, h)) {
+            merged[name].merge(h);
+        }
+        if (!in.eof()) {
+            std::cerr << "Corrupt histogram file " << arg << std::endl;
+            return 1;
+        }
+        files++;
+    }
+    
+    if (files == 0) {
+        std::cerr << "Usage: hist_merge <file>... [--out merged.hdr]" << std::endl;
+        return 1;
+    }
+    
+    std::cout << "Merged " << files << " file(s)" << std::endl;
+    for (const auto& entry : merged) {
+        tactile::printPercentiles(std::cout, entry.first.c_str(), entry.second);
+    }
+    
+    if (!outPath.empty()) {
+        std::ofstream out(outPath, std::ios::binary);
+        for (const auto& entry : merged) {
+            tactile::writeNamedHistogram(out, entry.first, entry.second);
+        }
+    }
+    return 0;
+}
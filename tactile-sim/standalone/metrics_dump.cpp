@@ -0,0 +1,60 @@
+// Prints the binary snapshots written with --snapshot-out (by
+// standalone_monitor or standalone_perf), one block per snapshot.
+//
+//   metrics_dump snapshots.bin [--last]
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "metrics.hpp"
+
+static void printSnapshot(const tactile::MetricsSnapshot& snapshot) {
+    std::cout << "@ " << std::fixed << std::setprecision(3) << snapshot.timeNs / 1e9 << "\n";
+    for (const auto& entry : snapshot.entries) {
+        std::cout << "  " << std::left << std::setw(48) << entry.name << std::right;
+        if (entry.type != tactile::MetricType::Histogram) {
+            std::cout << std::setprecision(entry.type == tactile::MetricType::Gauge ? 3 : 0) << entry.value << "\n";
+            continue;
+        }
+        uint64_t count = 0;
+        for (uint64_t c : entry.counts) {
+            count += c;
+        }
+        std::cout << "n=" << count << std::setprecision(3) << " mean="
+                  << (count ? entry.sumSeconds * 1e3 / double(count) : 0.0) << " ms\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: metrics_dump <snapshots.bin> [--last]" << std::endl;
+        return 1;
+    }
+    const bool lastOnly = argc > 2 && std::string(argv[2]) == "--last";
+    
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    tactile::MetricsSnapshot snapshot;
+    tactile::MetricsSnapshot next;
+    int snapshots = 0;
+    while (tactile::MetricsRegistry::readSnapshot(in, next)) {
+        if (!lastOnly) {
+            printSnapshot(next);
+        }
+        snapshot = next;
+        snapshots++;
+    }
+    if (!in.eof()) {
+        // A run killed mid-write leaves a partial snapshot at the end
+        std::cerr << "Stopped at a truncated or corrupt snapshot" << std::endl;
+    }
+    if (lastOnly && snapshots > 0) {
+        printSnapshot(snapshot);
+    }
+    std::cout << snapshots << " snapshot(s)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,765 @@
+// Self-contained benchmarks of the haptic path: no external publishers, a
+// fixed amount of work, and results that can be compared between builds.
+//
+//   pipeline_bench [--suite all|micro|macro] [--filter parse.]
+//                  [--json bench.json] [--baseline old.json]
+//                  [--tolerance 0.1] [--check]
+//                  [--repeats 5] [--min-time-ms 100]
+//                  [--transports shm,ipc,tcp] [--rates 1000,10000,100000,0]
+//                  [--sizes 68,256] [--point-ms 500] [--point-repeats 3]
+//                  [--round-trips 2000]
+//                  [--sessions 4] [--base-port 5700] [--wait block|spin|adaptive]
+//
+// micro  parse.*      wire decoding (text rows, binary, session key) and encoding
+//        filter.*     the dead-band modes, the contact codec and a full
+//                     RelayWorker pass (decode, codec, re-encode)
+//        stats.*      HdrHistogram, SequenceTrackers, SlidingWindowStats and
+//                     StreamHistograms as the receivers use them
+//        transport.*  round trips (p50/p99) and a one-way flood between two
+//                     in-process threads over each transport
+// macro  e2e.*        an in-process publisher, relay (RelayWorker with the
+//                     dead-band off, so every sample is forwarded) and
+//                     subscriber per transport, message rate (0 = as fast as
+//                     possible) and message size (a binary sample padded to
+//                     that many bytes, at most one relay slot): delivered
+//                     rate, end-to-end latency p50/p99 and loss
+//
+// Inputs are synthesized, so every run does the same work. Micro results
+// are the median of --repeats passes of at least --min-time-ms each (the
+// flood too); every sweep point runs --point-repeats times for --point-ms.
+// --json writes the results (bench_report.hpp); --baseline compares with
+// an earlier file, and --check makes any regression beyond --tolerance plus
+// the measured spread an exit status of 2. Only names containing --filter
+// are run.
+#include <zmq.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "bench_report.hpp"
+#include "clock.hpp"
+#include "contact_codec.hpp"
+#include "deadband.hpp"
+#include "haptic_relay.hpp"
+#include "haptic_wire.hpp"
+#include "hdr_histogram.hpp"
+#include "options.hpp"
+#include "receive_engine.hpp"
+#include "sequence_tracker.hpp"
+#include "transport.hpp"
+#include "windowed_stats.hpp"
+
+namespace {
+
+// Synthetic samples per pool; every micro-benchmark call walks the whole pool
+constexpr size_t poolSize = 1024;
+
+// Stream id of the handshake messages sent until the far end sees traffic
+constexpr uint16_t probeStream = 0xffff;
+
+// A hand moving on a slow path and pressing intermittently, 1 kHz per session
+void synthesize(uint16_t session, uint64_t i, tactile::HapticSample& s) {
+    s = tactile::makeHapticSample();
+    s.header.streamId = session;
+    s.header.seq = i;
+    s.header.timestampNs = static_cast<int64_t>(i) * 1000000;
+    const double t = i * 0.001 + session * 0.37;
+    s.payload.position[0] = static_cast<float>(0.3 * std::sin(1.3 * t));
+    s.payload.position[1] = static_cast<float>(1.1 + 0.1 * std::sin(0.7 * t));
+    s.payload.position[2] = static_cast<float>(0.4 + 0.2 * std::cos(0.9 * t));
+    const double half = 0.25 * std::sin(0.5 * t);
+    s.payload.orientation[1] = static_cast<float>(std::sin(half));
+    s.payload.orientation[3] = static_cast<float>(std::cos(half));
+    s.payload.forceN = static_cast<float>(std::max(0.0, 40.0 * std::sin(2.1 * t)));
+}
+
+bool parseList(const std::string& text, std::vector<long>& out, const char* option) {
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end = nullptr;
+        const long value = std::strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || value < 0) {
+            std::cerr << "Bad " << option << " entry '" << item << "'" << std::endl;
+            return false;
+        }
+        out.push_back(value);
+    }
+    return true;
+}
+
+struct Settings {
+    std::string filter;
+    int repeats = 5;
+    int64_t minNs = 100000000;
+    size_t sessions = 4;
+    int64_t pointNs = 500000000;
+    long roundTrips = 2000;
+    int pointRepeats = 3;
+    int basePort = 5700;
+    tactile::WaitStrategy wait = tactile::WaitStrategy::Block;
+};
+
+class Suite {
+public:
+    Suite(const Settings& settings, tactile::BenchReport& report)
+        : settings(settings), report(report), nextPort(settings.basePort) {}
+
+    // A fresh port (or endpoint name) for every pipeline, so runs never meet
+    int port() {
+        return nextPort++;
+    }
+
+    bool wanted(const std::string& name) const {
+        return settings.filter.empty() || name.find(settings.filter) != std::string::npos;
+    }
+
+    // Times f (one pass over the pool) unless filtered out
+    template <typename F>
+    void micro(const std::string& name, F&& f) {
+        if (!wanted(name)) {
+            return;
+        }
+        const tactile::BenchTiming t = tactile::timePerOp(f, poolSize, settings.repeats, settings.minNs);
+        add(name, "ns/op", t.median, false, t.spread);
+    }
+
+    void add(const std::string& name, const char* unit, double value, bool higherIsBetter, double spread = 0) {
+        report.add(name, unit, value, higherIsBetter, spread);
+        std::cout << std::left << std::setw(40) << name << std::right << std::setw(10) << unit
+                  << std::setw(14) << std::fixed << std::setprecision(value < 100 ? 3 : 0) << value
+                  << std::setw(9) << std::setprecision(1) << spread * 100 << "%" << std::endl;
+    }
+
+    const Settings& settings;
+    tactile::BenchReport& report;
+
+private:
+    int nextPort;
+};
+
+void runParse(Suite& suite, const std::vector<tactile::HapticSample>& samples) {
+    std::vector<std::string> tactileRows, xyzRows;
+    std::vector<std::array<char, tactile::hapticWireSize>> binary(samples.size());
+    char row[256];
+    for (size_t i = 0; i < samples.size(); i++) {
+        const tactile::HapticPayload& p = samples[i].payload;
+        std::snprintf(row, sizeof(row), "%.4f,Left Controller,Cube,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.3f,rubber#%zu",
+                      samples[i].header.timestampNs / 1e9, p.position[0], p.position[1], p.position[2],
+                      p.normal[0], p.normal[1], p.normal[2], p.forceN, i);
+        tactileRows.emplace_back(row);
+        xyzRows.emplace_back(row, tactile::formatHapticText(samples[i], row, sizeof(row)));
+        tactile::encodeHaptic(samples[i], binary[i].data(), binary[i].size());
+    }
+    tactile::HapticSample out;
+    suite.micro("parse.text_tactile", [&] {
+        for (const std::string& r : tactileRows) {
+            tactile::parseHapticText(r.data(), r.size(), out);
+            tactile::benchKeep(out);
+        }
+    });
+    suite.micro("parse.text_xyz", [&] {
+        for (const std::string& r : xyzRows) {
+            tactile::parseHapticText(r.data(), r.size(), out);
+            tactile::benchKeep(out);
+        }
+    });
+    suite.micro("parse.binary", [&] {
+        for (const auto& b : binary) {
+            tactile::decodeHaptic(b.data(), b.size(), out);
+            tactile::benchKeep(out);
+        }
+    });
+    suite.micro("parse.session_key", [&] {
+        uint16_t key;
+        for (const auto& b : binary) {
+            tactile::sessionKey(b.data(), b.size(), key);
+            tactile::benchKeep(key);
+        }
+    });
+    suite.micro("encode.binary", [&] {
+        for (const tactile::HapticSample& s : samples) {
+            tactile::encodeHaptic(s, row, sizeof(row));
+            tactile::benchKeep(row);
+        }
+    });
+    suite.micro("encode.text", [&] {
+        for (const tactile::HapticSample& s : samples) {
+            tactile::formatHapticText(s, row, sizeof(row));
+            tactile::benchKeep(row);
+        }
+    });
+}
+
+void runFilter(Suite& suite, const std::vector<tactile::HapticSample>& samples) {
+    const tactile::DeadbandConfig config;
+    const size_t sessions = suite.settings.sessions;
+    for (tactile::DeadbandMode mode : { tactile::DeadbandMode::Absolute, tactile::DeadbandMode::Weber,
+                                        tactile::DeadbandMode::Predictive }) {
+        std::vector<tactile::DeadbandCodec> codecs(sessions, tactile::DeadbandCodec(mode, config));
+        suite.micro(std::string("filter.deadband_") + tactile::deadbandModeName(mode), [&] {
+            for (const tactile::HapticSample& s : samples) {
+                bool send = codecs[s.header.streamId % sessions].offer(s);
+                tactile::benchKeep(send);
+            }
+        });
+    }
+    std::vector<tactile::ContactCodec> contact(sessions);
+    suite.micro("filter.contact", [&] {
+        for (const tactile::HapticSample& s : samples) {
+            tactile::ContactDecision d = contact[s.header.streamId % sessions].offer(s);
+            tactile::benchKeep(d);
+        }
+    });
+
+    std::vector<tactile::RelayMessage> messages(samples.size());
+    char frame[tactile::hapticWireSize];
+    for (size_t i = 0; i < samples.size(); i++) {
+        tactile::encodeHaptic(samples[i], frame, sizeof(frame));
+        messages[i].assign(frame, sizeof(frame), tactile::HopTrail(), 0);
+    }
+    tactile::RelayWorker worker(tactile::DeadbandMode::Weber, config, tactile::WireFormat::Binary);
+    suite.micro("filter.relay_worker", [&] {
+        for (const tactile::RelayMessage& m : messages) {
+            worker.process(m, [](const tactile::HapticSample&, const char* data, size_t, const tactile::RelayMessage&) {
+                tactile::benchKeep(data);
+            });
+        }
+    });
+}
+
+void runStats(Suite& suite, const std::vector<tactile::HapticSample>& samples) {
+    // Latencies around 1 ms with a tail, in a fixed order
+    std::vector<int64_t> latencies(poolSize);
+    for (size_t i = 0; i < poolSize; i++) {
+        const uint64_t h = (i + 1) * 0x9e3779b97f4a7c15ull;
+        latencies[i] = 200000 + int64_t(h >> 44) + ((h & 0xff) == 0 ? 20000000 : 0);
+    }
+    tactile::HdrHistogram histogram;
+    suite.micro("stats.hdr_record", [&] {
+        for (int64_t v : latencies) {
+            histogram.record(v);
+        }
+    });
+    tactile::SequenceTrackers sequences;
+    std::vector<uint64_t> next(suite.settings.sessions);
+    suite.micro("stats.sequence", [&] {
+        for (const tactile::HapticSample& s : samples) {
+            // Each stream counts on its own and skips one number in 256
+            uint64_t& seq = next[s.header.streamId % next.size()];
+            seq += (seq & 0xff) == 0xff ? 2 : 1;
+            sequences.record(s.header.streamId, seq);
+        }
+    });
+    tactile::SlidingWindowStats window(10000, 1000000000);
+    int64_t nowNs = 0;
+    suite.micro("stats.sliding_window", [&] {
+        for (int64_t v : latencies) {
+            nowNs += 1000000;
+            window.add(v / 1e6, nowNs);
+        }
+    });
+    tactile::StreamHistograms stream;
+    int64_t arrivalNs = 0;
+    suite.micro("stats.stream_histograms", [&] {
+        for (int64_t v : latencies) {
+            arrivalNs += 1000000;
+            stream.record(arrivalNs, arrivalNs - v);
+        }
+    });
+}
+
+// Bind and connect endpoints private to this process
+struct BenchEndpoint {
+    tactile::Transport transport;
+    std::string bind;
+    std::string connect;
+
+    BenchEndpoint(tactile::Transport transport, int port) : transport(transport) {
+        const std::string name = "tactile-bench-" + std::to_string(::getpid()) + "-" + std::to_string(port);
+        switch (transport) {
+            case tactile::Transport::Tcp:
+                bind = connect = "tcp://127.0.0.1:" + std::to_string(port);
+                break;
+            case tactile::Transport::Ipc:
+                bind = connect = "ipc:///tmp/" + name;
+                break;
+            case tactile::Transport::Shm:
+                bind = connect = tactile::shmScheme + name;
+                break;
+        }
+    }
+
+    ~BenchEndpoint() {
+        std::string name;
+        if (tactile::isShmEndpoint(bind, name)) {
+            tactile::ShmPublisher::unlink(name);
+        } else if (transport == tactile::Transport::Ipc) {
+            ::unlink(bind.c_str() + std::strlen("ipc://"));
+        }
+    }
+};
+
+// Sends paced (or, at rate 0, unpaced) binary samples padded to `size`
+// bytes, after probing until `ready` says the far end receives.
+struct Source {
+    tactile::Publisher& pub;
+    const tactile::Clock& clock;
+    std::atomic<bool> ready{false};
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> sent{0};
+    bool probed = false;
+
+    Source(tactile::Publisher& pub, const tactile::Clock& clock) : pub(pub), clock(clock) {}
+
+    void run(long rate, size_t size, size_t sessions, int64_t durationNs) {
+        std::vector<char> frame(size);
+        tactile::HapticSample s;
+        const auto probeEnd = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!ready.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < probeEnd) {
+            synthesize(probeStream, 0, s);
+            s.header.timestampNs = clock.nowNs();
+            tactile::encodeHaptic(s, frame.data(), frame.size());
+            pub.send(frame.data(), frame.size());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        probed = ready.load(std::memory_order_acquire);
+        const auto start = std::chrono::steady_clock::now();
+        const auto end = start + std::chrono::nanoseconds(durationNs);
+        uint64_t count = 0;
+        for (auto now = start; probed && now < end; now = std::chrono::steady_clock::now()) {
+            if (rate > 0) {
+                const auto due = start + std::chrono::nanoseconds(int64_t(count * 1e9 / rate));
+                if (due > now + std::chrono::microseconds(200)) {
+                    std::this_thread::sleep_for(due - now - std::chrono::microseconds(100));
+                    continue;
+                }
+                if (due > now) {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+            synthesize(uint16_t(count % sessions), count / sessions, s);
+            s.header.timestampNs = clock.nowNs();
+            tactile::encodeHaptic(s, frame.data(), frame.size());
+            pub.send(frame.data(), frame.size());
+            count++;
+            sent.store(count, std::memory_order_relaxed);
+        }
+        done.store(true, std::memory_order_release);
+    }
+};
+
+// What the last stage saw
+struct SinkStats {
+    uint64_t received = 0;
+    tactile::HdrHistogram latency;
+    int64_t firstNs = 0, lastNs = 0;
+};
+
+// Receives on `sub` until the source is done and everything it sent has
+// arrived (or a grace period passed); probes only flip source.ready.
+void drainInto(tactile::Subscriber& sub, Source& source, const tactile::Clock& clock,
+               tactile::WaitStrategy wait, SinkStats& stats) {
+    tactile::ReceiveEngine engine(wait);
+    tactile::HapticSample s;
+    engine.add(sub, [&](const tactile::RecvBuffer& buf) {
+        const int64_t nowNs = clock.nowNs();
+        if (!tactile::decodeHapticBinary(buf.data.data(), buf.size, s)) {
+            return;
+        }
+        if (s.header.streamId == probeStream) {
+            source.ready.store(true, std::memory_order_release);
+            return;
+        }
+        if (stats.received++ == 0) {
+            stats.firstNs = nowNs;
+        }
+        stats.lastNs = nowNs;
+        stats.latency.record(std::max<int64_t>(0, nowNs - s.header.timestampNs));
+    });
+    auto graceEnd = std::chrono::steady_clock::time_point::max();
+    while (std::chrono::steady_clock::now() < graceEnd) {
+        engine.runOnce(std::chrono::milliseconds(10));
+        if (source.done.load(std::memory_order_acquire)) {
+            if (stats.received >= source.sent.load(std::memory_order_relaxed)) {
+                break;
+            }
+            if (graceEnd == std::chrono::steady_clock::time_point::max()) {
+                graceEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+            }
+        }
+    }
+}
+
+struct PointResult {
+    double rate = 0;  // delivered messages per second
+    double p50Us = 0, p99Us = 0;
+    double lossPercent = 0;
+};
+
+// One publisher -> [relay ->] subscriber run over fresh endpoints. The relay
+// is haptic_tx's with one worker and the dead-band off: decode, codec,
+// re-encode; padding past the sample is passed through, so both legs carry
+// `size` bytes. Returns false if no traffic got through.
+bool pipelineOnce(Suite& suite, tactile::Transport transport, long rate, size_t size, bool withRelay,
+                  zmq::context_t& context, const tactile::Clock& clock, PointResult& out) {
+    const Settings& settings = suite.settings;
+    BenchEndpoint upstream(transport, suite.port());
+    BenchEndpoint downstream(transport, suite.port());
+    tactile::Publisher pub(context), relayOut(context);
+    tactile::Subscriber relayIn(context), sub(context);
+    pub.bind(upstream.bind);
+    if (withRelay) {
+        relayOut.bind(downstream.bind);
+        relayIn.connect(upstream.connect);
+        sub.connect(downstream.connect);
+    } else {
+        sub.connect(upstream.connect);
+    }
+
+    std::atomic<bool> stop{false};
+    tactile::RelayWorker worker(tactile::DeadbandMode::Off, tactile::DeadbandConfig(), tactile::WireFormat::Binary,
+                                clock);
+    std::thread relay;
+    if (withRelay) {
+        relay = std::thread([&] {
+            tactile::ReceiveEngine engine(settings.wait);
+            tactile::RelayMessage m;
+            char frame[sizeof(m.data)];
+            engine.add(relayIn, [&](const tactile::RecvBuffer& buf) {
+                if (!m.assign(buf.data.data(), buf.size, buf.hops, clock.nowNs())) {
+                    return;
+                }
+                worker.process(m, [&](const tactile::HapticSample&, const char* data, size_t len,
+                                      const tactile::RelayMessage& in) {
+                    std::memcpy(frame, data, len);
+                    if (in.size > len) {
+                        std::memcpy(frame + len, in.data + len, in.size - len);
+                    }
+                    relayOut.send(frame, std::max<size_t>(len, in.size));
+                });
+            });
+            while (!stop.load(std::memory_order_relaxed)) {
+                engine.runOnce(std::chrono::milliseconds(10));
+            }
+        });
+    }
+
+    Source source(pub, clock);
+    std::thread sender([&] { source.run(rate, size, settings.sessions, settings.pointNs); });
+    SinkStats stats;
+    drainInto(sub, source, clock, settings.wait, stats);
+    sender.join();
+    stop = true;
+    if (relay.joinable()) {
+        relay.join();
+    }
+    if (!source.probed || stats.received == 0) {
+        return false;
+    }
+    const uint64_t sent = source.sent.load();
+    out.rate = stats.received / (settings.pointNs / 1e9);
+    out.p50Us = stats.latency.valueAtPercentile(50) / 1e3;
+    out.p99Us = stats.latency.valueAtPercentile(99) / 1e3;
+    out.lossPercent = sent > stats.received ? 100.0 * double(sent - stats.received) / double(sent) : 0.0;
+    return true;
+}
+
+void runTransport(Suite& suite, tactile::Transport transport, zmq::context_t& context, const tactile::Clock& clock) {
+    const std::string prefix = std::string("transport.") + tactile::transportName(transport);
+    const Settings& settings = suite.settings;
+
+    if (suite.wanted(prefix + ".rtt")) {
+        // The echo thread sends every sample straight back
+        BenchEndpoint there(transport, suite.port());
+        BenchEndpoint back(transport, suite.port());
+        tactile::Publisher ping(context), pong(context);
+        tactile::Subscriber echoIn(context), replies(context);
+        ping.bind(there.bind);
+        pong.bind(back.bind);
+        echoIn.connect(there.connect);
+        replies.connect(back.connect);
+        std::atomic<bool> stop{false};
+        std::thread echo([&] {
+            tactile::ReceiveEngine engine(settings.wait);
+            engine.add(echoIn, [&](const tactile::RecvBuffer& buf) { pong.send(buf.data.data(), buf.size); });
+            while (!stop.load(std::memory_order_relaxed)) {
+                engine.runOnce(std::chrono::milliseconds(10));
+            }
+        });
+
+        tactile::ReceiveEngine engine(settings.wait);
+        tactile::HapticSample reply;
+        uint64_t expected = 0;
+        bool replied = false;
+        int64_t replyNs = 0;
+        engine.add(replies, [&](const tactile::RecvBuffer& buf) {
+            if (tactile::decodeHapticBinary(buf.data.data(), buf.size, reply) && reply.header.seq == expected) {
+                replyNs = clock.nowNs() - reply.header.timestampNs;
+                replied = true;
+            }
+        });
+        tactile::HapticSample s;
+        char frame[tactile::hapticWireSize];
+        // Sends `seq` every `resend` until it comes back or `timeout` passes
+        auto roundTrip = [&](uint64_t seq, std::chrono::milliseconds timeout, std::chrono::milliseconds resend) {
+            expected = seq;
+            replied = false;
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+            auto nextSend = std::chrono::steady_clock::now();
+            for (auto now = nextSend; !replied && now < deadline; now = std::chrono::steady_clock::now()) {
+                if (now >= nextSend) {
+                    synthesize(0, seq, s);
+                    s.header.timestampNs = clock.nowNs();
+                    tactile::encodeHaptic(s, frame, sizeof(frame));
+                    ping.send(frame, sizeof(frame));
+                    nextSend = now + resend;
+                }
+                engine.runOnce(std::chrono::milliseconds(1));
+            }
+            return replied;
+        };
+        tactile::HdrHistogram rtt;
+        // Round trip 0 is the handshake: the subscriptions may take a while
+        if (roundTrip(0, std::chrono::milliseconds(5000), std::chrono::milliseconds(1))) {
+            uint64_t lost = 0;
+            for (long i = 1; i <= settings.roundTrips && lost < 50; i++) {
+                if (roundTrip(uint64_t(i), std::chrono::milliseconds(1000), std::chrono::milliseconds(1000))) {
+                    rtt.record(replyNs);
+                } else {
+                    lost++;
+                }
+            }
+        }
+        stop = true;
+        echo.join();
+        if (rtt.count() == 0) {
+            std::cout << prefix << ": no replies, skipped" << std::endl;
+        } else {
+            suite.add(prefix + ".rtt_p50", "us", rtt.valueAtPercentile(50) / 1e3, false);
+            suite.add(prefix + ".rtt_p99", "us", rtt.valueAtPercentile(99) / 1e3, false);
+        }
+    }
+
+    if (suite.wanted(prefix + ".flood")) {
+        std::vector<double> rates;
+        PointResult r;
+        for (int i = 0; i < settings.repeats && pipelineOnce(suite, transport, 0, tactile::hapticWireSize, false,
+                                                              context, clock, r); i++) {
+            rates.push_back(r.rate);
+        }
+        if (rates.empty()) {
+            std::cout << prefix << ".flood: no traffic, skipped" << std::endl;
+        } else {
+            const tactile::BenchTiming t = tactile::summarizeRepeats(rates);
+            suite.add(prefix + ".flood", "msg/s", t.median, true, t.spread);
+        }
+    }
+}
+
+void runEndToEnd(Suite& suite, tactile::Transport transport, long rate, size_t size, zmq::context_t& context,
+                 const tactile::Clock& clock) {
+    std::ostringstream name;
+    name << "e2e." << tactile::transportName(transport) << ".r" << rate << ".s" << size;
+    if (!suite.wanted(name.str())) {
+        return;
+    }
+    std::vector<double> rates, p50, p99, loss;
+    PointResult r;
+    for (int i = 0; i < suite.settings.pointRepeats && pipelineOnce(suite, transport, rate, size, true,
+                                                                     context, clock, r); i++) {
+        rates.push_back(r.rate);
+        p50.push_back(r.p50Us);
+        p99.push_back(r.p99Us);
+        loss.push_back(r.lossPercent);
+    }
+    if (rates.empty()) {
+        std::cout << name.str() << ": no traffic, skipped" << std::endl;
+        return;
+    }
+    tactile::BenchTiming t = tactile::summarizeRepeats(rates);
+    suite.add(name.str() + ".rate", "msg/s", t.median, true, t.spread);
+    t = tactile::summarizeRepeats(p50);
+    suite.add(name.str() + ".p50", "us", t.median, false, t.spread);
+    t = tactile::summarizeRepeats(p99);
+    suite.add(name.str() + ".p99", "us", t.median, false, t.spread);
+    // Loss is mostly 0, where a relative spread means nothing
+    suite.add(name.str() + ".loss", "%", tactile::summarizeRepeats(loss).median, false);
+}
+
+std::string compilerName() {
+#if defined(__clang__)
+    return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    return std::string("gcc ") + __VERSION__;
+#else
+    return "unknown";
+#endif
+}
+
+std::string buildFlags() {
+    std::string flags;
+#if defined(TACTILE_BUILD_PROFILE)
+    flags += TACTILE_BUILD_PROFILE " ";
+#endif
+#if defined(__OPTIMIZE__)
+    flags += "optimized";
+#else
+    flags += "unoptimized";
+#endif
+#if defined(NDEBUG)
+    flags += " NDEBUG";
+#endif
+#if defined(__AVX2__)
+    flags += " avx2";
+#elif defined(__SSE2__)
+    flags += " sse2";
+#endif
+    return flags;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    tactile::Options opts(argc, argv);
+    Settings settings;
+    if (!tactile::setupReceiveThread(opts, settings.wait)) {
+        return 1;
+    }
+    const std::string suiteName = opts.get("--suite", "all");
+    if (suiteName != "all" && suiteName != "micro" && suiteName != "macro") {
+        std::cerr << "Unknown --suite (use all, micro or macro)" << std::endl;
+        return 1;
+    }
+    settings.filter = opts.get("--filter", "");
+    settings.repeats = int(std::max(1L, opts.getInt("--repeats", 5)));
+    settings.minNs = std::max(1L, opts.getInt("--min-time-ms", 100)) * 1000000;
+    settings.sessions = size_t(std::max(1L, opts.getInt("--sessions", 4)));
+    settings.pointNs = std::max(1L, opts.getInt("--point-ms", 500)) * 1000000;
+    settings.pointRepeats = int(std::max(1L, opts.getInt("--point-repeats", 3)));
+    settings.roundTrips = std::max(1L, opts.getInt("--round-trips", 2000));
+    settings.basePort = int(opts.getInt("--base-port", 5700));
+    const double tolerance = opts.getDouble("--tolerance", 0.1);
+    const std::string jsonPath = opts.get("--json", "");
+    const std::string baselinePath = opts.get("--baseline", "");
+
+    std::vector<tactile::Transport> transports;
+    {
+        std::stringstream in(opts.get("--transports", "shm,ipc,tcp"));
+        std::string item;
+        while (std::getline(in, item, ',')) {
+            tactile::Transport t;
+            if (!tactile::parseTransport(item, t)) {
+                std::cerr << "Unknown transport '" << item << "' (use tcp, ipc or shm)" << std::endl;
+                return 1;
+            }
+            transports.push_back(t);
+        }
+    }
+    std::vector<long> rates, sizes;
+    if (!parseList(opts.get("--rates", "1000,10000,100000,0"), rates, "--rates") ||
+        !parseList(opts.get("--sizes", "68,256"), sizes, "--sizes")) {
+        return 1;
+    }
+    const size_t maxSize = std::min(sizeof(tactile::RelayMessage::data), tactile::shmMessageCapacity);
+    for (long size : sizes) {
+        if (size < long(tactile::hapticWireSize) || size > long(maxSize)) {
+            std::cerr << "--sizes must be between " << tactile::hapticWireSize << " (one sample) and " << maxSize
+                      << " (one relay slot)" << std::endl;
+            return 1;
+        }
+    }
+    // Load the baseline first, so a bad path fails before the long part
+    tactile::BenchReport baseline;
+    std::string error;
+    if (!baselinePath.empty() && !baseline.read(baselinePath, error)) {
+        std::cerr << "Cannot use baseline: " << error << std::endl;
+        return 1;
+    }
+
+    tactile::BenchReport report;
+    char host[256] = "unknown";
+    ::gethostname(host, sizeof(host) - 1);
+    std::ostringstream options;
+    options << "suite=" << suiteName << " filter=" << settings.filter << " repeats=" << settings.repeats
+            << " min-time-ms=" << settings.minNs / 1000000 << " sessions=" << settings.sessions
+            << " point-ms=" << settings.pointNs / 1000000
+            << " point-repeats=" << settings.pointRepeats << " round-trips=" << settings.roundTrips
+            << " wait=" << tactile::waitStrategyName(settings.wait)
+            << " transports=" << opts.get("--transports", "shm,ipc,tcp")
+            << " rates=" << opts.get("--rates", "1000,10000,100000,0") << " sizes=" << opts.get("--sizes", "68,256");
+    report.info = {
+        { "compiler", compilerName() },
+        { "build", buildFlags() },
+        { "host", host },
+        { "cpus", std::to_string(std::thread::hardware_concurrency()) },
+        { "options", options.str() },
+    };
+    std::cout << "pipeline_bench: " << report.info[0].second << ", " << report.info[1].second << ", "
+              << report.info[3].second << " CPUs" << std::endl;
+    std::cout << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(10) << "Unit"
+              << std::setw(14) << "Value" << std::setw(10) << "Spread" << std::endl;
+
+    Suite suite(settings, report);
+    const tactile::Clock clock;
+    zmq::context_t context(1);
+    if (suiteName != "macro") {
+        std::vector<tactile::HapticSample> samples(poolSize);
+        for (size_t i = 0; i < poolSize; i++) {
+            synthesize(uint16_t(i % settings.sessions), i / settings.sessions, samples[i]);
+        }
+        runParse(suite, samples);
+        runFilter(suite, samples);
+        runStats(suite, samples);
+        for (tactile::Transport t : transports) {
+            try {
+                runTransport(suite, t, context, clock);
+            } catch (const std::exception& e) {
+                std::cerr << "transport." << tactile::transportName(t) << ": " << e.what() << std::endl;
+            }
+        }
+    }
+    if (suiteName != "micro") {
+        for (tactile::Transport t : transports) {
+            for (long size : sizes) {
+                for (long rate : rates) {
+                    try {
+                        runEndToEnd(suite, t, rate, size_t(size), context, clock);
+                    } catch (const std::exception& e) {
+                        std::cerr << "e2e." << tactile::transportName(t) << ": " << e.what() << std::endl;
+                    }
+                }
+            }
+        }
+    }
+
+    if (!jsonPath.empty()) {
+        if (!report.write(jsonPath, error)) {
+            std::cerr << "Cannot save results: " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << report.results.size() << " results to " << jsonPath << std::endl;
+    }
+    if (!baselinePath.empty()) {
+        std::cout << "\n=== Against " << baselinePath << " ===" << std::endl;
+        const size_t regressions = tactile::compareBench(std::cout, report, baseline, tolerance);
+        if (regressions && opts.has("--check")) {
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -1,220 +1,460 @@
 #include <zmq.hpp>
 #include <iostream>
 #include <string>
-#include <thread>
 #include <chrono>
 #include <iomanip>
-#include <deque>
-#include <numeric>
 #include <algorithm>
-#include <cmath>
-
-// Structure to hold interval statistics
-struct IntervalStats {
-    double min;
-    double max;
-    double avg;
-    double stddev;
-    int count;
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#define TACTILE_ALLOC_COUNTER_IMPL
+#include "alloc_counter.hpp"
+#include "clock.hpp"
+#include "contact_codec.hpp"
+#include "haptic_wire.hpp"
+#include "hdr_histogram.hpp"
+#include "metrics_export.hpp"
+#include "options.hpp"
+#include "receive_engine.hpp"
+#include "sequence_tracker.hpp"
+#include "spsc_ring.hpp"
+#include "transport.hpp"
+#include "windowed_stats.hpp"
+
+// One received message as handed from a receive thread to the aggregator
+struct ArrivalRecord {
+    int64_t arrivalNs;
+    int64_t sentNs;  // < 0 if the message carried no usable timestamp
+    uint64_t seq;    // tactile::noSequence if it carried none
+    uint16_t streamId;
+};
+
+using ArrivalRing = tactile::SpscRing<ArrivalRecord, 65536>;
+
+// What a scraper sees of one stream. Updated by the thread that records
+// the stream (the aggregator in "--threads" mode), read by the exporter.
+struct StreamMetrics {
+    tactile::MetricCounter& messages;
+    tactile::MetricHistogram& latency;
+    tactile::MetricHistogram& interArrival;
+    tactile::MetricCounter& lost;
+    tactile::MetricCounter& reordered;
+    tactile::MetricCounter& duplicates;
+    tactile::MetricGauge& rate;
+    tactile::MetricGauge& interArrivalP99;
+
+    StreamMetrics(tactile::MetricsRegistry& r, const std::string& stream)
+        : messages(r.counter("tactile_messages_total", "Messages received", label(stream))),
+          latency(r.histogram("tactile_latency_seconds", "Publisher to monitor latency", label(stream))),
+          interArrival(r.histogram("tactile_interarrival_seconds", "Time between arrivals", label(stream))),
+          lost(r.counter("tactile_lost_total", "Sequence numbers that never arrived", label(stream))),
+          reordered(r.counter("tactile_reordered_total", "Messages that arrived after a later one", label(stream))),
+          duplicates(r.counter("tactile_duplicates_total", "Messages that arrived twice", label(stream))),
+          rate(r.gauge("tactile_message_rate", "Messages per second over the last report interval", label(stream))),
+          interArrivalP99(r.gauge("tactile_interarrival_p99_seconds", "Inter-arrival p99 over the last report interval",
+                                  label(stream))) {}
+
+    static std::string label(const std::string& stream) {
+        return "stream=\"" + stream + "\"";
+    }
 };
 
-// Calculate statistics for a vector of values
-IntervalStats calculateStats(const std::deque<double>& values) {
-    IntervalStats stats;
-    stats.count = values.size();
-    
-    if (stats.count == 0) {
-        stats.min = 0;
-        stats.max = 0;
-        stats.avg = 0;
-        stats.stddev = 0;
-        return stats;
-    }
-    
-    stats.min = *std::min_element(values.begin(), values.end());
-    stats.max = *std::max_element(values.begin(), values.end());
-    stats.avg = std::accumulate(values.begin(), values.end(), 0.0) / stats.count;
-    
-    double varSum = 0;
-    for (double val : values) {
-        varSum += (val - stats.avg) * (val - stats.avg);
-    }
-    stats.stddev = std::sqrt(varSum / stats.count);
-    
-    return stats;
+// Everything the monitor reports for one stream. Both modes feed it the same
+// (arrival, sent) pairs in arrival order, so their statistics are identical.
+struct StreamMonitor {
+    uint64_t msgCount = 0;
+    tactile::SlidingWindowStats intervals;  // inter-arrival times, ms
+    tactile::StreamHistograms hist;
+    tactile::SequenceTrackers seq;  // per hand for haptic
+    StreamMetrics metrics;
+    int64_t lastArrivalNs = 0;
+    uint64_t lastReportCount = 0;
+
+    StreamMonitor(size_t maxIntervals, int64_t windowNs, tactile::MetricsRegistry& registry, const std::string& name)
+        : intervals(maxIntervals, windowNs), metrics(registry, name) {}
+
+    void record(const ArrivalRecord& r) {
+        if (msgCount > 0) {
+            intervals.add(tactile::nsToMs(r.arrivalNs - lastArrivalNs), r.arrivalNs);
+            metrics.interArrival.record(r.arrivalNs - lastArrivalNs);
+        }
+        hist.record(r.arrivalNs, r.sentNs);
+        if (r.sentNs >= 0) {
+            metrics.latency.record(r.arrivalNs - r.sentNs);
+        }
+        metrics.messages.add();
+        if (r.seq != tactile::noSequence) {
+            seq.record(r.streamId, r.seq);
+        }
+        lastArrivalNs = r.arrivalNs;
+        msgCount++;
+    }
+
+    // Refreshes what is only worked out once per report
+    void publishReport(double intervalSec) {
+        const tactile::SequenceStats s = seq.total();
+        metrics.lost.set(s.lost);
+        metrics.reordered.set(s.reordered);
+        metrics.duplicates.set(s.duplicates);
+        metrics.rate.set(double(msgCount - lastReportCount) / intervalSec);
+        metrics.interArrivalP99.set(hist.interArrival.window.valueAtPercentile(99) / 1e9);
+        lastReportCount = msgCount;
+    }
+};
+
+// Per-thread receive state for "--threads": each stream gets its own engine
+// and thread, stamps arrivals there and pushes them to the aggregator.
+struct StreamReceiver {
+    std::unique_ptr<ArrivalRing> ring = std::make_unique<ArrivalRing>();
+    std::atomic<uint64_t> ringFullStalls{0};
+    uint64_t allocations = 0;
+
+    void push(const ArrivalRecord& r) {
+        // Never drop: the arrival time is already taken, so waiting for the
+        // aggregator only costs throughput, not accuracy
+        if (!ring->tryPush(r)) {
+            ringFullStalls.fetch_add(1, std::memory_order_relaxed);
+            while (!ring->tryPush(r)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+// Through ContactDecoder, so a relay running "--contact-codec" is rebuilt
+// into samples; a delta that cannot be applied still counts as an arrival
+static ArrivalRecord hapticArrival(int64_t now, const tactile::RecvBuffer& buf, tactile::ContactDecoder& decoder,
+                                   tactile::HapticSample& sample) {
+    if (decoder.decode(buf.data.data(), buf.size, sample) == tactile::ContactReceived::Invalid) {
+        return { now, -1, tactile::noSequence, 0 };
+    }
+    return { now, sample.header.timestampNs, sample.header.seq, sample.header.streamId };
 }
 
-int main() {
+// Splits the haptic latency per hop when the message brought hop frames
+static void recordHops(tactile::HopBreakdown& hops, const ArrivalRecord& r, const tactile::RecvBuffer& buf) {
+    if (r.sentNs >= 0 && buf.hops.count > 0) {
+        hops.record(r.sentNs, buf.hops, r.arrivalNs);
+    }
+}
+
+static ArrivalRecord videoArrival(int64_t now, const tactile::RecvBuffer& buf) {
+    std::string_view text = buf.view();
+    uint64_t seq;
+    if (!tactile::splitTextSequence(text, seq)) {
+        seq = tactile::noSequence;
+    }
+    double sentSeconds;
+    return { now, tactile::parseLeadingDouble(text.data(), text.size(), sentSeconds)
+                      ? tactile::secondsToNs(sentSeconds) : -1, seq, 0 };
+}
+
+int main(int argc, char* argv[]) {
     std::cout << "Starting Advanced Performance Monitoring" << std::endl;
-    
+
+    tactile::Options opts(argc, argv);
+    tactile::WaitStrategy waitStrategy;
+    if (!tactile::setupReceiveThread(opts, waitStrategy)) {
+        return 1;
+    }
+    // Arrival stamps in integer nanoseconds ("--clock tsc" for the cheapest read)
+    const tactile::Clock clock = tactile::clockFromOptions(opts);
+
+    // "--threads" receives each stream on its own thread (optionally pinned
+    // with --haptic-cpu / --video-cpu); --cpu then pins the aggregator
+    const bool threaded = opts.has("--threads");
+
+    // "--transport tcp|ipc|shm" (transport.hpp); must match the publishers
+    tactile::Transport transport;
+    if (!tactile::transportFromOptions(opts, transport)) {
+        return 1;
+    }
+
     // Subscribe to haptic and video streams
     zmq::context_t context(1);
-    
+    const std::string hapticEndpoint = tactile::connectEndpoint(transport, "localhost", 5556);
+    const std::string videoEndpoint = tactile::connectEndpoint(transport, "localhost", 5566);
+
     // Haptic subscriber
-    zmq::socket_t hapticSub(context, zmq::socket_type::sub);
+    tactile::Subscriber hapticSub(context);
     try {
-        hapticSub.connect("tcp://localhost:5556");
-        hapticSub.set(zmq::sockopt::subscribe, "");
-        std::cout << "Connected to haptic stream on port 5556" << std::endl;
-    } catch (const zmq::error_t& e) {
+        hapticSub.connect(hapticEndpoint);
+        std::cout << "Connected to haptic stream on " << hapticEndpoint << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Failed to connect to haptic stream: " << e.what() << std::endl;
         return 1;
     }
-    
+
     // Video subscriber
-    zmq::socket_t videoSub(context, zmq::socket_type::sub);
+    tactile::Subscriber videoSub(context);
     try {
-        videoSub.connect("tcp://localhost:5566");
-        videoSub.set(zmq::sockopt::subscribe, "");
-        std::cout << "Connected to video stream on port 5566" << std::endl;
-    } catch (const zmq::error_t& e) {
+        videoSub.connect(videoEndpoint);
+        std::cout << "Connected to video stream on " << videoEndpoint << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Failed to connect to video stream: " << e.what() << std::endl;
         return 1;
     }
-    
-    // Set up poll items
-    zmq::pollitem_t items[] = {
-        { static_cast<void*>(hapticSub), 0, ZMQ_POLLIN, 0 },
-        { static_cast<void*>(videoSub), 0, ZMQ_POLLIN, 0 }
-    };
-    
-    // Performance metrics
-    int hapticMsgCount = 0;
-    int videoMsgCount = 0;
-    
-    // Interval tracking (sliding window of inter-arrival times)
-    std::deque<double> hapticIntervals;
-    std::deque<double> videoIntervals;
-    const int maxIntervals = 100; // Keep track of last 100 intervals
-    
-    // Last message timestamps
-    auto lastHapticTime = std::chrono::steady_clock::now();
-    auto lastVideoTime = std::chrono::steady_clock::now();
-    bool firstHapticMsg = true;
-    bool firstVideoMsg = true;
-    
-    // Main measurement loop - run for 20 seconds
+
+    // Interval tracking (sliding window of inter-arrival times). "--window N"
+    // keeps the last N intervals; "--window-ms T" keeps those from the last
+    // T ms instead, bounded by --window (default 16384 then).
+    const int64_t windowNs = opts.getInt("--window-ms", 0) * 1000000;
+    const long maxIntervals = opts.getInt("--window", windowNs > 0 ? 16384 : 100);
+    tactile::MetricsRegistry metrics;
+    StreamMonitor haptic(maxIntervals, windowNs, metrics, "haptic");
+    StreamMonitor video(maxIntervals, windowNs, metrics, "video");
+    tactile::MetricGauge& uptime = metrics.gauge("tactile_monitor_uptime_seconds", "Time since the monitor started");
+
+    // Counts allocations made by the receive loop once warmed up
+    tactile::AllocProbe allocProbe;
+    const int warmupMessages = 100;
+
+    // Metrics are scraped / snapshotted from a background thread
+    // (metrics_export.hpp); the receive path only bumps counters
+    tactile::MetricsExporter exporter(metrics);
+    if (!tactile::setupMetricsExport(opts, exporter)) {
+        return 1;
+    }
+
+    // Main measurement loop - 20 seconds by default; "--duration-s 0" keeps
+    // running until SIGINT/SIGTERM. "--report-s" spaces out the status lines.
+    const long durationSec = opts.getInt("--duration-s", 20);
+    const auto reportEvery = std::chrono::seconds(std::max(1L, opts.getInt("--report-s", 1)));
+    tactile::installStopSignals();
     const auto startTime = std::chrono::steady_clock::now();
-    const auto endTime = startTime + std::chrono::seconds(20);
-    
-    std::cout << "\nStarting measurement for 20 seconds...\n";
-    std::cout << std::setw(8) << "Time" 
-              << std::setw(8) << "H.Rate" 
-              << std::setw(8) << "V.Rate" 
-              << std::setw(8) << "H.Avg" 
-              << std::setw(8) << "H.Std" 
-              << std::setw(8) << "V.Avg" 
-              << std::setw(8) << "V.Std" 
+    const auto endTime = durationSec > 0 ? startTime + std::chrono::seconds(durationSec)
+                                         : std::chrono::steady_clock::time_point::max();
+    auto keepRunning = [&](std::chrono::steady_clock::time_point now) {
+        return now < endTime && !tactile::stopRequested();
+    };
+
+    std::cout << "\nStarting measurement over " << tactile::transportName(transport) << " ";
+    if (durationSec > 0) {
+        std::cout << "for " << durationSec << " seconds";
+    } else {
+        std::cout << "until interrupted";
+    }
+    std::cout << " (" << tactile::waitStrategyName(waitStrategy) << " wait, "
+              << (threaded ? "one thread per stream" : "single thread") << ")...\n";
+    std::cout << std::setw(8) << "Time"
+              << std::setw(8) << "H.Rate"
+              << std::setw(8) << "V.Rate"
+              << std::setw(8) << "H.Avg"
+              << std::setw(8) << "H.Std"
+              << std::setw(8) << "V.Avg"
+              << std::setw(8) << "V.Std"
+              << std::setw(8) << "H.p99"
+              << std::setw(8) << "V.p99"
+              << std::setw(8) << "H.Miss"
+              << std::setw(8) << "V.Miss"
               << std::endl;
-    
-    while (std::chrono::steady_clock::now() < endTime) {
-        // Poll with a short timeout
-        zmq::poll(items, 2, std::chrono::milliseconds(1));
-        
-        // Process haptic messages
-        if (items[0].revents & ZMQ_POLLIN) {
-            auto now = std::chrono::steady_clock::now();
-            zmq::message_t msg;
-            hapticSub.recv(msg);
-            hapticMsgCount++;
-            
-            // Calculate inter-arrival time
-            if (!firstHapticMsg) {
-                double interval = std::chrono::duration_cast<std::chrono::microseconds>(
-                    now - lastHapticTime).count() / 1000.0; // ms
-                
-                hapticIntervals.push_back(interval);
-                if (hapticIntervals.size() > maxIntervals) {
-                    hapticIntervals.pop_front();
-                }
-            } else {
-                firstHapticMsg = false;
+
+    auto nextReport = startTime + reportEvery;
+
+    // Prints one status line once a report interval has passed since the last one
+    auto reportIfDue = [&]() {
+        if (std::chrono::steady_clock::now() < nextReport) {
+            return;
+        }
+        double elapsedSec = std::chrono::duration_cast<std::chrono::milliseconds>(
+            nextReport - startTime).count() / 1000.0;
+        nextReport += reportEvery;
+
+        // Calculate current rates
+        double hapticRate = haptic.msgCount / elapsedSec;
+        double videoRate = video.msgCount / elapsedSec;
+
+        // Time windows also shrink while a stream is silent
+        int64_t nowNs = clock.nowNs();
+        haptic.intervals.expire(nowNs);
+        video.intervals.expire(nowNs);
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << std::setw(8) << elapsedSec
+                  << std::setw(8) << hapticRate
+                  << std::setw(8) << videoRate
+                  << std::setw(8) << haptic.intervals.mean()
+                  << std::setw(8) << haptic.intervals.stddev()
+                  << std::setw(8) << video.intervals.mean()
+                  << std::setw(8) << video.intervals.stddev()
+                  << std::setw(8) << haptic.hist.interArrival.window.valueAtPercentile(99) / 1e6
+                  << std::setw(8) << video.hist.interArrival.window.valueAtPercentile(99) / 1e6
+                  << std::setw(8) << haptic.seq.total().lost + haptic.seq.pending()
+                  << std::setw(8) << video.seq.total().lost + video.seq.pending()
+                  << std::endl;
+        const double intervalSec = std::chrono::duration<double>(reportEvery).count();
+        haptic.publishReport(intervalSec);
+        video.publishReport(intervalSec);
+        uptime.set(elapsedSec);
+        haptic.hist.rollWindow();
+        video.hist.rollWindow();
+    };
+
+    uint64_t receiveAllocations = 0;
+    uint64_t ringFullStalls = 0;
+    // Written by whichever thread receives haptic, read after the run
+    tactile::HopBreakdown hapticHops;
+    tactile::ContactDecoder hapticDecoder;
+
+    if (!threaded) {
+        // Both handlers timestamp arrival themselves; the engine drains every
+        // pending message per wakeup
+        tactile::HapticSample sample;
+        tactile::ReceiveEngine engine(waitStrategy);
+        engine.add(hapticSub, [&](const tactile::RecvBuffer& buf) {
+            ArrivalRecord r = hapticArrival(clock.nowNs(), buf, hapticDecoder, sample);
+            haptic.record(r);
+            recordHops(hapticHops, r, buf);
+        });
+        engine.add(videoSub, [&](const tactile::RecvBuffer& buf) {
+            video.record(videoArrival(clock.nowNs(), buf));
+        });
+
+        for (auto now = startTime; keepRunning(now); now = std::chrono::steady_clock::now()) {
+            // Wait no longer than the next status line is due
+            engine.runOnce(std::chrono::ceil<std::chrono::milliseconds>(std::min(nextReport, endTime) - now));
+
+            // Steady state starts once connections and buffers are warmed up
+            if (!allocProbe.isArmed() && haptic.msgCount + video.msgCount >= warmupMessages) {
+                allocProbe.arm();
             }
-            
-            lastHapticTime = now;
+
+            reportIfDue();
         }
-        
-        // Process video messages
-        if (items[1].revents & ZMQ_POLLIN) {
-            auto now = std::chrono::steady_clock::now();
-            zmq::message_t msg;
-            videoSub.recv(msg);
-            videoMsgCount++;
-            
-            // Calculate inter-arrival time
-            if (!firstVideoMsg) {
-                double interval = std::chrono::duration_cast<std::chrono::microseconds>(
-                    now - lastVideoTime).count() / 1000.0; // ms
-                
-                videoIntervals.push_back(interval);
-                if (videoIntervals.size() > maxIntervals) {
-                    videoIntervals.pop_front();
+        receiveAllocations = allocProbe.allocations();
+    } else {
+        StreamReceiver hapticRx;
+        StreamReceiver videoRx;
+        std::atomic<bool> running{true};
+
+        // Each socket is only touched by its own thread from here on
+        auto receiveLoop = [&](tactile::Subscriber& socket, StreamReceiver& rx, int cpu, bool isHaptic) {
+            if (cpu >= 0 && !tactile::pinCurrentThread(cpu)) {
+                std::cerr << "Could not pin receive thread to CPU " << cpu << std::endl;
+            }
+            tactile::HapticSample sample;
+            tactile::AllocProbe probe;
+            int received = 0;
+            tactile::ReceiveEngine engine(waitStrategy);
+            engine.add(socket, [&](const tactile::RecvBuffer& buf) {
+                int64_t now = clock.nowNs();
+                if (isHaptic) {
+                    ArrivalRecord r = hapticArrival(now, buf, hapticDecoder, sample);
+                    rx.push(r);
+                    recordHops(hapticHops, r, buf);
+                } else {
+                    rx.push(videoArrival(now, buf));
                 }
-            } else {
-                firstVideoMsg = false;
+                if (++received == warmupMessages) {
+                    probe.arm();
+                }
+            });
+            while (running.load(std::memory_order_relaxed)) {
+                engine.runOnce(std::chrono::milliseconds(100));
             }
-            
-            lastVideoTime = now;
-        }
-        
-        // Print status every second
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - startTime).count();
-        
-        if (elapsed % 1000 < 10) { // Print approximately once per second
-            double elapsedSec = elapsed / 1000.0;
-            
-            // Calculate current rates
-            double hapticRate = hapticMsgCount / elapsedSec;
-            double videoRate = videoMsgCount / elapsedSec;
-            
-            // Calculate interval statistics
-            IntervalStats hapticStats = calculateStats(hapticIntervals);
-            IntervalStats videoStats = calculateStats(videoIntervals);
-            
-            std::cout << std::fixed << std::setprecision(1);
-            std::cout << std::setw(8) << elapsedSec 
-                      << std::setw(8) << hapticRate 
-                      << std::setw(8) << videoRate
-                      << std::setw(8) << hapticStats.avg
-                      << std::setw(8) << hapticStats.stddev
-                      << std::setw(8) << videoStats.avg
-                      << std::setw(8) << videoStats.stddev
-                      << std::endl;
+            rx.allocations = probe.allocations();
+        };
+
+        std::thread hapticThread(receiveLoop, std::ref(hapticSub), std::ref(hapticRx),
+                                 static_cast<int>(opts.getInt("--haptic-cpu", -1)), true);
+        std::thread videoThread(receiveLoop, std::ref(videoSub), std::ref(videoRx),
+                                static_cast<int>(opts.getInt("--video-cpu", -1)), false);
+
+        // Aggregator: drains both rings, so slow output here never delays
+        // the receive threads' timestamps
+        auto drain = [](ArrivalRing& ring, StreamMonitor& monitor) {
+            size_t handled = 0;
+            ArrivalRecord r;
+            while (ring.tryPop(r)) {
+                monitor.record(r);
+                handled++;
+            }
+            return handled;
+        };
+
+        for (auto now = startTime; keepRunning(now); now = std::chrono::steady_clock::now()) {
+            size_t handled = drain(*hapticRx.ring, haptic) + drain(*videoRx.ring, video);
+            if (handled == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            reportIfDue();
         }
-        
-        // Short sleep to avoid high CPU usage
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        running = false;
+        hapticThread.join();
+        videoThread.join();
+        drain(*hapticRx.ring, haptic);
+        drain(*videoRx.ring, video);
+
+        receiveAllocations = hapticRx.allocations + videoRx.allocations;
+        ringFullStalls = hapticRx.ringFullStalls + videoRx.ringFullStalls;
     }
-    
-    const auto measuredTime = std::chrono::duration_cast<std::chrono::seconds>(
+
+    // Fractional: a run stopped with SIGINT ends between whole seconds
+    const double measuredTime = std::chrono::duration<double>(
         std::chrono::steady_clock::now() - startTime).count();
-    
-    // Calculate final statistics
-    IntervalStats hapticStats = calculateStats(hapticIntervals);
-    IntervalStats videoStats = calculateStats(videoIntervals);
-    
+    exporter.stop();
+
     // Print final summary
     std::cout << "\n========= Performance Summary =========\n";
     std::cout << "Measured over " << measuredTime << " seconds\n\n";
-    
+
     std::cout << "Haptic Messages:\n";
-    std::cout << "  Total Received: " << hapticMsgCount << " messages\n";
-    std::cout << "  Rate: " << (double)hapticMsgCount / measuredTime << " msgs/sec\n";
+    std::cout << "  Total Received: " << haptic.msgCount << " messages\n";
+    std::cout << "  Rate: " << (double)haptic.msgCount / measuredTime << " msgs/sec\n";
     std::cout << "  Inter-arrival Time:\n";
-    std::cout << "    Min: " << hapticStats.min << " ms\n";
-    std::cout << "    Max: " << hapticStats.max << " ms\n";
-    std::cout << "    Avg: " << hapticStats.avg << " ms (expected ~10 ms for 100 Hz)\n";
-    std::cout << "    StdDev: " << hapticStats.stddev << " ms\n\n";
-    
+    std::cout << "    Min: " << haptic.intervals.min() << " ms\n";
+    std::cout << "    Max: " << haptic.intervals.max() << " ms\n";
+    std::cout << "    Avg: " << haptic.intervals.mean() << " ms (expected ~10 ms for 100 Hz)\n";
+    std::cout << "    StdDev: " << haptic.intervals.stddev() << " ms\n";
+    haptic.seq.finish();
+    tactile::printSequenceStats(std::cout, "  ", haptic.seq.total());
+    tactile::printContactStats(std::cout, "  ", hapticDecoder.stats());
+    std::cout << "\n";
+
     std::cout << "Video Messages:\n";
-    std::cout << "  Total Received: " << videoMsgCount << " messages\n";
-    std::cout << "  Rate: " << (double)videoMsgCount / measuredTime << " msgs/sec\n";
+    std::cout << "  Total Received: " << video.msgCount << " messages\n";
+    std::cout << "  Rate: " << (double)video.msgCount / measuredTime << " msgs/sec\n";
     std::cout << "  Inter-arrival Time:\n";
-    std::cout << "    Min: " << videoStats.min << " ms\n";
-    std::cout << "    Max: " << videoStats.max << " ms\n";
-    std::cout << "    Avg: " << videoStats.avg << " ms (expected ~33.3 ms for 30 Hz)\n";
-    std::cout << "    StdDev: " << videoStats.stddev << " ms\n";
-    
+    std::cout << "    Min: " << video.intervals.min() << " ms\n";
+    std::cout << "    Max: " << video.intervals.max() << " ms\n";
+    std::cout << "    Avg: " << video.intervals.mean() << " ms (expected ~33.3 ms for 30 Hz)\n";
+    std::cout << "    StdDev: " << video.intervals.stddev() << " ms\n";
+    video.seq.finish();
+    tactile::printSequenceStats(std::cout, "  ", video.seq.total());
+    std::cout << "\n";
+
+    std::cout << "Percentiles (whole run):\n";
+    tactile::printPercentiles(std::cout, "  Haptic latency      ", haptic.hist.latency.run);
+    tactile::printPercentiles(std::cout, "  Haptic inter-arrival", haptic.hist.interArrival.run);
+    tactile::printPercentiles(std::cout, "  Video latency       ", video.hist.latency.run);
+    tactile::printPercentiles(std::cout, "  Video inter-arrival ", video.hist.interArrival.run);
+    std::cout << "\n";
+
+    if (hapticHops.count() > 0) {
+        std::cout << "Haptic latency budget (per hop, " << hapticHops.count() << " messages):\n";
+        hapticHops.print(std::cout, "  ");
+        std::cout << "\n";
+    }
+
+    // Merge files from several monitors with hist_merge
+    std::string histOut = opts.get("--hist-out", "");
+    if (!histOut.empty()) {
+        std::ofstream out(histOut, std::ios::binary);
+        tactile::writeStreamHistograms(out, "haptic", haptic.hist);
+        tactile::writeStreamHistograms(out, "video", video.hist);
+        std::cout << "Histograms written to " << histOut << "\n";
+    }
+
+    std::cout << "Receive path heap allocations after warm-up: " << receiveAllocations << "\n";
+    if (threaded) {
+        std::cout << "Receive thread stalls on a full ring: " << ringFullStalls << "\n";
+    }
+    if (exporter.enabled()) {
+        std::cout << "Metrics scrapes served: " << exporter.scrapes() << "\n";
+    }
+
     return 0;
 }
@@ -1,91 +1,186 @@
 #include <zmq.hpp>
 #include <iostream>
 #include <string>
-#include <thread>
 #include <chrono>
 #include <iomanip>
+#include <algorithm>
 
-int main() {
+#define TACTILE_ALLOC_COUNTER_IMPL
+#include "alloc_counter.hpp"
+#include "contact_codec.hpp"
+#include "haptic_wire.hpp"
+#include "metrics_export.hpp"
+#include "options.hpp"
+#include "receive_engine.hpp"
+#include "sequence_tracker.hpp"
+#include "transport.hpp"
+
+int main(int argc, char* argv[]) {
     std::cout << "Starting Performance Measurement" << std::endl;
     
+    tactile::Options opts(argc, argv);
+    tactile::WaitStrategy waitStrategy;
+    if (!tactile::setupReceiveThread(opts, waitStrategy)) {
+        return 1;
+    }
+    // "--transport tcp|ipc|shm" (transport.hpp); must match the publishers
+    tactile::Transport transport;
+    if (!tactile::transportFromOptions(opts, transport)) {
+        return 1;
+    }
+    
     // Subscribe to haptic and video streams
     zmq::context_t context(1);
+    const std::string hapticEndpoint = tactile::connectEndpoint(transport, "localhost", 5556);
+    const std::string videoEndpoint = tactile::connectEndpoint(transport, "localhost", 5566);
     
     // Haptic subscriber
-    zmq::socket_t hapticSub(context, zmq::socket_type::sub);
+    tactile::Subscriber hapticSub(context);
     try {
-        hapticSub.connect("tcp://localhost:5556");
-        hapticSub.set(zmq::sockopt::subscribe, "");
-        std::cout << "Connected to haptic stream on port 5556" << std::endl;
-    } catch (const zmq::error_t& e) {
+        hapticSub.connect(hapticEndpoint);
+        std::cout << "Connected to haptic stream on " << hapticEndpoint << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Failed to connect to haptic stream: " << e.what() << std::endl;
         return 1;
     }
     
     // Video subscriber
-    zmq::socket_t videoSub(context, zmq::socket_type::sub);
+    tactile::Subscriber videoSub(context);
     try {
-        videoSub.connect("tcp://localhost:5566");
-        videoSub.set(zmq::sockopt::subscribe, "");
-        std::cout << "Connected to video stream on port 5566" << std::endl;
-    } catch (const zmq::error_t& e) {
+        videoSub.connect(videoEndpoint);
+        std::cout << "Connected to video stream on " << videoEndpoint << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Failed to connect to video stream: " << e.what() << std::endl;
         return 1;
     }
     
-    // Set up poll items
-    zmq::pollitem_t items[] = {
-        { static_cast<void*>(hapticSub), 0, ZMQ_POLLIN, 0 },
-        { static_cast<void*>(videoSub), 0, ZMQ_POLLIN, 0 }
-    };
-    
     // Performance metrics
-    int hapticMsgCount = 0;
-    int videoMsgCount = 0;
+    uint64_t hapticMsgCount = 0;
+    uint64_t videoMsgCount = 0;
+    
+    // Loss, reordering and duplicates from the publishers' sequence numbers
+    // (per hand for haptic); "Missing" counts gaps that may still fill in
+    tactile::SequenceTrackers hapticSeq;
+    tactile::SequenceTrackers videoSeq;
+    uint64_t unsequenced = 0;
+    
+    // Counts allocations made by the receive loop once warmed up
+    tactile::AllocProbe allocProbe;
+    const int warmupMessages = 100;
+    
+    // The same numbers for a scraper (--metrics-port / --metrics-socket /
+    // --snapshot-out, see metrics_export.hpp). Message counters are bumped
+    // on the receive path; sequence totals are refreshed once per report.
+    tactile::MetricsRegistry metrics;
+    tactile::MetricCounter& hapticMessages =
+        metrics.counter("tactile_messages_total", "Messages received", "stream=\"haptic\"");
+    tactile::MetricCounter& videoMessages =
+        metrics.counter("tactile_messages_total", "Messages received", "stream=\"video\"");
+    tactile::MetricCounter& hapticLost =
+        metrics.counter("tactile_lost_total", "Sequence numbers that never arrived", "stream=\"haptic\"");
+    tactile::MetricCounter& videoLost =
+        metrics.counter("tactile_lost_total", "Sequence numbers that never arrived", "stream=\"video\"");
+    tactile::MetricCounter& hapticReordered =
+        metrics.counter("tactile_reordered_total", "Messages that arrived after a later one", "stream=\"haptic\"");
+    tactile::MetricCounter& videoReordered =
+        metrics.counter("tactile_reordered_total", "Messages that arrived after a later one", "stream=\"video\"");
+    tactile::MetricCounter& unsequencedMessages =
+        metrics.counter("tactile_unsequenced_total", "Messages without a sequence number");
+    tactile::MetricGauge& hapticStreams = metrics.gauge("tactile_haptic_streams", "Haptic streams (hands) seen");
+    tactile::MetricsExporter exporter(metrics);
+    if (!tactile::setupMetricsExport(opts, exporter)) {
+        return 1;
+    }
     
-    // Main measurement loop - run for 10 seconds
+    // Main measurement loop - 10 seconds by default; "--duration-s 0" keeps
+    // running until SIGINT/SIGTERM
+    const long durationSec = opts.getInt("--duration-s", 10);
+    tactile::installStopSignals();
     const auto startTime = std::chrono::steady_clock::now();
-    const auto endTime = startTime + std::chrono::seconds(10);
+    const auto endTime = durationSec > 0 ? startTime + std::chrono::seconds(durationSec)
+                                         : std::chrono::steady_clock::time_point::max();
     
-    std::cout << "\nStarting measurement for 10 seconds...\n";
-    std::cout << std::setw(15) << "Time (s)" << std::setw(15) << "Haptic Msgs" << std::setw(15) << "Video Msgs" << std::endl;
+    std::cout << "\nStarting measurement over " << tactile::transportName(transport) << " ";
+    if (durationSec > 0) {
+        std::cout << "for " << durationSec << " seconds";
+    } else {
+        std::cout << "until interrupted";
+    }
+    std::cout << " (" << tactile::waitStrategyName(waitStrategy) << " wait)...\n";
+    std::cout << std::setw(15) << "Time (s)" << std::setw(15) << "Haptic Msgs" << std::setw(15) << "Video Msgs"
+              << std::setw(15) << "Haptic Miss" << std::setw(15) << "Video Miss" << std::endl;
     
-    while (std::chrono::steady_clock::now() < endTime) {
-        // Poll with a short timeout
-        zmq::poll(items, 2, std::chrono::milliseconds(1));
-        
-        // Process haptic messages
-        if (items[0].revents & ZMQ_POLLIN) {
-            zmq::message_t msg;
-            hapticSub.recv(msg);
-            hapticMsgCount++;
+    // Only the sequence numbers are read from the contents. The decoder
+    // reads "--contact-codec" relay output too: the relay numbers deltas and
+    // heartbeats, so skipping them would count as loss
+    tactile::HapticSample sample;
+    tactile::ContactDecoder hapticDecoder;
+    tactile::ReceiveEngine engine(waitStrategy);
+    engine.add(hapticSub, [&](const tactile::RecvBuffer& buf) {
+        hapticMsgCount++;
+        hapticMessages.add();
+        if (hapticDecoder.decode(buf.data.data(), buf.size, sample) != tactile::ContactReceived::Invalid &&
+            sample.header.seq != tactile::noSequence) {
+            hapticSeq.record(sample.header.streamId, sample.header.seq);
+        } else {
+            unsequenced++;
+            unsequencedMessages.add();
+        }
+    });
+    engine.add(videoSub, [&](const tactile::RecvBuffer& buf) {
+        videoMsgCount++;
+        videoMessages.add();
+        std::string_view text = buf.view();
+        uint64_t seq;
+        if (tactile::splitTextSequence(text, seq)) {
+            videoSeq.record(0, seq);
+        } else {
+            unsequenced++;
+            unsequencedMessages.add();
         }
+    });
+    
+    auto nextReport = startTime + std::chrono::seconds(1);
+    
+    for (auto now = startTime; now < endTime && !tactile::stopRequested(); now = std::chrono::steady_clock::now()) {
+        // Wait no longer than the next status line is due
+        engine.runOnce(std::chrono::ceil<std::chrono::milliseconds>(std::min(nextReport, endTime) - now));
         
-        // Process video messages
-        if (items[1].revents & ZMQ_POLLIN) {
-            zmq::message_t msg;
-            videoSub.recv(msg);
-            videoMsgCount++;
+        // Steady state starts once connections and buffers are warmed up
+        if (!allocProbe.isArmed() && hapticMsgCount + videoMsgCount >= warmupMessages) {
+            allocProbe.arm();
         }
         
         // Print status every second
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - startTime).count();
-        
-        if (elapsed % 1000 < 10) { // Print approximately once per second
-            double elapsedSec = elapsed / 1000.0;
+        if (std::chrono::steady_clock::now() >= nextReport) {
+            double elapsedSec = std::chrono::duration_cast<std::chrono::milliseconds>(
+                nextReport - startTime).count() / 1000.0;
+            nextReport += std::chrono::seconds(1);
             std::cout << std::fixed << std::setprecision(1);
             std::cout << std::setw(15) << elapsedSec 
                       << std::setw(15) << hapticMsgCount 
-                      << std::setw(15) << videoMsgCount << std::endl;
+                      << std::setw(15) << videoMsgCount
+                      << std::setw(15) << hapticSeq.total().lost + hapticSeq.pending()
+                      << std::setw(15) << videoSeq.total().lost + videoSeq.pending() << std::endl;
+            
+            const tactile::SequenceStats hapticStats = hapticSeq.total();
+            const tactile::SequenceStats videoStats = videoSeq.total();
+            hapticLost.set(hapticStats.lost);
+            videoLost.set(videoStats.lost);
+            hapticReordered.set(hapticStats.reordered);
+            videoReordered.set(videoStats.reordered);
+            hapticStreams.set(double(hapticSeq.streamCount()));
         }
-        
-        // Short sleep to avoid high CPU usage
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
     
-    const auto measuredTime = std::chrono::duration_cast<std::chrono::seconds>(
+    // Fractional: a run stopped with SIGINT ends between whole seconds
+    const double measuredTime = std::chrono::duration<double>(
         std::chrono::steady_clock::now() - startTime).count();
+    exporter.stop();
+    
+    // Gaps still open at the end are losses now
+    hapticSeq.finish();
+    videoSeq.finish();
     
     // Print final summary
     std::cout << "\n========= Performance Summary =========\n";
@@ -93,11 +188,23 @@ int main() {
     
     std::cout << "Haptic Messages:\n";
     std::cout << "  Total Received: " << hapticMsgCount << " messages\n";
-    std::cout << "  Rate: " << (double)hapticMsgCount / measuredTime << " msgs/sec\n\n";
+    std::cout << "  Rate: " << (double)hapticMsgCount / measuredTime << " msgs/sec\n";
+    std::cout << "  Streams: " << hapticSeq.streamCount() << "\n";
+    tactile::printSequenceStats(std::cout, "  ", hapticSeq.total());
+    tactile::printContactStats(std::cout, "  ", hapticDecoder.stats());
+    std::cout << "\n";
     
     std::cout << "Video Messages:\n";
     std::cout << "  Total Received: " << videoMsgCount << " messages\n";
     std::cout << "  Rate: " << (double)videoMsgCount / measuredTime << " msgs/sec\n";
+    tactile::printSequenceStats(std::cout, "  ", videoSeq.total());
+    std::cout << "\n";
+    
+    if (unsequenced) {
+        std::cout << "Messages without a sequence number: " << unsequenced << "\n";
+    }
+    
+    std::cout << "Receive path heap allocations after warm-up: " << allocProbe.allocations() << "\n";
     
     return 0;
 }
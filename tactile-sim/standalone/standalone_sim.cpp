@@ -1,88 +1,183 @@
 #include <zmq.hpp>
 #include <iostream>
 #include <string>
-#include <thread>
 #include <chrono>
+#include <fstream>
+#include <cstdio>
 
-int main() {
+#define TACTILE_ALLOC_COUNTER_IMPL
+#include "alloc_counter.hpp"
+#include "async_log.hpp"
+#include "clock.hpp"
+#include "contact_codec.hpp"
+#include "haptic_wire.hpp"
+#include "hdr_histogram.hpp"
+#include "options.hpp"
+#include "receive_engine.hpp"
+#include "sequence_tracker.hpp"
+#include "transport.hpp"
+
+// Log formatters, run on the logger thread. %g matches the default
+// std::cout formatting these lines used to have.
+static int formatHaptic(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "Standalone [%g]: Received haptic timestamp %g, latency = %g ms",
+                         a.d[0], a.d[1], a.d[2]);
+}
+
+static int formatVideo(char* out, size_t size, const tactile::LogArgs& a) {
+    return std::snprintf(out, size, "Standalone [%g]: Received video timestamp %g, latency = %g ms",
+                         a.d[0], a.d[1], a.d[2]);
+}
+
+static int formatParseError(char* out, size_t size, const tactile::LogArgs& a) {
+    std::string_view text = a.textView();
+    return std::snprintf(out, size, "Error parsing %s data: %.*s", a.i[0] ? "video" : "haptic",
+                         static_cast<int>(text.size()), text.data());
+}
+
+int main(int argc, char* argv[]) {
     std::cout << "Starting ZMQ subscriber..." << std::endl;
     
+    tactile::Options opts(argc, argv);
+    tactile::WaitStrategy waitStrategy;
+    if (!tactile::setupReceiveThread(opts, waitStrategy)) {
+        return 1;
+    }
+    // Receive time in ns; "--epoch shared" when publishers stamp absolute time
+    tactile::Clock clock = tactile::clockFromOptions(opts);
+    // Per-message lines are formatted and written off the receive thread
+    tactile::AsyncLogger log(tactile::logLevelFromOptions(opts));
+    // "--transport tcp|ipc|shm" (transport.hpp); must match the publishers
+    tactile::Transport transport;
+    if (!tactile::transportFromOptions(opts, transport)) {
+        return 1;
+    }
+    
     // Subscribe to VM2 (haptic)
     zmq::context_t context(1);
-    zmq::socket_t hapticSub(context, zmq::socket_type::sub);
+    const std::string hapticEndpoint = tactile::connectEndpoint(transport, "localhost", 5556);
+    const std::string videoEndpoint = tactile::connectEndpoint(transport, "localhost", 5566);
+    tactile::Subscriber hapticSub(context);
     
     try {
-        hapticSub.connect("tcp://localhost:5556");
-        hapticSub.set(zmq::sockopt::subscribe, "");
-        std::cout << "Connected to haptic stream on port 5556" << std::endl;
-    } catch (const zmq::error_t& e) {
+        hapticSub.connect(hapticEndpoint);
+        std::cout << "Connected to haptic stream on " << hapticEndpoint << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Failed to connect to haptic stream: " << e.what() << std::endl;
         return 1;
     }
     
     // Subscribe to VM3 (video)
-    zmq::socket_t videoSub(context, zmq::socket_type::sub);
+    tactile::Subscriber videoSub(context);
     
     try {
-        videoSub.connect("tcp://localhost:5566");
-        videoSub.set(zmq::sockopt::subscribe, "");
-        std::cout << "Connected to video stream on port 5566" << std::endl;
-    } catch (const zmq::error_t& e) {
+        videoSub.connect(videoEndpoint);
+        std::cout << "Connected to video stream on " << videoEndpoint << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Failed to connect to video stream: " << e.what() << std::endl;
         return 1;
     }
     
-    zmq::pollitem_t items[] = {
-        { static_cast<void*>(hapticSub), 0, ZMQ_POLLIN, 0 },
-        { static_cast<void*>(videoSub), 0, ZMQ_POLLIN, 0 }
-    };
+    // Reused for every message so the loop does not allocate
+    tactile::HapticSample sample;
+    tactile::AllocProbe allocProbe;
+    tactile::StreamHistograms hapticHist;
+    tactile::StreamHistograms videoHist;
+    tactile::SequenceTrackers hapticSeq;  // per hand
+    tactile::SequenceTrackers videoSeq;
+    tactile::HopBreakdown hapticHops;  // when the relay sends hop frames
+    tactile::ContactDecoder hapticDecoder;  // rebuilds "--contact-codec" relay output
+    int messageCount = 0;
+    const int warmupMessages = 100;
     
     const auto startTime = std::chrono::steady_clock::now();
+    const auto endTime = startTime + std::chrono::seconds(30);
     
-    for (int i = 0; i < 3000; i++) { // Run for ~30 seconds
-        zmq::poll(items, 2, std::chrono::milliseconds(10));
-        
-        // Current time in seconds since start
-        const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - startTime).count() / 1000.0;
+    tactile::ReceiveEngine engine(waitStrategy);
+    engine.add(hapticSub, [&](const tactile::RecvBuffer& buf) {
+        const int64_t nowNs = clock.nowNs();
+        messageCount++;
         
-        // Check haptic socket
-        if (items[0].revents & ZMQ_POLLIN) {
-            zmq::message_t msg;
-            hapticSub.recv(msg);
-            std::string data = msg.to_string();
-            
-            try {
-                double timestamp = std::stod(data);
-                std::cout << "Standalone [" << now << "]: Received haptic timestamp " 
-                          << timestamp << ", latency = " << (now - timestamp) * 1000 
-                          << " ms" << std::endl;
-            } catch (const std::exception& e) {
-                std::cerr << "Error parsing haptic data: " << data << " - " << e.what() << std::endl;
+        if (hapticDecoder.decode(buf.data.data(), buf.size, sample) != tactile::ContactReceived::Invalid) {
+            int64_t latencyNs = nowNs - sample.header.timestampNs;
+            hapticHist.record(nowNs, sample.header.timestampNs);
+            if (sample.header.seq != tactile::noSequence) {
+                hapticSeq.record(sample.header.streamId, sample.header.seq);
+            }
+            if (buf.hops.count > 0) {
+                hapticHops.record(sample.header.timestampNs, buf.hops, nowNs);
             }
+            log.log(tactile::LogLevel::Info, formatHaptic, [&](tactile::LogArgs& a) {
+                a.d[0] = nowNs / 1e9;
+                a.d[1] = sample.header.timestampNs / 1e9;
+                a.d[2] = tactile::nsToMs(latencyNs);
+            });
+        } else {
+            log.log(tactile::LogLevel::Warn, formatParseError, [&](tactile::LogArgs& a) {
+                a.i[0] = 0;
+                a.setText(buf.view());
+            });
+        }
+    });
+    engine.add(videoSub, [&](const tactile::RecvBuffer& buf) {
+        const int64_t nowNs = clock.nowNs();
+        messageCount++;
+        double timestamp;
+        std::string_view text = buf.view();
+        uint64_t seq;
+        if (tactile::splitTextSequence(text, seq)) {
+            videoSeq.record(0, seq);
         }
         
-        // Check video socket
-        if (items[1].revents & ZMQ_POLLIN) {
-            zmq::message_t msg;
-            videoSub.recv(msg);
-            std::string data = msg.to_string();
-            
-            try {
-                // Parse timestamp from "timestamp,bitrate"
-                size_t commaPos = data.find(',');
-                if (commaPos != std::string::npos) {
-                    double timestamp = std::stod(data.substr(0, commaPos));
-                    std::cout << "Standalone [" << now << "]: Received video timestamp " 
-                              << timestamp << ", latency = " << (now - timestamp) * 1000 
-                              << " ms" << std::endl;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error parsing video data: " << data << " - " << e.what() << std::endl;
-            }
+        // Parse timestamp from "timestamp,bitrate#seq" in place
+        if (tactile::parseLeadingDouble(text.data(), text.size(), timestamp)) {
+            int64_t latencyNs = nowNs - tactile::secondsToNs(timestamp);
+            videoHist.record(nowNs, tactile::secondsToNs(timestamp));
+            log.log(tactile::LogLevel::Info, formatVideo, [&](tactile::LogArgs& a) {
+                a.d[0] = nowNs / 1e9;
+                a.d[1] = timestamp;
+                a.d[2] = tactile::nsToMs(latencyNs);
+            });
+        } else {
+            log.log(tactile::LogLevel::Warn, formatParseError, [&](tactile::LogArgs& a) {
+                a.i[0] = 1;
+                a.setText(buf.view());
+            });
         }
+    });
+    
+    // Run for 30 seconds
+    for (auto now = startTime; now < endTime; now = std::chrono::steady_clock::now()) {
+        engine.runOnce(std::chrono::ceil<std::chrono::milliseconds>(endTime - now));
         
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (!allocProbe.isArmed() && messageCount >= warmupMessages) {
+            allocProbe.arm();
+        }
+    }
+    
+    log.flush();
+    std::cout << "\n=== Final Summary ===" << std::endl;
+    tactile::printPercentiles(std::cout, "Haptic latency      ", hapticHist.latency.run);
+    tactile::printPercentiles(std::cout, "Haptic inter-arrival", hapticHist.interArrival.run);
+    tactile::printPercentiles(std::cout, "Video latency       ", videoHist.latency.run);
+    tactile::printPercentiles(std::cout, "Video inter-arrival ", videoHist.interArrival.run);
+    hapticSeq.finish();
+    videoSeq.finish();
+    tactile::printSequenceStats(std::cout, "Haptic ", hapticSeq.total());
+    tactile::printSequenceStats(std::cout, "Video ", videoSeq.total());
+    tactile::printContactStats(std::cout, "Haptic ", hapticDecoder.stats());
+    if (hapticHops.count() > 0) {
+        std::cout << "Haptic latency budget (per hop):" << std::endl;
+        hapticHops.print(std::cout, "  ");
+    }
+    std::cout << "Receive path heap allocations after warm-up: " << allocProbe.allocations() << std::endl;
+    std::cout << "Log records dropped: " << log.dropped() << std::endl;
+    
+    std::string histOut = opts.get("--hist-out", "");
+    if (!histOut.empty()) {
+        std::ofstream out(histOut, std::ios::binary);
+        tactile::writeStreamHistograms(out, "haptic", hapticHist);
+        tactile::writeStreamHistograms(out, "video", videoHist);
     }
     
     return 0;
@@ -20,12 +20,16 @@ def main():
     time.sleep(0.2)  # allow subscribers to connect
 
     interval = 1.0 / args.hz
+    seq = {}  # next sequence number per hand_id, continued across loops
     while True:
         with open(filepath, newline="") as f:
             reader = csv.reader(f)
             next(reader, None)  # skip header
             for row in reader:
-                line = ",".join(row)
+                hand = row[1] if len(row) > 1 else ""
+                n = seq.get(hand, 0)
+                seq[hand] = n + 1
+                line = ",".join(row) + f"#{n}"
                 print(f"[stream_haptic] → {line}", flush=True)
                 pub.send_string(line)
                 time.sleep(interval)
@@ -20,12 +20,14 @@ def main():
     time.sleep(0.2)
 
     interval = 1.0 / args.fps
+    seq = 0  # continued across loops
     while True:
         with open(filepath, newline="") as f:
             reader = csv.reader(f)
             next(reader, None)
             for row in reader:
-                line = ",".join(row)
+                line = ",".join(row) + f"#{seq}"
+                seq += 1
                 print(f"[stream_video] → {line}", flush=True)
                 pub.send_string(line)
                 time.sleep(interval)